@@ -0,0 +1,126 @@
+/*
+  AdcSampler.cpp - Interrupt driven acquisition of two analog channels with oversampling.
+
+  Licensed under "MIT" License.
+*/
+#include "AdcSampler.h"
+
+#include "Arduino.h"
+
+#define ADC_SAMPLER_MUX_MASK 0x0F      // MUX3..0 of ADMUX
+#define ADC_SAMPLER_TRIGGER bit(ADTS2) // Auto trigger source: Timer0 overflow
+
+uint8_t AdcSampler::channels[ADC_SAMPLER_CHANNELS];
+uint16_t AdcSampler::lastMeans[ADC_SAMPLER_CHANNELS];
+AdcBufferType AdcSampler::buffers[2];
+volatile uint8_t AdcSampler::active = 0;
+volatile unsigned long AdcSampler::conversions = 0;
+volatile unsigned long AdcSampler::dropped = 0;
+bool AdcSampler::dropNext = false;
+
+// PUBLIC
+
+/*
+ * Start the sampling of two analog pins. A first reading of both by analogRead() is the mean,
+ * until the interrupt delivered conversions of both.
+ * @param pin0 First analog pin (A0 ... A5)
+ * @param pin1 Second analog pin (A0 ... A5)
+ */
+void AdcSampler::begin(uint8_t pin0, uint8_t pin1) {
+    uint8_t pins[ADC_SAMPLER_CHANNELS] = {pin0, pin1};
+    for (uint8_t i = 0; i < ADC_SAMPLER_CHANNELS; i++) {
+        channels[i] = pins[i] - A0;
+        lastMeans[i] = analogRead(pins[i]) << ADC_SAMPLER_SHIFT;
+    }
+
+    noInterrupts();
+    memset(buffers, 0, sizeof(buffers));
+    active = 0;
+    dropNext = false;
+    ADMUX = bit(REFS0) | channels[0];  // AVcc reference (like analogRead)
+    ADCSRB = ADC_SAMPLER_TRIGGER;
+    ADCSRA = bit(ADEN) | bit(ADATE) | bit(ADIE) | bit(ADIF) | bit(ADPS2) | bit(ADPS1) | bit(ADPS0);  // 125 kHz ADC clock
+    interrupts();
+}
+
+/*
+ * Get the means of both channels since the last call. Takes constant time: the buffer of the
+ * interrupt is swapped and the full one is evaluated.
+ * @param means Means of the channels in 1/16 LSB (the last ones for a channel without conversions)
+ * @return true, if both channels had new conversions
+ */
+bool AdcSampler::collect(uint16_t *means) {
+    noInterrupts();
+    uint8_t full = active;
+    active = full ^ 1;
+    interrupts();
+
+    AdcBufferType &buffer = buffers[full];
+    bool updated = true;
+    for (uint8_t i = 0; i < ADC_SAMPLER_CHANNELS; i++) {
+        if (buffer.count[i] > 0) {
+            lastMeans[i] = (buffer.sum[i] << ADC_SAMPLER_SHIFT) / buffer.count[i];
+        } else {
+            updated = false;
+        }
+        means[i] = lastMeans[i];
+        buffer.sum[i] = 0;
+        buffer.count[i] = 0;
+    }
+    return updated;
+}
+
+/*
+ * Take the result of a conversion and select the other channel for the next one.
+ * Called by the ADC interrupt vector.
+ */
+void AdcSampler::handle(void) {
+    uint8_t low = ADCL;  // ADCL first, it locks ADCH
+    uint16_t value = low | ((uint16_t)ADCH << 8);
+    uint8_t mux = ADMUX;
+    uint8_t channel = (mux & ADC_SAMPLER_MUX_MASK) == channels[0] ? 0 : 1;
+    ADMUX = (mux & ~ADC_SAMPLER_MUX_MASK) | channels[channel ^ 1];
+    bool drop = dropNext;
+    // A conversion running after the write started before or with it: its channel is unknown
+    dropNext = ADCSRA & bit(ADSC);
+
+    conversions++;
+    if (drop) {
+        dropped++;
+        return;
+    }
+    AdcBufferType &buffer = buffers[active];
+    if (buffer.count[channel] < ADC_SAMPLER_MAX_COUNT) {
+        buffer.sum[channel] += value;
+        buffer.count[channel]++;
+    }
+}
+
+/*
+ * Get the number of conversions since begin().
+ */
+unsigned long AdcSampler::getConversions(void) {
+    noInterrupts();
+    unsigned long count = conversions;
+    interrupts();
+    return count;
+}
+
+/*
+ * Get the number of conversions since begin(), which were dropped, because their channel was
+ * unknown after a delayed interrupt.
+ */
+unsigned long AdcSampler::getDropped(void) {
+    noInterrupts();
+    unsigned long count = dropped;
+    interrupts();
+    return count;
+}
+
+// INTERRUPT VECTORS
+
+#ifdef __AVR__
+ISR(ADC_vect) {
+    AdcSampler::handle();
+}
+#endif
@@ -0,0 +1,55 @@
+/*
+  AdcSampler.h - Interrupt driven acquisition of two analog channels with oversampling.
+  The ADC converts in auto trigger mode at every overflow of Timer0 (976 Hz, the timer of
+  millis()), so it runs without the CPU and the idle sleep keeps its wake up rate. The ADC
+  interrupt alternates between the two channels (488 conversions per channel and second)
+  and adds every result to the sums of a buffer. collect() swaps the double buffer and
+  returns the means since the last call in 1/16 LSB, in constant time and without waiting
+  for a conversion. The mean over all conversions of a period follows a cycling load (e.g.
+  a compressor fridge), which single readings would alias.
+
+  The channel of a result is the one selected by ADMUX: the next conversion starts only at
+  the next trigger (1 ms later), long after the interrupt selected the other channel. A
+  conversion latches ADMUX at its start, so an interrupt, which was delayed past the next
+  trigger (e.g. by the blocking DHT read), can't select the channel of the running one any
+  more: its result may belong to either channel and is dropped (ADSC set after the write of
+  ADMUX). Results, which were overwritten before the delayed interrupt, are lost.
+
+  analogRead() must not be used for other pins, while the sampler runs.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef ADCSAMPLER_H
+#define ADCSAMPLER_H
+
+#include "Arduino.h"
+
+#define ADC_SAMPLER_CHANNELS 2       // Number of sampled channels
+#define ADC_SAMPLER_SHIFT 4          // Fraction bits of the means (1/16 LSB)
+#define ADC_SAMPLER_MAX_COUNT 4096   // Conversions per channel and buffer, the later ones are dropped (8 s)
+
+struct AdcBufferType {
+    uint32_t sum[ADC_SAMPLER_CHANNELS];    // Sum of the conversions per channel
+    uint16_t count[ADC_SAMPLER_CHANNELS];  // Number of conversions per channel
+};
+
+class AdcSampler {
+   public:
+    static void begin(uint8_t pin0, uint8_t pin1);
+    static bool collect(uint16_t *means);
+    static void handle(void);
+    static unsigned long getConversions(void);
+    static unsigned long getDropped(void);
+
+   private:
+    static uint8_t channels[ADC_SAMPLER_CHANNELS];        // MUX value of the channels
+    static uint16_t lastMeans[ADC_SAMPLER_CHANNELS];      // Means of the last collect() in 1/16 LSB
+    static AdcBufferType buffers[2];
+    static volatile uint8_t active;                       // Buffer filled by the interrupt
+    static volatile unsigned long conversions;            // Conversions since begin()
+    static volatile unsigned long dropped;                // Conversions of an unknown channel since begin()
+    static bool dropNext;                                 // The next result is of an unknown channel
+};
+
+#endif
@@ -34,7 +34,7 @@
         - XCL
         - XDA
         - AD0 -> VCC 3.3V (high for different I2C ID active)
-        - INT
+        - INT (optional, FIFO overflow interrupt)
     - Real time clock module RTC DS3231 (3.3V I2C)
         - GND (brown)
         - VCC 3.3V (red)
@@ -82,8 +82,8 @@
          Vin
           A0 <-> Analog voltage sensor (green)
           A1 <-> Analog current sensor (blue)
-          A2
-          A3
+          A2 <-> RTC INT/SQW (optional, hourly alarm interrupt)
+          A3 <-> MPU INT (optional, FIFO overflow interrupt)
     (SDA) A4 <-> Display I2C data (green)
     (SCL) A5 <-> Display I2C clock (blue)
 
@@ -93,8 +93,8 @@
          GND
           13
           12
-    (PWM) 11
-    (PWM) 10
+    (PWM) 11 <-> DHT22 data fridge (optional: DHT_FRIDGE)
+    (PWM) 10 <-> DHT22 data outside (optional: DHT_OUTSIDE)
     (PWM)  9 <-> LED greywater full front (blue)
            8 <-> LED freshwater empty back (red)
            7 <-> DHT11 data (red)
@@ -112,17 +112,48 @@
 #include "DS3231_minimal.h"   // Library: Real time device (minimal Version by me)
 #include "MPU6050_minimal.h"  // Library: MPU accelerometer & gyrosope (minimal Version by me)
 #include "Rotary.h"           // Library: Encoder https://github.com/buxtronix/arduino/tree/master/libraries/Rotary
-#include "dht_nonblocking.h"  // Library: DHT sensor
-#include "display.h"          // Display based on lcdgfx library https://github.com/lexus2k/lcdgfx
-#include "LookupTable1D.h"    // 1D lookup Class to interpolate data
+#include "dht_static.h"       // Library: DHT sensor (non-blocking, specialized at compile time)
+#include "DHTManager.h"       // Staggered reads and history of all DHT sensors
+#include "Display.h"          // Display based on lcdgfx library https://github.com/lexus2k/lcdgfx
+#include "LookupTable.h"      // Lookup tables built at compile time
+#include "Scheduler.h"        // Cooperative task scheduler for the main loop
+#include "Profiler.h"         // Runtime statistics of the main loop stages
+#include "StackMonitor.h"     // High-water mark of the stack of the DHT read
+#include "SoftwareClock.h"    // Wall clock disciplined by the RTC device
+#include "PinChangeInterrupt.h" // Shared pin change interrupt dispatcher
+#include "PowerSaver.h"       // Sleep between tasks in standby
+#include "SensorTrace.h"      // Binary trace of the raw sensor inputs
+#include "TwiQueue.h"         // Non-blocking I2C transactions of the MPU and RTC
+#include "TiltFilter.h"       // Fusion of the gyroscope and accelerometer tilt
+#include "AdcSampler.h"       // Oversampled voltage and current by the ADC interrupt
+#include "BatteryState.h"     // State of charge by coulomb counting
+#include "FixedPoint.h"       // Scaled integer arithmetic of the DC path
+#include "EepromStore.h"      // Settings in the EEPROM with version and CRC
+#include "Wire.h"             // Library: blocking I2C transactions (setup, display)
 
 // ---------------------- Settings ----------------------
 // #define ROTARY_INTERRUPT      // active: interrupt mode of rotary switch; not active: polling mode
+// #define RTC_INTERRUPT         // active: hourly alarm by the RTC INT/SQW pin (RTC_INT_PIN wired); not active: polling mode
+// #define MPU_FIFO              // active: MPU samples at MPU_FIFO_RATE into its FIFO, averaged per sensor period (MPU_INT_PIN wired); not active: one MPU reading per sensor period
+// #define DHT_INTERRUPT         // active: DHT bits decoded from the edges by the pin change interrupt (interrupts stay enabled); not active: busy loops with interrupts disabled for ~5 ms
+// #define DHT_OUTSIDE           // active: second DHT sensor outside (DHT_OUTSIDE_PIN); not active: inside sensor only
+// #define DHT_FRIDGE            // active: DHT sensor in the fridge (DHT_FRIDGE_PIN); not active: no fridge sensor
+// #define TILT_KALMAN           // active: tilt fusion by a Kalman filter, which adapts to disturbances; not active: complementary filter
 #define RTC_RESET_TIME false  // true: set time for RTC.
 
 // --------------------- Debug Mode ---------------------
 // #define DEBUG    // switch to (de)activate serial debug output
 // #define PLOTTER  // switch to (de)activate serial plotter output
+// #define PROFILER // switch to (de)activate runtime statistics of the loop stages and the stack of the DHT read (send 'p' to print, 'r' to reset)
+                    // with DEBUG, PLOTTER or PROFILER: send 'i' to print the I2C error counters
+// #define TRACE    // switch to (de)activate the binary trace of the raw sensor inputs (replay by simulator/replay.cpp)
+// #define I2C_BENCHMARK // switch to (de)activate the I2C benchmark at startup (times of MPU, RTC and display at 100 and 400 kHz)
+// #define TILT_BENCHMARK // switch to (de)activate the tilt benchmark at startup (CPU cycles of the fixed-point and the float tilt)
+// #define DC_BENCHMARK   // switch to (de)activate the DC benchmark at startup (CPU cycles of the fixed-point and the float DC processing)
+
+#if defined(TRACE) && (defined(DEBUG) || defined(PLOTTER) || defined(PROFILER) || defined(I2C_BENCHMARK) || defined(TILT_BENCHMARK) || defined(DC_BENCHMARK))
+#error "TRACE needs the serial port for itself"
+#endif
 
 #ifdef DEBUG
 #define DEBUG_PRINT(x) Serial.print(F(x))
@@ -136,104 +167,226 @@
 #define DEBUG_PRINTVARLN(x)
 #endif
 
+#ifdef PROFILER
+#define PROFILE_BEGIN(stage) unsigned long profileStart_##stage = micros()
+#define PROFILE_END(stage) profiler.add(stage, micros() - profileStart_##stage)
+#else
+#define PROFILE_BEGIN(stage)
+#define PROFILE_END(stage)
+#endif
+
 // ---------------------- Defines -----------------------
 #define MPU_I2C_ADDR 0x69     // I2C address of the MPU sensor (0x68 for AD0=LOW, 0x69 for AD0=HIGH)
-#define DHT_TYPE DHT_TYPE_11  // Type of DHT sensor
+#define DISPLAY_I2C_ADDR 0x3C // I2C address of the display
+#define I2C_CLOCK TWI_FAST_FREQUENCY  // SCL clock of the I2C bus (MPU, RTC and display support 400 kHz; TWI_FREQUENCY: 100 kHz for long wires)
+#define MPU_I2C_CLOCK 0       // SCL clock of the MPU transactions in Hz, if it can't handle I2C_CLOCK (0: I2C_CLOCK)
+#define RTC_I2C_CLOCK 0       // SCL clock of the RTC transactions in Hz, if it can't handle I2C_CLOCK (0: I2C_CLOCK)
+#define DHT_TYPE DHT_TYPE_11  // Type of the inside DHT sensor
+#define DHT_OUTSIDE_TYPE DHT_TYPE_22  // Type of the outside DHT sensor
+#define DHT_FRIDGE_TYPE DHT_TYPE_22   // Type of the fridge DHT sensor
 #define ROTARY_PIN_SW 2       // Rotary switch pin (interrupt/poll)
 #define FRESH_WATER_PIN 3     // Water (fresh) switch pin (digital)
 #define GREY_WATER_PIN 4      // Water (grey) switch pin (digital)
 #define ROTARY_PIN_DT 5       // Rotary data pin (digital)
 #define ROTARY_PIN_CLK 6      // Rotary clock pin (digital)
-#define DHT_PIN 7             // DHT data pin (digital)
+#define DHT_PIN 7             // DHT data pin of the inside sensor (digital)
 #define FRESH_WATER_LED_PIN 8 // LED pin for fresh water empty (digital)
 #define GREY_WATER_LED_PIN 9  // LED pin for grey water full (digital)
+#define DHT_OUTSIDE_PIN 10    // DHT data pin of the outside sensor (digital)
+#define DHT_FRIDGE_PIN 11     // DHT data pin of the fridge sensor (digital)
 #define VOLTAGE_PIN A0        // Voltage read pin (analog)
 #define CURRENT_PIN A1        // Current read pin (analog)
+#define RTC_INT_PIN A2        // RTC alarm interrupt pin (INT/SQW, pin change interrupt)
+#define MPU_INT_PIN A3        // MPU FIFO overflow interrupt pin (INT, pin change interrupt)
 
-#define DHT_HISTORY_COUNT 24  // Number of DHT history data
-#define MPU_HISTORY_COUNT 10  // Number of MPU history data
+// Pins with a pin change handler: rotary and water switches (wake up), RTC and MPU INT, DHT data (edges)
+constexpr uint8_t pinChangePins = 5
+#ifdef RTC_INTERRUPT
+    + 1
+#endif
+#ifdef MPU_FIFO
+    + 1
+#endif
+#ifdef DHT_INTERRUPT
+    + 1
+#ifdef DHT_OUTSIDE
+    + 1
+#endif
+#ifdef DHT_FRIDGE
+    + 1
+#endif
+#endif
+    ;
+static_assert(pinChangePins <= PINCHANGE_MAX_HANDLERS, "More pin change handlers than PINCHANGE_MAX_HANDLERS");
+
+#define DHT_INSIDE 0          // Index of the inside sensor in dhtSensors (main menu, plotter)
+#ifdef DHT_INTERRUPT
+#define DHT_EDGES true        // DHT bits decoded from the edges
+#else
+#define DHT_EDGES false
+#endif
+#define TILT_TAU 10000        // Time constant of the tilt fusion (in ms); the gyroscope follows faster changes
+#ifdef TILT_KALMAN
+#define TILT_MODE TILT_FILTER_KALMAN
+#else
+#define TILT_MODE TILT_FILTER_COMPLEMENTARY
+#endif
 #define DC_ENERGY_COUNT 24    // Number of DC energy history data
+#define BATTERY_CAPACITY 100  // Capacity of the battery (in Ah)
+#define BATTERY_EFFICIENCY 95 // Charge efficiency of the battery: stored share of the charge (in %)
+#define BATTERY_REST_CURRENT 1000  // Maximum current at rest (in mA)
+#define BATTERY_REST_TIME 900 // Time at rest, after which the voltage is taken as open circuit voltage (in s)
+#define BATTERY_RESISTANCE 15   // Internal resistance of the battery (in mOhm): its voltage drop is added back
+#define BATTERY_TEMPERATURE 25.0   // Temperature of the battery without a valid reading of the inside DHT (in degC)
 #define STANDBY_DELAY 60      // Time till standby (in s)
 
+#define SENSOR_PERIOD 500     // Time between two MPU, DC and water readings (in ms)
+#define MPU_FIFO_RATE 50      // Sample rate of the MPU in FIFO mode (in Hz); the FIFO holds 73 samples (1.4 s)
+#define DHT_PERIOD 10         // Time between two polls of the DHT state machine (in ms)
+#define CLOCK_PERIOD 100      // Time between two RTC time and alarm readings (in ms)
+#define DISPLAY_PERIOD 250    // Time between two display refreshes (in ms); main menu needs ~ 30ms
+#define STANDBY_PERIOD 100    // Time between two standby checks (in ms)
+#define SERIAL_PERIOD 200     // Time between two checks for serial commands (in ms)
+#define TRACE_BAUD 115200     // Baud rate of the trace; a wake up triggers bursts of sensor readings
+#define I2C_BENCHMARK_RUNS 10 // Runs per measurement of the I2C benchmark
+#define TILT_BENCHMARK_RUNS 100 // Runs per measurement of the tilt benchmark
+#define DC_BENCHMARK_RUNS 100 // Runs per measurement of the DC benchmark
+#define DC_VOLTAGE_FACTOR FIXED_FACTOR(5000.0 / 16384.0 / 0.2, 16)  // Battery voltage in mV per 1/16 LSB (Q16, 100000: raw * factor < 2^31)
+#define DC_CURRENT_FACTOR FIXED_FACTOR(5000.0 / 16384.0 / 66.2 * 1000.0, 15)  // Current in mA per 1/16 LSB (Q15, 151089: 8192 * factor < 2^31)
+#define DC_CURRENT_ZERO 8192  // Raw value of the current sensor at 0 A (2500 mV in 1/16 LSB)
+#define DC_EMA_WEIGHT 5       // Weight of a reading in the EMA of voltage and current (in 1/2^DC_EMA_SHIFT)
+#define DC_EMA_SHIFT 4        // 5/16 = 0.31 => tau = 1.3 s at SENSOR_PERIOD
+#define MPU_CALIBRATION_SAMPLES 64 // Raw samples averaged by the MPU calibration (~ 1 s)
+#define MPU_OFFSET_VERSION 1  // Version of the MPU offsets in the EEPROM (increase with a change of MPUOffsetType)
+#define EEPROM_MPU_OFFSET 0   // EEPROM address of the MPU offsets (EEPROM_STORE_SIZE(sizeof(MPUOffsetType)) = 20 bytes)
+#define ROTARY_STANDBY_PERIOD 100  // Time between two rotary polls in standby (in ms); pin changes wake up immediately
+
 // --------------------- Data struct types ---------------------
-struct DHTDataType  // DHT data type as a struct
+struct WaterDataType  // Water data type as struct
 {
-    float temperature;  // Temperature value
-    float humidity;     // Humidity value
+    bool fresh;  // true, when freshwater is not empty
+    bool grey;   // true, when greywater is full
 };
 
-struct DHTHistoryType  // DHT history data type as a struct
+struct DCDataType  // Data type for DC information (scaled integers, floats only for the display)
 {
-    int8_t hour[DHT_HISTORY_COUNT];         // Hour array
-    int8_t temperature[DHT_HISTORY_COUNT];  // Temperature array
-    int8_t humidity[DHT_HISTORY_COUNT];     // Humidity array
+    int32_t voltage;                    // Voltage value in mV
+    int32_t current;                    // Current value in mA (positive: discharge)
+    int32_t power;                      // Power value in mW
+    int32_t energy;                     // Energy accumulation in mAs of the last hour (discharged - charged)
+    int soc;                            // State of charge of the battery in %
+    float energy24[DC_ENERGY_COUNT];    // Energy data in Ah of the last 24 hours (display)
+    int32_t voltageAverage;             // EMA of the voltage in mV (Q FIXED_FRACTION, 0: no reading yet)
+    int32_t currentAverage;             // EMA of the current in mA (Q FIXED_FRACTION)
 };
 
-struct MPUHistoryType  // MPU history data type as a struct
+struct DCRawType  // Raw ADC values of the DC sensors (means of the sensor period in 1/16 LSB)
 {
-    float phiX[MPU_HISTORY_COUNT];  // PhiX array
-    float phiY[MPU_HISTORY_COUNT];  // PhiY array
+    uint16_t voltage;  // Raw value at the voltage sensor pin
+    uint16_t current;  // Raw value at the current sensor pin
 };
 
-struct WaterDataType  // Water data type as struct
+struct SensorSampleType  // Raw inputs of one sensor reading
 {
-    bool fresh;  // true, when freshwater is not empty
-    bool grey;   // true, when greywater is full
+    MPURawType mpu;  // Raw MPU registers
+    DCRawType dc;    // Raw DC values
+    uint8_t water;   // Water switch pin levels (bit 0: fresh, bit 1: grey)
 };
 
-struct DCDataType  // Data type for DC information
-{
-    float voltage;                      // Voltage value in V
-    float current;                      // Current value in A
-    float power;                        // Power value in W
-    float energy;                       // Energy accumulation Ah of the last hour
-    int soc;                            // State of charge of the battery
-    float energy24[DC_ENERGY_COUNT];    // Energy data in Ah of the last 24 hours
+// Battery SoC in % over the open circuit voltage and the temperature (only used at compile time for batteryTable).
+// At 25 degC 10 ... 100 % are 11.51 ... 12.73 V, the voltage changes by 4 mV/K.
+constexpr float batteryVoltages[] = {11.20, 11.36, 11.51, 11.66, 11.81, 11.96, 12.10, 12.24, 12.37, 12.50, 12.62, 12.73, 12.90};  // in V
+constexpr float batteryTemperatures[] = {-10, 0, 10, 20, 30, 40};  // in degC
+constexpr float batterySOCs[][sizeof(batteryVoltages) / sizeof(batteryVoltages[0])] = {
+    {0, 9.3, 19.3, 29.3, 39.3, 50, 60, 70.8, 80.8, 91.8, 100, 100, 100},    // -10 degC
+    {0, 6.7, 16.7, 26.7, 36.7, 47.1, 57.1, 67.7, 77.7, 88.3, 99.1, 100, 100},  // 0 degC
+    {0, 4, 14, 24, 34, 44.3, 54.3, 64.6, 74.6, 85, 95.5, 100, 100},          // 10 degC
+    {0, 1.3, 11.3, 21.3, 31.3, 41.4, 51.4, 61.5, 71.5, 81.7, 91.8, 100, 100},  // 20 degC
+    {0, 0, 8.7, 18.7, 28.7, 38.7, 48.6, 58.6, 68.5, 78.5, 88.3, 98.2, 100},    // 30 degC
+    {0, 0, 6, 16, 26, 36, 45.7, 55.7, 65.4, 75.4, 85, 94.5, 100},              // 40 degC
 };
-
-double voltageMap[] = {11.51, 11.66, 11.81, 11.96, 12.10, 12.24, 12.37, 12.50, 12.62, 12.73};   // Battery voltage data
-double socMap[] = {10, 20, 30, 40, 50, 60, 70, 80, 90, 100};                                    // Battery soc data
+static_assert(lookupIncreasing(batteryVoltages), "batteryVoltages must increase");
+static_assert(lookupIncreasing(batteryTemperatures), "batteryTemperatures must increase");
 
 // --------------- Classes & Data structs ---------------
 MPU6050 MPU_device = MPU6050(MPU_I2C_ADDR);             // MPU6050 accelerometer & gyrosope device
-MPUHistoryType MPUHistory;                              // MPU History data struct with phix and phiy
+TiltFilter tiltFilterX(TILT_MODE, TILT_TAU);            // Fused tilt around x
+TiltFilter tiltFilterY(TILT_MODE, TILT_TAU);            // Fused tilt around y
 DS3231 RTC_device;                                      // DS3231 clock device
-DHT_nonblocking dht_sensor(DHT_PIN, DHT_TYPE);          // DHT class (pin, sensor_type)
-DHTDataType DHTData;                                    // DHT struct from the DHT sensor
-DHTHistoryType DHTHistory;                              // DHT struct for DHT sensor history
+SoftwareClock softClock(RTC_device);                    // Software clock, resynced by the RTC every minute
+DHT_static<DHT_PIN, DHT_TYPE, DHT_EDGES> dht_inside;    // DHT class (pin, sensor_type, edge decoder)
+#ifdef DHT_OUTSIDE
+DHT_static<DHT_OUTSIDE_PIN, DHT_OUTSIDE_TYPE, DHT_EDGES> dht_outside;  // Outside DHT sensor
+#endif
+#ifdef DHT_FRIDGE
+DHT_static<DHT_FRIDGE_PIN, DHT_FRIDGE_TYPE, DHT_EDGES> dht_fridge;     // Fridge DHT sensor
+#endif
+DHTSensorType dhtSensors[] = {                          // DHT sensors with their readings and history
+    {&dht_inside, "Innen"},
+#ifdef DHT_OUTSIDE
+    {&dht_outside, "Aussen"},
+#endif
+#ifdef DHT_FRIDGE
+    {&dht_fridge, "Kuehlbox"},
+#endif
+};
+DHTManager dhtManager(dhtSensors, sizeof(dhtSensors) / sizeof(dhtSensors[0]));  // Staggered reads of the DHT sensors
 Rotary rotary = Rotary(ROTARY_PIN_DT, ROTARY_PIN_CLK);  // Rotary Definition als Poll
 WaterDataType WaterData = {true, false};                // Water struct for freshwater and greywater sensors
 DCDataType DCData = {0, 0, 0, 0, 0};                    // DC struct for current, voltage and power
-displayOscar display(-1);                               // Display class inherited from lcdgfx
+BatteryState batteryState(BATTERY_CAPACITY, BATTERY_EFFICIENCY, BATTERY_REST_CURRENT, BATTERY_REST_TIME);  // Coulomb counter of the battery
+displayOscar display(-1, {-1, DISPLAY_I2C_ADDR, -1, -1, I2C_CLOCK});  // Display class inherited from lcdgfx
 RTCDateTime RTCSettings;                                // Date time to set a new time for RTC device
-// LookupTable1D batteryLookup(voltageMap, socMap, sizeof(voltageMap) / sizeof(voltageMap[0]));    // 1D Loopup for battery map
+Scheduler scheduler;                                    // Task scheduler of the main loop
+PowerSaver powerSaver;                                  // Sleep between tasks in standby
+#ifdef PROFILER
+Profiler profiler;                                      // Runtime statistics of the loop stages
+StackMonitor dhtStack;                                  // Stack high-water mark of the DHT read
+#endif
+#ifdef TRACE
+SensorTrace sensorTrace;                                // Binary trace of the raw sensor inputs
+#endif
+constexpr auto batteryTable PROGMEM = lookupTable2D(batteryVoltages, batteryTemperatures, batterySOCs);  // Battery SoC over voltage and temperature (in flash)
 
 // ------------------ Global Variables ------------------
 unsigned long timestampIdle = 0;            // Timestamp since last user action
-unsigned long timestampSensors = 0;         // Timestamp since last MPU read
-unsigned long timestampDisplay = 0;         // Timestamp since last display refresh
 unsigned long timestampInterrupt = 0;       // Timestamp since last interrupt
 unsigned long timestampFreshWaterLED = 0;   // Timestamp since the LED turned on
+volatile bool RTCAlarmFlag = false;         // Set by the RTC alarm interrupt
+volatile bool MPUFifoFlag = false;          // Set by the MPU FIFO overflow interrupt
+uint8_t taskRotary;                         // Scheduler id of the rotary task
+uint8_t taskSensors;                        // Scheduler id of the sensor task
+uint8_t dhtPage = 0;                        // DHT sensor shown by the DHT menu
+SensorSampleType sensorSample;              // Raw inputs of the running sensor reading
+unsigned long sensorSampleDt = 0;           // Time since the last processed sensor reading
+bool sensorSamplePending = false;           // MPU registers of sensorSample requested, not yet received
+bool sensorSampleMPU = false;               // sensorSample waits for the MPU (false: the MPU is skipped)
+bool MPUReady = false;                      // MPU found and initialized
 
 // --------------------- Main Setup ---------------------
 void setup() {
-#if defined(DEBUG) || defined(PLOTTER)
+#if defined(DEBUG) || defined(PLOTTER) || defined(PROFILER) || defined(I2C_BENCHMARK) || defined(TILT_BENCHMARK) || defined(DC_BENCHMARK)
     Serial.begin(9600);
-    int sizeTimestamps = sizeof(timestampIdle) + sizeof(timestampDisplay) + sizeof(timestampInterrupt) + sizeof(timestampSensors);
+    int sizeTimestamps = sizeof(timestampIdle) + sizeof(timestampInterrupt) + sizeof(timestampFreshWaterLED);
+#endif
+#ifdef TRACE
+    Serial.begin(TRACE_BAUD);
 #endif
     DEBUG_PRINTLN("Byte sizes of:");
-    DEBUG_PRINT("dht_sensor: ");
-    DEBUG_PRINTVARLN((int)sizeof(dht_sensor));
-    DEBUG_PRINT("DHTData: ");
-    DEBUG_PRINTVARLN((int)sizeof(DHTData));
-    DEBUG_PRINT("DHTHistory: ");
-    DEBUG_PRINTVARLN((int)sizeof(DHTHistory));
+    DEBUG_PRINT("dht_inside: ");
+    DEBUG_PRINTVARLN((int)sizeof(dht_inside));
+    DEBUG_PRINT("dhtSensors: ");
+    DEBUG_PRINTVARLN((int)sizeof(dhtSensors));
+    DEBUG_PRINT("dhtManager: ");
+    DEBUG_PRINTVARLN((int)sizeof(dhtManager));
     DEBUG_PRINT("MPU: ");
     DEBUG_PRINTVARLN((int)sizeof(MPU_device));
-    DEBUG_PRINT("MPUHistory: ");
-    DEBUG_PRINTVARLN((int)sizeof(MPUHistory));
+    DEBUG_PRINT("Tilt filters: ");
+    DEBUG_PRINTVARLN((int)(sizeof(tiltFilterX) + sizeof(tiltFilterY)));
     DEBUG_PRINT("RTC: ");
     DEBUG_PRINTVARLN((int)sizeof(RTC_device));
+    DEBUG_PRINT("softClock: ");
+    DEBUG_PRINTVARLN((int)sizeof(softClock));
     DEBUG_PRINT("rotary: ");
     DEBUG_PRINTVARLN((int)sizeof(rotary));
     DEBUG_PRINT("display: ");
@@ -242,34 +395,101 @@ void setup() {
     DEBUG_PRINTVARLN((int)sizeof(WaterData));
     DEBUG_PRINT("timestamps: ");
     DEBUG_PRINTVARLN(sizeTimestamps);
+    DEBUG_PRINT("scheduler: ");
+    DEBUG_PRINTVARLN((int)sizeof(scheduler));
+#ifdef PROFILER
+    DEBUG_PRINT("profiler: ");
+    DEBUG_PRINTVARLN((int)sizeof(profiler));
+#endif
 
     DEBUG_PRINTLN("------ Setup begin ------");
     pinMode(LED_BUILTIN, OUTPUT);
     digitalWrite(LED_BUILTIN, LOW);
     DEBUG_PRINTLN("- LED Setup completed");
+    Wire.begin();
+    Wire.setWireTimeout(TWI_WIRE_TIMEOUT, true);  // a held bus ends the blocking calls, recovered by the loop
+    TwiQueue::begin(I2C_CLOCK);
     RTC_setup(RTC_RESET_TIME);
     DEBUG_PRINTLN("- RTC Setup completed");
     MPU_setup();
     DEBUG_PRINTLN("- MPU Setup completed");
     rotary_setup();
     DEBUG_PRINTLN("- Rotary Setup completed");
+    DHT_setup();
+    DEBUG_PRINTLN("- DHT Setup completed");
     waterLevel_setup();
     DEBUG_PRINTLN("- WaterLevel Setup completed");
+    DC_setup();
+    DEBUG_PRINTLN("- DC Setup completed");
+    wake_setup();
+    DEBUG_PRINTLN("- Wake Setup completed");
     display.initialize();
     DEBUG_PRINTLN("- Display Setup completed");
+    scheduler_setup();
+    DEBUG_PRINTLN("- Scheduler Setup completed");
+#ifdef I2C_BENCHMARK
+    I2C_benchmark();
+#endif
+#ifdef TILT_BENCHMARK
+    tilt_benchmark();
+#endif
+#ifdef DC_BENCHMARK
+    DC_benchmark();
+#endif
+#ifdef TRACE
+    sensorTrace.begin(Serial, millis());
+    sensorTrace.recordOffset(millis(), MPU_device.offset);
+#endif
     timestampIdle = millis();
     DEBUG_PRINTLN("------ Setup ended ------");
 }
 
 // ---------------------- Main Loop ---------------------
 void loop() {
-    // Rotary reading: -> check process -> activate input turn with the direction
+    // Advance the queued I2C transactions of the MPU and RTC and process their results
+    TwiQueue::poll();
+    sensors_complete();
+
+    // Run the next due task. Only one task runs per pass, so the rotary polling (due on every pass)
+    // is delayed at most by the longest single task (display refresh ~ 30ms).
+    PROFILE_BEGIN(PROFILE_LOOP);
+    bool taskRun = scheduler.run(millis());
+    PROFILE_END(PROFILE_LOOP);
+
+    // A blocking Wire call of a task ran into the timeout: free the bus for the next transactions
+    if (Wire.getWireTimeoutFlag()) {
+        Wire.clearWireTimeoutFlag();
+        TwiQueue::recover();
+    }
+
+    // In standby sleep until the next task is due or a pin change wakes up (not during I2C transactions)
+    if (!taskRun && display.getDisplayState() == STANDBY && TwiQueue::isIdle()) {
+        standby_sleep();
+    }
+}
+
+// ----------------------- Tasks ------------------------
+
+/*
+ * Rotary reading: -> check process -> activate input turn with the direction.
+ * Polls the rotary switch in polling mode.
+ * @param dt time since last run in ms
+ */
+void task_rotary(unsigned long dt) {
+    PROFILE_BEGIN(PROFILE_ROTARY);
     unsigned char result = rotary.process();
+    PROFILE_END(PROFILE_ROTARY);
     if (result == DIR_CW) {
         DEBUG_PRINTLN("Rotary was turned CW");
+#ifdef TRACE
+        sensorTrace.recordRotary(millis(), TRACE_ROTARY_CW);
+#endif
         rotary_turn(1);
     } else if (result == DIR_CCW) {
         DEBUG_PRINTLN("Rotary was turned CCW");
+#ifdef TRACE
+        sensorTrace.recordRotary(millis(), TRACE_ROTARY_CCW);
+#endif
         rotary_turn(-1);
     }
 
@@ -278,45 +498,127 @@ void loop() {
         rotary_interrupt();
     }
     #endif
+}
 
-    // Sensor readings:
-    unsigned long dtSensor = millis() - timestampSensors;
-    if (dtSensor > 500) {
-        // DEBUG_PRINTLN("Reading sensor data...");
-        timestampSensors = millis();
-        MPU_device.getData();
-        DCData = DC_getData(dtSensor);
-        WaterData = getWaterData();
-        pushFloatArray(MPUHistory.phiX, MPU_device.data.phiX, MPU_HISTORY_COUNT);
-        pushFloatArray(MPUHistory.phiY, MPU_device.data.phiY, MPU_HISTORY_COUNT);
-        DEBUG_PLOTTER();
-    }
-
-    // DHT reading: -> Try to get new DHT data
-    if (DHT_read(&DHTData.temperature, &DHTData.humidity) == true) {
-        // DEBUG_PRINTLN("Reading DHT sensor...");
+/*
+ * Sensor readings: MPU, DC and water switches.
+ * The MPU registers (in FIFO mode: the drain of the FIFO) are requested from the TWI queue,
+ * the reading is completed by sensors_complete().
+ * If the last reading is still pending, the time is added to the next one. If the queue is full,
+ * the task runs again on the next loop pass, so it can't be locked out by the clock task's reads.
+ * A missing or degraded MPU is initialized again after its backoff time. Until then the readings
+ * keep its last values, DC and water are still read.
+ * @param dt time since last run in ms
+ */
+void task_sensors(unsigned long dt) {
+    sensorSampleDt += dt;
+    if (sensorSamplePending) {
+        return;
     }
+    PROFILE_BEGIN(PROFILE_MPU);
+    unsigned long now = millis();
+    if (MPU_device.health.isDue(now) && (!MPUReady || MPU_device.health.isDegraded())) {
+        MPUReady = MPU_initialize();  // plugged in again or back from a brown-out
+    }
+    sensorSampleMPU = MPUReady && MPU_device.health.isDue(now);
+    bool requested = true;
+    if (sensorSampleMPU) {
+#ifdef MPU_FIFO
+        if (MPUFifoFlag) {
+            MPUFifoFlag = false;
+            MPU_device.resetFifo();  // the samples lost their alignment; counts the overflow and releases INT
+        }
+        requested = MPU_device.requestFifo();
+#else
+        requested = MPU_device.requestRaw();
+#endif
+    }
+    PROFILE_END(PROFILE_MPU);
+    if (!requested) {
+        scheduler.trigger(taskSensors, millis());  // queue full, try again on the next pass (not only in the next period)
+        return;
+    }
+    PROFILE_BEGIN(PROFILE_DC);
+    sensorSample.dc = DC_read();
+    PROFILE_END(PROFILE_DC);
+    sensorSample.water = water_read();
+    sensorSamplePending = true;
+}
 
-    // Get new time data
-    RTC_device.getDateTime();
-
-    // Every full hour: -> Save data to history arrays
-    if (RTC_device.isAlarm1()) {
-        RTC_device.getDateTime();  // update datetime, to prevent offsync between alarm timing and datetime update.
-        pushFloatArray(DCData.energy24, DCData.energy, DC_ENERGY_COUNT);
-        DCData.energy = 0;
-        pushInt8Array(DHTHistory.hour, RTC_device.t.hour, DHT_HISTORY_COUNT);
-        pushInt8Array(DHTHistory.temperature, DHTData.temperature, DHT_HISTORY_COUNT);
-        pushInt8Array(DHTHistory.humidity, DHTData.humidity, DHT_HISTORY_COUNT);
+/*
+ * DHT reading: -> Advance the staggered reads of the DHT sensors
+ * @param dt time since last run in ms
+ */
+void task_DHT(unsigned long dt) {
+    PROFILE_BEGIN(PROFILE_DHT);
+#ifdef PROFILER
+    bool reading = dhtManager.isReading();  // only a poll in the read sequence reads the bits
+    if (reading) {
+        dhtStack.paint();
+    }
+#endif
+    int8_t index = dhtManager.poll();
+#ifdef PROFILER
+    if (reading) {
+        dhtStack.measure();
+    }
+#endif
+    if (index >= 0) {
+        // DEBUG_PRINTLN("Reading DHT sensor...");
+#ifdef TRACE
+        sensorTrace.recordDHT(millis(), index, dhtSensors[index].sensor->get_data());
+#endif
     }
+    PROFILE_END(PROFILE_DHT);
+}
 
-    // display refresh at 4 fps (main menu needs ~ 30ms, leave some time to poll rotary reading etc.)
-    if (millis() - timestampDisplay > 250) {
-        timestampDisplay = millis();
-        display_refresh();
+/*
+ * Advance the software clock (reads the RTC only at minute boundaries).
+ * Every full hour: -> Save data to history arrays
+ * @param dt time since last run in ms
+ */
+void task_clock(unsigned long dt) {
+    PROFILE_BEGIN(PROFILE_RTC);
+    softClock.update(millis());
+    PROFILE_END(PROFILE_RTC);
+
+    PROFILE_BEGIN(PROFILE_ALARM);
+    bool alarm = RTC_device.pollAlarm1();  // result of the read requested by the last run; clears the alarm flag
+    // A degraded RTC is only asked again after its backoff time (a missed alarm stays set in the RTC)
+#ifdef RTC_INTERRUPT
+    // Only ask the RTC if the alarm pulled the INT line low (also catches a missed edge by the pin level)
+    if ((RTCAlarmFlag || digitalRead(RTC_INT_PIN) == LOW) && RTC_device.health.isDue(millis())) {
+        RTCAlarmFlag = false;
+        RTC_device.requestAlarm1();
+    }
+#else
+    if (RTC_device.health.isDue(millis())) {
+        RTC_device.requestAlarm1();
+    }
+#endif
+    PROFILE_END(PROFILE_ALARM);
+    if (alarm) {
+        softClock.resync(millis());  // update datetime, to prevent offsync between alarm timing and datetime update.
+#ifdef TRACE
+        sensorTrace.recordRollover(millis(), softClock.t.hour);
+#endif
+        history_rollover(softClock.t.hour);
     }
+}
+
+/*
+ * Display refresh at 4 fps.
+ * @param dt time since last run in ms
+ */
+void task_display(unsigned long dt) {
+    display_refresh();
+}
 
-    // Enter standby after certain time under certain conditions
+/*
+ * Enter standby after certain time under certain conditions
+ * @param dt time since last run in ms
+ */
+void task_standby(unsigned long dt) {
     bool check1 = millis() - timestampIdle > (unsigned long)STANDBY_DELAY * 1000;
     bool check2 = display.getDisplayState() != STANDBY;
     bool check3 = !WaterData.grey;
@@ -324,20 +626,57 @@ void loop() {
     if (check1 && check2 && check3 && check4) {
         DEBUG_PRINTLN("Entering standby...");
         display.setDisplayState(STANDBY);
+        TwiQueue::flush();  // the display uses the blocking Wire library
         display.clear();
         display_refresh();
+        scheduler.setPeriod(taskRotary, ROTARY_STANDBY_PERIOD);  // rotary is woken up by pin changes
     }
 }
 
+#if defined(DEBUG) || defined(PLOTTER) || defined(PROFILER)
+/*
+ * Serial commands: 'i' prints the I2C error counters of the devices.
+ * Of the profiler: 'p' prints the statistics (and the stack of the DHT read), 'r' resets them.
+ * @param dt time since last run in ms
+ */
+void task_serial(unsigned long dt) {
+    while (Serial.available() > 0) {
+        switch (Serial.read()) {
+            case 'i':
+                MPU_device.health.print("MPU");
+                RTC_device.health.print("RTC");
+                Serial.print(F("I2C bus recoveries: "));
+                Serial.println(TwiQueue::getRecoveries());
+                break;
+#ifdef PROFILER
+            case 'p':
+                profiler.print();
+                dhtStack.print("DHT");
+                break;
+            case 'r':
+                profiler.reset();
+                dhtStack.reset();
+                Serial.println(F("Profiler reset"));
+                break;
+#endif
+            default:
+                break;
+        }
+    }
+}
+#endif
+
 // ----------------------- Setups -----------------------
 
 void (*restartFunc)(void) = 0;  // declare restart function @ address 0
 
 /*
  * Initialize the RTC device with 2 alarms and get the first time data.
+ * In interrupt mode the hourly alarm drives the INT/SQW pin, which is watched by a pin change interrupt.
  * @param setTime set true to update the saved time on the RTC device.
  */
 void RTC_setup(bool setTime) {
+    RTC_device.setClock(RTC_I2C_CLOCK);
     RTC_device.begin();
 
     // Send sketch compiling time to Arduino (delayed by ~6 seconds!)
@@ -345,25 +684,94 @@ void RTC_setup(bool setTime) {
         RTC_device.setDateTime(__DATE__, __TIME__);
         DEBUG_PRINTLN("Updated RTC time!");
     }
+#ifdef RTC_INTERRUPT
+    RTC_device.setInterruptSetting(true);                       // INT/SQW pin as alarm interrupt output
+    RTC_device.setAlarm1(0, 0, 0, 0, DS3231_MATCH_M_S, true);   // match every hour
+    pinMode(RTC_INT_PIN, INPUT_PULLUP);                         // INT/SQW is open drain and active low
+    pinChange_attach(RTC_INT_PIN, RTC_interrupt);
+#else
     RTC_device.setAlarm1(0, 0, 0, 0, DS3231_MATCH_M_S, false);  // match every hour
+#endif
     // RTC_device.setAlarm2(0, 0, 0, DS3231_EVERY_MINUTE, false);  // match every minute
-    RTC_device.getDateTime();
+#ifdef DEBUG
+    if (!RTC_device.verifyRegisters()) {
+        DEBUG_PRINTLN("RTC registers differ from their shadow!");
+    }
+#endif
+    softClock.begin(millis());
 }
 
 /*
- * Initialize the MPU device and active the I2C Bypass. Also test the connection.
+ * Setup of the MPU device: the offsets of the last calibration (if stored in the EEPROM), the
+ * interrupt pin in FIFO mode and the first initialization. Without a connection the sensor task
+ * tries again.
  */
 void MPU_setup() {
-    if (MPU_device.testConnection()) {
-        MPU_device.initialize();
-        MPU_device.setBypass();
-        MPU_device.getData();
+    MPU_device.setClock(MPU_I2C_CLOCK);
+    if (EepromStore::load(EEPROM_MPU_OFFSET, MPU_OFFSET_VERSION, &MPU_device.offset, sizeof(MPU_device.offset))) {
+        DEBUG_PRINTLN("MPU6050 offsets loaded from EEPROM");
+    }
+#ifdef MPU_FIFO
+    pinMode(MPU_INT_PIN, INPUT);  // INT is push-pull and active high
+    pinChange_attach(MPU_INT_PIN, MPU_interrupt);
+#endif
+    MPUReady = MPU_initialize();
+    if (MPUReady) {
         DEBUG_PRINTLN("MPU6050 connected successfully!");
     } else {
         DEBUG_PRINTLN("MPU6050 not connected!");
     }
 }
 
+/*
+ * Initialize the MPU device and active the I2C Bypass. Also test the connection.
+ * @return true, if the MPU answered all transactions.
+ */
+bool MPU_initialize() {
+    if (!MPU_device.testConnection()) {
+        return false;
+    }
+    MPU_device.initialize();
+    MPU_device.setBypass();
+    MPU_device.getData();
+#ifdef MPU_FIFO
+    MPU_device.beginFifo(MPU_FIFO_RATE);
+#endif
+#ifdef DEBUG
+    if (!MPU_device.verifyRegisters()) {
+        DEBUG_PRINTLN("MPU6050 registers differ from their shadow!");
+    }
+#endif
+    return MPU_device.health.getFailures() == 0;
+}
+
+/*
+ * Calibrate the MPU on level ground and store the offsets in the EEPROM (menu).
+ * Blocks for MPU_CALIBRATION_SAMPLES readings, the van must stand still.
+ * @return true, if the calibration succeeded. Otherwise the offsets stay.
+ */
+bool MPU_calibrate() {
+    if (!MPUReady || !MPU_device.calibrate(MPU_CALIBRATION_SAMPLES)) {
+        DEBUG_PRINTLN("MPU6050 calibration failed!");
+        return false;
+    }
+    EepromStore::save(EEPROM_MPU_OFFSET, MPU_OFFSET_VERSION, &MPU_device.offset, sizeof(MPU_device.offset));
+    MPU_offset_changed();
+    return true;
+}
+
+/*
+ * Restart the tilt fusion after a change of the MPU offsets (the gyroscope offset of the filters
+ * is the rest left by them) and record the offsets in the trace.
+ */
+void MPU_offset_changed() {
+    tiltFilterX.restart();
+    tiltFilterY.restart();
+#ifdef TRACE
+    sensorTrace.recordOffset(millis(), MPU_device.offset);
+#endif
+}
+
 /*
  * Setup for the water level switches.
  * Defines the pins and the modes.
@@ -377,6 +785,13 @@ void waterLevel_setup() {
     digitalWrite(GREY_WATER_LED_PIN, LOW);
 }
 
+/*
+ * Setup of the DC sensors: the ADC samples voltage and current by its interrupt from now on.
+ */
+void DC_setup() {
+    AdcSampler::begin(VOLTAGE_PIN, CURRENT_PIN);
+}
+
 /*
  * Setup for the rotary switch.
  * Select the pin mode and attatch the interrupt handler to the interrupt pin in interrupt mode.
@@ -390,61 +805,220 @@ void rotary_setup() {
     #endif
 }
 
+/*
+ * Attach a handler to the level changes of a pin. A failure (no free handler) is reported in debug mode.
+ * @param pin Arduino pin number
+ * @param callback Function called on every level change (interrupt context)
+ */
+void pinChange_attach(uint8_t pin, PinChangeCallback callback) {
+    if (!PinChangeInterrupt::attach(pin, callback)) {
+        DEBUG_PRINT("Pin change handler not attached, pin ");
+        DEBUG_PRINTVARLN(pin);
+    }
+}
+
+/*
+ * Setup of the DHT sensors: in interrupt mode their edges are decoded by the pin change interrupt.
+ */
+void DHT_setup() {
+#ifdef DHT_INTERRUPT
+    pinChange_attach(DHT_PIN, DHT_interrupt_edge);
+#ifdef DHT_OUTSIDE
+    pinChange_attach(DHT_OUTSIDE_PIN, DHT_outside_interrupt_edge);
+#endif
+#ifdef DHT_FRIDGE
+    pinChange_attach(DHT_FRIDGE_PIN, DHT_fridge_interrupt_edge);
+#endif
+#endif
+}
+
+/*
+ * Register all tasks of the main loop at the scheduler.
+ * The rotary task is due on every pass and has the highest priority.
+ */
+void scheduler_setup() {
+    unsigned long now = millis();
+    taskRotary = scheduler.addTask(task_rotary, 0, 4, 5, now);
+    taskSensors = scheduler.addTask(task_sensors, SENSOR_PERIOD, 3, 100, now);
+    scheduler.addTask(task_DHT, DHT_PERIOD, 2, 50, now);
+    scheduler.addTask(task_clock, CLOCK_PERIOD, 2, 100, now, CLOCK_PERIOD / 2);
+    scheduler.addTask(task_display, DISPLAY_PERIOD, 1, DISPLAY_PERIOD, now);
+    scheduler.addTask(task_standby, STANDBY_PERIOD, 0, 1000, now);
+#if defined(DEBUG) || defined(PLOTTER) || defined(PROFILER)
+    scheduler.addTask(task_serial, SERIAL_PERIOD, 0, 1000, now);
+#endif
+}
+
+/*
+ * Setup of the wake up sources for the standby sleep.
+ * Pin changes of the rotary and the water switches end the sleep.
+ */
+void wake_setup() {
+    pinChange_attach(ROTARY_PIN_SW, wake_interrupt);
+    pinChange_attach(ROTARY_PIN_DT, wake_interrupt);
+    pinChange_attach(ROTARY_PIN_CLK, wake_interrupt);
+    pinChange_attach(GREY_WATER_PIN, wake_interrupt);
+    pinChange_attach(FRESH_WATER_PIN, wake_interrupt);
+}
+
 // ------------------------ Reads -----------------------
 
 /*
- * Read analog values from the DC pins.
- * Calculate power and energy consumption.
- * @return DC struct
+ * Collect the means of the DC pins since the last reading (sampled by the ADC interrupt, no waiting).
+ * @return Raw ADC values in 1/16 LSB
+ */
+DCRawType DC_read() {
+    uint16_t means[ADC_SAMPLER_CHANNELS];
+    AdcSampler::collect(means);
+    DCRawType raw;
+    raw.voltage = means[0];  // Raw voltage value at the voltage sensor pin
+    raw.current = means[1];  // Raw voltage value at the current sensor pin
+    return raw;
+}
+
+/*
+ * Reads the digital pins for the two water switches.
+ * @return Pin levels (bit 0: fresh, bit 1: grey)
+ */
+uint8_t water_read() {
+    return digitalRead(FRESH_WATER_PIN) | digitalRead(GREY_WATER_PIN) << 1;
+}
+
+/*
+ * Converts the pin level of a water switch.
+ * @return Returns true if the water level is reached.
+ */
+bool getWaterLevel(uint8_t pinRead) {
+    if (pinRead) {
+        // water level not reached
+        return false;
+    } else {
+        // water level is reached
+        return true;
+    };
+}
+
+// --------------------- Processing ---------------------
+
+/*
+ * Complete the sensor reading of the sensor task, as soon as the requested MPU registers arrived
+ * (in FIFO mode: the average of the drained samples). Called on every loop pass.
+ */
+void sensors_complete() {
+    if (!sensorSamplePending) {
+        return;
+    }
+#ifdef MPU_FIFO
+    if (sensorSampleMPU && !MPU_device.fifoReady()) {
+        return;
+    }
+#else
+    if (sensorSampleMPU && !MPU_device.rawReady()) {
+        return;
+    }
+#endif
+    sensorSamplePending = false;
+    sensorSample.mpu = MPU_device.raw;
+#ifdef TRACE
+    sensorTrace.recordSample(millis(), sensorSampleDt, sensorSample.dc.voltage, sensorSample.dc.current, sensorSample.mpu, sensorSample.water);
+    sensorTrace.flush();  // moves the records of this period to the serial port without waiting for it
+#endif
+    sensors_process(sensorSample, sensorSampleDt);
+    sensorSampleDt = 0;
+}
+
+/*
+ * Process the raw inputs of a sensor reading. Called by sensors_complete() and by the trace replay.
+ * @param sample Raw inputs of the MPU, the DC sensors and the water switches
+ * @param dt time since last reading in ms
+ */
+void sensors_process(const SensorSampleType &sample, unsigned long dt) {
+    MPU_device.convert(sample.mpu);
+    DC_process(DCData, sample.dc, dt);
+    WaterData = getWaterData(sample.water);
+    MPU_fuse(sample.mpu, dt);
+    DEBUG_PLOTTER();
+}
+
+/*
+ * Fuse the tilt of the accelerometer (converted before) with the rates of the gyroscope.
+ * @param raw Raw MPU registers
+ * @param dt time since last reading in ms
+ */
+void MPU_fuse(const MPURawType &raw, unsigned long dt) {
+    // Rates in 0.01 deg/s. A rotation around y lowers AcX, so phiY turns against GyY.
+    int16_t rateX = (int32_t)(raw.GyX + MPU_device.offset.GyX) * 100 / MPU6050_Gy_convert;
+    int16_t rateY = -(int32_t)(raw.GyY + MPU_device.offset.GyY) * 100 / MPU6050_Gy_convert;
+    tiltFilterX.update(MPU_device.data.tiltX, rateX, dt);
+    tiltFilterY.update(MPU_device.data.tiltY, rateY, dt);
+}
+
+/*
+ * Save the data of the last hour to the history arrays.
+ * @param hour Hour of the day after the rollover
+ */
+void history_rollover(uint8_t hour) {
+    pushFloatArray(DCData.energy24, DCData.energy * (1.0 / 3600000.0), DC_ENERGY_COUNT);  // mAs to Ah
+    batteryState.resetCounters();
+    DCData.energy = 0;
+    dhtManager.pushHistory(hour);
+}
+
+/*
+ * Calculate voltage, current, power and energy consumption from the raw DC values.
+ * Updates the DC struct in place, so the energy history is kept. The state of charge is counted
+ * by batteryState and anchored to the voltage after a rest.
+ * All in scaled integers (mV, mA, mW, mAs), only the lookup of the state of charge at a rest is float.
+ * @param data DC struct to update
+ * @param raw Raw ADC values
  * @param dt time since last update in ms
  */
-DCDataType DC_getData(unsigned long dt) {
-    int VVraw = analogRead(VOLTAGE_PIN);                                // Raw voltage value at the voltage sensor pin
-    float VVout = analogRead(VOLTAGE_PIN) * 5.0 / 1024.0;               // Voltage value in V of the voltage sensor (1024: 10bit resolution)
-    float voltageRaw = VVout / 0.2;                                     // Input voltage in V of the voltage sensor Vout = Vin / (R2/(R1+R2)); R1=30k, R2=7.5k
-    int VIraw = analogRead(CURRENT_PIN);                                // Raw voltage value at the current sensor pin
-    float VIout = (analogRead(CURRENT_PIN) * 5000.0 / 1024.0);          // Voltage value in mV of the current sensor (1024: 10bit resolution)
-    float currentRaw = -((VIout - 2500.0) / 66.2);                      // Current value in A of the current sensor (2500 mV offset, 66 A/mV)
-    
+void DC_process(DCDataType &data, DCRawType raw, unsigned long dt) {
+    // Vin = Vout / (R2/(R1+R2)); R1=30k, R2=7.5k. ACS712: 2500 mV offset, 66.2 mV/A
+    int32_t voltageRaw = fixedScale(raw.voltage, DC_VOLTAGE_FACTOR, 16 - FIXED_FRACTION);                       // Input voltage in mV (Q8)
+    int32_t currentRaw = fixedScale(DC_CURRENT_ZERO - (int32_t)raw.current, DC_CURRENT_FACTOR, 15 - FIXED_FRACTION);  // Current in mA (Q8)
+    if (data.voltageAverage == 0) {
+        // first reading: start the filters at the reading, so the voltage is valid for the first anchor
+        data.voltageAverage = voltageRaw;
+        data.currentAverage = currentRaw;
+    }
+
     // filter current and voltage with exponential moving average
-    float alpha = 0.3;                                                  // weight factor (0 < alpha < 1); alpha = 0.3 => tau = 1.4 sec
-    float current = alpha * currentRaw + (1 - alpha) * DCData.current;  // EMA formula
-    float voltage = alpha * voltageRaw + (1 - alpha) * DCData.voltage;  // EMA formula
-
-    float power = voltage * current;                                        // Power value in W
-    float energy = DCData.energy + (current * dt / 1000.0 / 60.0 / 60.0);   // Accumulate the used energy in Ah (dt in ms)
-    
-    // Update SoC by voltage only if there is no load
-    int soc = DCData.soc;
-    if (current <= 1.0) {
-        // Simple linear function for SoC estimation
-        float socRaw = 66.576 * voltage - 762.22;
-
-        // 1D lookup interpolation
-        // float socRaw = batteryLookup.interpolate(voltage);
-
-        // Limits and rounding
-        if (socRaw <= 0.0) {
-            soc = 0.0;
-        } else if (socRaw >= 100.0) {
-            soc = 100.0;
-        } else {
-            // round to nearest 5% value
-            soc = (((int) (socRaw + 2.5) ) / 5) * 5;
-        }
+    data.voltageAverage = fixedEma(data.voltageAverage, voltageRaw, DC_EMA_WEIGHT, DC_EMA_SHIFT);
+    data.currentAverage = fixedEma(data.currentAverage, currentRaw, DC_EMA_WEIGHT, DC_EMA_SHIFT);
+    int32_t voltage = fixedRound(data.voltageAverage, FIXED_FRACTION);  // mV
+    int32_t current = fixedRound(data.currentAverage, FIXED_FRACTION);  // mA
+
+    // Count the charge of the mean current of the period (unfiltered, the mean is the charge already)
+    batteryState.update(fixedRound(currentRaw, FIXED_FRACTION), dt);
+
+    // Anchor the charge to the voltage only after a rest, when it is the open circuit voltage
+    if (batteryState.isResting()) {
+        // The drop at the internal resistance is added back, the curve is taken at the inside temperature
+        const DHTSensorType &inside = dhtSensors[DHT_INSIDE];
+        float temperature = inside.valid ? inside.temperature : BATTERY_TEMPERATURE;
+        int32_t openVoltage = voltage + current * BATTERY_RESISTANCE / 1000;  // mV
+        float socRaw = batteryTable.interpolate(openVoltage * 0.001f, temperature);
+
+        batteryState.anchor(constrain(socRaw, 0.0, 100.0) * 10.0 + 0.5);
     }
-    return {voltage, current, power, energy, soc};
+    data.voltage = voltage;
+    data.current = current;
+    data.power = voltage * current / 1000;                                          // mW (mV * mA < 2^31 up to 50 A)
+    data.energy = (int32_t)(batteryState.getDischarged() - batteryState.getCharged());  // Used energy of the hour in mAs
+    data.soc = (batteryState.getSOC() + 5) / 10;
 }
 
 /*
- * Reads the digital pins for the two switches.
+ * Evaluates the pin levels of the two switches.
  * If a new state is noticed, the display wakes up from standby.
+ * @param pins Pin levels (bit 0: fresh, bit 1: grey)
  * @return Returns the new water data
  */
-WaterDataType getWaterData() {
+WaterDataType getWaterData(uint8_t pins) {
     WaterDataType newWaterData;
-    newWaterData.grey = getWaterLevel(GREY_WATER_PIN);
-    newWaterData.fresh = getWaterLevel(FRESH_WATER_PIN);
+    newWaterData.grey = getWaterLevel(pins & 0x02);
+    newWaterData.fresh = getWaterLevel(pins & 0x01);
 
     if (newWaterData.grey != WaterData.grey) {
         if (newWaterData.grey) {
@@ -483,97 +1057,146 @@ WaterDataType getWaterData() {
     return newWaterData;
 }
 
+// --------------------- Interrupts ---------------------
+
 /*
- * Reads the digital pin of a water switch.
- * @return Returns true if the water level is reached.
+ * Pin change handler of the rotary and water switches. Ends the standby sleep.
  */
-bool getWaterLevel(uint8_t PIN) {
-    int pinRead = digitalRead(PIN);
-    if (pinRead == HIGH) {
-        // water level not reached
-        return false;
-    } else {
-        // water level is reached
-        return true;
-    };
+void wake_interrupt() {
+    powerSaver.wake();
 }
 
 /*
- * Reads the digital pin of the DHT sensor. Acts as a statemachine to prevent polling.
- * @return Returns true if a new value was available.
+ * Pin change handler of the RTC INT/SQW pin. Sets the alarm flag on the falling edge.
  */
-static bool DHT_read(float *temperatureMes, float *humidityMes) {
-    static unsigned long timestampDHT = millis();
+void RTC_interrupt() {
+    if (digitalRead(RTC_INT_PIN) == LOW) {
+        RTCAlarmFlag = true;
+    }
+}
 
-    // Measure once every four seconds.
-    if (millis() - timestampDHT > 3000ul || millis() < 4000) {
-        if (dht_sensor.measure(temperatureMes, humidityMes) == true) {
-            timestampDHT = millis();
-            return (true);
-        }
+#ifdef DHT_INTERRUPT
+/*
+ * Pin change handler of the DHT data pin. Timestamps and decodes the edge.
+ */
+void DHT_interrupt_edge() {
+    dht_inside.pin_changed();
+}
+
+#ifdef DHT_OUTSIDE
+/*
+ * Pin change handler of the outside DHT data pin.
+ */
+void DHT_outside_interrupt_edge() {
+    dht_outside.pin_changed();
+}
+#endif
+
+#ifdef DHT_FRIDGE
+/*
+ * Pin change handler of the fridge DHT data pin.
+ */
+void DHT_fridge_interrupt_edge() {
+    dht_fridge.pin_changed();
+}
+#endif
+#endif
+
+/*
+ * Pin change handler of the MPU INT pin. Sets the FIFO overflow flag on the rising edge.
+ */
+void MPU_interrupt() {
+    if (digitalRead(MPU_INT_PIN) == HIGH) {
+        MPUFifoFlag = true;
     }
-    return (false);
 }
 
 // --------------------- User Inputs --------------------
 
 /*
- * User input by interrupt switch. Enter or leave the menu.
+ * User input by interrupt switch. Debounces the switch and handles the press.
  */
 void rotary_interrupt() {
     if (millis() - timestampInterrupt > 500) {
         DEBUG_PRINTLN("Switch has been pressed");
         timestampInterrupt = millis();
-        timestampIdle = millis();
-        DISPLAY_STATE displayState = display.getDisplayState();
-        uint8_t menuItem = display.getMenuItem();
-        switch (displayState) {
-            case STANDBY:
-                display_wake_up();
-                break;
-            case MENU_DHT:
-                switch (menuItem) {
-                    case 0:  // enter scrolling
-                        display.setMenuItem(1);
-                        break;
-                    default:
-                        // leave scrolling
-                        display.setMenuItem(0);
-                        break;
-                }
-                break;
-            case MENU_CLOCK:
-                // go through all clock items (i.e. hour, minute, day, month, year)
-                switch (menuItem) {
-                    case 5:     // last item (year)
-                        display.setMenuItem(0);
-                        RTC_device.getDateTime();
-                        // update time on RTC device (but use the old seconds)
-                        RTC_device.setDateTime(RTCSettings.year, RTCSettings.month, RTCSettings.day, RTCSettings.hour, RTCSettings.minute, RTC_device.t.second);
-                        break;
-                    default:    // select next item
-                        display.setMenuItem(counter(menuItem, 1, 0, 5, false));
-                        break;
-                }
-                break;
-            case MENU_RESTART:
-                switch (menuItem) {
-                    case 0:
-                        display.setMenuItem(1);
-                        break;
-                    case 1:  // no
-                        display.setMenuItem(0);
-                        break;
-                    case 2:  // yes
-                        restartFunc();
-                        break;
-                    default:
-                        break;
-                }
-                break;
-            default:
-                break;
-        }
+#ifdef TRACE
+        sensorTrace.recordRotary(millis(), TRACE_ROTARY_PRESS);
+#endif
+        rotary_press();
+    }
+}
+
+/*
+ * User input by a press of the rotary switch. Enter or leave the menu.
+ */
+void rotary_press() {
+    timestampIdle = millis();
+    DISPLAY_STATE displayState = display.getDisplayState();
+    uint8_t menuItem = display.getMenuItem();
+    switch (displayState) {
+        case STANDBY:
+            display_wake_up();
+            break;
+        case MENU_DHT:
+            switch (menuItem) {
+                case 0:  // enter scrolling
+                    display.setMenuItem(1);
+                    break;
+                default:
+                    // leave scrolling and show the next sensor
+                    display.setMenuItem(0);
+                    dhtPage = (dhtPage + 1) % dhtManager.getCount();
+                    break;
+            }
+            break;
+        case MENU_CLOCK:
+            // go through all clock items (i.e. hour, minute, day, month, year)
+            switch (menuItem) {
+                case 5:     // last item (year)
+                    display.setMenuItem(0);
+                    RTC_device.getDateTime();
+                    // update time on RTC device (but use the old seconds)
+                    RTC_device.setDateTime(RTCSettings.year, RTCSettings.month, RTCSettings.day, RTCSettings.hour, RTCSettings.minute, RTC_device.t.second);
+                    softClock.resync(millis());
+                    break;
+                default:    // select next item
+                    display.setMenuItem(counter(menuItem, 1, 0, 5, false));
+                    break;
+            }
+            break;
+        case MENU_CALIBRATION:
+            switch (menuItem) {
+                case 0:
+                    display.setMenuItem(1);
+                    break;
+                case 1:  // no
+                    display.setMenuItem(0);
+                    break;
+                case 2:  // yes
+                    display.setMenuItem(3);  // calibrated by the next display refresh (not in the interrupt)
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case MENU_RESTART:
+            switch (menuItem) {
+                case 0:
+                    display.setMenuItem(1);
+                    break;
+                case 1:  // no
+                    display.setMenuItem(0);
+                    break;
+                case 2:  // yes
+                    restartFunc();
+                    break;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
     }
 }
 
@@ -594,6 +1217,7 @@ void rotary_turn(int8_t direction) {
         } else {
             // scroll through menus
             display.setDisplayState(static_cast<DISPLAY_STATE>(counter(displayState, direction, 1, COUNT - 1, false)));
+            TwiQueue::flush();  // the display uses the blocking Wire library
             display.clear();
         }
     } else {
@@ -625,9 +1249,12 @@ void rotary_turn(int8_t direction) {
                         break;
                 }
                 break;
+            case MENU_CALIBRATION:
             case MENU_RESTART:
                 // change yes/no selection
-                display.setMenuItem(counter(menuItem, direction, 1, 2, false));
+                if (menuItem <= 2) {
+                    display.setMenuItem(counter(menuItem, direction, 1, 2, false));
+                }
                 break;
             default:
                 break;
@@ -641,7 +1268,8 @@ void rotary_turn(int8_t direction) {
  * Refreshes the display based on the display state.
  */
 void display_refresh() {
-    unsigned long dt = millis();
+    PROFILE_BEGIN(PROFILE_DISPLAY);
+    TwiQueue::flush();  // the display uses the blocking Wire library
     switch (display.getDisplayState()) {
         case STANDBY:
             break;
@@ -657,15 +1285,16 @@ void display_refresh() {
         case MENU_CLOCK:
             display_menu_clock();
             break;
+        case MENU_CALIBRATION:
+            display_menu_calibration();
+            break;
         case MENU_RESTART:
             display_menu_restart();
             break;
         default:
             display_menu_main();
     }
-    dt = millis() - dt;
-    // DEBUG_PRINT("dt (ms): ");
-    // DEBUG_PRINTVARLN(dt);
+    PROFILE_END(PROFILE_DISPLAY);
 }
 
 /*
@@ -673,7 +1302,24 @@ void display_refresh() {
  */
 void display_wake_up() {
     DEBUG_PRINTLN("Waking up from standby...");
+    DEBUG_PRINT("Awake fraction (permille): ");
+    DEBUG_PRINTVARLN(powerSaver.getAwakePermille());
     display.setDisplayState(MENU_MAIN);
+    scheduler.setPeriod(taskRotary, 0);
+    scheduler.trigger(taskRotary, millis());
+}
+
+/*
+ * Sleep until the next task is due. A pin change of the rotary or the water switches
+ * makes the rotary and sensor task due immediately.
+ */
+void standby_sleep() {
+    powerSaver.sleep(scheduler.timeToNext(millis()));
+    if (powerSaver.wakeRequested()) {
+        unsigned long now = millis();
+        scheduler.trigger(taskRotary, now);
+        scheduler.trigger(taskSensors, now);
+    }
 }
 
 /*
@@ -681,7 +1327,7 @@ void display_wake_up() {
  */
 void display_render_header() {
     display.renderHeadline(1);
-    display.renderTime(RTC_device.t.hour, RTC_device.t.minute);
+    display.renderTime(softClock.t.hour, softClock.t.minute);
     display.renderPageNr(0, 19);
 }
 
@@ -690,23 +1336,21 @@ void display_render_header() {
  */
 void display_render_footer() {
     display.renderFootline(6);
-    display.renderDate(RTC_device.t.day, RTC_device.t.month, RTC_device.t.year, 7, 0);
-    display.renderTemperature(DHTData.temperature, 7, 18);
+    display.renderDate(softClock.t.day, softClock.t.month, softClock.t.year, 7, 0);
+    display.renderTemperature(dhtSensors[DHT_INSIDE].temperature, 7, 18);
 }
 
 /*
  * Render the main menu
  */
 void display_menu_main() {
-    float phiX_mean = floatAverage(MPUHistory.phiX, MPU_HISTORY_COUNT);
-    float phiY_mean = floatAverage(MPUHistory.phiY, MPU_HISTORY_COUNT);
     display_render_header();
     display_render_footer();
 
-    display.renderHumidity(DHTData.humidity, 2);
+    display.renderHumidity(dhtSensors[DHT_INSIDE].humidity, 2);
     display.renderFreshWater(WaterData.fresh, 3);
     display.renderGreyWater(WaterData.grey, 4);
-    display.renderAngles(phiX_mean, phiY_mean, 5);
+    display.renderAngles(tiltFilterX.getAngle() / 100.0, tiltFilterY.getAngle() / 100.0, 5);
 }
 
 /*
@@ -718,36 +1362,39 @@ void display_menu_battery() {
     sprintf(buffer, "Batteriewerte:");
     display.renderText(buffer, 0, 2);
 
-    display.renderBatterySOC(DCData.soc, DCData.voltage, 3);
-    display.renderBatteryVoltage(DCData.voltage, 4);
-    display.renderBatteryCurrent(DCData.current, 5);
-    display.renderBatteryPower(DCData.power, 6);
+    display.renderBatterySOC(DCData.soc, DCData.voltage * 0.001, 3);
+    display.renderBatteryVoltage(DCData.voltage * 0.001, 4);
+    display.renderBatteryCurrent(DCData.current * 0.001, 5);
+    display.renderBatteryPower(DCData.power * 0.001, 6);
     display.renderBatteryEnergy(DCData.energy24, DC_ENERGY_COUNT, 7);
 }
 
 /*
- * Render the menu with DHT history data.
+ * Render the menu with the DHT data of one sensor (dhtPage): name, last reading, error rate and history.
  */
 void display_menu_DHT() {
     display_render_header();
+    const DHTSensorType &sensor = dhtSensors[dhtPage];
     char buffer[25];
-    if (display.getMenuItem() >= 1) {
-        // show scrolling
-        sprintf(buffer, "Vergangene Werte:<->");
+    // show scrolling
+    sprintf(buffer, "%-8s Verlauf %s", sensor.name, display.getMenuItem() >= 1 ? "<->" : "   ");
+    display.renderText(buffer, 0, 2);
+    if (sensor.valid) {
+        sprintf(buffer, "%3dC %3d%% Fehler%3u%%", (int)sensor.temperature, (int)sensor.humidity, dhtManager.getErrorRate(dhtPage));
     } else {
-        sprintf(buffer, "Vergangene Werte:   ");
+        sprintf(buffer, " --C  --%% Fehler%3u%%", dhtManager.getErrorRate(dhtPage));
     }
-    display.renderText(buffer, 0, 2);
+    display.renderText(buffer, 0, 3);
 
     uint8_t start = display.getMenuItem() == 0 ? 0 : display.getMenuItem() - 1;
     uint8_t end = min(start + 5, DHT_HISTORY_COUNT - 1);  // only 6 items fit on the display (0-5)
     char label[2];
     sprintf(label, "h");
-    display.renderInt8Array(DHTHistory.hour, start, end, label, 4);
+    display.renderInt8Array(dhtManager.getHistoryHours(), start, end, label, 4);
     sprintf(label, "T");
-    display.renderInt8Array(DHTHistory.temperature, start, end, label, 5);
+    display.renderInt8Array(sensor.temperatureHistory, start, end, label, 5);
     sprintf(label, "H");
-    display.renderInt8Array(DHTHistory.humidity, start, end, label, 6);
+    display.renderInt8Array(sensor.humidityHistory, start, end, label, 6);
     sprintf(label, "B");
     display.renderFloatIntArray(DCData.energy24, start, end, label, 7);
 }
@@ -770,7 +1417,7 @@ void display_menu_clock() {
     display.renderDate(RTCSettings.day, RTCSettings.month, RTCSettings.year, 7, 4);
 
     if (menuItem == 0) {
-        RTCSettings = RTC_device.t;     // get current time
+        RTCSettings = softClock.t;      // get current time
         // clear selector
         display.renderText(clearBuffer, 0, 4);
         display.renderText(clearBuffer, 0, 6);
@@ -808,6 +1455,38 @@ void display_menu_clock() {
     }
 }
 
+/*
+ * Render the menu to calibrate the tilt on level ground. The calibration runs here after the
+ * confirmation, the fused tilt shows its result.
+ */
+void display_menu_calibration() {
+    display_render_header();
+
+    char buffer[25];
+    sprintf(buffer, "Kalibrieren?");
+    display.renderText(buffer, 5, 3);
+    switch (display.getMenuItem()) {
+        case 1:
+            display.renderYesNo(false, 5);
+            break;
+        case 2:
+            display.renderYesNo(true, 5);
+            break;
+        case 3:
+            display.clearLine(5);
+            sprintf(buffer, "Bitte warten...");
+            display.renderText(buffer, 3, 5);
+            MPU_calibrate();
+            display.setMenuItem(0);
+            display.clearLine(5);
+            break;
+        default:
+            display.clearLine(5);
+            break;
+    }
+    display.renderAngles(tiltFilterX.getAngle() / 100.0, tiltFilterY.getAngle() / 100.0, 7);
+}
+
 /*
  * Render the menu to restart the device.
  */
@@ -882,20 +1561,6 @@ int counter16(uint16_t oldValue, uint16_t direction, uint16_t minValue, uint16_t
     return newValue;
 }
 
-/*
- * Calculate average of a float array.
- * @param array Float array to calculate the average of.
- * @param count Number of items in the array.
- * @return Average of the array
- */
-float floatAverage(float *array, int count) {
-    double sum = 0;
-    for (int i = 0; i < count; i++) {
-        sum += array[i];
-    }
-    return ((float)sum) / count;
-}
-
 /*
  * Pushes a int value to an array at index 0.
  * @param array Integer array to push a value to.
@@ -968,20 +1633,145 @@ void DEBUG_PRINT_FLOAT_ARRAY(float *array, uint8_t count) {
 #endif
 }
 
+/*
+ * Measures the blocking I2C operations at the standard and the fast mode clock and prints the
+ * mean times in us to the serial. The clock of the bus is set to I2C_CLOCK again afterwards.
+ */
+void I2C_benchmark() {
+#ifdef I2C_BENCHMARK
+    const uint32_t frequencies[] = {TWI_FREQUENCY, TWI_FAST_FREQUENCY};
+    for (uint8_t i = 0; i < 2; i++) {
+        TwiQueue::begin(frequencies[i]);
+        unsigned long start = micros();
+        for (uint8_t run = 0; run < I2C_BENCHMARK_RUNS; run++) {
+            MPU_device.getData();
+        }
+        unsigned long timeMPU = (micros() - start) / I2C_BENCHMARK_RUNS;
+        start = micros();
+        for (uint8_t run = 0; run < I2C_BENCHMARK_RUNS; run++) {
+            RTC_device.getDateTime();
+        }
+        unsigned long timeRTC = (micros() - start) / I2C_BENCHMARK_RUNS;
+        start = micros();
+        for (uint8_t run = 0; run < I2C_BENCHMARK_RUNS; run++) {
+            display_refresh();
+        }
+        unsigned long timeDisplay = (micros() - start) / I2C_BENCHMARK_RUNS;
+
+        Serial.print(F("I2C benchmark "));
+        Serial.print(TwiQueue::getFrequency() / 1000);
+        Serial.print(F(" kHz: MPU getData "));
+        Serial.print(timeMPU);
+        Serial.print(F(" us, RTC getDateTime "));
+        Serial.print(timeRTC);
+        Serial.print(F(" us, display refresh "));
+        Serial.print(timeDisplay);
+        Serial.println(F(" us"));
+    }
+    TwiQueue::begin(I2C_CLOCK);
+#endif
+}
+
+void tilt_benchmark() {
+#ifdef TILT_BENCHMARK
+    MPU_device.readRaw();
+    volatile int16_t AcX = MPU_device.raw.AcX;  // volatile: read in every run
+    volatile int16_t AcY = MPU_device.raw.AcY;
+    volatile int16_t AcZ = MPU_device.raw.AcZ;
+    int16_t tiltX, tiltY;
+    unsigned long start = micros();
+    for (uint8_t run = 0; run < TILT_BENCHMARK_RUNS; run++) {
+        MPU_device.getTilt(AcX, AcY, AcZ, tiltX, tiltY);
+    }
+    unsigned long cyclesFixed = (micros() - start) * (F_CPU / 1000000L) / TILT_BENCHMARK_RUNS;
+
+    // Former float math of the driver (MPU6050::getAngles()): asin of the normalized vector
+    float phiX, phiY;
+    start = micros();
+    for (uint8_t run = 0; run < TILT_BENCHMARK_RUNS; run++) {
+        float x = (AcX + MPU6050_OFFSET_AcX) / (float)MPU6050_Ac_convert;
+        float y = (AcY + MPU6050_OFFSET_AcY) / (float)MPU6050_Ac_convert;
+        float z = (AcZ + MPU6050_OFFSET_AcZ) / (float)MPU6050_Ac_convert;
+        float length = sqrt(x * x + y * y + z * z);
+        phiY = asin(x / length) * RAD_TO_DEG - MPU6050_OFFSET_phiY;
+        phiX = asin(y / length) * RAD_TO_DEG - MPU6050_OFFSET_phiX;
+    }
+    unsigned long cyclesFloat = (micros() - start) * (F_CPU / 1000000L) / TILT_BENCHMARK_RUNS;
+
+    Serial.print(F("Tilt benchmark: fixed "));
+    Serial.print(cyclesFixed);
+    Serial.print(F(" cycles ("));
+    Serial.print(tiltX / 100.0);
+    Serial.print(F(", "));
+    Serial.print(tiltY / 100.0);
+    Serial.print(F(" deg), float "));
+    Serial.print(cyclesFloat);
+    Serial.print(F(" cycles ("));
+    Serial.print(phiX);
+    Serial.print(F(", "));
+    Serial.print(phiY);
+    Serial.println(F(" deg)"));
+#endif
+}
+
+/*
+ * Benchmark of the DC processing at startup: the CPU cycles of the fixed-point conversion and
+ * filter of DC_process() and of the former float math, printed to the serial port.
+ */
+void DC_benchmark() {
+#ifdef DC_BENCHMARK
+    volatile uint16_t rawVoltage = 8100;  // volatile: read in every run (12.36 V, 1.6 A)
+    volatile uint16_t rawCurrent = 7850;
+    int32_t voltageAverage = 0, currentAverage = 0, power = 0;
+    unsigned long start = micros();
+    for (uint8_t run = 0; run < DC_BENCHMARK_RUNS; run++) {
+        int32_t voltageRaw = fixedScale(rawVoltage, DC_VOLTAGE_FACTOR, 16 - FIXED_FRACTION);
+        int32_t currentRaw = fixedScale(DC_CURRENT_ZERO - (int32_t)rawCurrent, DC_CURRENT_FACTOR, 15 - FIXED_FRACTION);
+        voltageAverage = fixedEma(voltageAverage, voltageRaw, DC_EMA_WEIGHT, DC_EMA_SHIFT);
+        currentAverage = fixedEma(currentAverage, currentRaw, DC_EMA_WEIGHT, DC_EMA_SHIFT);
+        power = fixedRound(voltageAverage, FIXED_FRACTION) * fixedRound(currentAverage, FIXED_FRACTION) / 1000;
+    }
+    unsigned long cyclesFixed = (micros() - start) * (F_CPU / 1000000L) / DC_BENCHMARK_RUNS;
+
+    // Former float math of DC_process()
+    float voltage = 0, current = 0, powerFloat = 0, energy = 0;
+    start = micros();
+    for (uint8_t run = 0; run < DC_BENCHMARK_RUNS; run++) {
+        float voltageRaw = rawVoltage * 5.0 / 16384.0 / 0.2;
+        float currentRaw = -((rawCurrent * 5000.0 / 16384.0 - 2500.0) / 66.2);
+        current = 0.3 * currentRaw + 0.7 * current;
+        voltage = 0.3 * voltageRaw + 0.7 * voltage;
+        powerFloat = voltage * current;
+        energy = energy + (current * SENSOR_PERIOD / 1000.0 / 60.0 / 60.0);
+    }
+    unsigned long cyclesFloat = (micros() - start) * (F_CPU / 1000000L) / DC_BENCHMARK_RUNS;
+
+    Serial.print(F("DC benchmark: fixed "));
+    Serial.print(cyclesFixed);
+    Serial.print(F(" cycles ("));
+    Serial.print(power);
+    Serial.print(F(" mW), float "));
+    Serial.print(cyclesFloat);
+    Serial.print(F(" cycles ("));
+    Serial.print(powerFloat);
+    Serial.println(F(" W)"));
+#endif
+}
+
 void DEBUG_PLOTTER() {
 #ifdef PLOTTER
     Serial.print(F("Time:"));
-    Serial.print(RTC_device.t.hour);
+    Serial.print(softClock.t.hour);
     Serial.print(F(":"));
-    Serial.print(RTC_device.t.minute);
+    Serial.print(softClock.t.minute);
     Serial.print(F(":"));
-    Serial.print(RTC_device.t.second);
+    Serial.print(softClock.t.second);
     Serial.print(F(","));
     Serial.print(F("Temperature:"));
-    Serial.print(DHTData.temperature);
+    Serial.print(dhtSensors[DHT_INSIDE].temperature);
     Serial.print(F(","));
     Serial.print(F("Humidity:"));
-    Serial.print(DHTData.humidity);
+    Serial.print(dhtSensors[DHT_INSIDE].humidity);
     Serial.print(F(","));
     Serial.print(F("AcX:"));
     Serial.print(MPU_device.data.AcX);
@@ -1010,11 +1800,20 @@ void DEBUG_PLOTTER() {
     Serial.print(F("phiY:"));
     Serial.print(MPU_device.data.phiY);
     Serial.print(F(","));
+    Serial.print(F("tiltX:"));
+    Serial.print(tiltFilterX.getAngle() / 100.0);
+    Serial.print(F(","));
+    Serial.print(F("tiltY:"));
+    Serial.print(tiltFilterY.getAngle() / 100.0);
+    Serial.print(F(","));
     Serial.print(F("Voltage:"));
-    Serial.print(DCData.voltage);
+    Serial.print(DCData.voltage * 0.001);
     Serial.print(F(","));
     Serial.print(F("Current:"));
-    Serial.print(DCData.current);
+    Serial.print(DCData.current * 0.001);
+    Serial.print(F(","));
+    Serial.print(F("Awake:"));
+    Serial.print(powerSaver.getAwakePermille());
     Serial.print(F(","));
     Serial.println(F(""));
 #endif
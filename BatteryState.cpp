@@ -0,0 +1,146 @@
+/*
+  BatteryState.cpp - State of charge of the battery by coulomb counting.
+
+  Licensed under "MIT" License.
+*/
+#include "BatteryState.h"
+
+// PUBLIC
+
+/*
+ * Constructor of the state. The charge is unknown until the first anchor().
+ * @param capacity Capacity of the battery in Ah (up to 590 Ah)
+ * @param efficiency Charge efficiency: stored share of the charge in %
+ * @param restCurrent Maximum current at rest in mA
+ * @param restTime Time at rest, after which the voltage is the open circuit voltage, in s
+ */
+BatteryState::BatteryState(uint16_t capacity, uint8_t efficiency, uint16_t restCurrent, uint16_t restTime) {
+    full = (int32_t)capacity * 3600000L;
+    this->efficiency = efficiency;
+    this->restCurrent = restCurrent;
+    this->restTime = restTime * 1000UL;
+    rest = 0;
+    anchored = false;
+    restAnchored = false;
+    anchors = 0;
+    charge = 0;
+    charged = 0;
+    discharged = 0;
+    chargeRest = 0;
+    dischargeRest = 0;
+    storeRest = 0;
+}
+
+/*
+ * Integrate the current of a sample.
+ * @param current Mean current since the last update in mA (positive: discharge)
+ * @param dt Time since the last update in ms
+ */
+void BatteryState::update(int32_t current, unsigned long dt) {
+    if (dt > BATTERY_STATE_MAX_DT) {
+        dt = BATTERY_STATE_MAX_DT;
+    }
+    current = constrain(current, -BATTERY_STATE_MAX_CURRENT, BATTERY_STATE_MAX_CURRENT);
+
+    if (current <= (int32_t)restCurrent && current >= -(int32_t)restCurrent) {
+        rest = min(rest + dt, restTime);
+    } else {
+        rest = 0;
+        restAnchored = false;
+    }
+
+    if (current >= 0) {
+        uint32_t out = carry(dischargeRest, (uint32_t)current * dt);
+        discharged += out;
+        charge -= out;
+    } else {
+        uint32_t in = (uint32_t)-current * dt;  // in uAs
+        charged += carry(chargeRest, in);
+        charge += carry(storeRest, in / 100 * efficiency + in % 100 * efficiency / 100);
+    }
+    charge = constrain(charge, 0L, full);
+}
+
+/*
+ * @return true, if the voltage may be taken as the open circuit voltage (after the rest time at
+ * rest, or before the first anchor)
+ */
+bool BatteryState::isResting(void) {
+    return !anchored || rest >= restTime;
+}
+
+/*
+ * Set the charge to the state of charge of the open circuit voltage, if the battery rests.
+ * @param soc State of charge of the voltage in 0.1 % (0 ... 1000)
+ * @return true, if the charge was set
+ */
+bool BatteryState::anchor(uint16_t soc) {
+    if (!isResting()) {
+        return false;
+    }
+    charge = (int32_t)min(soc, (uint16_t)1000) * (full / 1000);
+    anchored = true;
+    if (!restAnchored) {
+        restAnchored = true;
+        anchors++;
+    }
+    return true;
+}
+
+/*
+ * Get the state of charge in 0.1 % (0 ... 1000).
+ */
+uint16_t BatteryState::getSOC(void) {
+    return charge / (full / 1000);
+}
+
+/*
+ * Get the charge in mAs.
+ */
+int32_t BatteryState::getCharge(void) {
+    return charge;
+}
+
+/*
+ * Get the charged mAs since the last reset of the counters (at the terminals).
+ */
+uint32_t BatteryState::getCharged(void) {
+    return charged;
+}
+
+/*
+ * Get the discharged mAs since the last reset of the counters.
+ */
+uint32_t BatteryState::getDischarged(void) {
+    return discharged;
+}
+
+/*
+ * Get the number of rests (and the start), in which the charge was anchored.
+ */
+uint16_t BatteryState::getAnchors(void) {
+    return anchors;
+}
+
+/*
+ * Reset the charged and the discharged mAs (e.g. at the start of an hour). The fractions of a
+ * mAs are kept, so no charge is lost between two counts.
+ */
+void BatteryState::resetCounters(void) {
+    charged = 0;
+    discharged = 0;
+}
+
+// PRIVATE
+
+/*
+ * Add uAs to the fraction of a mAs and take the whole mAs out.
+ * @param fraction Fraction in uAs (< 1000), updated
+ * @param uAs Charge to add in uAs
+ * @return Whole mAs
+ */
+uint32_t BatteryState::carry(uint16_t &fraction, uint32_t uAs) {
+    uAs += fraction;
+    fraction = uAs % 1000;
+    return uAs / 1000;
+}
@@ -0,0 +1,60 @@
+/*
+  BatteryState.h - State of charge of the battery by coulomb counting.
+  The current is integrated per sample into a charge in mAs (integer, the fractions of a mAs are
+  carried to the next sample), so the charge doesn't drift by rounding however long it runs.
+  Discharge is taken out completely, of the charge only the share of the charge efficiency is
+  stored (the rest is lost as heat and gas). The charge is limited to the capacity.
+
+  The charged and the discharged mAs are also counted separately (at the terminals, without
+  the efficiency) until the next reset, e.g. for the hourly energy.
+
+  The current drifts the charge by its offset error, so the charge is anchored to the state of
+  charge of the open circuit voltage, but only after a rest: while the current stays below the
+  rest current for the rest time, the voltage is near the open circuit voltage. Until the first
+  anchor (after the start) the state of charge of the voltage is taken at any current.
+
+  An update takes constant time (a few 32 bit divisions).
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef BATTERYSTATE_H
+#define BATTERYSTATE_H
+
+#include "Arduino.h"
+
+#define BATTERY_STATE_MAX_DT 50000       // Longer gaps between two updates (in ms) are cut (mA * ms must fit in 32 bit)
+#define BATTERY_STATE_MAX_CURRENT 40000  // Limit of the current (in mA, beyond the range of the sensor)
+
+class BatteryState {
+   public:
+    BatteryState(uint16_t capacity, uint8_t efficiency = 95, uint16_t restCurrent = 1000, uint16_t restTime = 900);
+    void update(int32_t current, unsigned long dt);
+    bool isResting(void);
+    bool anchor(uint16_t soc);
+    uint16_t getSOC(void);
+    int32_t getCharge(void);
+    uint32_t getCharged(void);
+    uint32_t getDischarged(void);
+    uint16_t getAnchors(void);
+    void resetCounters(void);
+
+   private:
+    int32_t full;           // Charge of the full battery in mAs
+    uint8_t efficiency;     // Stored share of the charge in %
+    uint16_t restCurrent;   // Maximum current at rest in mA
+    uint32_t restTime;      // Time at rest, after which the voltage is the open circuit voltage, in ms
+    uint32_t rest;          // Time at rest so far in ms (up to restTime)
+    bool anchored;          // false: the next anchor() is taken at any current
+    bool restAnchored;      // The charge was anchored in this rest
+    uint16_t anchors;       // Rests with an anchor since the start
+    int32_t charge;         // Charge in mAs (0 ... full)
+    uint32_t charged;       // Charged mAs since the last reset of the counters
+    uint32_t discharged;    // Discharged mAs since the last reset of the counters
+    uint16_t chargeRest;    // Fractions of a mAs in uAs (< 1000) of charged,
+    uint16_t dischargeRest; // discharged
+    uint16_t storeRest;     // and of the stored charge
+    static uint32_t carry(uint16_t &fraction, uint32_t uAs);
+};
+
+#endif
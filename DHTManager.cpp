@@ -0,0 +1,155 @@
+/*
+  DHTManager.cpp - Acquisition of several DHT sensors on different pins by one non-blocking scheduler.
+
+  Licensed under "MIT" License.
+*/
+#include "DHTManager.h"
+
+#include "Arduino.h"
+
+// PUBLIC
+
+/*
+ * Constructor of the manager.
+ * @param sensors Array of the sensors (kept by the caller)
+ * @param count Number of sensors in the array
+ */
+DHTManager::DHTManager(DHTSensorType *sensors, uint8_t count) {
+    this->sensors = sensors;
+    this->count = count;
+    current = DHT_MANAGER_NONE;
+    next = 0;
+    memset(hour, 0, sizeof(hour));
+}
+
+/*
+ * Advance the reads of the sensors. Call it every few ms. While a sensor runs its read sequence,
+ * only this one is polled. Otherwise the due sensors are polled in turn, starting after the one
+ * started last, until one starts its read sequence.
+ * @return Index of the sensor with a new valid reading, -1 if there is none
+ */
+int8_t DHTManager::poll(void) {
+    if (current != DHT_MANAGER_NONE) {
+        return pollSensor(current);
+    }
+    for (uint8_t n = 0; n < count; n++) {
+        uint8_t index = (next + n) % count;
+        if (!isDue(index)) {
+            continue;
+        }
+        int8_t result = pollSensor(index);
+        if (current != DHT_MANAGER_NONE || result >= 0) {
+            next = (index + 1) % count;
+            return result;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Take the data bytes of a transmission as the reading of a sensor (e.g. of a replayed trace).
+ * @param index Index of the sensor
+ * @param raw The 5 data bytes (humidity, temperature, checksum)
+ * @return true, if the checksum matches
+ */
+bool DHTManager::decode(uint8_t index, const uint8_t *raw) {
+    if (index >= count) {
+        return false;
+    }
+    DHTSensorType &entry = sensors[index];
+    if (!entry.sensor->decode(raw, &entry.temperature, &entry.humidity)) {
+        return false;
+    }
+    entry.valid = true;
+    entry.timestamp = millis();
+    return true;
+}
+
+/*
+ * Save the last readings of all sensors to their history arrays.
+ * @param hour Hour of the day after the rollover
+ */
+void DHTManager::pushHistory(uint8_t hour) {
+    push(this->hour, hour);
+    for (uint8_t i = 0; i < count; i++) {
+        push(sensors[i].temperatureHistory, sensors[i].temperature);
+        push(sensors[i].humidityHistory, sensors[i].humidity);
+    }
+}
+
+/*
+ * @return true, while a sensor runs its read sequence (the next poll() may read its bits)
+ */
+bool DHTManager::isReading(void) {
+    return current != DHT_MANAGER_NONE;
+}
+
+uint8_t DHTManager::getCount(void) {
+    return count;
+}
+
+/*
+ * Get the share of failed reads of a sensor (over the last DHT_MANAGER_RATE_WINDOW reads or more).
+ * @param index Index of the sensor
+ * @return Error rate in %
+ */
+uint8_t DHTManager::getErrorRate(uint8_t index) {
+    if (index >= count || sensors[index].reads == 0) {
+        return 0;
+    }
+    return (uint32_t)sensors[index].failures * 100 / sensors[index].reads;
+}
+
+/*
+ * Get the hours of the history arrays (index 0: last rollover).
+ */
+const int8_t *DHTManager::getHistoryHours(void) {
+    return hour;
+}
+
+// PRIVATE
+
+/*
+ * Check, if a sensor may be polled: DHT_MANAGER_PERIOD after its last valid reading.
+ * @param index Index of the sensor
+ */
+bool DHTManager::isDue(uint8_t index) {
+    unsigned long now = millis();
+    return now - sensors[index].timestamp > DHT_MANAGER_PERIOD || now < DHT_MANAGER_STARTUP;
+}
+
+/*
+ * Poll a sensor once and count its finished read.
+ * @param index Index of the sensor
+ * @return index, if the sensor has a new valid reading, -1 otherwise
+ */
+int8_t DHTManager::pollSensor(uint8_t index) {
+    DHTSensorType &entry = sensors[index];
+    uint8_t result = entry.sensor->poll(&entry.temperature, &entry.humidity);
+    current = entry.sensor->active() ? index : DHT_MANAGER_NONE;
+    if (result == DHT_POLL_BUSY) {
+        return -1;
+    }
+    if (entry.reads >= DHT_MANAGER_RATE_WINDOW) {
+        entry.reads /= 2;
+        entry.failures /= 2;
+    }
+    entry.reads++;
+    if (result == DHT_POLL_FAILED) {
+        entry.failures++;
+        return -1;
+    }
+    entry.valid = true;
+    entry.timestamp = millis();
+    return index;
+}
+
+/*
+ * Push a value to a history array at index 0 (the oldest value is dropped).
+ * @param array History array with DHT_HISTORY_COUNT items
+ * @param value Value to push
+ */
+void DHTManager::push(int8_t *array, int8_t value) {
+    memmove(array + 1, array, DHT_HISTORY_COUNT - 1);
+    array[0] = value;
+}
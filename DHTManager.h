@@ -0,0 +1,61 @@
+/*
+  DHTManager.h - Acquisition of several DHT sensors on different pins by one non-blocking scheduler.
+  Every sensor is read once per DHT_MANAGER_PERIOD. Only one sensor at a time runs its read
+  sequence (start signal, transmission), the others wait or cool down meanwhile, so their start
+  pulses are staggered and the 2 s cooldowns overlap. A call of poll() advances at most one
+  sensor, so it never blocks longer than the read of a single sensor, however many are attached.
+
+  Per sensor the last valid reading, its error rate and the hourly history are kept.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef DHTMANAGER_H
+#define DHTMANAGER_H
+
+#include "Arduino.h"
+#include "dht_static.h"
+
+#define DHT_HISTORY_COUNT 24         // Number of DHT history data
+#define DHT_MANAGER_PERIOD 3000      // Time between two valid readings of a sensor (in ms)
+#define DHT_MANAGER_STARTUP 4000     // Time after the start, in which a sensor is read as soon as possible (in ms)
+#define DHT_MANAGER_RATE_WINDOW 100  // Reads, after which the counters of the error rate are halved
+#define DHT_MANAGER_NONE 0xFF        // No sensor in its read sequence
+
+struct DHTSensorType  // DHT sensor with its readings
+{
+    DHT_sensor *sensor;                           // Driver of the sensor
+    const char *name;                             // Name on the display
+    float temperature;                            // Temperature value of the last valid reading
+    float humidity;                               // Humidity value of the last valid reading
+    bool valid;                                   // true, after the first valid reading
+    unsigned long timestamp;                      // Timestamp of the last valid reading
+    uint16_t reads;                               // Finished reads (valid and failed)
+    uint16_t failures;                            // Failed reads
+    int8_t temperatureHistory[DHT_HISTORY_COUNT]; // Temperature array
+    int8_t humidityHistory[DHT_HISTORY_COUNT];    // Humidity array
+};
+
+class DHTManager {
+   public:
+    DHTManager(DHTSensorType *sensors, uint8_t count);
+    int8_t poll(void);
+    bool decode(uint8_t index, const uint8_t *raw);
+    void pushHistory(uint8_t hour);
+    bool isReading(void);
+    uint8_t getCount(void);
+    uint8_t getErrorRate(uint8_t index);
+    const int8_t *getHistoryHours(void);
+
+   private:
+    DHTSensorType *sensors;
+    uint8_t count;
+    uint8_t current;                // Sensor in its read sequence (DHT_MANAGER_NONE: none)
+    uint8_t next;                   // Sensor, which is started next, if it is due
+    int8_t hour[DHT_HISTORY_COUNT]; // Hour array of the history
+    bool isDue(uint8_t index);
+    int8_t pollSensor(uint8_t index);
+    static void push(int8_t *array, int8_t value);
+};
+
+#endif
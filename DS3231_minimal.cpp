@@ -29,12 +29,25 @@ const uint8_t dowArray[] PROGMEM = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
 
 // PUBLIC
 /*
- * Initializing the RTC device.
+ * Constructor of the RTC device. No non-blocking request is pending.
+ * The register shadows start with the power-on values, until begin() reads the device.
+ */
+DS3231::DS3231() {
+    bitRate = 0;
+    statusRequest.status = TWI_IDLE;
+    clearRequest.status = TWI_IDLE;
+    controlShadow = 0b00011100;  // INTCN, RS2, RS1
+    statusShadow = 0b00001000;   // EN32kHz
+}
+
+/*
+ * Initializing the RTC device. The I2C bus must be started before (Wire.begin()).
+ * The control and status registers are read once into their shadows, the settings are only
+ * written afterwards.
  * @return true, if no errors occurred.
  */
 bool DS3231::begin(void) {
-    Wire.begin();
-
+    loadShadow();
     setBattery(true, false);
 
     t.year = 2000;
@@ -49,6 +62,14 @@ bool DS3231::begin(void) {
     return true;
 }
 
+/*
+ * Set the SCL clock of the transactions with the device, if it differs from the clock of the bus.
+ * @param frequency SCL frequency in Hz (0: clock of the bus)
+ */
+void DS3231::setClock(uint32_t frequency) {
+    bitRate = frequency != 0 ? TWI_BIT_RATE(frequency) : 0;
+}
+
 /*
  * Sets the internal time of the RTC device.
  * @param year Year
@@ -59,7 +80,7 @@ bool DS3231::begin(void) {
  * @param second Second
  */
 void DS3231::setDateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second) {
-    Wire.beginTransmission(DS3231_ADDRESS);
+    beginTransmission();
     Wire.write(DS3231_REG_TIME);
 
     Wire.write(dec2bcd(second));
@@ -71,7 +92,7 @@ void DS3231::setDateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour
     Wire.write(dec2bcd(year - 2000));
 
     Wire.write(DS3231_REG_TIME);
-    Wire.endTransmission();
+    endTransmission();
 }
 
 /*
@@ -176,26 +197,20 @@ void DS3231::setDateTime(const char* date, const char* time) {
 
 /*
  * Get the internal time of the RTC device.
- * @return Date time struct
+ * @return Date time struct (the last read time, if the device doesn't answer)
  */
 RTCDateTime DS3231::getDateTime(void) {
+    uint8_t bytes[7];
     int values[7];
 
-    Wire.beginTransmission(DS3231_ADDRESS);
-    Wire.write(DS3231_REG_TIME);
-    Wire.endTransmission();
-
-    Wire.requestFrom(DS3231_ADDRESS, 7);
-
-    while (!Wire.available()) {
-    };
+    if (!readRegisters(DS3231_REG_TIME, bytes, 7)) {
+        return t;  // no answer, the last time stays
+    }
 
     for (int i = 6; i >= 0; i--) {
-        values[i] = bcd2dec(Wire.read());
+        values[i] = bcd2dec(bytes[6 - i]);
     }
 
-    Wire.endTransmission();
-
     t.year = values[0] + 2000;
     t.month = values[1];
     t.day = values[2];
@@ -224,12 +239,12 @@ uint8_t DS3231::isReady(void) {
 void DS3231::setInterruptSetting(bool enabled) {
     uint8_t value;
 
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
 
     value &= 0b11111011;
-    value |= (!enabled << 2);
+    value |= (enabled << 2);
 
-    writeRegister8(DS3231_REG_CONTROL, value);
+    writeControl(value);
 }
 
 /*
@@ -240,12 +255,12 @@ void DS3231::setInterruptSetting(bool enabled) {
 bool DS3231::getInterruptSetting(void) {
     uint8_t value;
 
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
 
     value &= 0b00000100;
     value >>= 2;
 
-    return !value;
+    return value;
 }
 
 /*
@@ -257,7 +272,7 @@ bool DS3231::getInterruptSetting(void) {
 void DS3231::setBattery(bool timeBattery, bool sqwBattery) {
     uint8_t value;
 
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
 
     if (sqwBattery) {
         value |= 0b01000000;
@@ -271,7 +286,7 @@ void DS3231::setBattery(bool timeBattery, bool sqwBattery) {
         value |= 0b10000000;
     }
 
-    writeRegister8(DS3231_REG_CONTROL, value);
+    writeControl(value);
 }
 
 /*
@@ -281,12 +296,12 @@ void DS3231::setBattery(bool timeBattery, bool sqwBattery) {
 void DS3231::setSQWFrequency(DS3231_sqw_t mode) {
     uint8_t value;
 
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
 
     value &= 0b11100111;
     value |= (mode << 3);
 
-    writeRegister8(DS3231_REG_CONTROL, value);
+    writeControl(value);
 }
 
 /*
@@ -296,7 +311,7 @@ void DS3231::setSQWFrequency(DS3231_sqw_t mode) {
 DS3231_sqw_t DS3231::getSQWFrequency(void) {
     uint8_t value;
 
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
 
     value &= 0b00011000;
     value >>= 3;
@@ -311,12 +326,15 @@ DS3231_sqw_t DS3231::getSQWFrequency(void) {
 void DS3231::set32kHzPin(bool enabled) {
     uint8_t value;
 
-    value = readRegister8(DS3231_REG_STATUS);
+    value = statusShadow;
 
     value &= 0b11110111;
     value |= (enabled << 3);
 
-    writeRegister8(DS3231_REG_STATUS, value);
+    if (value != statusShadow) {
+        statusShadow = value;
+        writeStatus(0);
+    }
 }
 
 /*
@@ -326,7 +344,7 @@ void DS3231::set32kHzPin(bool enabled) {
 bool DS3231::get32kHzPin(void) {
     uint8_t value;
 
-    value = readRegister8(DS3231_REG_STATUS);
+    value = statusShadow;
 
     value &= 0b00001000;
     value >>= 3;
@@ -340,11 +358,11 @@ bool DS3231::get32kHzPin(void) {
 void DS3231::forceTempConversion(void) {
     uint8_t value;
 
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
 
     value |= 0b00100000;
 
-    writeRegister8(DS3231_REG_CONTROL, value);
+    writeRegister8(DS3231_REG_CONTROL, value);  // CONV clears itself, so it is not stored in the shadow
 
     do {
     } while ((readRegister8(DS3231_REG_CONTROL) & 0b00100000) != 0);
@@ -352,21 +370,16 @@ void DS3231::forceTempConversion(void) {
 
 /*
  * Read temperature value.
- * @return temperature value converted
+ * @return temperature value converted (NAN, if the device doesn't answer)
  */
 float DS3231::readTemperature(void) {
-    uint8_t msb, lsb;
-
-    Wire.beginTransmission(DS3231_ADDRESS);
-    Wire.write(DS3231_REG_TEMPERATURE);
-    Wire.endTransmission();
-
-    Wire.requestFrom(DS3231_ADDRESS, 2);
+    uint8_t bytes[2];
 
-    while (!Wire.available()) {
-    };
-    msb = Wire.read();
-    lsb = Wire.read();
+    if (!readRegisters(DS3231_REG_TEMPERATURE, bytes, 2)) {
+        return NAN;
+    }
+    uint8_t msb = bytes[0];
+    uint8_t lsb = bytes[1];
 
     return ((((short)msb << 8) | (short)lsb) >> 6) / 4.0f;
 }
@@ -379,21 +392,13 @@ RTCAlarmTime DS3231::getAlarm1(void) {
     uint8_t values[4];
     RTCAlarmTime a;
 
-    Wire.beginTransmission(DS3231_ADDRESS);
-    Wire.write(DS3231_REG_ALARM_1);
-    Wire.endTransmission();
-
-    Wire.requestFrom(DS3231_ADDRESS, 4);
-
-    while (!Wire.available()) {
-    };
+    uint8_t bytes[4] = {0};
+    readRegisters(DS3231_REG_ALARM_1, bytes, 4);
 
     for (int i = 3; i >= 0; i--) {
-        values[i] = bcd2dec(Wire.read() & 0b01111111);
+        values[i] = bcd2dec(bytes[3 - i] & 0b01111111);
     }
 
-    Wire.endTransmission();
-
     a.day = values[0];
     a.hour = values[1];
     a.minute = values[2];
@@ -410,21 +415,13 @@ DS3231_alarm1_t DS3231::getAlarmType1(void) {
     uint8_t values[4];
     uint8_t mode = 0;
 
-    Wire.beginTransmission(DS3231_ADDRESS);
-    Wire.write(DS3231_REG_ALARM_1);
-    Wire.endTransmission();
-
-    Wire.requestFrom(DS3231_ADDRESS, 4);
-
-    while (!Wire.available()) {
-    };
+    uint8_t bytes[4] = {0};
+    readRegisters(DS3231_REG_ALARM_1, bytes, 4);
 
     for (int i = 3; i >= 0; i--) {
-        values[i] = bcd2dec(Wire.read());
+        values[i] = bcd2dec(bytes[3 - i]);
     }
 
-    Wire.endTransmission();
-
     mode |= ((values[3] & 0b01000000) >> 6);
     mode |= ((values[2] & 0b01000000) >> 5);
     mode |= ((values[1] & 0b01000000) >> 4);
@@ -494,13 +491,13 @@ void DS3231::setAlarm1(uint8_t dydw, uint8_t hour, uint8_t minute, uint8_t secon
             break;
     }
 
-    Wire.beginTransmission(DS3231_ADDRESS);
+    beginTransmission();
     Wire.write(DS3231_REG_ALARM_1);
     Wire.write(second);
     Wire.write(minute);
     Wire.write(hour);
     Wire.write(dydw);
-    Wire.endTransmission();
+    endTransmission();
 
     setInterruptAlarm1(interruptEnable);
 
@@ -524,13 +521,73 @@ bool DS3231::isAlarm1(bool clear) {
     return alarm;
 }
 
+/*
+ * A1F of REG_STATUS: post a non-blocking read of the alarm 1 flag to the TWI queue.
+ * The result is picked up by pollAlarm1().
+ * A failed clear of the alarm flag is posted again first, so the read doesn't see the reported alarm again.
+ * @return true, if the read was posted. false, if a read is still pending or the queue is full.
+ */
+bool DS3231::requestAlarm1(void) {
+    if (statusRequest.status != TWI_IDLE) {
+        return false;
+    }
+    if (clearFailed() && !TwiQueue::post(&clearRequest)) {
+        return false;
+    }
+    statusRegister = DS3231_REG_STATUS;
+    statusRequest.address = DS3231_ADDRESS;
+    statusRequest.writeData = &statusRegister;
+    statusRequest.writeLength = 1;
+    statusRequest.readData = &statusValue;
+    statusRequest.readLength = 1;
+    statusRequest.bitRate = bitRate;
+    statusRequest.callback = NULL;
+    return TwiQueue::post(&statusRequest);
+}
+
+/*
+ * A1F of REG_STATUS: check the result of the read posted by requestAlarm1() (non-blocking).
+ * A set flag is cleared by a queued write, which runs before any later read. While a clear
+ * failed, the still set flag is not reported again.
+ * @return true, if the alarm occured. false, if not or the read is not completed yet.
+ */
+bool DS3231::pollAlarm1(void) {
+    if (statusRequest.status == TWI_IDLE || statusRequest.status == TWI_QUEUED || statusRequest.status == TWI_ACTIVE) {
+        return false;
+    }
+    if (statusRequest.status != TWI_DONE) {
+        health.record(statusRequest.status);
+        statusRequest.status = TWI_IDLE;
+        return false;
+    }
+    bool alarm = (statusValue & 0b00000001) && !clearFailed();
+    if (alarm) {
+        clearData[0] = DS3231_REG_STATUS;
+        clearData[1] = (statusShadow | DS3231_STATUS_FLAGS) & 0b11111110;
+        clearRequest.address = DS3231_ADDRESS;
+        clearRequest.writeData = clearData;
+        clearRequest.writeLength = 2;
+        clearRequest.readData = NULL;
+        clearRequest.readLength = 0;
+        clearRequest.bitRate = bitRate;
+        clearRequest.callback = clearCallback;
+        clearRequest.context = this;
+        if (!TwiQueue::post(&clearRequest)) {
+            return false;  // evaluated again by the next call
+        }
+    }
+    health.record(TWI_DONE);
+    statusRequest.status = TWI_IDLE;
+    return alarm;
+}
+
 /*
  * A1IE of REG_CONTROL: set alarm interrupt for alarm 1
  * @param enabled set interrupt true or false
  */
 void DS3231::setInterruptAlarm1(bool armed) {
     uint8_t value;
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
 
     if (armed) {
         value |= 0b00000001;
@@ -538,7 +595,7 @@ void DS3231::setInterruptAlarm1(bool armed) {
         value &= 0b11111110;
     }
 
-    writeRegister8(DS3231_REG_CONTROL, value);
+    writeControl(value);
 }
 
 /*
@@ -547,7 +604,7 @@ void DS3231::setInterruptAlarm1(bool armed) {
  */
 bool DS3231::getInterruptAlarm1(void) {
     uint8_t value;
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
     value &= 0b00000001;
     return value;
 }
@@ -556,12 +613,7 @@ bool DS3231::getInterruptAlarm1(void) {
  * A1F of REG_STATUS: clear/quit alarm 1 flag
  */
 void DS3231::clearAlarm1(void) {
-    uint8_t value;
-
-    value = readRegister8(DS3231_REG_STATUS);
-    value &= 0b11111110;
-
-    writeRegister8(DS3231_REG_STATUS, value);
+    writeStatus(0b00000001);
 }
 
 /*
@@ -572,21 +624,13 @@ RTCAlarmTime DS3231::getAlarm2(void) {
     uint8_t values[3];
     RTCAlarmTime a;
 
-    Wire.beginTransmission(DS3231_ADDRESS);
-    Wire.write(DS3231_REG_ALARM_2);
-    Wire.endTransmission();
-
-    Wire.requestFrom(DS3231_ADDRESS, 3);
-
-    while (!Wire.available()) {
-    };
+    uint8_t bytes[3] = {0};
+    readRegisters(DS3231_REG_ALARM_2, bytes, 3);
 
     for (int i = 2; i >= 0; i--) {
-        values[i] = bcd2dec(Wire.read() & 0b01111111);
+        values[i] = bcd2dec(bytes[2 - i] & 0b01111111);
     }
 
-    Wire.endTransmission();
-
     a.day = values[0];
     a.hour = values[1];
     a.minute = values[2];
@@ -603,21 +647,13 @@ DS3231_alarm2_t DS3231::getAlarmType2(void) {
     uint8_t values[3];
     uint8_t mode = 0;
 
-    Wire.beginTransmission(DS3231_ADDRESS);
-    Wire.write(DS3231_REG_ALARM_2);
-    Wire.endTransmission();
-
-    Wire.requestFrom(DS3231_ADDRESS, 3);
-
-    while (!Wire.available()) {
-    };
+    uint8_t bytes[3] = {0};
+    readRegisters(DS3231_REG_ALARM_2, bytes, 3);
 
     for (int i = 2; i >= 0; i--) {
-        values[i] = bcd2dec(Wire.read());
+        values[i] = bcd2dec(bytes[2 - i]);
     }
 
-    Wire.endTransmission();
-
     mode |= ((values[2] & 0b01000000) >> 5);
     mode |= ((values[1] & 0b01000000) >> 4);
     mode |= ((values[0] & 0b01000000) >> 3);
@@ -673,12 +709,12 @@ void DS3231::setAlarm2(uint8_t dydw, uint8_t hour, uint8_t minute, DS3231_alarm2
             break;
     }
 
-    Wire.beginTransmission(DS3231_ADDRESS);
+    beginTransmission();
     Wire.write(DS3231_REG_ALARM_2);
     Wire.write(minute);
     Wire.write(hour);
     Wire.write(dydw);
-    Wire.endTransmission();
+    endTransmission();
 
     setInterruptAlarm2(interruptEnable);
 
@@ -708,7 +744,7 @@ bool DS3231::isAlarm2(bool clear) {
  */
 void DS3231::setInterruptAlarm2(bool armed) {
     uint8_t value;
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
 
     if (armed) {
         value |= 0b00000010;
@@ -716,7 +752,7 @@ void DS3231::setInterruptAlarm2(bool armed) {
         value &= 0b11111101;
     }
 
-    writeRegister8(DS3231_REG_CONTROL, value);
+    writeControl(value);
 }
 
 /*
@@ -725,7 +761,7 @@ void DS3231::setInterruptAlarm2(bool armed) {
  */
 bool DS3231::getInterruptAlarm2(void) {
     uint8_t value;
-    value = readRegister8(DS3231_REG_CONTROL);
+    value = controlShadow;
     value &= 0b00000010;
     value >>= 1;
     return value;
@@ -735,12 +771,21 @@ bool DS3231::getInterruptAlarm2(void) {
  * A1F of REG_STATUS: clear/quit alarm 1 flag
  */
 void DS3231::clearAlarm2(void) {
-    uint8_t value;
-
-    value = readRegister8(DS3231_REG_STATUS);
-    value &= 0b11111101;
+    writeStatus(0b00000010);
+}
 
-    writeRegister8(DS3231_REG_STATUS, value);
+/*
+ * Compare the shadows of REG_CONTROL and REG_STATUS with the device (e.g. after a power loss
+ * of the RTC) and take over the values of the device.
+ * @return true, if both registers match their shadow. false also without an answer.
+ */
+bool DS3231::verifyRegisters(void) {
+    uint8_t control = controlShadow;
+    uint8_t status = statusShadow;
+    if (!loadShadow()) {
+        return false;
+    }
+    return control == controlShadow && status == statusShadow;
 }
 
 // PRIVATE
@@ -831,24 +876,112 @@ uint8_t DS3231::conv2d(const char* p) {
     return 10 * v + *++p - '0';
 }
 
-void DS3231::writeRegister8(uint8_t reg, uint8_t value) {
+/*
+ * Completion of the non-blocking clear of the alarm flag (called by TwiQueue::poll()).
+ */
+void DS3231::clearCallback(TwiRequest* request) {
+    ((DS3231*)request->context)->health.record(request->status);
+}
+
+/*
+ * Check if the last clear of the alarm flag was not acknowledged.
+ */
+bool DS3231::clearFailed(void) {
+    return clearRequest.status == TWI_NACK || clearRequest.status == TWI_TIMEOUT || clearRequest.status == TWI_ERROR;
+}
+
+/*
+ * Start a blocking Wire transmission at the clock of the device. The queued non-blocking
+ * transactions run first. Ended by endTransmission() or in readRegisters().
+ */
+void DS3231::beginTransmission(void) {
+    TwiQueue::flush();
+    TwiQueue::select(bitRate);
     Wire.beginTransmission(DS3231_ADDRESS);
+}
+
+/*
+ * End a blocking Wire transmission and record its result.
+ * @return true, if the device acknowledged all bytes
+ */
+bool DS3231::endTransmission(void) {
+    uint8_t error = Wire.endTransmission();
+    TwiQueue::select(0);
+    health.recordWire(error);
+    return error == 0;
+}
+
+bool DS3231::writeRegister8(uint8_t reg, uint8_t value) {
+    beginTransmission();
     Wire.write(reg);
     Wire.write(value);
-    Wire.endTransmission();
+    return endTransmission();
 }
 
 uint8_t DS3231::readRegister8(uint8_t reg) {
-    uint8_t value;
-    Wire.beginTransmission(DS3231_ADDRESS);
+    uint8_t value = 0;
+    readRegisters(reg, &value, 1);
+    return value;
+}
+
+/*
+ * Read consecutive registers in one transaction. Bounded by the Wire timeout, a missing
+ * device doesn't block.
+ * @param reg address of the first register
+ * @param values destination of the values
+ * @param length number of registers
+ * @return true, if the device answered. Otherwise the destination is untouched.
+ */
+bool DS3231::readRegisters(uint8_t reg, uint8_t *values, uint8_t length) {
+    beginTransmission();
     Wire.write(reg);
-    Wire.endTransmission();
+    uint8_t error = Wire.endTransmission();
+    if (error == 0 && Wire.requestFrom((uint8_t)DS3231_ADDRESS, length) != length) {
+        error = Wire.getWireTimeoutFlag() ? 5 : 2;
+    }
+    TwiQueue::select(0);
+    health.recordWire(error);
+    if (error != 0) {
+        return false;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        values[i] = Wire.read();
+    }
+    return true;
+}
 
-    Wire.requestFrom(DS3231_ADDRESS, 1);
-    while (!Wire.available()) {
-    };
-    value = Wire.read();
-    Wire.endTransmission();
+/*
+ * Read REG_CONTROL and REG_STATUS in one transaction into their shadows.
+ * @return true, if the device answered. Otherwise the shadows stay.
+ */
+bool DS3231::loadShadow(void) {
+    uint8_t values[2];
+    if (!readRegisters(DS3231_REG_CONTROL, values, 2)) {
+        return false;
+    }
+    controlShadow = values[0] & 0b11011111;  // without CONV
+    statusShadow = values[1] & 0b00001000;   // EN32kHz
+    return true;
+}
 
-    return value;
-}
\ No newline at end of file
+/*
+ * Write REG_CONTROL, if the value differs from its shadow.
+ * @param value new register value
+ */
+void DS3231::writeControl(uint8_t value) {
+    if (value == controlShadow) {
+        return;
+    }
+    if (writeRegister8(DS3231_REG_CONTROL, value)) {
+        controlShadow = value;
+    }
+}
+
+/*
+ * Write REG_STATUS from its shadow without a read: the flags, which are not cleared, are
+ * written as 1 and keep their state.
+ * @param clearFlags flags to clear (DS3231_STATUS_FLAGS)
+ */
+void DS3231::writeStatus(uint8_t clearFlags) {
+    writeRegister8(DS3231_REG_STATUS, (statusShadow | DS3231_STATUS_FLAGS) & ~clearFlags);
+}
@@ -16,6 +16,8 @@
 #define DS3231_minimal
 
 #include "Arduino.h"
+#include "I2CHealth.h"
+#include "TwiQueue.h"
 
 #define DS3231_ADDRESS (0x68)
 
@@ -26,6 +28,8 @@
 #define DS3231_REG_STATUS (0x0F)
 #define DS3231_REG_TEMPERATURE (0x11)
 
+#define DS3231_STATUS_FLAGS (0b10000011)  // OSF, A2F, A1F of REG_STATUS: can only be cleared, writing 1 keeps them
+
 #ifndef RTCDATETIME_STRUCT_H
 #define RTCDATETIME_STRUCT_H
 struct RTCDateTime {
@@ -73,15 +77,19 @@ typedef enum {
 
 class DS3231 {
    public:
+    DS3231();
     bool begin(void);
+    void setClock(uint32_t frequency);
 
     RTCDateTime t;
+    I2CHealth health;  // Results of the transactions
 
     void setDateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
     void setDateTime(uint32_t t);
     void setDateTime(const char* date, const char* time);
     RTCDateTime getDateTime(void);
     uint8_t isReady(void);
+    uint8_t daysInMonth(uint16_t year, uint8_t month);
 
     DS3231_sqw_t getSQWFrequency(void);
     void setSQWFrequency(DS3231_sqw_t mode);
@@ -100,6 +108,8 @@ class DS3231 {
     void setInterruptAlarm1(bool enabled);
     bool getInterruptAlarm1(void);
     void clearAlarm1(void);
+    bool requestAlarm1(void);
+    bool pollAlarm1(void);
 
     void setAlarm2(uint8_t dydw, uint8_t hour, uint8_t minute, DS3231_alarm2_t mode, bool interruptEnable);
     RTCAlarmTime getAlarm2(void);
@@ -110,6 +120,7 @@ class DS3231 {
     void clearAlarm2(void);
 
     void setBattery(bool timeBattery, bool squareBattery);
+    bool verifyRegisters(void);
 
    private:
     uint8_t hour12(uint8_t hour24);
@@ -118,7 +129,6 @@ class DS3231 {
 
     long time2long(uint16_t days, uint8_t hours, uint8_t minutes, uint8_t seconds);
     uint16_t date2days(uint16_t year, uint8_t month, uint8_t day);
-    uint8_t daysInMonth(uint16_t year, uint8_t month);
     uint16_t dayInYear(uint16_t year, uint8_t month, uint8_t day);
     bool isLeapYear(uint16_t year);
     uint8_t dow(uint16_t y, uint8_t m, uint8_t d);
@@ -126,8 +136,25 @@ class DS3231 {
     uint32_t unixtime(void);
     uint8_t conv2d(const char* p);
 
-    void writeRegister8(uint8_t reg, uint8_t value);
+    void beginTransmission(void);
+    bool endTransmission(void);
+    bool writeRegister8(uint8_t reg, uint8_t value);
     uint8_t readRegister8(uint8_t reg);
+    bool readRegisters(uint8_t reg, uint8_t* values, uint8_t length);
+    bool loadShadow(void);
+    void writeControl(uint8_t value);
+    void writeStatus(uint8_t clearFlags);
+    static void clearCallback(TwiRequest* request);
+    bool clearFailed(void);
+
+    uint8_t bitRate;             // TWBR of the SCL clock of the device (0: clock of the bus)
+    TwiRequest statusRequest;    // Non-blocking read of REG_STATUS
+    TwiRequest clearRequest;     // Non-blocking write of REG_STATUS (clears the alarm flag)
+    uint8_t statusRegister;      // Register address of statusRequest
+    uint8_t statusValue;         // Result of statusRequest
+    uint8_t clearData[2];        // Register address and value of clearRequest
+    uint8_t controlShadow;       // Last written value of REG_CONTROL (without CONV)
+    uint8_t statusShadow;        // Last written EN32kHz of REG_STATUS (the flags are owned by the device)
 };
 
 #endif
\ No newline at end of file
@@ -291,7 +291,7 @@ void displayOscar::renderBatteryEnergy(float* energy24, uint8_t count, uint8_t l
  * @param label One char to label the data.
  * @param lineNr Line position Y (0-7) to render to. Default: 0
  */
-void displayOscar::renderInt8Array(int8_t* array, uint8_t startN, uint8_t endN, char* label, uint8_t lineNr) {
+void displayOscar::renderInt8Array(const int8_t* array, uint8_t startN, uint8_t endN, char* label, uint8_t lineNr) {
     char buffer1[25];
     char buffer2[25];
     sprintf(buffer1, "%s: ", label);
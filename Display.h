@@ -12,6 +12,7 @@ typedef enum {
     MENU_BATTERY,
     MENU_DHT,
     MENU_CLOCK,
+    MENU_CALIBRATION,
     MENU_RESTART,
     COUNT
 } DISPLAY_STATE;
@@ -42,7 +43,7 @@ class displayOscar : DisplaySH1106_128x64_I2C {
     void renderBatterySOC(int soc, float voltage, uint8_t lineNr = 0);
     void renderBatteryEnergy(float* energy24, uint8_t count, uint8_t lineNr = 0);
 
-    void renderInt8Array(int8_t* array, uint8_t startN, uint8_t endN, char* label, uint8_t lineNr = 0);
+    void renderInt8Array(const int8_t* array, uint8_t startN, uint8_t endN, char* label, uint8_t lineNr = 0);
     void renderFloatIntArray(float* array, uint8_t startN, uint8_t endN, char* label, uint8_t lineNr = 0);
     void renderText(char text[], uint8_t charNr = 0, uint8_t lineNr  = 0);
     void clearLine(uint8_t lineNr = 0);
@@ -0,0 +1,78 @@
+/*
+  EepromStore.cpp - Records of settings in the EEPROM with a version and a CRC.
+
+  Licensed under "MIT" License.
+*/
+#include "EepromStore.h"
+
+#include <EEPROM.h>
+#include <util/crc16.h>
+
+#include "Arduino.h"
+
+// PUBLIC
+
+/*
+ * Load a record from the EEPROM. The data is untouched, if the record is not valid.
+ * @param address EEPROM address of the record
+ * @param version Version of the layout of the data (1 ... 254)
+ * @param data Destination of the data
+ * @param length Size of the data in bytes
+ * @return true, if version, length and CRC match and the data is loaded
+ */
+bool EepromStore::load(uint16_t address, uint8_t version, void *data, uint8_t length) {
+    if (address + EEPROM_STORE_SIZE(length) > EEPROM.length()) {
+        return false;
+    }
+    if (EEPROM.read(address) != version || EEPROM.read(address + 1) != length) {
+        return false;
+    }
+    uint16_t crcAddress = address + EEPROM_STORE_HEADER + length;
+    uint16_t crc = EEPROM.read(crcAddress) | EEPROM.read(crcAddress + 1) << 8;
+    if (checksum(address, length) != crc) {
+        return false;
+    }
+    uint8_t *bytes = (uint8_t *)data;
+    for (uint8_t i = 0; i < length; i++) {
+        bytes[i] = EEPROM.read(address + EEPROM_STORE_HEADER + i);
+    }
+    return true;
+}
+
+/*
+ * Save a record to the EEPROM (about 3.3 ms per changed byte, blocking).
+ * @param address EEPROM address of the record (EEPROM_STORE_SIZE(length) bytes)
+ * @param version Version of the layout of the data (1 ... 254)
+ * @param data Data to save
+ * @param length Size of the data in bytes
+ */
+void EepromStore::save(uint16_t address, uint8_t version, const void *data, uint8_t length) {
+    if (address + EEPROM_STORE_SIZE(length) > EEPROM.length()) {
+        return;
+    }
+    const uint8_t *bytes = (const uint8_t *)data;
+    EEPROM.update(address, version);
+    EEPROM.update(address + 1, length);
+    for (uint8_t i = 0; i < length; i++) {
+        EEPROM.update(address + EEPROM_STORE_HEADER + i, bytes[i]);
+    }
+    uint16_t crc = checksum(address, length);
+    uint16_t crcAddress = address + EEPROM_STORE_HEADER + length;
+    EEPROM.update(crcAddress, crc & 0xFF);
+    EEPROM.update(crcAddress + 1, crc >> 8);
+}
+
+// PRIVATE
+
+/*
+ * CRC-16 (CCITT) of the header and the data of a record, as stored in the EEPROM.
+ * @param address EEPROM address of the record
+ * @param length Size of the data in bytes
+ */
+uint16_t EepromStore::checksum(uint16_t address, uint8_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < EEPROM_STORE_HEADER + length; i++) {
+        crc = _crc_ccitt_update(crc, EEPROM.read(address + i));
+    }
+    return crc;
+}
@@ -0,0 +1,29 @@
+/*
+  EepromStore.h - Records of settings in the EEPROM with a version and a CRC.
+  A record is the version, the length and the bytes of a struct, followed by the CRC-16
+  (CCITT, util/crc16.h) of all of them. A record is only loaded, if version, length and CRC
+  match, so an erased EEPROM (all 0xFF), an older layout of the struct or a write cut by a
+  reset keep the defaults of the caller. Saving writes only the bytes that changed (the
+  EEPROM endures 100000 writes per byte).
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef EEPROMSTORE_H
+#define EEPROMSTORE_H
+
+#include "Arduino.h"
+
+#define EEPROM_STORE_HEADER 2  // Version and length in front of the data
+#define EEPROM_STORE_SIZE(length) (EEPROM_STORE_HEADER + (length) + 2)  // Bytes of a record in the EEPROM
+
+class EepromStore {
+   public:
+    static bool load(uint16_t address, uint8_t version, void *data, uint8_t length);
+    static void save(uint16_t address, uint8_t version, const void *data, uint8_t length);
+
+   private:
+    static uint16_t checksum(uint16_t address, uint8_t length);
+};
+
+#endif
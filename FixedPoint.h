@@ -0,0 +1,55 @@
+/*
+  FixedPoint.h - Scaled integer arithmetic (Q format) for the measurement paths without FPU.
+  A value in Qn is an int32 with n fraction bits (value * 2^n), e.g. mV or mA with
+  FIXED_FRACTION bits, so a filter keeps the fractions of a mV between two samples. Conversion
+  factors are integers with their own fraction bits, computed by the compiler from the float
+  expression (FIXED_FACTOR), so no float math runs on the board.
+
+  The shifts of negative values are arithmetic (GCC), a Qn value is rounded half up.
+  The callers keep the products within 31 bits (see the ranges at the factors).
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include "Arduino.h"
+
+#define FIXED_FRACTION 8  // Fraction bits of the filtered values (1/256 mV, 1/256 mA)
+
+// Integer factor with shift fraction bits of a constant float expression (folded by the compiler)
+#define FIXED_FACTOR(factor, shift) ((int32_t)((factor) * (1L << (shift)) + 0.5))
+
+/*
+ * Multiply a value by a factor with fraction bits.
+ * @param value Value (any Q format)
+ * @param factor Factor with shift fraction bits (FIXED_FACTOR)
+ * @param shift Fraction bits to drop after the multiplication
+ */
+inline int32_t fixedScale(int32_t value, int32_t factor, uint8_t shift) {
+    return (value * factor) >> shift;
+}
+
+/*
+ * Round a value with fraction bits to an integer.
+ * @param value Value with bits fraction bits
+ * @param bits Fraction bits (>= 1)
+ */
+inline int32_t fixedRound(int32_t value, uint8_t bits) {
+    return (value + (1L << (bits - 1))) >> bits;
+}
+
+/*
+ * Exponential moving average with the weight weight / 2^shift (shift and add, no division).
+ * @param average Average so far (any Q format, the one of the sample)
+ * @param sample New sample
+ * @param weight Weight of the sample in 1/2^shift
+ * @param shift Bits of the weight
+ * @return New average
+ */
+inline int32_t fixedEma(int32_t average, int32_t sample, uint8_t weight, uint8_t shift) {
+    return average + (((sample - average) * weight) >> shift);
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*
+  I2CHealth.cpp - Result counters and backoff of an I2C device.
+  A driver records the result of every transaction. After I2C_DEGRADED_FAILURES failures
+  in a row the device is degraded: it is only tried again after a backoff time, which
+  doubles with every failed try (I2C_BACKOFF_MIN up to 64 s). The first success
+  ends the degraded state.
+
+  Licensed under "MIT" License.
+*/
+#include "I2CHealth.h"
+
+#include "TwiQueue.h"
+
+// PUBLIC
+
+/*
+ * Constructor of the counters. The device starts as not degraded.
+ */
+I2CHealth::I2CHealth() {
+    successes = 0;
+    nacks = 0;
+    timeouts = 0;
+    degradedCount = 0;
+    failures = 0;
+    backoff = 0;
+    retryTime = 0;
+}
+
+/*
+ * Record the result of a transaction.
+ * @param status Result of the transaction (TWI_STATUS: TWI_DONE, TWI_NACK, TWI_TIMEOUT or TWI_ERROR)
+ */
+void I2CHealth::record(uint8_t status) {
+    if (status == TWI_DONE) {
+        successes++;
+        failures = 0;
+        backoff = 0;
+        return;
+    }
+    if (status == TWI_NACK) {
+        nacks++;
+    } else {
+        timeouts++;  // time limit or bus error
+    }
+    if (failures < 0xFF) {
+        failures++;
+    }
+    if (failures == I2C_DEGRADED_FAILURES) {
+        degradedCount++;
+    } else if (failures > I2C_DEGRADED_FAILURES && backoff < I2C_BACKOFF_MAX_SHIFT) {
+        backoff++;  // a try of the degraded device failed
+    }
+    if (failures >= I2C_DEGRADED_FAILURES) {
+        retryTime = millis() + ((unsigned long)I2C_BACKOFF_MIN << backoff);
+    }
+}
+
+/*
+ * Record the result of a blocking Wire transaction.
+ * @param error Result of Wire.endTransmission() (0: success, 2/3: NACK, 4: other error, 5: timeout)
+ */
+void I2CHealth::recordWire(uint8_t error) {
+    switch (error) {
+        case 0:
+            record(TWI_DONE);
+            break;
+        case 4:
+            record(TWI_ERROR);
+            break;
+        case 5:
+            record(TWI_TIMEOUT);
+            break;
+        default:
+            record(TWI_NACK);
+            break;
+    }
+}
+
+/*
+ * Check if the device may be used: it is not degraded or its backoff time is over.
+ * @param now Current timestamp in ms
+ */
+bool I2CHealth::isDue(unsigned long now) {
+    return failures < I2C_DEGRADED_FAILURES || (long)(now - retryTime) >= 0;
+}
+
+/*
+ * Check if the device failed I2C_DEGRADED_FAILURES times in a row.
+ */
+bool I2CHealth::isDegraded(void) {
+    return failures >= I2C_DEGRADED_FAILURES;
+}
+
+/*
+ * Get the number of failures in a row (0: the last transaction succeeded).
+ */
+uint8_t I2CHealth::getFailures(void) {
+    return failures;
+}
+
+/*
+ * Get the number of successful transactions.
+ */
+unsigned long I2CHealth::getSuccesses(void) {
+    return successes;
+}
+
+/*
+ * Get the number of transactions, which the device did not acknowledge.
+ */
+unsigned long I2CHealth::getNacks(void) {
+    return nacks;
+}
+
+/*
+ * Get the number of transactions, which ran into the time limit or a bus error (TWI_ERROR).
+ */
+unsigned long I2CHealth::getTimeouts(void) {
+    return timeouts;
+}
+
+/*
+ * Get the number of times the device was degraded.
+ */
+uint16_t I2CHealth::getDegradedCount(void) {
+    return degradedCount;
+}
+
+/*
+ * Print the counters as one line to the serial port.
+ * @param name Name of the device
+ */
+void I2CHealth::print(const char *name) {
+    Serial.print(name);
+    Serial.print(F(": "));
+    Serial.print(successes);
+    Serial.print(F(" ok, "));
+    Serial.print(nacks);
+    Serial.print(F(" nack, "));
+    Serial.print(timeouts);
+    Serial.print(F(" timeout, degraded "));
+    Serial.print(degradedCount);
+    Serial.println(isDegraded() ? F("x (now)") : F("x"));
+}
@@ -0,0 +1,44 @@
+/*
+  I2CHealth.h - Result counters and backoff of an I2C device.
+  A driver records the result of every transaction. After I2C_DEGRADED_FAILURES failures
+  in a row the device is degraded: it is only tried again after a backoff time, which
+  doubles with every failed try (I2C_BACKOFF_MIN up to 64 s). The first success
+  ends the degraded state.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef I2CHEALTH_H
+#define I2CHEALTH_H
+
+#include "Arduino.h"
+
+#define I2C_DEGRADED_FAILURES 3   // Failures in a row, which degrade a device
+#define I2C_BACKOFF_MIN 1000      // First backoff time of a degraded device in ms
+#define I2C_BACKOFF_MAX_SHIFT 6   // Maximum backoff time = I2C_BACKOFF_MIN << I2C_BACKOFF_MAX_SHIFT (64 s)
+
+class I2CHealth {
+   public:
+    I2CHealth();
+    void record(uint8_t status);
+    void recordWire(uint8_t error);
+    bool isDue(unsigned long now);
+    bool isDegraded(void);
+    uint8_t getFailures(void);
+    unsigned long getSuccesses(void);
+    unsigned long getNacks(void);
+    unsigned long getTimeouts(void);
+    uint16_t getDegradedCount(void);
+    void print(const char *name);
+
+   private:
+    unsigned long successes;   // Completed transactions
+    unsigned long nacks;       // Transactions not acknowledged (device missing)
+    unsigned long timeouts;    // Transactions aborted by the time limit (bus held or lost)
+    uint16_t degradedCount;    // Number of times the device was degraded
+    uint8_t failures;          // Failures in a row
+    uint8_t backoff;           // Shift of the backoff time
+    unsigned long retryTime;   // Timestamp of the next try of a degraded device in ms
+};
+
+#endif
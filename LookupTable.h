@@ -0,0 +1,159 @@
+/*
+  LookupTable.h - Tables of one and two inputs, built at compile time, for PROGMEM.
+  LookupTable<N> interpolates linearly between N breakpoints, LookupTable2D<NX, NY> bilinearly
+  in a grid of NX x NY values. The factories lookupTable() and lookupTable2D() are constexpr:
+  they copy the breakpoints and outputs of constexpr arrays and compute the reciprocal of every
+  segment width, so an interpolation has no division (a binary search per input, a few
+  multiplications). Declare the table constexpr and PROGMEM, it is built by the compiler and
+  takes no SRAM; the methods read it by pgm_read_float():
+
+    constexpr float inputs[] = {...};  // only used at compile time
+    static_assert(lookupIncreasing(inputs), "inputs must increase");
+    constexpr LookupTable<4> table PROGMEM = lookupTable(inputs, outputs);
+
+  The breakpoints must increase, check them by static_assert(lookupIncreasing(...)). Inputs
+  outside the breakpoints are handled by the LOOKUP_MODE of the table (per input of a 2D table).
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef LOOKUPTABLE_H
+#define LOOKUPTABLE_H
+
+#include "Arduino.h"
+#include "LookupTable1D.h"  // LOOKUP_MODE
+
+// Index sequences (C++11) to expand the arrays in the constexpr factories
+template <uint16_t... I>
+struct LookupIndices {};
+template <uint16_t N, uint16_t... I>
+struct LookupSequence : LookupSequence<N - 1, N - 1, I...> {};
+template <uint16_t... I>
+struct LookupSequence<0, I...> : LookupIndices<I...> {};
+
+/*
+ * Check at compile time, that the breakpoints increase.
+ * @param points Breakpoints
+ * @param index Index of the next breakpoint to check (recursion)
+ */
+template <uint8_t N>
+constexpr bool lookupIncreasing(const float (&points)[N], uint8_t index = 1) {
+    return index >= N || (points[index] > points[index - 1] && lookupIncreasing(points, index + 1));
+}
+
+/*
+ * Breakpoints of an input with the reciprocal widths of their segments.
+ */
+template <uint8_t N>
+struct LookupAxis {
+    static_assert(N >= 2, "A lookup axis needs two breakpoints at least");
+    float points[N];           // Breakpoints (increasing)
+    float reciprocals[N - 1];  // 1 / (points[i + 1] - points[i])
+
+    /*
+     * Find the segment of an input (in PROGMEM) by a binary search.
+     * @param input Input value
+     * @param mode LOOKUP_MODE
+     * @param index Index of the first breakpoint of the segment (0 ... N - 2)
+     * @param fraction Position of the input in the segment (0 ... 1, outside by the mode)
+     */
+    void locate(float input, uint8_t mode, uint8_t &index, float &fraction) const {
+        uint8_t low = 0;
+        uint8_t high = N - 1;
+        while (high - low > 1) {
+            uint8_t middle = (low + high) / 2;
+            if (input < pgm_read_float(&points[middle])) {
+                high = middle;
+            } else {
+                low = middle;
+            }
+        }
+        index = low;
+        fraction = (input - pgm_read_float(&points[low])) * pgm_read_float(&reciprocals[low]);
+        if (mode == LOOKUP_CLAMP) {
+            fraction = constrain(fraction, 0.0f, 1.0f);
+        }
+    }
+};
+
+template <uint8_t N, uint8_t MODE = LOOKUP_CLAMP>
+struct LookupTable {
+    LookupAxis<N> axis;  // Breakpoints of the input
+    float outputs[N];    // Outputs of the breakpoints
+
+    /*
+     * Interpolate the output of an input linearly (table in PROGMEM).
+     */
+    float interpolate(float input) const {
+        uint8_t index;
+        float fraction;
+        axis.locate(input, MODE, index, fraction);
+        float y0 = pgm_read_float(&outputs[index]);
+        return y0 + (pgm_read_float(&outputs[index + 1]) - y0) * fraction;
+    }
+};
+
+template <uint8_t NX, uint8_t NY, uint8_t MODE = LOOKUP_CLAMP>
+struct LookupTable2D {
+    LookupAxis<NX> x;        // Breakpoints of the first input
+    LookupAxis<NY> y;        // Breakpoints of the second input
+    float values[NY * NX];   // Outputs of the grid, row by row (one row per breakpoint of y)
+
+    /*
+     * Interpolate the output of two inputs bilinearly (table in PROGMEM).
+     */
+    float interpolate(float inputX, float inputY) const {
+        uint8_t ix, iy;
+        float fx, fy;
+        x.locate(inputX, MODE, ix, fx);
+        y.locate(inputY, MODE, iy, fy);
+        const float *row = &values[iy * NX + ix];
+        float v00 = pgm_read_float(row);
+        float v01 = pgm_read_float(row + 1);
+        float v10 = pgm_read_float(row + NX);
+        float v11 = pgm_read_float(row + NX + 1);
+        float v0 = v00 + (v01 - v00) * fx;
+        float v1 = v10 + (v11 - v10) * fx;
+        return v0 + (v1 - v0) * fy;
+    }
+};
+
+template <uint8_t N, uint16_t... I>
+constexpr LookupAxis<N> lookupAxis(const float (&points)[N], LookupIndices<I...>) {
+    return LookupAxis<N>{{points[I]..., points[N - 1]}, {1.0f / (points[I + 1] - points[I])...}};
+}
+
+template <uint8_t N, uint8_t MODE, uint16_t... I>
+constexpr LookupTable<N, MODE> lookupTable(const float (&inputs)[N], const float (&outputs)[N], LookupIndices<I...> indices) {
+    return LookupTable<N, MODE>{lookupAxis(inputs, indices), {outputs[I]..., outputs[N - 1]}};
+}
+
+template <uint8_t NX, uint8_t NY, uint8_t MODE, uint16_t... I>
+constexpr LookupTable2D<NX, NY, MODE> lookupTable2D(const float (&inputsX)[NX], const float (&inputsY)[NY],
+                                                    const float (&values)[NY][NX], LookupIndices<I...>) {
+    return LookupTable2D<NX, NY, MODE>{lookupAxis(inputsX, LookupSequence<NX - 1>()), lookupAxis(inputsY, LookupSequence<NY - 1>()),
+                                       {values[I / NX][I % NX]...}};
+}
+
+/*
+ * Build a table of one input at compile time.
+ * @param inputs Breakpoints (increasing)
+ * @param outputs Outputs of the breakpoints
+ */
+template <uint8_t MODE = LOOKUP_CLAMP, uint8_t N>
+constexpr LookupTable<N, MODE> lookupTable(const float (&inputs)[N], const float (&outputs)[N]) {
+    return lookupTable<N, MODE>(inputs, outputs, LookupSequence<N - 1>());
+}
+
+/*
+ * Build a table of two inputs at compile time.
+ * @param inputsX Breakpoints of the first input (increasing)
+ * @param inputsY Breakpoints of the second input (increasing)
+ * @param values Outputs of the grid: values[iy][ix] at inputsX[ix], inputsY[iy]
+ */
+template <uint8_t MODE = LOOKUP_CLAMP, uint8_t NX, uint8_t NY>
+constexpr LookupTable2D<NX, NY, MODE> lookupTable2D(const float (&inputsX)[NX], const float (&inputsY)[NY], const float (&values)[NY][NX]) {
+    return lookupTable2D<NX, NY, MODE>(inputsX, inputsY, values, LookupSequence<NX * NY>());
+}
+
+#endif
@@ -1,31 +1,96 @@
-#include "LookupTable1D.h"
+/*
+  LookupTable1D.cpp - Linear interpolation of a table of breakpoints in PROGMEM.
 
-LookupTable1D::LookupTable1D(const double* inputValues, const double* outputValues, size_t size)
-    : inputValues_(inputValues), outputValues_(outputValues), size_(size) {
-    // No need to check size since it's the responsibility of the user to provide correct sizes
-}
+  Licensed under "MIT" License.
+*/
+#include "LookupTable1D.h"
 
-double LookupTable1D::interpolate(double inputValue) const {
-    size_t index = findClosestIndex(inputValue);
+// PUBLIC
 
-    // Perform linear interpolation
-    double x0 = inputValues_[index];
-    double x1 = inputValues_[index + 1];
-    double y0 = outputValues_[index];
-    double y1 = outputValues_[index + 1];
+/*
+ * Constructor of a table with any breakpoints (binary search).
+ * @param inputs Breakpoints in PROGMEM (increasing)
+ * @param outputs Outputs of the breakpoints in PROGMEM
+ * @param size Number of breakpoints (>= 2)
+ * @param mode LOOKUP_MODE of inputs outside the breakpoints
+ */
+LookupTable1D::LookupTable1D(const float *inputs, const float *outputs, uint8_t size, uint8_t mode) {
+    this->inputs = inputs;
+    this->outputs = outputs;
+    this->size = size;
+    this->mode = mode;
+    first = pgm_read_float(inputs);
+    last = pgm_read_float(inputs + size - 1);
+    reciprocal = 0;
+}
 
-    // Linear interpolation formula
-    return y0 + (y1 - y0) * (inputValue - x0) / (x1 - x0);
+/*
+ * Constructor of a table with breakpoints on a uniform grid (index by multiplication).
+ * @param first First breakpoint
+ * @param step Distance of the breakpoints (> 0)
+ * @param outputs Outputs of the breakpoints in PROGMEM
+ * @param size Number of breakpoints (>= 2)
+ * @param mode LOOKUP_MODE of inputs outside the breakpoints
+ */
+LookupTable1D::LookupTable1D(float first, float step, const float *outputs, uint8_t size, uint8_t mode) {
+    inputs = NULL;
+    this->outputs = outputs;
+    this->size = size;
+    this->mode = mode;
+    this->first = first;
+    last = first + step * (size - 1);
+    reciprocal = 1.0 / step;
 }
 
-size_t LookupTable1D::findClosestIndex(double inputValue) const {
-    for (size_t i = 0; i < size_ - 1; ++i) {
-        if (inputValue >= inputValues_[i] && inputValue <= inputValues_[i + 1]) {
-            return i;
+/*
+ * Interpolate the output of an input linearly between the two breakpoints around it.
+ * @param input Input value
+ * @return Output value (outside the breakpoints by the mode)
+ */
+float LookupTable1D::interpolate(float input) const {
+    if (mode == LOOKUP_CLAMP) {
+        if (input <= first) {
+            return pgm_read_float(outputs);
+        }
+        if (input >= last) {
+            return pgm_read_float(outputs + size - 1);
         }
     }
+    float y0, y1, fraction;
+    if (inputs == NULL) {
+        float position = (input - first) * reciprocal;
+        uint8_t index = position <= 0 ? 0 : (position >= size - 2 ? size - 2 : (uint8_t)position);
+        y0 = pgm_read_float(outputs + index);
+        y1 = pgm_read_float(outputs + index + 1);
+        fraction = position - index;
+    } else {
+        uint8_t index = findSegment(input);
+        float x0 = pgm_read_float(inputs + index);
+        float x1 = pgm_read_float(inputs + index + 1);
+        y0 = pgm_read_float(outputs + index);
+        y1 = pgm_read_float(outputs + index + 1);
+        fraction = (input - x0) / (x1 - x0);
+    }
+    return y0 + (y1 - y0) * fraction;
+}
+
+// PRIVATE
 
-    // This should not happen if the input values are sorted
-    Serial.println("Error: Failed to find closest index.");
-    return 0;
+/*
+ * Find the segment of an input by a binary search: inputs[index] <= input < inputs[index + 1].
+ * @param input Input value (below or above the breakpoints: first or last segment)
+ * @return Index of the first breakpoint of the segment (0 ... size - 2)
+ */
+uint8_t LookupTable1D::findSegment(float input) const {
+    uint8_t low = 0;
+    uint8_t high = size - 1;
+    while (high - low > 1) {
+        uint8_t middle = (low + high) / 2;
+        if (input < pgm_read_float(inputs + middle)) {
+            high = middle;
+        } else {
+            low = middle;
+        }
+    }
+    return low;
 }
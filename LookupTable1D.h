@@ -1,20 +1,41 @@
+/*
+  LookupTable1D.h - Linear interpolation of a table of breakpoints in PROGMEM.
+  The breakpoints (inputs) must increase. For any breakpoints the segment of an input is found
+  by a binary search (log2(size) comparisons); for breakpoints on a uniform grid (first input
+  and step) it is computed by one multiplication with the reciprocal step. The tables stay in
+  the flash and are read by pgm_read_float(), they take no SRAM.
+
+  An input outside the breakpoints is handled by the mode: LOOKUP_CLAMP returns the output of
+  the nearest end, LOOKUP_EXTRAPOLATE extends the first or the last segment.
+
+  Licensed under "MIT" License.
+*/
+
 #ifndef LOOKUPTABLE1D_H
 #define LOOKUPTABLE1D_H
 
-#include <Arduino.h>
+#include "Arduino.h"
 
-class LookupTable1D {
-public:
-    LookupTable1D(const double* inputValues, const double* outputValues, size_t size);
-    double interpolate(double inputValue) const;
+enum LOOKUP_MODE {
+    LOOKUP_CLAMP,       // Output of the first or last breakpoint
+    LOOKUP_EXTRAPOLATE  // Straight line of the first or last segment
+};
 
-private:
-    size_t findClosestIndex(double inputValue) const;
+class LookupTable1D {
+   public:
+    LookupTable1D(const float *inputs, const float *outputs, uint8_t size, uint8_t mode = LOOKUP_CLAMP);
+    LookupTable1D(float first, float step, const float *outputs, uint8_t size, uint8_t mode = LOOKUP_CLAMP);
+    float interpolate(float input) const;
 
-private:
-    const double* inputValues_;
-    const double* outputValues_;
-    size_t size_;
+   private:
+    const float *inputs;   // Breakpoints in PROGMEM (NULL: uniform grid)
+    const float *outputs;  // Outputs of the breakpoints in PROGMEM
+    uint8_t size;          // Number of breakpoints (>= 2)
+    uint8_t mode;          // LOOKUP_MODE
+    float first;           // First breakpoint
+    float last;            // Last breakpoint
+    float reciprocal;      // 1 / step of the uniform grid
+    uint8_t findSegment(float input) const;
 };
 
-#endif // LOOKUPTABLE1D_H
+#endif
@@ -11,6 +11,25 @@
 #include "Arduino.h"
 #include "Wire.h"
 
+// Configuration registers with a shadow copy and their bits, which clear themselves (not stored in the shadow)
+const uint8_t mpuShadowRegisters[MPU6050_SHADOW_COUNT][2] PROGMEM = {
+    {MPU6050_RA_SMPLRT_DIV, 0},
+    {MPU6050_RA_CONFIG, 0},
+    {MPU6050_RA_GYRO_CONFIG, 0},
+    {MPU6050_RA_ACCEL_CONFIG, 0},
+    {MPU6050_RA_FIFO_EN, 0},
+    {MPU6050_RA_INT_PIN_CFG, 0},
+    {MPU6050_RA_INT_ENABLE, 0},
+    {MPU6050_RA_USER_CTRL, 0b00000111},  // FIFO_RESET, I2C_MST_RESET, SIG_COND_RESET
+    {MPU6050_RA_PWR_MGMT_1, 0b10000000}  // DEVICE_RESET
+};
+
+// atan(i / 32) in 0.01 deg for i = 0 ... 32 (first octant of atan2Centi)
+const uint16_t mpuAtanTable[(1 << MPU6050_ATAN_BITS) + 1] PROGMEM = {
+    0, 179, 358, 536, 713, 888, 1062, 1234, 1404, 1571, 1735, 1897, 2056, 2211, 2363, 2511, 2657,
+    2798, 2936, 3070, 3201, 3327, 3451, 3571, 3687, 3800, 3909, 4016, 4119, 4218, 4315, 4409, 4500
+};
+
 // PUBLIC
 
 /*
@@ -19,21 +38,38 @@
  * Either 0x68 for AD0=LOW or 0x69 for AD0=HIGH.
  */
 MPU6050::MPU6050(uint8_t I2C_addr) {
-    devAddr = I2C_addr;    
+    devAddr = I2C_addr;
+    bitRate = 0;
+    request.status = TWI_IDLE;
+    fifoSamples = 0;
+    fifoState = MPU6050_FIFO_IDLE;
+    fifoResetPending = false;
+    fifoOverflows = 0;
+    resetShadow();
+    resetOffset();
 }
 
 /*
  * Reset and initialize the MPU6050. Fine scales for accelerometer & gyroscope.
  * 5 Hz filter to get best static data.
+ * The reset sets the register shadows to the reset values, so only changed registers are written.
  */
 void MPU6050::initialize(void) {
-    writeBit(devAddr, MPU6050_RA_PWR_MGMT_1, 6, 0);        // PWR_MGMT_1: set SLEEP false (wakes up the MPU-6050)
-    writeBit(devAddr, MPU6050_RA_PWR_MGMT_1, 7, 1);        // PWR_MGMT_1: set RESET true
-    writeBits(devAddr, MPU6050_RA_PWR_MGMT_1, 2, 2, 1);    // PWR_MGMT_1: set CLKSEL 1 (clock source = X axis gyro ref)
-    writeBits(devAddr, MPU6050_RA_GYRO_CONFIG, 4, 2, 0);   // GYRO_CONFIG: set FS_SEL 0 (full scale to 250 deg/s)
-    writeBits(devAddr, MPU6050_RA_ACCEL_CONFIG, 4, 2, 0);  // ACCEL_CONFIG: set AFS_SEL (full scale to 2 g)
-    writeBits(devAddr, MPU6050_RA_ACCEL_CONFIG, 4, 2, 0);  // CONFIG: set DLPF_CFG 6 (Low Pass Filter to 5Hz)
-    writeBit(devAddr, MPU6050_RA_PWR_MGMT_1, 6, 0);        // PWR_MGMT_1: set SLEEP false (wakes up the MPU-6050)
+    writeByte(devAddr, MPU6050_RA_PWR_MGMT_1, 0b10000000);  // PWR_MGMT_1: set DEVICE_RESET true (all registers to reset values)
+    writeBits(devAddr, MPU6050_RA_PWR_MGMT_1, 2, 3, 1);     // PWR_MGMT_1: set CLKSEL 1 (clock source = X axis gyro ref)
+    writeBits(devAddr, MPU6050_RA_GYRO_CONFIG, 4, 2, 0);    // GYRO_CONFIG: set FS_SEL 0 (full scale to 250 deg/s)
+    writeBits(devAddr, MPU6050_RA_ACCEL_CONFIG, 4, 2, 0);   // ACCEL_CONFIG: set AFS_SEL (full scale to 2 g)
+    writeBits(devAddr, MPU6050_RA_CONFIG, 2, 3, 6);         // CONFIG: set DLPF_CFG 6 (Low Pass Filter to 5Hz)
+    writeBit(devAddr, MPU6050_RA_PWR_MGMT_1, 6, 0);         // PWR_MGMT_1: set SLEEP false (wakes up the MPU-6050)
+}
+
+/*
+ * Set the SCL clock of the transactions with the device, if it differs from the clock of the bus
+ * (e.g. long wires to the sensor).
+ * @param frequency SCL frequency in Hz (0: clock of the bus)
+ */
+void MPU6050::setClock(uint32_t frequency) {
+    bitRate = frequency != 0 ? TWI_BIT_RATE(frequency) : 0;
 }
 
 /*
@@ -54,11 +90,200 @@ void MPU6050::setBypass(uint8_t enable) {
     writeBit(devAddr, MPU6050_RA_PWR_MGMT_1, 6, 0);   // PWR_MGMT_1: set SLEEP false (wakes up the MPU-6050)
 }
 
+/*
+ * Compare the register shadows with the device (e.g. after a brown-out of the MPU) and take over the
+ * values of the device.
+ * @return true, if all configuration registers match their shadow
+ */
+bool MPU6050::verifyRegisters(void) {
+    bool match = true;
+    for (uint8_t i = 0; i < MPU6050_SHADOW_COUNT; i++) {
+        uint8_t value;
+        if (!readBytes(pgm_read_byte(&mpuShadowRegisters[i][0]), &value, 1)) {
+            return false;  // no answer, the shadows stay
+        }
+        value &= ~pgm_read_byte(&mpuShadowRegisters[i][1]);
+        if (value != shadow[i]) {
+            shadow[i] = value;
+            match = false;
+        }
+    }
+    return match;
+}
+
+/*
+ * Read the raw registers and convert them to physical values and angles.
+ * @return Converted data (also stored in data)
+ */
 MPUDataType MPU6050::getData(void) {
-    getAcceleration(data.AcX, data.AcY, data.AcZ);
-    getGyroscope(data.GyX, data.GyY, data.GyZ);
-    getTemperature(data.Temp);
-    getAngles(data.AcX, data.AcY, data.AcZ, data.phiX, data.phiY);
+    readRaw();
+    return convert(raw);
+}
+
+/*
+ * Read the raw accelerometer, temperature and gyroscope registers in one burst (0x3B ... 0x48),
+ * so all values are from the same sample.
+ * @return Raw registers (also stored in raw)
+ */
+MPURawType MPU6050::readRaw(void) {
+    if (readBytes(MPU6050_RA_ACCEL_XOUT_H, buffer, MPU6050_RAW_LENGTH)) {
+        decodeRaw(buffer);
+    }
+    return raw;
+}
+
+/*
+ * Post a non-blocking burst read of the raw registers to the TWI queue (same registers as readRaw()).
+ * The result is picked up by rawReady().
+ * @return true, if the read was posted. false, if the read is still pending or the queue is full.
+ */
+bool MPU6050::requestRaw(void) {
+    if (request.status == TWI_QUEUED || request.status == TWI_ACTIVE) {
+        return false;
+    }
+    registerAddress = MPU6050_RA_ACCEL_XOUT_H;
+    request.address = devAddr;
+    request.writeData = &registerAddress;
+    request.writeLength = 1;
+    request.readData = buffer;
+    request.readLength = MPU6050_RAW_LENGTH;
+    request.bitRate = bitRate;
+    request.callback = NULL;
+    return TwiQueue::post(&request);
+}
+
+/*
+ * Check if the read posted by requestRaw() is completed and decode its values to raw.
+ * A failed read keeps the last values.
+ * @return true, if the read is completed
+ */
+bool MPU6050::rawReady(void) {
+    if (request.status == TWI_IDLE || request.status == TWI_QUEUED || request.status == TWI_ACTIVE) {
+        return false;
+    }
+    health.record(request.status);
+    if (request.status == TWI_DONE) {
+        decodeRaw(buffer);
+    }
+    request.status = TWI_IDLE;
+    return true;
+}
+
+/*
+ * Start the FIFO mode: the device samples accelerometer, temperature and gyroscope at a fixed
+ * rate into its FIFO. The INT pin goes high on a FIFO overflow (latched until resetFifo()).
+ * @param rate Sample rate in Hz (32 ... 1000 Hz; the FIFO holds 73 samples)
+ */
+void MPU6050::beginFifo(uint16_t rate) {
+    uint8_t dlpf = readShadow(MPU6050_RA_CONFIG) & 0b00000111;
+    uint16_t gyroRate = (dlpf == 0 || dlpf == 7) ? 8000 : 1000;  // gyroscope output rate in Hz
+    uint16_t divider = constrain(gyroRate / rate, 1, 256);
+    writeByte(devAddr, MPU6050_RA_SMPLRT_DIV, divider - 1);
+    writeBits(devAddr, MPU6050_RA_INT_PIN_CFG, 5, 2, 0b10);  // INT_PIN_CFG: set LATCH_INT_EN true, INT_RD_CLEAR false (INT high until INT_STATUS is read)
+    writeByte(devAddr, MPU6050_RA_INT_ENABLE, 0b00010000);   // INT_ENABLE: set FIFO_OFLOW_EN true
+    writeByte(devAddr, MPU6050_RA_FIFO_EN, 0b11111000);      // FIFO_EN: temperature, gyroscope x, y, z and accelerometer
+    writeBits(devAddr, MPU6050_RA_USER_CTRL, 6, 1, 1);       // USER_CTRL: set FIFO_EN true
+    resetFifo();
+    fifoOverflows = 0;
+}
+
+/*
+ * Empty the FIFO (after an overflow the samples are not aligned anymore) and clear the INT pin.
+ * An overflow reported by the device is counted.
+ */
+void MPU6050::resetFifo(void) {
+    if (readByte(devAddr, MPU6050_RA_INT_STATUS) & 0b00010000) {  // FIFO_OFLOW_INT, cleared by the read
+        fifoOverflows++;
+    }
+    writeBits(devAddr, MPU6050_RA_USER_CTRL, 2, 1, 1);  // USER_CTRL: set FIFO_RESET true (clears itself)
+    fifoResetPending = false;
+}
+
+/*
+ * Post a non-blocking drain of the FIFO to the TWI queue: the number of bytes is read first,
+ * then the samples one after another. The average is picked up by fifoReady().
+ * @return true, if the drain was started. false, if a drain is still running or the queue is full.
+ */
+bool MPU6050::requestFifo(void) {
+    if (fifoState != MPU6050_FIFO_IDLE) {
+        return false;
+    }
+    if (fifoResetPending) {
+        resetFifo();
+    }
+    registerAddress = MPU6050_RA_FIFO_COUNTH;
+    request.address = devAddr;
+    request.writeData = &registerAddress;
+    request.writeLength = 1;
+    request.readData = buffer;
+    request.readLength = 2;
+    request.bitRate = bitRate;
+    request.callback = fifoCallback;
+    request.context = this;
+    if (!TwiQueue::post(&request)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < 7; i++) {
+        fifoSum[i] = 0;
+    }
+    fifoSamples = 0;
+    fifoState = MPU6050_FIFO_COUNT;
+    return true;
+}
+
+/*
+ * Check if the drain posted by requestFifo() is completed and store the average of the drained
+ * samples in raw. Without new samples raw keeps the last values.
+ * @return true, if the drain is completed
+ */
+bool MPU6050::fifoReady(void) {
+    if (fifoState != MPU6050_FIFO_DONE) {
+        return false;
+    }
+    if (fifoSamples > 0) {
+        raw.AcX = fifoSum[0] / fifoSamples;
+        raw.AcY = fifoSum[1] / fifoSamples;
+        raw.AcZ = fifoSum[2] / fifoSamples;
+        raw.Temp = fifoSum[3] / fifoSamples;
+        raw.GyX = fifoSum[4] / fifoSamples;
+        raw.GyY = fifoSum[5] / fifoSamples;
+        raw.GyZ = fifoSum[6] / fifoSamples;
+    }
+    fifoState = MPU6050_FIFO_IDLE;
+    return true;
+}
+
+/*
+ * Get the number of samples averaged by the last drain.
+ */
+uint8_t MPU6050::getFifoSamples(void) {
+    return fifoSamples;
+}
+
+/*
+ * Get the number of FIFO overflows since beginFifo().
+ */
+uint16_t MPU6050::getFifoOverflows(void) {
+    return fifoOverflows;
+}
+
+/*
+ * Convert raw registers to physical values (offsets removed) and angles.
+ * Used for live data and for the replay of recorded raw data.
+ * @param rawData Raw registers
+ * @return Converted data (also stored in data)
+ */
+MPUDataType MPU6050::convert(const MPURawType &rawData) {
+    data.AcX = convertAcceleration(rawData.AcX, offset.AcX);
+    data.AcY = convertAcceleration(rawData.AcY, offset.AcY);
+    data.AcZ = convertAcceleration(rawData.AcZ, offset.AcZ);
+    data.GyX = convertGyroscope(rawData.GyX, offset.GyX);
+    data.GyY = convertGyroscope(rawData.GyY, offset.GyY);
+    data.GyZ = convertGyroscope(rawData.GyZ, offset.GyZ);
+    data.Temp = convertTemperature(rawData.Temp);
+    getTilt(rawData.AcX, rawData.AcY, rawData.AcZ, data.tiltX, data.tiltY);
+    data.phiX = data.tiltX / 100.0;
+    data.phiY = data.tiltY / 100.0;
     return data;
 }
 
@@ -69,23 +294,11 @@ MPUDataType MPU6050::getData(void) {
  * @param AcZ z-data of the g-Vector
  */
 void MPU6050::getAcceleration(float &AcX, float &AcY, float &AcZ) {
-    Wire.beginTransmission(devAddr);
-    Wire.write(MPU6050_RA_ACCEL_XOUT_H);  // starting with register 0x3B (ACCEL_XOUT_H)
-    Wire.endTransmission(false);
-    WIRE_REQUEST_FROM(devAddr, 6, true);
-    int16_t AcX_read = Wire.read() << 8 | Wire.read();      // 0x3B (ACCEL_XOUT_H) & 0x3C (ACCEL_XOUT_L)
-    int16_t AcY_read = Wire.read() << 8 | Wire.read();      // 0x3D (ACCEL_YOUT_H) & 0x3E (ACCEL_YOUT_L)
-    int16_t AcZ_read = Wire.read() << 8 | Wire.read();      // 0x3F (ACCEL_ZOUT_H) & 0x40 (ACCEL_ZOUT_L)
-
-    // remove offsets
-    AcX_read += MPU6050_OFFSET_AcX;
-    AcY_read += MPU6050_OFFSET_AcY;
-    AcZ_read += MPU6050_OFFSET_AcZ;
-
-    // convert raw data to g
-    AcX = (float) AcX_read / (float) MPU6050_Ac_convert;
-    AcY = (float) AcY_read / (float) MPU6050_Ac_convert;
-    AcZ = (float) AcZ_read / (float) MPU6050_Ac_convert;
+    int16_t words[3];
+    readWords(MPU6050_RA_ACCEL_XOUT_H, words, 3);  // 0x3B (ACCEL_XOUT_H) ... 0x40 (ACCEL_ZOUT_L)
+    AcX = convertAcceleration(words[0], offset.AcX);
+    AcY = convertAcceleration(words[1], offset.AcY);
+    AcZ = convertAcceleration(words[2], offset.AcZ);
 }
 
 /*
@@ -93,15 +306,9 @@ void MPU6050::getAcceleration(float &AcX, float &AcY, float &AcZ) {
  * @param T temperature value
  */
 void MPU6050::getTemperature(float &T) {
-    Wire.beginTransmission(devAddr);
-    Wire.write(MPU6050_RA_TEMP_OUT_H);  // starting with register 0x43 (TEMP_OUT_H)
-    Wire.endTransmission(false);
-    WIRE_REQUEST_FROM(devAddr, 2, true);
-    int16_t T_read = Wire.read() << 8 | Wire.read();                // 0x3B (TEMP_OUT_H) & 0x3C (TEMP_OUT_L)
-
-    T_read += MPU6050_OFFSET_temp;
-
-    T = (float) T_read / (float) MPU6050_T_convert + 36.53;
+    int16_t word;
+    readWords(MPU6050_RA_TEMP_OUT_H, &word, 1);  // 0x41 (TEMP_OUT_H) & 0x42 (TEMP_OUT_L)
+    T = convertTemperature(word);
 }
 
 /*
@@ -111,85 +318,340 @@ void MPU6050::getTemperature(float &T) {
  * @param GyZ angular z-data
  */
 void MPU6050::getGyroscope(float &GyX, float &GyY, float &GyZ) {
-    Wire.beginTransmission(devAddr);
-    Wire.write(MPU6050_RA_GYRO_XOUT_H);  // starting with register 0x43 (GYRO_XOUT_H)
-    Wire.endTransmission(false);
-    WIRE_REQUEST_FROM(devAddr, 6, true);
-    int16_t GyX_read = Wire.read() << 8 | Wire.read();                   // 0x43 (GYRO_XOUT_H) & 0x44 (GYRO_XOUT_L)
-    int16_t GyY_read = Wire.read() << 8 | Wire.read();                   // 0x45 (GYRO_YOUT_H) & 0x46 (GYRO_YOUT_L)
-    int16_t GyZ_read = Wire.read() << 8 | Wire.read();                   // 0x48 (GYRO_ZOUT_H) & 0x47 (GYRO_ZOUT_L)
+    int16_t words[3];
+    readWords(MPU6050_RA_GYRO_XOUT_H, words, 3);  // 0x43 (GYRO_XOUT_H) ... 0x48 (GYRO_ZOUT_L)
+    GyX = convertGyroscope(words[0], offset.GyX);
+    GyY = convertGyroscope(words[1], offset.GyY);
+    GyZ = convertGyroscope(words[2], offset.GyZ);
+}
+
+/*
+ * Calculate the tilt from raw acceleration values in fixed point (no float math).
+ * phiY = atan2(AcX, sqrt(AcY^2 + AcZ^2)), phiX = atan2(AcY, sqrt(AcX^2 + AcZ^2)), which is
+ * the same as asin(AcX / |a|) and asin(AcY / |a|). The offsets of the acceleration and the
+ * angles are removed (one add per raw value). Error < 0.02 deg for |a| >= 0.25 g.
+ * @param AcX Raw acceleration in x (ACCEL_XOUT)
+ * @param AcY Raw acceleration in y (ACCEL_YOUT)
+ * @param AcZ Raw acceleration in z (ACCEL_ZOUT)
+ * @param tiltX Angle around x in 0.01 deg
+ * @param tiltY Angle around y in 0.01 deg
+ */
+void MPU6050::getTilt(int16_t AcX, int16_t AcY, int16_t AcZ, int16_t &tiltX, int16_t &tiltY) {
+    int32_t x = (int32_t)AcX + offset.AcX;  // 32 bit: the offset may exceed the int16 range
+    int32_t y = (int32_t)AcY + offset.AcY;
+    int32_t z = (int32_t)AcZ + offset.AcZ;
+    uint32_t zz = (uint32_t)(z * z);
+    tiltY = atan2Centi(x, isqrt32((uint32_t)(y * y) + zz)) - offset.tiltY;
+    tiltX = atan2Centi(y, isqrt32((uint32_t)(x * x) + zz)) - offset.tiltX;
+}
+
+/*
+ * Set the offsets to their defaults (MPU6050_OFFSET_*).
+ */
+void MPU6050::resetOffset(void) {
+    offset.AcX = MPU6050_OFFSET_AcX;
+    offset.AcY = MPU6050_OFFSET_AcY;
+    offset.AcZ = MPU6050_OFFSET_AcZ;
+    offset.GyX = MPU6050_OFFSET_GyX;
+    offset.GyY = MPU6050_OFFSET_GyY;
+    offset.GyZ = MPU6050_OFFSET_GyZ;
+    offset.tiltX = MPU6050_OFFSET_TILT_X;
+    offset.tiltY = MPU6050_OFFSET_TILT_Y;
+}
+
+/*
+ * Calibrate the offsets on level ground and at rest (blocking, samples * MPU6050_CALIBRATION_DELAY ms).
+ * The raw values of the samples are averaged. The gyroscope stands still, so its offsets are the
+ * negative means. The mean acceleration is gravity: the offset of z scales it to 1 g and its tilt
+ * is the mounting angle. The offsets of x and y stay, in one orientation their bias can't be told
+ * apart from the mounting angle.
+ * @param samples Number of samples (1 ... 255)
+ * @return true, if all samples were read and the sensor is less than 45 deg off level. Otherwise the offsets stay.
+ */
+bool MPU6050::calibrate(uint8_t samples) {
+    if (samples == 0) {
+        return false;
+    }
+    int32_t sum[7] = {0, 0, 0, 0, 0, 0, 0};
+    for (uint8_t i = 0; i < samples; i++) {
+        uint8_t bytes[MPU6050_RAW_LENGTH];
+        if (!readBytes(MPU6050_RA_ACCEL_XOUT_H, bytes, MPU6050_RAW_LENGTH)) {
+            return false;
+        }
+        for (uint8_t j = 0; j < 7; j++) {
+            sum[j] += (int16_t)(bytes[2 * j] << 8 | bytes[2 * j + 1]);
+        }
+        delay(MPU6050_CALIBRATION_DELAY);
+    }
+    int16_t mean[7];  // order of MPURawType
+    for (uint8_t j = 0; j < 7; j++) {
+        mean[j] = (sum[j] + (sum[j] < 0 ? -(samples / 2) : samples / 2)) / samples;  // rounded
+    }
 
-    // remove offsets
-    GyX_read += MPU6050_OFFSET_GyX;
-    GyY_read += MPU6050_OFFSET_GyY;
-    GyZ_read += MPU6050_OFFSET_GyZ;
+    int32_t x = (int32_t)mean[0] + offset.AcX;
+    int32_t y = (int32_t)mean[1] + offset.AcY;
+    uint32_t horizontal = (uint32_t)(x * x) + (uint32_t)(y * y);
+    const uint32_t gravity = (uint32_t)MPU6050_Ac_convert * MPU6050_Ac_convert;
+    if (mean[2] <= 0 || horizontal >= gravity / 2) {
+        return false;  // upside down or tilted by 45 deg and more
+    }
+    offset.AcZ = isqrt32(gravity - horizontal) - mean[2];
+    offset.GyX = -mean[4];
+    offset.GyY = -mean[5];
+    offset.GyZ = -mean[6];
+    int16_t tiltX, tiltY;
+    offset.tiltX = 0;
+    offset.tiltY = 0;
+    getTilt(mean[0], mean[1], mean[2], tiltX, tiltY);
+    offset.tiltX = tiltX;
+    offset.tiltY = tiltY;
+    return true;
+}
 
-    // convert raw data to deg/s
-    GyX = (float) GyX_read / (float) MPU6050_Gy_convert;
-    GyY = (float) GyY_read / (float) MPU6050_Gy_convert;
-    GyZ = (float) GyZ_read / (float) MPU6050_Gy_convert;
+/*
+ * Integer atan2 by a table of atan() in the first octant (mpuAtanTable) with linear interpolation.
+ * Error < 0.01 deg.
+ * @param y y-coordinate (|y| < 2^16)
+ * @param x x-coordinate (|x| < 2^16)
+ * @return Angle in 0.01 deg (-18000 ... 18000)
+ */
+int16_t MPU6050::atan2Centi(int32_t y, int32_t x) {
+    uint32_t ay = y < 0 ? -y : y;
+    uint32_t ax = x < 0 ? -x : x;
+    if (ax == 0 && ay == 0) {
+        return 0;
+    }
+    bool swapped = ay > ax;  // second octant: atan(y / x) = 90 deg - atan(x / y)
+    uint32_t ratio = swapped ? (ax << 15) / ay : (ay << 15) / ax;  // tan in Q15 (0 ... 32768)
+    uint8_t index = ratio >> (15 - MPU6050_ATAN_BITS);
+    uint16_t fraction = ratio & ((1 << (15 - MPU6050_ATAN_BITS)) - 1);
+    int16_t angle = pgm_read_word(&mpuAtanTable[index]);
+    if (fraction != 0) {
+        uint16_t step = pgm_read_word(&mpuAtanTable[index + 1]) - angle;
+        angle += ((uint32_t)step * fraction + (1 << (14 - MPU6050_ATAN_BITS))) >> (15 - MPU6050_ATAN_BITS);
+    }
+    if (swapped) {
+        angle = 9000 - angle;
+    }
+    if (x < 0) {
+        angle = 18000 - angle;
+    }
+    return y < 0 ? -angle : angle;
 }
 
 // PRIVATE
 
 /*
- * Calculates the angles from the acceleration data.
- * @param AcX x-data of the g-Vector
- * @param AcY y-data of the g-Vector
- * @param AcZ z-data of the g-Vector
- * @param phiX x-angle
- * @param phiY y-angle
+ * Square root of an unsigned 32 bit value (bitwise, rounded to the nearest integer).
+ * @param value Radicand
+ * @return Integer square root
+ */
+uint16_t MPU6050::isqrt32(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return value > root ? root + 1 : root;  // value >= root^2 + root + 1 > (root + 0.5)^2
+}
+
+/*
+ * Completion callback of the FIFO drain (called by TwiQueue::poll()).
+ */
+void MPU6050::fifoCallback(TwiRequest *request) {
+    ((MPU6050 *)request->context)->fifoStep();
+}
+
+/*
+ * Next step of the FIFO drain: evaluate the completed read and post the read of the next sample.
+ */
+void MPU6050::fifoStep(void) {
+    health.record(request.status);
+    if (request.status != TWI_DONE) {
+        if (fifoState == MPU6050_FIFO_DATA) {
+            fifoResetPending = true;  // a sample may be read in part
+        }
+        fifoState = MPU6050_FIFO_DONE;
+        return;
+    }
+    if (fifoState == MPU6050_FIFO_COUNT) {
+        uint16_t count = buffer[0] << 8 | buffer[1];
+        if (count >= MPU6050_FIFO_SIZE || count % MPU6050_RAW_LENGTH != 0) {
+            fifoResetPending = true;  // overflowed, reset by the next requestFifo()
+            fifoState = MPU6050_FIFO_DONE;
+            return;
+        }
+        fifoRemaining = count / MPU6050_RAW_LENGTH;
+    } else {
+        for (uint8_t i = 0; i < 7; i++) {
+            fifoSum[i] += (int16_t)(buffer[2 * i] << 8 | buffer[2 * i + 1]);
+        }
+        fifoSamples++;
+        fifoRemaining--;
+    }
+    if (fifoRemaining == 0) {
+        fifoState = MPU6050_FIFO_DONE;
+        return;
+    }
+    registerAddress = MPU6050_RA_FIFO_R_W;
+    request.writeLength = fifoState == MPU6050_FIFO_COUNT ? 1 : 0;  // the register pointer stays at FIFO_R_W
+    request.readLength = MPU6050_RAW_LENGTH;
+    fifoState = TwiQueue::post(&request) ? MPU6050_FIFO_DATA : MPU6050_FIFO_DONE;  // the completed request left room
+}
+
+/*
+ * Read consecutive 16 bit registers (high byte first) from the device.
+ * @param regAddr address of the first high byte
+ * @param words destination of the values
+ * @param count number of values
+ */
+void MPU6050::readWords(uint8_t regAddr, int16_t *words, uint8_t count) {
+    uint8_t bytes[MPU6050_RAW_LENGTH] = {0};  // values of 0 without an answer
+    readBytes(regAddr, bytes, 2 * count);
+    for (uint8_t i = 0; i < count; i++) {
+        words[i] = bytes[2 * i] << 8 | bytes[2 * i + 1];
+    }
+}
+
+/*
+ * Read consecutive registers from the device in one transaction.
+ * @param regAddr address of the first register
+ * @param bytes destination of the values
+ * @param length number of registers (up to the Wire buffer of 32 bytes)
+ * @return true, if the device answered. Otherwise the destination is untouched.
  */
-void MPU6050::getAngles(float AcX, float AcY, float AcZ, float &phiX, float &phiY) {
-    float xVec[3] = { 1, 0, 0 };
-    float yVec[3] = { 0, 1, 0 };
-    float vec[3] = {AcX, AcY, AcZ};
+bool MPU6050::readBytes(uint8_t regAddr, uint8_t *bytes, uint8_t length) {
+    TwiQueue::flush();
+    TwiQueue::select(bitRate);
+    Wire.beginTransmission(devAddr);
+    Wire.write(regAddr);
+    uint8_t error = Wire.endTransmission(false);
+    if (error == 0 && WIRE_REQUEST_FROM(devAddr, length, true) != length) {
+        error = Wire.getWireTimeoutFlag() ? 5 : 2;
+    }
+    TwiQueue::select(0);
+    health.recordWire(error);
+    if (error != 0) {
+        return false;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        bytes[i] = Wire.read();
+    }
+    return true;
+}
+
+/*
+ * Decode the 14 bytes of a burst read (0x3B ... 0x48, high byte first) to raw.
+ * @param bytes register values
+ */
+void MPU6050::decodeRaw(const uint8_t *bytes) {
+    raw.AcX = bytes[0] << 8 | bytes[1];
+    raw.AcY = bytes[2] << 8 | bytes[3];
+    raw.AcZ = bytes[4] << 8 | bytes[5];
+    raw.Temp = bytes[6] << 8 | bytes[7];
+    raw.GyX = bytes[8] << 8 | bytes[9];
+    raw.GyY = bytes[10] << 8 | bytes[11];
+    raw.GyZ = bytes[12] << 8 | bytes[13];
+}
+
+/*
+ * Convert a raw acceleration value to g.
+ * @param rawValue raw register value
+ * @param offset offset to remove (in LSB)
+ */
+float MPU6050::convertAcceleration(int16_t rawValue, int16_t offset) {
+    int16_t value = rawValue + offset;
+    return (float) value / (float) MPU6050_Ac_convert;
+}
 
-    float phiYRaw = asin((xVec[0] * vec[0] + xVec[1] * vec[1] + xVec[2] * vec[2]) / (vecLength(vec) * vecLength(xVec))) * RAD_TO_DEG;
-    float phiXRaw = asin((yVec[0] * vec[0] + yVec[1] * vec[1] + yVec[2] * vec[2]) / (vecLength(vec) * vecLength(xVec))) * RAD_TO_DEG;
+/*
+ * Convert a raw temperature value to degC.
+ * @param rawValue raw register value
+ */
+float MPU6050::convertTemperature(int16_t rawValue) {
+    int16_t value = rawValue + MPU6050_OFFSET_temp;
+    return (float) value / (float) MPU6050_T_convert + 36.53;
+}
 
-    phiX = phiXRaw - MPU6050_OFFSET_phiX;
-    phiY = phiYRaw - MPU6050_OFFSET_phiY;
+/*
+ * Convert a raw angular velocity value to deg/s.
+ * @param rawValue raw register value
+ * @param offset offset to remove (in LSB)
+ */
+float MPU6050::convertGyroscope(int16_t rawValue, int16_t offset) {
+    int16_t value = rawValue + offset;
+    return (float) value / (float) MPU6050_Gy_convert;
 }
 
 /*
- * Get the length of a 1x3 vector.
- * @param vec Input vector
- * @return Length of the vector
+ * Set the register shadows to the reset values of the device (all 0, except SLEEP of PWR_MGMT_1).
  */
-float MPU6050::vecLength(float vec[3]) {
-  return sqrt(sq(vec[0]) + sq(vec[1]) + sq(vec[2]));
+void MPU6050::resetShadow(void) {
+    for (uint8_t i = 0; i < MPU6050_SHADOW_COUNT; i++) {
+        shadow[i] = 0;
+    }
+    shadow[shadowIndex(MPU6050_RA_PWR_MGMT_1)] = 0b01000000;
+}
+
+/*
+ * Find the shadow of a register.
+ * @param regAddr register address
+ * @return Index in shadow or -1, if the register has no shadow
+ */
+int8_t MPU6050::shadowIndex(uint8_t regAddr) {
+    for (uint8_t i = 0; i < MPU6050_SHADOW_COUNT; i++) {
+        if (pgm_read_byte(&mpuShadowRegisters[i][0]) == regAddr) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Get the value of a configuration register from its shadow (without bus traffic).
+ * Registers without shadow are read from the device.
+ * @param regAddr register address
+ */
+uint8_t MPU6050::readShadow(uint8_t regAddr) {
+    int8_t index = shadowIndex(regAddr);
+    return index >= 0 ? shadow[index] : readByte(devAddr, regAddr);
 }
 
 /*
  * Read a register from device
  * @param devAddr device I2C address
  * @param regAddr register address
- * @return Byte in that register
+ * @return Byte in that register (0 without an answer)
  */
 uint8_t MPU6050::readByte(uint8_t devAddr, uint8_t regAddr) {
-    Wire.beginTransmission(devAddr);
-    Wire.write(regAddr);
-    Wire.endTransmission(false);
-    WIRE_REQUEST_FROM(devAddr, 1, true);
-    uint8_t dataByte = Wire.read();
+    uint8_t dataByte = 0;
+    readBytes(regAddr, &dataByte, 1);
     return dataByte;
 }
 
 /*
  * Write a bit at a specific location to a register of a device.
- * Read register at the beginning to keep the other bits.
  * @param devAddr device I2C address
  * @param regAddr register address
- * @param byteToWrite byte to write into the register
+ * @param bitNum bit position to write (0-7)
+ * @param bitToWrite value of the bit (0 or 1)
  */
 void MPU6050::writeBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t bitToWrite) {
-    uint8_t byteToWrite = readByte(devAddr, regAddr);
-    byteToWrite = (bitToWrite != 0) ? (bitToWrite | (1 << bitNum)) : (byteToWrite & ~(1 << bitNum));
-    writeByte(devAddr, regAddr, byteToWrite);
+    writeBits(devAddr, regAddr, bitNum, 1, bitToWrite != 0);
 }
 
 /** Write multiple bits in an 8-bit device register.
+ * The other bits are taken from the shadow of the register (registers without shadow are read first).
+ * Nothing is written, if the register keeps its value.
  * @param devAddr I2C slave device address
  * @param regAddr Register regAddr to write to
  * @param bitStart First bit position to write (0-7)
@@ -204,24 +666,43 @@ void MPU6050::writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint
     // 10101111 original value (sample)
     // 10100011 original & ~mask
     // 10101011 masked | value
-    uint8_t b = readByte(devAddr, regAddr);
+    int8_t index = shadowIndex(regAddr);
+    uint8_t b = index >= 0 ? shadow[index] : readByte(devAddr, regAddr);
     uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
     data <<= (bitStart - length + 1);  // shift data into correct position
     data &= mask;                      // zero all non-important bits in data
     b &= ~(mask);                      // zero all important bits in existing byte
     b |= data;                         // combine data with existing byte
+    if (index >= 0 && b == shadow[index]) {
+        return;
+    }
     writeByte(devAddr, regAddr, b);
 }
 
 /*
- * Write a byte to a register of a device
+ * Write a byte to a register of a device and update the shadow of the register.
+ * A DEVICE_RESET sets all shadows to the reset values.
  * @param devAddr device I2C address
  * @param regAddr register address
  * @param byteToWrite byte to write into the register
  */
 void MPU6050::writeByte(uint8_t devAddr, uint8_t regAddr, uint8_t byteToWrite) {
+    TwiQueue::flush();
+    TwiQueue::select(bitRate);
     Wire.beginTransmission(devAddr);
     Wire.write(regAddr);
     Wire.write(byteToWrite);
-    Wire.endTransmission(true);
-}
\ No newline at end of file
+    uint8_t error = Wire.endTransmission(true);
+    TwiQueue::select(0);
+    health.recordWire(error);
+    if (error != 0) {
+        return;  // the shadow keeps the value of the device
+    }
+
+    int8_t index = shadowIndex(regAddr);
+    if (regAddr == MPU6050_RA_PWR_MGMT_1 && (byteToWrite & 0b10000000)) {
+        resetShadow();
+    } else if (index >= 0) {
+        shadow[index] = byteToWrite & ~pgm_read_byte(&mpuShadowRegisters[index][1]);
+    }
+}
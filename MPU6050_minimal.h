@@ -11,6 +11,8 @@
 #define MPU6050_minimal
 
 #include "Arduino.h"
+#include "I2CHealth.h"
+#include "TwiQueue.h"
 #include "Wire.h"
 
 // Wire Nano Every support
@@ -23,6 +25,12 @@
 #endif
 
 // Register addresses
+#define MPU6050_RA_SMPLRT_DIV 0x19    // [7:0] SMPLRT_DIV (sample rate = gyroscope output rate / (1 + SMPLRT_DIV))
+#define MPU6050_RA_FIFO_EN 0x23       // [7] TEMP_FIFO_EN, [6] XG_FIFO_EN, [5] YG_FIFO_EN, [4] ZG_FIFO_EN, [3] ACCEL_FIFO_EN
+#define MPU6050_RA_INT_ENABLE 0x38    // [4] FIFO_OFLOW_EN, [3] I2C_MST_INT_EN, [0] DATA_RDY_EN
+#define MPU6050_RA_INT_STATUS 0x3A    // [4] FIFO_OFLOW_INT, [3] I2C_MST_INT, [0] DATA_RDY_INT (cleared by a read)
+#define MPU6050_RA_FIFO_COUNTH 0x72   // [7:0] FIFO_COUNT (2 total register; goes from 0x72 to 0x73)
+#define MPU6050_RA_FIFO_R_W 0x74      // [7:0] FIFO_DATA (next byte of the FIFO)
 #define MPU6050_RA_PWR_MGMT_1 0x6B    // [7] DEVICE_RESET, [6] SLEEP, [5] CYCLE, [3] TEMP_DIS, [2:0] CLKSEL
 #define MPU6050_RA_GYRO_CONFIG 0x1B   // [7] XG_ST, [6] YG_ST, [5] ZG_ST, [4:3] FS_SEL
 #define MPU6050_RA_ACCEL_CONFIG 0x1C  // [7] XA_ST, [6] YA_ST, [5] ZA_ST, [4:3] AFS_SEL
@@ -37,12 +45,28 @@
 // WHO_AM_I
 #define MPU6050_SET_WHO_AM_I 0b01101000
 
+// Burst read of the accelerometer, temperature and gyroscope registers (ACCEL_XOUT_H ... GYRO_ZOUT_L)
+#define MPU6050_RAW_LENGTH 14
+
+// Shadow copies of the configuration registers (see mpuShadowRegisters in the .cpp)
+#define MPU6050_SHADOW_COUNT 9
+
+// FIFO
+#define MPU6050_FIFO_SIZE 1024  // Size of the FIFO in bytes (73 samples of MPU6050_RAW_LENGTH)
+
+enum MPU6050_FIFO_STATE {
+    MPU6050_FIFO_IDLE,   // No drain requested
+    MPU6050_FIFO_COUNT,  // Reading the number of bytes in the FIFO
+    MPU6050_FIFO_DATA,   // Reading the samples
+    MPU6050_FIFO_DONE    // Drain completed, waiting for fifoReady()
+};
+
 // Values
 #define MPU6050_Ac_convert 16384  // LSB/g
 #define MPU6050_Gy_convert 131    // LSB/deg/s
 #define MPU6050_T_convert 340     // LSB/degC (offset 35degC = -521 LSB)
 
-// Offsets
+// Offsets (defaults of MPUOffsetType, until a calibration replaces them)
 #define MPU6050_OFFSET_AcX 0
 #define MPU6050_OFFSET_AcY 0
 #define MPU6050_OFFSET_AcZ 1688 // factory: 1688
@@ -52,6 +76,15 @@
 #define MPU6050_OFFSET_GyZ 0
 #define MPU6050_OFFSET_phiX 1.0
 #define MPU6050_OFFSET_phiY 1.6
+#define MPU6050_CENTI(value) ((int16_t)((value) * 100 + ((value) < 0 ? -0.5 : 0.5)))  // deg to 0.01 deg (rounded)
+#define MPU6050_OFFSET_TILT_X MPU6050_CENTI(MPU6050_OFFSET_phiX)
+#define MPU6050_OFFSET_TILT_Y MPU6050_CENTI(MPU6050_OFFSET_phiY)
+
+// Fixed-point tilt
+#define MPU6050_ATAN_BITS 5  // Table of atan() with 2^5 + 1 entries in the first octant
+
+// Calibration
+#define MPU6050_CALIBRATION_DELAY 10  // Time between two samples of the calibration in ms (DLPF 5 Hz: samples 10 ms apart still correlate)
 
 // MPU struct
 #ifndef MPU6050_STRUCT
@@ -66,6 +99,29 @@ struct MPUDataType {
     float Temp;  // Temperature in T
     float phiX;  // Angle around x in deg
     float phiY;  // Angle around y in deg
+    int16_t tiltX;  // Angle around x in 0.01 deg (fixed point, phiX = tiltX / 100)
+    int16_t tiltY;  // Angle around y in 0.01 deg
+};
+
+struct MPURawType {
+    int16_t AcX;   // Raw acceleration in x (ACCEL_XOUT)
+    int16_t AcY;   // Raw acceleration in y (ACCEL_YOUT)
+    int16_t AcZ;   // Raw acceleration in z (ACCEL_ZOUT)
+    int16_t Temp;  // Raw temperature (TEMP_OUT)
+    int16_t GyX;   // Raw angular velocity around x (GYRO_XOUT)
+    int16_t GyY;   // Raw angular velocity around y (GYRO_YOUT)
+    int16_t GyZ;   // Raw angular velocity around z (GYRO_ZOUT)
+};
+
+struct MPUOffsetType {
+    int16_t AcX;    // Offset added to the raw acceleration in x (in LSB)
+    int16_t AcY;    // Offset added to the raw acceleration in y (in LSB)
+    int16_t AcZ;    // Offset added to the raw acceleration in z (in LSB)
+    int16_t GyX;    // Offset added to the raw angular velocity around x (in LSB)
+    int16_t GyY;    // Offset added to the raw angular velocity around y (in LSB)
+    int16_t GyZ;    // Offset added to the raw angular velocity around z (in LSB)
+    int16_t tiltX;  // Mounting angle around x, removed from the tilt (in 0.01 deg)
+    int16_t tiltY;  // Mounting angle around y, removed from the tilt (in 0.01 deg)
 };
 #endif
 
@@ -73,18 +129,58 @@ class MPU6050 {
    public:
     MPU6050(uint8_t I2C_addr = 0x68);
     MPUDataType data;
+    MPURawType raw;
+    MPUOffsetType offset;  // Offsets of the raw values and the angles (defaults or calibration)
+    I2CHealth health;  // Results of the transactions
     void initialize(void);
+    void setClock(uint32_t frequency);
     bool testConnection(void);
     void setBypass(uint8_t enable = true);
+    bool verifyRegisters(void);
     MPUDataType getData(void);
+    MPURawType readRaw(void);
+    bool requestRaw(void);
+    bool rawReady(void);
+    void beginFifo(uint16_t rate);
+    void resetFifo(void);
+    bool requestFifo(void);
+    bool fifoReady(void);
+    uint8_t getFifoSamples(void);
+    uint16_t getFifoOverflows(void);
+    MPUDataType convert(const MPURawType &rawData);
     void getAcceleration(float &AcX, float &AcY, float &AcZ);
     void getTemperature(float &T);
     void getGyroscope(float &GyX, float &GyY, float &GyZ);
+    void getTilt(int16_t AcX, int16_t AcY, int16_t AcZ, int16_t &tiltX, int16_t &tiltY);
+    void resetOffset(void);
+    bool calibrate(uint8_t samples);
+    static int16_t atan2Centi(int32_t y, int32_t x);
 
    private:
     uint8_t devAddr;
-    void getAngles(float AcX, float AcY, float AcZ, float &phiX, float &phiY);
-    float vecLength(float vec[3]);
+    uint8_t bitRate;                      // TWBR of the SCL clock of the device (0: clock of the bus)
+    uint8_t shadow[MPU6050_SHADOW_COUNT];  // Last written values of the configuration registers
+    TwiRequest request;                   // Non-blocking burst read of the raw registers
+    uint8_t registerAddress;              // First register address of request
+    uint8_t buffer[MPU6050_RAW_LENGTH];   // Raw bytes of a burst read (0x3B ... 0x48, big endian)
+    int32_t fifoSum[7];                   // Sums of the drained samples (order of MPURawType)
+    uint8_t fifoSamples;                  // Number of drained samples
+    uint8_t fifoRemaining;                // Samples left to drain
+    uint8_t fifoState;                    // MPU6050_FIFO_STATE
+    bool fifoResetPending;                // FIFO content is not aligned to samples
+    uint16_t fifoOverflows;               // Number of FIFO overflows
+    static void fifoCallback(TwiRequest *request);
+    void fifoStep(void);
+    static uint16_t isqrt32(uint32_t value);
+    void readWords(uint8_t regAddr, int16_t *words, uint8_t count);
+    bool readBytes(uint8_t regAddr, uint8_t *bytes, uint8_t length);
+    void decodeRaw(const uint8_t *bytes);
+    float convertAcceleration(int16_t rawValue, int16_t offset);
+    float convertTemperature(int16_t rawValue);
+    float convertGyroscope(int16_t rawValue, int16_t offset);
+    void resetShadow(void);
+    int8_t shadowIndex(uint8_t regAddr);
+    uint8_t readShadow(uint8_t regAddr);
     uint8_t readByte(uint8_t devAddr, uint8_t regAddr);
     void writeBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t data);
     void writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8_t length, uint8_t data);
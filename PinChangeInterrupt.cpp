@@ -0,0 +1,96 @@
+/*
+  PinChangeInterrupt.cpp - Shared dispatcher for the pin change interrupts.
+  Several handlers may be attached to pins of the same port (same interrupt vector).
+  A handler is called on every level change of its pin.
+
+  Licensed under "MIT" License.
+*/
+#include "PinChangeInterrupt.h"
+
+#include "Arduino.h"
+
+PinChangeHandlerType PinChangeInterrupt::handlers[PINCHANGE_MAX_HANDLERS];
+uint8_t PinChangeInterrupt::count = 0;
+
+// PUBLIC
+
+/*
+ * Attach a handler to the level changes of a pin and enable the pin change interrupt.
+ * The pin mode has to be set before.
+ * @param pin Arduino pin number
+ * @param callback Function called on every level change (interrupt context)
+ * @return true, if the handler could be attached.
+ */
+bool PinChangeInterrupt::attach(uint8_t pin, PinChangeCallback callback) {
+    if (count >= PINCHANGE_MAX_HANDLERS) {
+        return false;
+    }
+    uint8_t port = digitalPinToPort(pin);
+    uint8_t mask = digitalPinToBitMask(pin);
+
+    noInterrupts();
+    handlers[count].callback = callback;
+    handlers[count].port = port;
+    handlers[count].mask = mask;
+    handlers[count].level = *portInputRegister(port) & mask;
+    count++;
+#ifdef __AVR__
+    *digitalPinToPCMSK(pin) |= bit(digitalPinToPCMSKbit(pin));
+    PCICR |= bit(digitalPinToPCICRbit(pin));
+#endif
+    interrupts();
+    return true;
+}
+
+/*
+ * Detach the handler of a pin and disable its pin change interrupt.
+ * @param pin Arduino pin number
+ */
+void PinChangeInterrupt::detach(uint8_t pin) {
+    uint8_t port = digitalPinToPort(pin);
+    uint8_t mask = digitalPinToBitMask(pin);
+
+    noInterrupts();
+    for (uint8_t i = 0; i < count; i++) {
+        if (handlers[i].port == port && handlers[i].mask == mask) {
+            count--;
+            handlers[i] = handlers[count];
+            break;
+        }
+    }
+#ifdef __AVR__
+    *digitalPinToPCMSK(pin) &= ~bit(digitalPinToPCMSKbit(pin));
+#endif
+    interrupts();
+}
+
+/*
+ * Call the handlers of all changed pins of a port. Called by the interrupt vectors.
+ * @param port Port of the pins (digitalPinToPort)
+ * @param pins Current input register value of the port
+ */
+void PinChangeInterrupt::handle(uint8_t port, uint8_t pins) {
+    for (uint8_t i = 0; i < count; i++) {
+        PinChangeHandlerType &h = handlers[i];
+        if (h.port == port && (pins & h.mask) != h.level) {
+            h.level = pins & h.mask;
+            h.callback();
+        }
+    }
+}
+
+// INTERRUPT VECTORS
+
+#ifdef __AVR__
+ISR(PCINT0_vect) {
+    PinChangeInterrupt::handle(PB, PINB);
+}
+
+ISR(PCINT1_vect) {
+    PinChangeInterrupt::handle(PC, PINC);
+}
+
+ISR(PCINT2_vect) {
+    PinChangeInterrupt::handle(PD, PIND);
+}
+#endif
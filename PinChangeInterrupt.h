@@ -0,0 +1,36 @@
+/*
+  PinChangeInterrupt.h - Shared dispatcher for the pin change interrupts.
+  Several handlers may be attached to pins of the same port (same interrupt vector).
+  A handler is called on every level change of its pin.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef PINCHANGEINTERRUPT_H
+#define PINCHANGEINTERRUPT_H
+
+#include "Arduino.h"
+
+#define PINCHANGE_MAX_HANDLERS 10  // Maximum number of attached pins (the sketch with all switches needs 10)
+
+typedef void (*PinChangeCallback)(void);
+
+struct PinChangeHandlerType {
+    PinChangeCallback callback;  // Function called on a level change (interrupt context)
+    uint8_t port;                // Port of the pin (digitalPinToPort)
+    uint8_t mask;                // Bit mask of the pin (digitalPinToBitMask)
+    uint8_t level;               // Last seen level (masked)
+};
+
+class PinChangeInterrupt {
+   public:
+    static bool attach(uint8_t pin, PinChangeCallback callback);
+    static void detach(uint8_t pin);
+    static void handle(uint8_t port, uint8_t pins);
+
+   private:
+    static PinChangeHandlerType handlers[PINCHANGE_MAX_HANDLERS];
+    static uint8_t count;
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+  PowerSaver.cpp - Sleep between scheduled tasks in standby.
+  Uses the idle sleep mode, so Timer0 (millis) keeps running and all time based
+  calculations stay correct. Any interrupt ends a sleep period, a wake request
+  (e.g. by a pin change) ends the whole sleep.
+
+  Licensed under "MIT" License.
+*/
+#include "PowerSaver.h"
+
+#include "Arduino.h"
+
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
+// PUBLIC
+
+/*
+ * Constructor of the power saver. The device counts as fully awake until the first window ends.
+ */
+PowerSaver::PowerSaver() {
+    wakeRequest = false;
+    windowStart = 0;
+    sleptUs = 0;
+    awakePermille = 1000;
+}
+
+/*
+ * Sleep for a duration or until a wake request. The ADC is switched off while sleeping, unless
+ * it converts by an auto trigger (its interrupt comes with the Timer0 overflow, which wakes anyway).
+ * @param duration Maximum sleep time in ms
+ */
+void PowerSaver::sleep(unsigned long duration) {
+    unsigned long start = millis();
+    unsigned long startUs = micros();
+
+#ifdef __AVR__
+    uint8_t adcsra = ADCSRA;
+    if (!(adcsra & bit(ADATE))) {
+        ADCSRA &= ~bit(ADEN);  // ADC off
+    }
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while (millis() - start < duration) {
+        noInterrupts();
+        if (wakeRequest) {
+            interrupts();
+            break;
+        }
+        sleep_enable();
+        interrupts();
+        sleep_cpu();  // woken up by any interrupt, at least by Timer0 every ~1 ms
+        sleep_disable();
+    }
+    ADCSRA = adcsra;  // ADC on
+#else
+    while (!wakeRequest && millis() - start < duration) {
+        delay(1);
+    }
+#endif
+
+    sleptUs += micros() - startUs;
+    updateStatistics(millis());
+}
+
+/*
+ * Request to end the sleep. Can be called from an interrupt.
+ */
+void PowerSaver::wake(void) {
+    wakeRequest = true;
+}
+
+/*
+ * Check and clear the wake request.
+ * @return true, if a wake request occured since the last call.
+ */
+bool PowerSaver::wakeRequested(void) {
+    noInterrupts();
+    bool request = wakeRequest;
+    wakeRequest = false;
+    interrupts();
+    return request;
+}
+
+/*
+ * Get the awake fraction of the last full statistic window.
+ * @return Awake time in 1/1000 of the window
+ */
+uint16_t PowerSaver::getAwakePermille(void) {
+    updateStatistics(millis());
+    return awakePermille;
+}
+
+// PRIVATE
+
+/*
+ * Close the statistic window, if it is full.
+ * @param now Current timestamp in ms
+ */
+void PowerSaver::updateStatistics(unsigned long now) {
+    unsigned long window = now - windowStart;
+    if (window < POWERSAVER_WINDOW) {
+        return;
+    }
+    unsigned long sleptMs = min(sleptUs / 1000, window);
+    awakePermille = 1000 - (uint16_t)(sleptMs * 1000 / window);
+    windowStart = now;
+    sleptUs = 0;
+}
@@ -0,0 +1,33 @@
+/*
+  PowerSaver.h - Sleep between scheduled tasks in standby.
+  Uses the idle sleep mode, so Timer0 (millis) keeps running and all time based
+  calculations stay correct. Any interrupt ends a sleep period, a wake request
+  (e.g. by a pin change) ends the whole sleep.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef POWERSAVER_H
+#define POWERSAVER_H
+
+#include "Arduino.h"
+
+#define POWERSAVER_WINDOW 60000  // Time window for the awake statistic in ms
+
+class PowerSaver {
+   public:
+    PowerSaver();
+    void sleep(unsigned long duration);
+    void wake(void);
+    bool wakeRequested(void);
+    uint16_t getAwakePermille(void);
+
+   private:
+    volatile bool wakeRequest;
+    unsigned long windowStart;  // Timestamp of the statistic window start in ms
+    unsigned long sleptUs;      // Time slept in the current window in us
+    uint16_t awakePermille;     // Awake fraction of the last full window in 1/1000
+    void updateStatistics(unsigned long now);
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*
+  Profiler.cpp - Runtime statistics of the main loop stages.
+  Collects min/max/mean and a log2 histogram of the run time (in us) per stage
+  and prints them to the serial on request.
+
+  Licensed under "MIT" License.
+*/
+#include "Profiler.h"
+
+#include "Arduino.h"
+
+const char profileName0[] PROGMEM = "loop";
+const char profileName1[] PROGMEM = "rotary";
+const char profileName2[] PROGMEM = "MPU";
+const char profileName3[] PROGMEM = "DC";
+const char profileName4[] PROGMEM = "DHT";
+const char profileName5[] PROGMEM = "RTC";
+const char profileName6[] PROGMEM = "alarm";
+const char profileName7[] PROGMEM = "display";
+const char* const profileNames[] PROGMEM = {profileName0, profileName1, profileName2, profileName3,
+                                            profileName4, profileName5, profileName6, profileName7};
+
+// PUBLIC
+
+/*
+ * Constructor of the profiler with cleared statistics.
+ */
+Profiler::Profiler() {
+    reset();
+}
+
+/*
+ * Clear the statistics of all stages.
+ */
+void Profiler::reset(void) {
+    memset(stages, 0, sizeof(stages));
+    for (uint8_t i = 0; i < PROFILE_COUNT; i++) {
+        stages[i].min = 0xFFFFFFFF;
+    }
+}
+
+/*
+ * Add a time measurement to a stage.
+ * @param stage Stage of the measurement (PROFILE_STAGE type)
+ * @param us Measured time in us
+ */
+void Profiler::add(uint8_t stage, unsigned long us) {
+    if (stage >= PROFILE_COUNT) {
+        return;
+    }
+    ProfileStageType &s = stages[stage];
+    s.count++;
+    s.sum += us;
+    if (us < s.min) {
+        s.min = us;
+    }
+    if (us > s.max) {
+        s.max = us;
+    }
+    uint8_t b = bucket(us);
+    if (s.histogram[b] < 0xFFFF) {
+        s.histogram[b]++;
+    }
+}
+
+/*
+ * Print the statistics of all stages to the serial.
+ * One line per stage: "name: n min max mean | histogram buckets".
+ */
+void Profiler::print(void) {
+    Serial.println(F("stage: n min max mean (us) | log2 histogram (1us, 2us, 4us, ...)"));
+    for (uint8_t i = 0; i < PROFILE_COUNT; i++) {
+        ProfileStageType &s = stages[i];
+        char name[10];
+        strcpy_P(name, (const char*)pgm_read_ptr(&(profileNames[i])));
+        Serial.print(name);
+        Serial.print(F(": "));
+        Serial.print(s.count);
+        Serial.print(F(" "));
+        Serial.print(s.count > 0 ? s.min : 0);
+        Serial.print(F(" "));
+        Serial.print(s.max);
+        Serial.print(F(" "));
+        Serial.print(s.count > 0 ? (unsigned long)(s.sum / s.count) : 0);
+        Serial.print(F(" |"));
+        for (uint8_t b = 0; b < PROFILER_BUCKETS; b++) {
+            Serial.print(F(" "));
+            Serial.print(s.histogram[b]);
+        }
+        Serial.println();
+    }
+}
+
+// PRIVATE
+
+/*
+ * Calculate the histogram bucket of a time (position of the highest set bit).
+ * @param us Time in us
+ * @return Bucket index (0 to PROFILER_BUCKETS-1)
+ */
+uint8_t Profiler::bucket(unsigned long us) {
+    uint8_t b = 0;
+    while (us > 1 && b < PROFILER_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
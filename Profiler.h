@@ -0,0 +1,48 @@
+/*
+  Profiler.h - Runtime statistics of the main loop stages.
+  Collects min/max/mean and a log2 histogram of the run time (in us) per stage
+  and prints them to the serial on request.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Arduino.h"
+
+#define PROFILER_BUCKETS 16  // Histogram buckets: bucket n counts times of 2^n to 2^(n+1)-1 us, last bucket counts all above
+
+typedef enum {
+    PROFILE_LOOP,
+    PROFILE_ROTARY,
+    PROFILE_MPU,
+    PROFILE_DC,
+    PROFILE_DHT,
+    PROFILE_RTC,
+    PROFILE_ALARM,
+    PROFILE_DISPLAY,
+    PROFILE_COUNT
+} PROFILE_STAGE;
+
+struct ProfileStageType {
+    unsigned long count;                  // Number of measurements
+    unsigned long min;                    // Minimum time in us
+    unsigned long max;                    // Maximum time in us
+    uint64_t sum;                         // Sum of all times in us
+    uint16_t histogram[PROFILER_BUCKETS]; // log2 histogram of the times
+};
+
+class Profiler {
+   public:
+    Profiler();
+    void reset(void);
+    void add(uint8_t stage, unsigned long us);
+    void print(void);
+
+   private:
+    ProfileStageType stages[PROFILE_COUNT];
+    uint8_t bucket(unsigned long us);
+};
+
+#endif
@@ -0,0 +1,213 @@
+/*
+  Scheduler.cpp - Minimal cooperative task scheduler for the main loop.
+  Tasks are kept in a min-heap ordered by their next due time (ties are broken by priority).
+  Polling tasks (period 0) are moved ahead of the due tasks after every run of another task.
+
+  Licensed under "MIT" License.
+*/
+#include "Scheduler.h"
+
+#include "Arduino.h"
+
+// PUBLIC
+
+/*
+ * Constructor of the scheduler without any tasks.
+ */
+Scheduler::Scheduler() {
+    count = 0;
+}
+
+/*
+ * Add a periodic task.
+ * @param callback Function to run, gets the time since its last run in ms.
+ * @param period Time between two runs in ms (0: run on every pass).
+ * @param priority Higher value runs first, if two tasks are due at the same time.
+ * @param deadline Allowed delay after the due time (period 0: after the last run) in ms, before a run counts as overrun.
+ * @param now Current timestamp in ms.
+ * @param offset Delay of the first run in ms, to stagger tasks with the same period.
+ * @return Task id or SCHEDULER_INVALID_TASK if the scheduler is full.
+ */
+uint8_t Scheduler::addTask(TaskCallback callback, uint16_t period, uint8_t priority, uint16_t deadline, unsigned long now, uint16_t offset) {
+    if (count >= SCHEDULER_MAX_TASKS) {
+        return SCHEDULER_INVALID_TASK;
+    }
+    uint8_t id = count;
+    tasks[id].callback = callback;
+    tasks[id].period = period;
+    tasks[id].deadline = deadline;
+    tasks[id].due = now + offset;
+    tasks[id].lastRun = now;
+    tasks[id].overruns = 0;
+    tasks[id].priority = priority;
+
+    heap[count] = id;
+    count++;
+    siftUp(count - 1);
+    return id;
+}
+
+/*
+ * Run the next task, if it is due. Only one task is run per call. After a task with a period,
+ * the polling tasks (period 0) get its due time, so they run before the other due tasks.
+ * @param now Current timestamp in ms.
+ * @return true, if a task was run.
+ */
+bool Scheduler::run(unsigned long now) {
+    if (count == 0 || (long)(now - tasks[heap[0]].due) < 0) {
+        return false;
+    }
+
+    TaskType &task = tasks[heap[0]];
+    unsigned long due = task.due;
+    unsigned long late = task.period == 0 ? now - task.lastRun : now - due;  // a polling task is late to its last run
+    if (late > task.deadline && task.overruns < 0xFFFF) {
+        task.overruns++;
+    }
+
+    unsigned long dt = now - task.lastRun;
+    task.lastRun = now;
+
+    // reschedule before running, so the task may change its own period
+    if (task.period == 0) {
+        task.due = now;
+    } else {
+        task.due += task.period;
+        if ((long)(now - task.due) >= 0) {
+            task.due = now + task.period;  // skip missed runs instead of catching up in a burst
+        }
+    }
+    siftDown(0);
+    if (task.period != 0) {
+        for (uint8_t id = 0; id < count; id++) {
+            if (tasks[id].period == 0 && (long)(tasks[id].due - due) > 0) {
+                tasks[id].due = due;  // ties with the due tasks are broken by priority
+                siftUp(findHeapPos(id));
+            }
+        }
+    }
+
+    task.callback(dt);
+    return true;
+}
+
+/*
+ * Change the period of a task. The next due time stays untouched.
+ * @param id Task id.
+ * @param period New time between two runs in ms (0: run on every pass).
+ */
+void Scheduler::setPeriod(uint8_t id, uint16_t period) {
+    if (id < count) {
+        tasks[id].period = period;
+    }
+}
+
+/*
+ * Make a task due immediately (tasks which are already due keep their due time).
+ * @param id Task id.
+ * @param now Current timestamp in ms.
+ */
+void Scheduler::trigger(uint8_t id, unsigned long now) {
+    if (id < count && (long)(tasks[id].due - now) > 0) {
+        tasks[id].due = now;
+        siftUp(findHeapPos(id));
+    }
+}
+
+/*
+ * Time until the next task is due.
+ * @param now Current timestamp in ms.
+ * @return Time in ms (0 if a task is already due).
+ */
+unsigned long Scheduler::timeToNext(unsigned long now) {
+    if (count == 0) {
+        return 0xFFFFFFFF;
+    }
+    long remaining = (long)(tasks[heap[0]].due - now);
+    return remaining > 0 ? remaining : 0;
+}
+
+/*
+ * Get the number of overruns of a task.
+ * @param id Task id.
+ * @return Number of runs, which started later than due + deadline.
+ */
+uint16_t Scheduler::getOverruns(uint8_t id) {
+    return id < count ? tasks[id].overruns : 0;
+}
+
+/*
+ * Get the number of added tasks.
+ */
+uint8_t Scheduler::getTaskCount() {
+    return count;
+}
+
+// PRIVATE
+
+/*
+ * Compare two tasks by due time (overflow safe) and by priority.
+ * @return true, if task a has to run before task b.
+ */
+bool Scheduler::runsBefore(uint8_t a, uint8_t b) {
+    long diff = (long)(tasks[a].due - tasks[b].due);
+    if (diff != 0) {
+        return diff < 0;
+    }
+    return tasks[a].priority > tasks[b].priority;
+}
+
+/*
+ * Find the heap position of a task.
+ * @param id Task id.
+ */
+uint8_t Scheduler::findHeapPos(uint8_t id) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (heap[i] == id) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Move a heap entry up until its parent runs before it.
+ * @param pos Heap position.
+ */
+void Scheduler::siftUp(uint8_t pos) {
+    while (pos > 0) {
+        uint8_t parent = (pos - 1) / 2;
+        if (!runsBefore(heap[pos], heap[parent])) {
+            break;
+        }
+        uint8_t swap = heap[pos];
+        heap[pos] = heap[parent];
+        heap[parent] = swap;
+        pos = parent;
+    }
+}
+
+/*
+ * Move a heap entry down until it runs before both children.
+ * @param pos Heap position.
+ */
+void Scheduler::siftDown(uint8_t pos) {
+    while (true) {
+        uint8_t first = pos;
+        uint8_t left = 2 * pos + 1;
+        uint8_t right = left + 1;
+        if (left < count && runsBefore(heap[left], heap[first])) {
+            first = left;
+        }
+        if (right < count && runsBefore(heap[right], heap[first])) {
+            first = right;
+        }
+        if (first == pos) {
+            break;
+        }
+        uint8_t swap = heap[pos];
+        heap[pos] = heap[first];
+        heap[first] = swap;
+        pos = first;
+    }
+}
@@ -0,0 +1,52 @@
+/*
+  Scheduler.h - Minimal cooperative task scheduler for the main loop.
+  Tasks are kept in a min-heap ordered by their next due time (ties are broken by priority).
+  One call of run() executes at most one due task. A polling task (period 0) is moved ahead
+  of the due tasks after every run of another task, so it is never delayed by more than the
+  longest single task, even if several tasks are overdue (e.g. after a wake up).
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "Arduino.h"
+
+#define SCHEDULER_MAX_TASKS 8        // Maximum number of tasks
+#define SCHEDULER_INVALID_TASK 0xFF  // Returned by addTask() if no slot is left
+
+typedef void (*TaskCallback)(unsigned long dt);  // Task function, dt: time since last run in ms
+
+struct TaskType {
+    TaskCallback callback;  // Function to run
+    uint16_t period;        // Time between two runs in ms (0: run on every pass)
+    uint16_t deadline;      // Allowed delay after the due time (period 0: after the last run) in ms, before a run counts as overrun
+    unsigned long due;      // Timestamp of the next run
+    unsigned long lastRun;  // Timestamp of the last run
+    uint16_t overruns;      // Number of runs that started later than due + deadline
+    uint8_t priority;       // Higher value runs first, if two tasks are due at the same time
+};
+
+class Scheduler {
+   public:
+    Scheduler();
+    uint8_t addTask(TaskCallback callback, uint16_t period, uint8_t priority, uint16_t deadline, unsigned long now, uint16_t offset = 0);
+    bool run(unsigned long now);
+    void setPeriod(uint8_t id, uint16_t period);
+    void trigger(uint8_t id, unsigned long now);
+    unsigned long timeToNext(unsigned long now);
+    uint16_t getOverruns(uint8_t id);
+    uint8_t getTaskCount();
+
+   private:
+    TaskType tasks[SCHEDULER_MAX_TASKS];
+    uint8_t heap[SCHEDULER_MAX_TASKS];  // Task ids, heap[0] is the next task to run
+    uint8_t count;
+    bool runsBefore(uint8_t a, uint8_t b);
+    uint8_t findHeapPos(uint8_t id);
+    void siftUp(uint8_t pos);
+    void siftDown(uint8_t pos);
+};
+
+#endif
@@ -0,0 +1,230 @@
+/*
+  SensorTrace.cpp - Recorder of the raw sensor inputs in a compact binary format.
+  The records are streamed through a small ring buffer to a serial port, so RAM usage
+  stays bounded. A recorded trace is fed back through the processing code of the
+  sketch by the replay of the host simulator (simulator/replay.cpp).
+
+  Licensed under "MIT" License.
+*/
+#include "SensorTrace.h"
+
+// PUBLIC
+
+/*
+ * Constructor of the trace recorder. Nothing is recorded before begin().
+ */
+SensorTrace::SensorTrace() {
+    output = NULL;
+    head = 0;
+    tail = 0;
+    lastTime = 0;
+    droppedPending = 0;
+    droppedTotal = 0;
+}
+
+/*
+ * Start a new trace with the header.
+ * @param output Stream of the trace (e.g. Serial)
+ * @param now Current time in ms
+ */
+void SensorTrace::begin(Print &output, unsigned long now) {
+    uint8_t header[4 + 5] = {'C', 'V', 'T', TRACE_VERSION};
+    uint8_t length = 4 + putVarint(&header[4], now);
+    uint8_t state = SREG;  // restored, not enabled: safe in an interrupt handler
+    noInterrupts();
+    this->output = &output;
+    head = 0;
+    tail = 0;
+    lastTime = now;
+    droppedPending = 0;
+    droppedTotal = 0;
+    push(header, length);
+    SREG = state;
+}
+
+/*
+ * Record the raw inputs of a sensor reading.
+ * @param now Current time in ms
+ * @param dt Time since the last sensor reading in ms
+ * @param voltage Raw ADC mean of the voltage sensor in 1/16 LSB
+ * @param current Raw ADC mean of the current sensor in 1/16 LSB
+ * @param mpu Raw registers of the MPU
+ * @param water Pin levels of the water switches (bit 0: fresh, bit 1: grey)
+ */
+void SensorTrace::recordSample(unsigned long now, unsigned long dt, uint16_t voltage, uint16_t current, const MPURawType &mpu, uint8_t water) {
+    uint8_t payload[5 + 4 + 14 + 1];
+    uint8_t length = putVarint(payload, dt);
+
+    uint32_t adc = (uint32_t)(voltage & 0x3FFF) | ((uint32_t)(current & 0x3FFF) << 14);
+    payload[length++] = adc;
+    payload[length++] = adc >> 8;
+    payload[length++] = adc >> 16;
+    payload[length++] = adc >> 24;
+
+    const int16_t registers[7] = {mpu.AcX, mpu.AcY, mpu.AcZ, mpu.Temp, mpu.GyX, mpu.GyY, mpu.GyZ};
+    for (uint8_t i = 0; i < 7; i++) {
+        payload[length++] = (uint16_t)registers[i] >> 8;
+        payload[length++] = registers[i];
+    }
+
+    payload[length++] = water;
+    write(TRACE_SAMPLE, now, payload, length);
+}
+
+/*
+ * Record a valid measurement of a DHT sensor.
+ * @param now Current time in ms
+ * @param sensor Index of the sensor
+ * @param data The 5 data bytes (humidity, temperature, checksum)
+ */
+void SensorTrace::recordDHT(unsigned long now, uint8_t sensor, const uint8_t *data) {
+    uint8_t payload[6] = {sensor, data[0], data[1], data[2], data[3], data[4]};
+    write(TRACE_DHT, now, payload, sizeof(payload));
+}
+
+/*
+ * Record a user input at the rotary encoder. Safe to call from an interrupt handler.
+ * @param now Current time in ms
+ * @param event Rotary event (TRACE_ROTARY_EVENT)
+ */
+void SensorTrace::recordRotary(unsigned long now, uint8_t event) {
+    write(TRACE_ROTARY, now, &event, 1);
+}
+
+/*
+ * Record the hourly rollover of the history data.
+ * @param now Current time in ms
+ * @param hour Hour of the software clock after the rollover
+ */
+void SensorTrace::recordRollover(unsigned long now, uint8_t hour) {
+    write(TRACE_ROLLOVER, now, &hour, 1);
+}
+
+/*
+ * Record the offsets of the MPU, which convert the raw registers of the following samples.
+ * @param now Current time in ms
+ * @param offset Offsets of the MPU (loaded from the EEPROM or calibrated)
+ */
+void SensorTrace::recordOffset(unsigned long now, const MPUOffsetType &offset) {
+    const int16_t values[8] = {offset.AcX, offset.AcY, offset.AcZ, offset.GyX, offset.GyY, offset.GyZ, offset.tiltX, offset.tiltY};
+    uint8_t payload[16];
+    for (uint8_t i = 0; i < 8; i++) {
+        payload[2 * i] = (uint16_t)values[i] >> 8;
+        payload[2 * i + 1] = values[i];
+    }
+    write(TRACE_OFFSET, now, payload, sizeof(payload));
+}
+
+/*
+ * Move buffered bytes to the output, as far as it accepts them without blocking.
+ */
+void SensorTrace::flush(void) {
+    if (output == NULL) {
+        return;
+    }
+    int space = output->availableForWrite();
+    while (tail != head && space > 0) {
+        output->write(buffer[tail]);
+        tail = (tail + 1) & (TRACE_BUFFER_SIZE - 1);
+        space--;
+    }
+}
+
+/*
+ * Check if all records were moved to the output.
+ */
+bool SensorTrace::isEmpty(void) {
+    return tail == head;
+}
+
+/*
+ * Get the number of records lost by a full buffer since begin().
+ */
+uint16_t SensorTrace::getDropped(void) {
+    return droppedTotal;
+}
+
+// PRIVATE
+
+/*
+ * Assemble a record and add it to the buffer. A record, which doesn't fit, is dropped
+ * and counted. The count is written before the next record, which fits.
+ * Restores the interrupt flag, so it may be called by an interrupt handler. An interrupt
+ * handler may have recorded a later time after the caller took now: the record gets the time
+ * of the last record then (a delta of 0 instead of a wrap around).
+ * @param type Record type (TRACE_RECORD)
+ * @param now Current time in ms
+ * @param payload Payload of the record
+ * @param length Length of the payload
+ * @return true if the record was added
+ */
+bool SensorTrace::write(uint8_t type, unsigned long now, const uint8_t *payload, uint8_t length) {
+    if (output == NULL) {
+        return false;
+    }
+    uint8_t record[TRACE_RECORD_SIZE];
+    uint8_t recordLength;
+    bool written = false;
+
+    uint8_t state = SREG;
+    noInterrupts();
+    if ((long)(now - lastTime) < 0) {
+        now = lastTime;
+    }
+    if (droppedPending > 0) {
+        record[0] = TRACE_DROPPED;
+        recordLength = 1 + putVarint(&record[1], now - lastTime);
+        recordLength += putVarint(&record[recordLength], droppedPending);
+        if (push(record, recordLength)) {
+            droppedPending = 0;
+            lastTime = now;
+        }
+    }
+    if (droppedPending == 0) {
+        record[0] = type;
+        recordLength = 1 + putVarint(&record[1], now - lastTime);
+        memcpy(&record[recordLength], payload, length);
+        written = push(record, recordLength + length);
+        if (written) {
+            lastTime = now;
+        }
+    }
+    if (!written) {
+        droppedPending++;
+        droppedTotal++;
+    }
+    SREG = state;
+    return written;
+}
+
+/*
+ * Copy bytes to the ring buffer, if all of them fit.
+ * @return true if the bytes were added
+ */
+bool SensorTrace::push(const uint8_t *data, uint8_t length) {
+    uint8_t space = (tail - head - 1) & (TRACE_BUFFER_SIZE - 1);
+    if (length > space) {
+        return false;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        buffer[head] = data[i];
+        head = (head + 1) & (TRACE_BUFFER_SIZE - 1);
+    }
+    return true;
+}
+
+/*
+ * Encode an unsigned value as LEB128 varint (7 bits per byte, MSB set if more bytes follow).
+ * @param data Destination (up to 5 bytes)
+ * @param value Value to encode
+ * @return Number of bytes written
+ */
+uint8_t SensorTrace::putVarint(uint8_t *data, unsigned long value) {
+    uint8_t length = 0;
+    while (value >= 0x80) {
+        data[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    data[length++] = value;
+    return length;
+}
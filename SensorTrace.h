@@ -0,0 +1,74 @@
+/*
+  SensorTrace.h - Recorder of the raw sensor inputs in a compact binary format.
+  The records are streamed through a small ring buffer to a serial port, so RAM usage
+  stays bounded. A recorded trace is fed back through the processing code of the
+  sketch by the replay of the host simulator (simulator/replay.cpp).
+
+  Format (multi byte values little endian, varints unsigned LEB128):
+    Header:          'C' 'V' 'T' version | time of begin() in ms (varint)
+    Record:          type | time since the previous record in ms (varint) | payload
+    TRACE_SAMPLE:    dt in ms (varint) | voltage and current ADC mean in 1/16 LSB (2 x 14 bit in 4 bytes) |
+                     MPU registers 0x3B ... 0x48 (14 bytes, big endian as on the bus) |
+                     water switch pins (bit 0: fresh, bit 1: grey)
+    TRACE_DHT:       index of the DHT sensor | its 5 data bytes
+    TRACE_ROTARY:    event (TRACE_ROTARY_EVENT)
+    TRACE_ROLLOVER:  hour of the software clock
+    TRACE_DROPPED:   number of records lost by a full buffer (varint)
+    TRACE_OFFSET:    MPU offsets AcX, AcY, AcZ, GyX, GyY, GyZ, tiltX, tiltY (8 x 16 bit, big endian),
+                     after begin() and after a calibration
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef SENSORTRACE_H
+#define SENSORTRACE_H
+
+#include "Arduino.h"
+#include "MPU6050_minimal.h"
+
+#define TRACE_VERSION 4        // Version of the format in the header
+#define TRACE_BUFFER_SIZE 64   // Size of the ring buffer in bytes (power of 2)
+#define TRACE_RECORD_SIZE 32   // Maximum size of a record in bytes
+
+enum TRACE_RECORD {
+    TRACE_SAMPLE = 1,
+    TRACE_DHT,
+    TRACE_ROTARY,
+    TRACE_ROLLOVER,
+    TRACE_DROPPED,
+    TRACE_OFFSET
+};
+
+enum TRACE_ROTARY_EVENT {
+    TRACE_ROTARY_CW = 1,
+    TRACE_ROTARY_CCW,
+    TRACE_ROTARY_PRESS
+};
+
+class SensorTrace {
+   public:
+    SensorTrace();
+    void begin(Print &output, unsigned long now);
+    void recordSample(unsigned long now, unsigned long dt, uint16_t voltage, uint16_t current, const MPURawType &mpu, uint8_t water);
+    void recordDHT(unsigned long now, uint8_t sensor, const uint8_t *data);
+    void recordRotary(unsigned long now, uint8_t event);
+    void recordRollover(unsigned long now, uint8_t hour);
+    void recordOffset(unsigned long now, const MPUOffsetType &offset);
+    void flush(void);
+    bool isEmpty(void);
+    uint16_t getDropped(void);
+
+   private:
+    Print *output;
+    uint8_t buffer[TRACE_BUFFER_SIZE];
+    volatile uint8_t head;      // Next write position
+    volatile uint8_t tail;      // Next read position
+    unsigned long lastTime;     // Timestamp of the last record in ms
+    uint16_t droppedPending;    // Records lost since the last TRACE_DROPPED record
+    uint16_t droppedTotal;      // Records lost since begin()
+    bool write(uint8_t type, unsigned long now, const uint8_t *payload, uint8_t length);
+    bool push(const uint8_t *data, uint8_t length);
+    static uint8_t putVarint(uint8_t *data, unsigned long value);
+};
+
+#endif
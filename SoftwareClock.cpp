@@ -0,0 +1,127 @@
+/*
+  SoftwareClock.cpp - Wall clock which advances by millis() and is disciplined by the DS3231.
+  The RTC is only read at minute boundaries (or on request), which frees the I2C bus
+  from a full time read on every loop pass.
+
+  Licensed under "MIT" License.
+*/
+#include "SoftwareClock.h"
+
+#include "Arduino.h"
+#include "DS3231_minimal.h"
+
+// PUBLIC
+
+/*
+ * Constructor of the software clock.
+ * @param rtc RTC device to discipline the clock.
+ */
+SoftwareClock::SoftwareClock(DS3231 &rtc) : rtc(rtc) {
+    timestamp = 0;
+    drift = 0;
+    resyncCount = 0;
+}
+
+/*
+ * Initial read of the time from the RTC device.
+ * @param now Current timestamp in ms.
+ */
+void SoftwareClock::begin(unsigned long now) {
+    rtc.getDateTime();
+    t = rtc.t;
+    timestamp = now;
+    drift = 0;
+    resyncCount = 1;
+}
+
+/*
+ * Advance the clock by the elapsed full seconds. Resyncs with the RTC at every minute boundary.
+ * @param now Current timestamp in ms.
+ * @return true, if the second has changed.
+ */
+bool SoftwareClock::update(unsigned long now) {
+    bool changed = false;
+    bool minuteBoundary = false;
+    while (now - timestamp >= 1000) {
+        timestamp += 1000;
+        advanceSecond();
+        changed = true;
+        if (t.second == 0) {
+            minuteBoundary = true;
+        }
+    }
+    if (minuteBoundary) {
+        resync(now);
+    }
+    return changed;
+}
+
+/*
+ * Read the time from the RTC and correct the software clock.
+ * The millis() phase is restarted at the time of the read (error < 1 s until the next resync).
+ * Without an answer of the RTC (or while it is degraded) the clock keeps running on millis().
+ * @param now Current timestamp in ms.
+ */
+void SoftwareClock::resync(unsigned long now) {
+    if (!rtc.health.isDue(now)) {
+        return;
+    }
+    uint32_t softUnixtime = t.unixtime;
+    rtc.getDateTime();
+    if (rtc.health.getFailures() > 0) {
+        return;
+    }
+    t = rtc.t;
+    drift = (long)(t.unixtime - softUnixtime);
+    timestamp = now;
+    if (resyncCount < 0xFFFF) {
+        resyncCount++;
+    }
+}
+
+/*
+ * Get the drift between RTC and software clock at the last resync.
+ * @return Drift in s (positive if the software clock was late)
+ */
+long SoftwareClock::getDrift(void) {
+    return drift;
+}
+
+/*
+ * Get the number of reads from the RTC.
+ */
+uint16_t SoftwareClock::getResyncCount(void) {
+    return resyncCount;
+}
+
+// PRIVATE
+
+/*
+ * Advance the time by one second. Carries into minute, hour and the date (day of the week,
+ * day, month, year), so the clock keeps the date, while the RTC is missing or degraded.
+ */
+void SoftwareClock::advanceSecond(void) {
+    t.unixtime++;
+    if (++t.second < 60) {
+        return;
+    }
+    t.second = 0;
+    if (++t.minute < 60) {
+        return;
+    }
+    t.minute = 0;
+    if (++t.hour < 24) {
+        return;
+    }
+    t.hour = 0;
+    t.dayOfWeek = t.dayOfWeek % 7 + 1;  // 1 ... 7 like the RTC
+    if (++t.day <= rtc.daysInMonth(t.year, t.month)) {
+        return;
+    }
+    t.day = 1;
+    if (++t.month <= 12) {
+        return;
+    }
+    t.month = 1;
+    t.year++;
+}
@@ -0,0 +1,33 @@
+/*
+  SoftwareClock.h - Wall clock which advances by millis() and is disciplined by the DS3231.
+  The RTC is only read at minute boundaries (or on request), which frees the I2C bus
+  from a full time read on every loop pass.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef SOFTWARECLOCK_H
+#define SOFTWARECLOCK_H
+
+#include "Arduino.h"
+#include "DS3231_minimal.h"
+
+class SoftwareClock {
+   public:
+    SoftwareClock(DS3231 &rtc);
+    RTCDateTime t;
+    void begin(unsigned long now);
+    bool update(unsigned long now);
+    void resync(unsigned long now);
+    long getDrift(void);
+    uint16_t getResyncCount(void);
+
+   private:
+    DS3231 &rtc;
+    unsigned long timestamp;  // Timestamp of the last full second in ms
+    long drift;               // Difference RTC - software clock in s at the last resync
+    uint16_t resyncCount;     // Number of reads from the RTC
+    void advanceSecond(void);
+};
+
+#endif
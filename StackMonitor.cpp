@@ -0,0 +1,101 @@
+/*
+  StackMonitor.cpp - High-water mark of the stack used by a piece of code.
+
+  Licensed under "MIT" License.
+*/
+#include "StackMonitor.h"
+
+#include "Arduino.h"
+
+#ifdef __AVR
+extern uint8_t __heap_start;  // End of the static variables (linker)
+extern void *__brkval;        // End of the heap (malloc), 0 without heap
+#else
+#define STACK_MONITOR_HOST_GUARD 256   // Red zone and locals of paint() below its frame on the host
+#define STACK_MONITOR_HOST_SIZE 4096   // The host frames of the simulator are larger
+#endif
+
+// PUBLIC
+
+/*
+ * Constructor of the monitor without measurements.
+ */
+StackMonitor::StackMonitor() {
+    top = NULL;
+    size = 0;
+    reset();
+}
+
+/*
+ * Clear the high-water mark.
+ */
+void StackMonitor::reset(void) {
+    maxDepth = 0;
+    count = 0;
+}
+
+/*
+ * Paint the free stack below the caller. Not inlined, so the frame of paint() is the lowest one.
+ */
+void __attribute__((noinline)) StackMonitor::paint(void) {
+#ifdef __AVR
+    top = (uint8_t *)SP;
+    uint8_t *heapEnd = __brkval != 0 ? (uint8_t *)__brkval : &__heap_start;
+    uint16_t free = top - heapEnd > STACK_MONITOR_MARGIN ? top - heapEnd - STACK_MONITOR_MARGIN : 0;
+    size = min(free, (uint16_t)STACK_MONITOR_SIZE);
+#else
+    top = (uint8_t *)__builtin_frame_address(0) - STACK_MONITOR_HOST_GUARD;
+    size = STACK_MONITOR_HOST_SIZE;
+#endif
+    volatile uint8_t *p = top - size;
+    while (p < top) {
+        *p++ = STACK_MONITOR_PATTERN;
+    }
+}
+
+/*
+ * Find the lowest overwritten byte since paint() and update the high-water mark.
+ * @return Used bytes below the stack pointer of paint() (size of the painted area, if all were used)
+ */
+uint16_t StackMonitor::measure(void) {
+    if (top == NULL) {
+        return 0;
+    }
+    volatile uint8_t *p = top - size;
+    while (p < top && *p == STACK_MONITOR_PATTERN) {
+        p++;
+    }
+    uint16_t depth = top - (uint8_t *)p;
+    if (depth > maxDepth) {
+        maxDepth = depth;
+    }
+    count++;
+    return depth;
+}
+
+/*
+ * Get the maximum depth of all measurements in bytes.
+ */
+uint16_t StackMonitor::getMaxDepth(void) {
+    return maxDepth;
+}
+
+/*
+ * Get the number of measurements.
+ */
+unsigned long StackMonitor::getCount(void) {
+    return count;
+}
+
+/*
+ * Print the high-water mark as one line to the serial port.
+ * @param name Name of the measured code
+ */
+void StackMonitor::print(const char *name) {
+    Serial.print(name);
+    Serial.print(F(" stack: "));
+    Serial.print(maxDepth);
+    Serial.print(F(" bytes max ("));
+    Serial.print(count);
+    Serial.println(F(" measurements)"));
+}
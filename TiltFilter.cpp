@@ -0,0 +1,123 @@
+/*
+  TiltFilter.cpp - Fusion of the gyroscope rate and the accelerometer angle of one tilt axis.
+  The gyroscope rate is integrated to the angle and the angle is pulled towards the angle of
+  the accelerometer, so short disturbances of the accelerometer (people walking in the van,
+  wind gusts) are damped, while a real tilt is followed at once. The offset of the gyroscope
+  is its mean rate at rest (accelerometer angle steady), so the angle doesn't drift. Until the
+  first rest, the rate at the start is taken.
+
+  Licensed under "MIT" License.
+*/
+#include "TiltFilter.h"
+
+// PUBLIC
+
+/*
+ * Constructor of the filter. The first update starts at the accelerometer angle and takes the
+ * gyroscope rate as its offset, until the first rest.
+ * @param mode TILT_FILTER_MODE
+ * @param tau Time constant of the complementary filter in ms (>= 4 times the time between two updates)
+ */
+TiltFilter::TiltFilter(uint8_t mode, uint16_t tau) {
+    this->mode = mode;
+    this->tau = tau;
+    started = false;
+    restCount = 0;
+    restSamples = 0;
+    angle = 0;
+    offset = 0;
+    lastAccel = 0;
+    variance = TILT_KALMAN_R;
+    disturbance = 0;
+}
+
+/*
+ * Start again like after the construction (e.g. after a new calibration of the gyroscope): the
+ * next update starts at the accelerometer angle and takes the gyroscope rate as its offset.
+ */
+void TiltFilter::restart(void) {
+    started = false;
+    restCount = 0;
+    restSamples = 0;
+}
+
+/*
+ * Restart at an angle. The offset of the gyroscope is kept.
+ * @param angle Angle in 0.01 deg
+ */
+void TiltFilter::reset(int16_t angle) {
+    this->angle = (int32_t)angle * (1L << TILT_FILTER_SHIFT);
+    lastAccel = angle;
+    restCount = 0;
+    variance = TILT_KALMAN_R;  // as uncertain as the accelerometer
+    disturbance = 0;
+    started = true;
+}
+
+/*
+ * Add a sample: integrate the rate over the time since the last sample and correct the angle
+ * by the accelerometer angle.
+ * @param accelAngle Angle of the accelerometer in 0.01 deg (-18000 ... 18000)
+ * @param gyroRate Rate of the gyroscope in 0.01 deg/s (sense of the angle)
+ * @param dt Time since the last sample in ms
+ * @return Fused angle in 0.01 deg
+ */
+int16_t TiltFilter::update(int16_t accelAngle, int16_t gyroRate, unsigned long dt) {
+    int32_t rate = (int32_t)gyroRate * (1L << TILT_FILTER_SHIFT);
+    if (!started) {
+        offset = rate;
+    }
+    if (!started || dt > TILT_FILTER_MAX_DT) {
+        reset(accelAngle);  // the gyroscope doesn't know, what happened in the gap
+        return getAngle();
+    }
+
+    // Offset of the gyroscope: mean of its rate, while the van stands still (running mean of the
+    // first samples, then a moving mean over TILT_FILTER_OFFSET_TAU)
+    if (abs(accelAngle - lastAccel) > TILT_FILTER_REST_ANGLE) {
+        restCount = 0;
+    } else if (restCount < TILT_FILTER_REST_COUNT) {
+        restCount++;
+    } else if (restSamples < 0xFF && (uint32_t)restSamples * dt < TILT_FILTER_OFFSET_TAU) {
+        restSamples++;
+        offset += (rate - offset) / restSamples;
+    } else {
+        offset += (rate - offset) * (int32_t)dt / TILT_FILTER_OFFSET_TAU;
+    }
+    lastAccel = accelAngle;
+
+    // Prediction by the rate without its offset (rate * dt / 1000 in two steps, without overflow)
+    angle += (rate - offset) / 8 * (int32_t)dt / 125;
+
+    // Correction by the accelerometer: weight of its angle in 1/256
+    const int32_t errorRange = 18000L << TILT_FILTER_SHIFT;
+    int32_t error = constrain((int32_t)accelAngle * (1L << TILT_FILTER_SHIFT) - angle, -errorRange, errorRange);
+    int32_t gain;
+    if (mode == TILT_FILTER_KALMAN) {
+        int32_t difference = constrain(error / (1L << TILT_FILTER_SHIFT), -TILT_FILTER_MAX_ERROR, TILT_FILTER_MAX_ERROR);
+        disturbance += (difference * difference - disturbance) * (int32_t)dt / tau;
+        variance += (int32_t)TILT_KALMAN_Q * dt / 1000;
+        gain = (variance << 8) / (variance + max((int32_t)TILT_KALMAN_R, disturbance));
+        variance -= variance * gain / 256;
+    } else {
+        gain = min(256L, (int32_t)dt * 256 / tau);
+    }
+    angle += error * gain / 256;
+    return getAngle();
+}
+
+/*
+ * Get the fused angle.
+ * @return Angle in 0.01 deg
+ */
+int16_t TiltFilter::getAngle(void) {
+    return (angle + (1L << (TILT_FILTER_SHIFT - 1))) >> TILT_FILTER_SHIFT;
+}
+
+/*
+ * Get the offset of the gyroscope rate.
+ * @return Offset in 0.01 deg/s
+ */
+int16_t TiltFilter::getOffset(void) {
+    return offset / (1L << TILT_FILTER_SHIFT);
+}
@@ -0,0 +1,66 @@
+/*
+  TiltFilter.h - Fusion of the gyroscope rate and the accelerometer angle of one tilt axis.
+  The gyroscope rate is integrated to the angle and the angle is pulled towards the angle of
+  the accelerometer, so short disturbances of the accelerometer (people walking in the van,
+  wind gusts) are damped, while a real tilt is followed at once. The offset of the gyroscope
+  is its mean rate at rest (accelerometer angle steady), so the angle doesn't drift. Until the
+  first rest, the rate at the start is taken.
+
+  Modes: the complementary filter pulls the angle by a fixed time constant; the Kalman filter
+  by the gain of the variance of the angle (process noise TILT_KALMAN_Q of the integrated
+  rate, measurement noise TILT_KALMAN_R of the accelerometer angle). Its gain is high after a
+  reset and settles near the one of the complementary filter with 10 s at 2 updates/s. While
+  the accelerometer is disturbed (mean square of the difference of the angles above
+  TILT_KALMAN_R), the gain drops.
+
+  All state is fixed point, an update takes constant time (a few 32 bit divisions).
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef TILTFILTER_H
+#define TILTFILTER_H
+
+#include "Arduino.h"
+
+#define TILT_FILTER_SHIFT 8        // Fraction bits of the angle and the rate offset
+#define TILT_FILTER_MAX_DT 2000    // Longer gaps between two updates (in ms) restart at the accelerometer angle
+#define TILT_FILTER_REST_ANGLE 30  // Maximum change of the accelerometer angle between two updates at rest (in 0.01 deg)
+#define TILT_FILTER_REST_COUNT 4   // Updates with a steady accelerometer angle in a row, which mean rest
+#define TILT_FILTER_OFFSET_TAU 10000  // Time constant of the mean of the gyroscope rate at rest (in ms)
+#define TILT_FILTER_MAX_ERROR 200  // Limit of the angle difference for the disturbance estimation (in 0.01 deg: gain >= 1/4)
+#ifndef TILT_KALMAN_Q
+#define TILT_KALMAN_Q 250          // Variance of the integrated rate per s (in (0.01 deg)^2/s: rocking of the van and noise)
+#endif
+#ifndef TILT_KALMAN_R
+#define TILT_KALMAN_R 10000        // Variance of the accelerometer angle (in (0.01 deg)^2: 1 deg standard deviation)
+#endif
+
+enum TILT_FILTER_MODE {
+    TILT_FILTER_COMPLEMENTARY,  // Fixed time constant
+    TILT_FILTER_KALMAN          // Gain by the variance of the angle
+};
+
+class TiltFilter {
+   public:
+    TiltFilter(uint8_t mode = TILT_FILTER_COMPLEMENTARY, uint16_t tau = 10000);
+    void restart(void);
+    void reset(int16_t angle);
+    int16_t update(int16_t accelAngle, int16_t gyroRate, unsigned long dt);
+    int16_t getAngle(void);
+    int16_t getOffset(void);
+
+   private:
+    uint8_t mode;       // TILT_FILTER_MODE
+    bool started;       // false: the next update starts at the accelerometer angle and the gyroscope rate
+    uint8_t restCount;  // Updates with a steady accelerometer angle in a row
+    uint8_t restSamples;  // Rates in the mean of the offset (up to TILT_FILTER_OFFSET_TAU)
+    uint16_t tau;       // Time constant in ms
+    int32_t angle;      // Angle in 0.01 deg << TILT_FILTER_SHIFT
+    int32_t offset;     // Offset of the gyroscope rate in 0.01 deg/s << TILT_FILTER_SHIFT
+    int16_t lastAccel;  // Accelerometer angle of the last update in 0.01 deg
+    int32_t variance;   // Variance of the angle in (0.01 deg)^2 (Kalman)
+    int32_t disturbance;  // Mean square of the difference of the angles in (0.01 deg)^2 (Kalman)
+};
+
+#endif
@@ -0,0 +1,274 @@
+/*
+  TwiQueue.cpp - Non-blocking I2C master with a fixed-size queue of transactions.
+  A driver posts a request (register address to write, buffer to read) and picks up
+  the result later by its status or a completion callback. The transactions run one
+  after another in the order of posting, driven by the TWI hardware flags.
+
+  Licensed under "MIT" License.
+*/
+#include "TwiQueue.h"
+
+#include <util/twi.h>
+
+#include "Arduino.h"
+
+TwiRequest *TwiQueue::queue[TWI_QUEUE_SIZE];
+uint8_t TwiQueue::head = 0;
+uint8_t TwiQueue::count = 0;
+uint8_t TwiQueue::index = 0;
+bool TwiQueue::reading = false;
+unsigned long TwiQueue::completed = 0;
+unsigned long TwiQueue::rejected = 0;
+unsigned long TwiQueue::recoveries = 0;
+unsigned long TwiQueue::stepTime = 0;
+uint8_t TwiQueue::busBitRate = TWI_BIT_RATE(TWI_FREQUENCY);
+
+// PUBLIC
+
+/*
+ * Set the SCL frequency of the bus and enable the TWI module (same settings as Wire.begin() and
+ * Wire.setClock()). All devices on the bus must support the frequency, or have a slower clock
+ * in their requests.
+ * @param frequency SCL frequency in Hz (TWI_FREQUENCY or TWI_FAST_FREQUENCY)
+ */
+void TwiQueue::begin(uint32_t frequency) {
+    busBitRate = TWI_BIT_RATE(frequency);
+    TWSR = 0;  // prescaler 1
+    TWBR = busBitRate;
+    TWCR = _BV(TWEN);
+}
+
+/*
+ * Set the SCL clock of the following blocking Wire calls. Call select(0) after them, so the
+ * other devices (e.g. the display) run at the clock of the bus again.
+ * @param bitRate TWBR of the device (TWI_BIT_RATE), 0: clock of the bus
+ */
+void TwiQueue::select(uint8_t bitRate) {
+    TWBR = bitRate != 0 ? bitRate : busBitRate;
+}
+
+/*
+ * Get the SCL frequency of the bus in Hz.
+ */
+uint32_t TwiQueue::getFrequency(void) {
+    return F_CPU / (16 + 2UL * busBitRate);
+}
+
+/*
+ * Add a transaction to the end of the queue. The request must stay valid until it is
+ * completed. A rejected request is untouched, the caller keeps it and posts it again later.
+ * @param request Transaction to run
+ * @return true, if the request was queued. false, if the queue is full or the request is still pending.
+ */
+bool TwiQueue::post(TwiRequest *request) {
+    if (request->status == TWI_QUEUED || request->status == TWI_ACTIVE) {
+        return false;
+    }
+    noInterrupts();
+    if (count >= TWI_QUEUE_SIZE) {
+        rejected++;
+        interrupts();
+        return false;
+    }
+    request->status = TWI_QUEUED;
+    queue[(head + count) % TWI_QUEUE_SIZE] = request;
+    count++;
+    interrupts();
+    return true;
+}
+
+/*
+ * Advance the active transaction by one step, if the bus is ready. Call it often (every loop pass).
+ */
+void TwiQueue::poll(void) {
+    noInterrupts();
+    step();
+    interrupts();
+}
+
+/*
+ * Run all queued transactions to completion (blocking). Used before a blocking Wire call.
+ * Bounded by the time limit of the bus steps.
+ */
+void TwiQueue::flush(void) {
+    while (!isIdle()) {
+        poll();
+    }
+}
+
+/*
+ * Check if no transaction is queued and the bus is released (stop condition sent).
+ */
+bool TwiQueue::isIdle(void) {
+    return count == 0 && !(TWCR & _BV(TWSTO));
+}
+
+/*
+ * Get the number of free places in the queue.
+ */
+uint8_t TwiQueue::available(void) {
+    return TWI_QUEUE_SIZE - count;
+}
+
+/*
+ * Get the number of completed transactions (incl. failed ones).
+ */
+unsigned long TwiQueue::getCompleted(void) {
+    return completed;
+}
+
+/*
+ * Get the number of posts rejected by a full queue.
+ */
+unsigned long TwiQueue::getRejected(void) {
+    return rejected;
+}
+
+/*
+ * Free the bus from a slave, which holds SDA low: with the TWI module off, SCL is clocked
+ * (open drain) until SDA is released (at most 9 clocks, one byte and the acknowledge), then
+ * a stop condition is sent and the module is restarted. Queued transactions stay queued.
+ * Also used after a timeout of a blocking Wire call.
+ * @return true, if SDA is released
+ */
+bool TwiQueue::recover(void) {
+    recoveries++;
+    TWCR = 0;  // TWI off, SDA and SCL are port pins
+    pinMode(SDA, INPUT_PULLUP);
+    pinMode(SCL, INPUT_PULLUP);
+    for (uint8_t i = 0; i < 9 && digitalRead(SDA) == LOW; i++) {
+        digitalWrite(SCL, LOW);  // pull-up off before the pin drives low
+        pinMode(SCL, OUTPUT);
+        delayMicroseconds(5);
+        pinMode(SCL, INPUT_PULLUP);
+        delayMicroseconds(5);
+    }
+    // Stop condition: SDA rises while SCL is high
+    digitalWrite(SDA, LOW);
+    pinMode(SDA, OUTPUT);
+    delayMicroseconds(5);
+    pinMode(SDA, INPUT_PULLUP);
+    delayMicroseconds(5);
+    bool released = digitalRead(SDA) == HIGH;
+    TWSR = 0;
+    TWBR = busBitRate;
+    TWCR = _BV(TWEN);
+    stepTime = micros();
+    return released;
+}
+
+/*
+ * Get the number of bus recoveries.
+ */
+unsigned long TwiQueue::getRecoveries(void) {
+    return recoveries;
+}
+
+// PRIVATE
+
+/*
+ * State machine of the master transmitter and receiver (status codes of util/twi.h).
+ * A request writes its bytes first and reads after a repeated start, if it has both.
+ * A bus step, which exceeds TWI_STEP_TIMEOUT, ends the transaction and recovers the bus.
+ */
+void TwiQueue::step(void) {
+    if (count == 0) {
+        return;
+    }
+    TwiRequest *request = queue[head];
+
+    if (request->status == TWI_QUEUED) {
+        if (TWCR & _BV(TWSTO)) {
+            if (micros() - stepTime > TWI_STEP_TIMEOUT) {
+                recover();  // stop condition of the previous transaction hangs
+            }
+            return;  // stop condition of the previous transaction still on the bus
+        }
+        request->status = TWI_ACTIVE;
+        index = 0;
+        reading = request->writeLength == 0 && request->readLength > 0;
+        select(request->bitRate);
+        TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTA);
+        stepTime = micros();
+        return;
+    }
+    if (!(TWCR & _BV(TWINT))) {
+        if (micros() - stepTime > TWI_STEP_TIMEOUT) {
+            finish(TWI_TIMEOUT, false);
+            recover();
+        }
+        return;  // bus busy
+    }
+    stepTime = micros();
+
+    switch (TW_STATUS) {
+        case TW_START:
+        case TW_REP_START:
+            TWDR = (request->address << 1) | (reading ? TW_READ : TW_WRITE);
+            TWCR = _BV(TWINT) | _BV(TWEN);
+            break;
+
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if (index < request->writeLength) {
+                TWDR = request->writeData[index++];
+                TWCR = _BV(TWINT) | _BV(TWEN);
+            } else if (request->readLength > 0) {
+                index = 0;
+                reading = true;
+                TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTA);
+            } else {
+                finish(TWI_DONE, true);
+            }
+            break;
+
+        case TW_MR_SLA_ACK:
+            TWCR = _BV(TWINT) | _BV(TWEN) | (request->readLength > 1 ? _BV(TWEA) : 0);
+            break;
+
+        case TW_MR_DATA_ACK:
+            request->readData[index++] = TWDR;
+            TWCR = _BV(TWINT) | _BV(TWEN) | (index + 1 < request->readLength ? _BV(TWEA) : 0);
+            break;
+
+        case TW_MR_DATA_NACK:
+            request->readData[index++] = TWDR;
+            finish(TWI_DONE, true);
+            break;
+
+        case TW_MT_SLA_NACK:
+        case TW_MT_DATA_NACK:
+        case TW_MR_SLA_NACK:
+            finish(TWI_NACK, true);
+            break;
+
+        case TW_MT_ARB_LOST:
+            finish(TWI_ERROR, false);  // release the bus without a stop condition
+            break;
+
+        default:
+            finish(TWI_ERROR, true);  // bus error, a stop condition resets the module
+            break;
+    }
+}
+
+/*
+ * End the active transaction and remove it from the queue.
+ * @param status Result of the transaction (TWI_STATUS)
+ * @param stop true, if a stop condition is sent
+ */
+void TwiQueue::finish(uint8_t status, bool stop) {
+    TWCR = _BV(TWINT) | _BV(TWEN) | (stop ? _BV(TWSTO) : 0);
+    stepTime = micros();
+    TwiRequest *request = queue[head];
+    if (request->bitRate != 0) {
+        TWBR = busBitRate;  // back to the clock of the bus (the stop condition is already on its way)
+    }
+    head = (head + 1) % TWI_QUEUE_SIZE;
+    count--;
+    completed++;
+    request->status = status;
+    if (request->callback != NULL) {
+        request->callback(request);
+    }
+}
@@ -0,0 +1,90 @@
+/*
+  TwiQueue.h - Non-blocking I2C master with a fixed-size queue of transactions.
+  A driver posts a request (register address to write, buffer to read) and picks up
+  the result later by its status or a completion callback. The transactions run one
+  after another in the order of posting, driven by the TWI hardware flags.
+
+  The Wire library owns the TWI interrupt vector (and the display library needs Wire),
+  so the state machine is advanced by poll() from the main loop instead of an ISR. The
+  blocking calls of the drivers flush the queue before they use Wire.
+
+  The SCL clock is set for the bus by begin(). A request (or a blocking call by select())
+  of a device, which can't handle it, runs at the slower clock of the device.
+
+  Every bus step (start, byte, stop) has a time limit. A transaction, which exceeds it, ends
+  with TWI_TIMEOUT and the bus is recovered: a slave, which holds SDA low (e.g. after a
+  glitch in the middle of a read), is clocked out by SCL pulses and a stop condition.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef TWIQUEUE_H
+#define TWIQUEUE_H
+
+#include "Arduino.h"
+
+#ifndef TWI_QUEUE_SIZE
+#define TWI_QUEUE_SIZE 4        // Maximum number of queued transactions
+#endif
+#define TWI_FREQUENCY 100000L        // Default SCL frequency in Hz (standard mode)
+#define TWI_FAST_FREQUENCY 400000L   // SCL frequency of the fast mode in Hz
+#define TWI_BIT_RATE(frequency) ((uint8_t)(((F_CPU / (frequency)) - 16) / 2))  // TWBR of an SCL frequency (prescaler 1, >= 31 kHz)
+#define TWI_STEP_TIMEOUT 1000   // Time limit of one bus step in us (a byte takes 90 us)
+#define TWI_WIRE_TIMEOUT 5000   // Time limit of the blocking Wire calls in us (Wire.setWireTimeout)
+
+enum TWI_STATUS {
+    TWI_IDLE = 0,   // Not posted
+    TWI_QUEUED,     // Waiting in the queue
+    TWI_ACTIVE,     // On the bus
+    TWI_DONE,       // Completed
+    TWI_NACK,       // Not acknowledged by the device
+    TWI_ERROR,      // Arbitration lost or bus error
+    TWI_TIMEOUT     // Time limit of a bus step exceeded
+};
+
+struct TwiRequest;
+typedef void (*TwiCallback)(TwiRequest *request);
+
+struct TwiRequest {
+    uint8_t address;            // 7 bit device address
+    const uint8_t *writeData;   // Bytes to write (e.g. the register address)
+    uint8_t writeLength;
+    uint8_t *readData;          // Buffer of the bytes to read after a repeated start
+    uint8_t readLength;
+    uint8_t bitRate;            // TWBR of the SCL clock of the device (0: clock of the bus)
+    TwiCallback callback;       // Called on completion (optional, from poll())
+    void *context;              // Free for the owner of the request
+    volatile uint8_t status;    // TWI_STATUS
+};
+
+class TwiQueue {
+   public:
+    static void begin(uint32_t frequency = TWI_FREQUENCY);
+    static void select(uint8_t bitRate);
+    static uint32_t getFrequency(void);
+    static bool post(TwiRequest *request);
+    static void poll(void);
+    static void flush(void);
+    static bool isIdle(void);
+    static uint8_t available(void);
+    static unsigned long getCompleted(void);
+    static unsigned long getRejected(void);
+    static bool recover(void);
+    static unsigned long getRecoveries(void);
+
+   private:
+    static TwiRequest *queue[TWI_QUEUE_SIZE];
+    static uint8_t head;         // Index of the active or next transaction
+    static uint8_t count;        // Number of queued transactions
+    static uint8_t index;        // Next byte of the active transaction
+    static bool reading;         // Read phase of the active transaction
+    static unsigned long completed;
+    static unsigned long rejected;
+    static unsigned long recoveries;
+    static unsigned long stepTime;  // Start of the running bus step in us
+    static uint8_t busBitRate;      // TWBR of the SCL clock of the bus
+    static void step(void);
+    static void finish(uint8_t status, bool stop);
+};
+
+#endif
@@ -27,6 +27,11 @@
 #define DHT_BEGIN_MEASUREMENT_2   2
 #define DHT_DO_READING            3
 #define DHT_COOLDOWN              4
+#define DHT_RECEIVING             5
+
+
+/* Number of milliseconds to wait for the edges of a transmission (~5 ms). */
+#define RECEIVE_TIME  10
 
 
 /* Number of milliseconds before a new sensor read may be initiated. */
@@ -45,6 +50,9 @@ DHT_nonblocking::DHT_nonblocking( uint8_t pin, uint8_t type )
 	  _maxcycles( microsecondsToClockCycles( 1000 ) )
 {
   dht_state = DHT_IDLE;
+  interrupt_mode = false;
+  edge_index = DHT_EDGE_COUNT;
+  edge_failed = true;
 
   pinMode( _pin, INPUT );
   digitalWrite( _pin, HIGH );
@@ -72,6 +80,129 @@ bool DHT_nonblocking::measure( float *temperature, float *humidity )
 
 
 
+/*
+ * The five data bytes of the last valid measurement (humidity, temperature
+ * and checksum), e.g. to record them.
+ */
+const uint8_t *DHT_nonblocking::get_data( ) const
+{
+  return( data );
+}
+
+
+
+/*
+ * Convert recorded data bytes like a measurement.  Returns false if the
+ * checksum doesn't match.
+ */
+bool DHT_nonblocking::decode( const uint8_t *raw, float *temperature, float *humidity )
+{
+  memcpy( data, raw, 5 );
+  if( checksum_valid( ) == false )
+  {
+    return( false );
+  }
+  *temperature = read_temperature( );
+  *humidity    = read_humidity( );
+  return( true );
+}
+
+
+
+/*
+ * Select how the bits of a transmission are read: with interrupt mode, the
+ * line is released after the start signal and the bits are decoded from the
+ * edges passed to pin_changed( ), interrupts stay enabled.  Otherwise the
+ * pulses are timed by busy loops with interrupts disabled (~5 ms).
+ */
+void DHT_nonblocking::set_interrupt_mode( bool enable )
+{
+  interrupt_mode = enable;
+}
+
+
+
+/*
+ * Pin change handler of the data pin in interrupt mode.  Call it on every
+ * level change of the pin (interrupt context).
+ */
+void DHT_nonblocking::pin_changed( )
+{
+  decode_edge( ( *portInputRegister( _port ) & _bit ) != 0, micros( ) );
+}
+
+
+
+/*
+ * Prepare the edge decoder for a new transmission.  The edges before are
+ * ignored.
+ */
+void DHT_nonblocking::begin_edges( )
+{
+  edge_index = 0;
+  edge_failed = false;
+}
+
+
+
+/*
+ * Decode the next edge of a transmission.  The response of the sensor (low,
+ * high) is skipped, then every falling edge ends the high pulse of a bit: the
+ * bit is a 1, if the pulse is longer than DHT_EDGE_ONE.  Unlike the blocking
+ * read, the pulse is not compared with the low pulse, as the latency of the
+ * interrupt adds to both of them.  A rising edge before the
+ * response is the release of the line.  An edge of the wrong level (a lost
+ * edge) or a pulse longer than DHT_EDGE_TIMEOUT fails the transmission.
+ * The level is the one after the edge, the time is micros( ) of the edge.
+ */
+void DHT_nonblocking::decode_edge( bool level, uint16_t time )
+{
+  if( edge_failed == true || edge_index >= DHT_EDGE_COUNT )
+  {
+    return;
+  }
+  if( edge_index == 0 && level == HIGH )
+  {
+    return;
+  }
+
+  uint16_t pulse = time - edge_time;
+  bool expected = ( edge_index & 1 ) != 0;
+  if( level != expected || ( edge_index > 0 && pulse > DHT_EDGE_TIMEOUT ) )
+  {
+    edge_failed = true;
+    return;
+  }
+  if( edge_index >= 4 && level == LOW )
+  {
+    uint8_t bit = ( edge_index - 4 ) / 2;
+    data[ bit / 8 ] <<= 1;
+    if( pulse > DHT_EDGE_ONE )
+    {
+      data[ bit / 8 ] |= 1;
+    }
+  }
+  edge_time = time;
+  edge_index++;
+}
+
+
+
+/*
+ * State of the edge decoder: DHT_EDGE_PENDING while the edges arrive,
+ * DHT_EDGE_DONE after all 40 bits, DHT_EDGE_FAILED after a timing error.
+ */
+uint8_t DHT_nonblocking::edge_status( ) const
+{
+  if( edge_failed == true )
+  {
+    return( DHT_EDGE_FAILED );
+  }
+  return( edge_index >= DHT_EDGE_COUNT ? DHT_EDGE_DONE : DHT_EDGE_PENDING );
+}
+
+
+
 float DHT_nonblocking::read_temperature( ) const
 {
   int16_t value;
@@ -137,11 +268,12 @@ float DHT_nonblocking::read_humidity( ) const
 /*
  * Expect the input to be at the specified level and return the number
  * of loop cycles spent there.  This is identical to Adafruit's blocking
- * driver.
+ * driver, but counts in 16 bits (the timeout of 1 ms is 16000 cycles at
+ * 16 MHz).
  */
-uint32_t DHT_nonblocking::expect_pulse(bool level) const
+uint16_t DHT_nonblocking::expect_pulse(bool level) const
 {
-  uint32_t count = 0;
+  uint16_t count = 0;
   // On AVR platforms use direct GPIO port access as it's much faster and better
   // for catching pulses that are 10's of microseconds in length:
   #ifdef __AVR
@@ -207,6 +339,12 @@ bool DHT_nonblocking::read_nonblocking( )
     if( millis( ) - dht_timestamp > 20 )
     {
       dht_timestamp = millis( );
+      if( interrupt_mode == true )
+      {
+        release_line( );
+        dht_state = DHT_RECEIVING;
+        break;
+      }
       dht_state = DHT_COOLDOWN;
       status = read_data( );
 //      if( status != true )
@@ -216,6 +354,18 @@ bool DHT_nonblocking::read_nonblocking( )
     }
     break;
 
+  /* Wait for the edges of the transmission, decoded by the pin change
+     interrupt. */
+  case DHT_RECEIVING:
+    if( edge_status( ) != DHT_EDGE_PENDING || millis( ) - dht_timestamp > RECEIVE_TIME )
+    {
+      status = edge_status( ) == DHT_EDGE_DONE && checksum_valid( );
+      edge_failed = true;
+      dht_timestamp = millis( );
+      dht_state = DHT_COOLDOWN;
+    }
+    break;
+
   /* If it has been less than two seconds since the last time we read
      the sensor, then let the sensor cool down.. */
   case DHT_COOLDOWN:
@@ -234,10 +384,11 @@ bool DHT_nonblocking::read_nonblocking( )
 
 
 
-/* Read sensor data.  This is identical to Adafruit's blocking driver. */
+/* Read sensor data.  This is based on Adafruit's blocking driver, but
+   decodes every bit as soon as its high pulse ended instead of storing
+   the 80 pulse lengths first (320 bytes of stack). */
 bool DHT_nonblocking::read_data( )
 {
-  uint32_t cycles[ 80 ];
 
   /* Turn off interrupts temporarily because the next sections are timing critical
      and we don't want any interruptions. */
@@ -270,47 +421,52 @@ bool DHT_nonblocking::read_data( )
     // then it's a 1.  We measure the cycle count of the initial 50us low pulse
     // and use that to compare to the cycle count of the high pulse to determine
     // if the bit is a 0 (high state cycle count < low state cycle count), or a
-    // 1 (high state cycle count > low state cycle count). Note that for speed all
-    // the pulses are read into a array and then examined in a later step.
-    for( int i = 0; i < 80; i += 2 )
+    // 1 (high state cycle count > low state cycle count).  The bit is shifted
+    // in right after its high pulse: this takes a few cycles of the next low
+    // pulse, which is only compared with the next high pulse (~50 us against
+    // ~28 or ~70 us), so the tolerance stays the same.
+    for( uint8_t i = 0; i < 40; ++i )
     {
-      cycles[ i     ] = expect_pulse( LOW );
-      cycles[ i + 1 ] = expect_pulse( HIGH );
+      uint16_t low_cycles  = expect_pulse( LOW );
+      uint16_t high_cycles = expect_pulse( HIGH );
+      if( ( low_cycles == 0 ) || ( high_cycles == 0 ) )
+      {
+        return( false );
+      }
+      data[ i / 8 ] <<= 1;
+      if( high_cycles > low_cycles )
+      {
+        data[ i / 8 ] |= 1;
+      }
     }
 
     /* Timing critical code is now complete. */
   }
 
-  // Inspect pulses and determine which ones are 0 (high state cycle count < low
-  // state cycle count), or 1 (high state cycle count > low state cycle count).
-  for( int i = 0; i < 40; ++i )
-  {
-    uint32_t low_cycles  = cycles[ 2 * i     ];
-    uint32_t high_cycles = cycles[ 2 * i + 1 ];
-    if( ( low_cycles == 0 ) || ( high_cycles == 0 ) )
-    {
-      return( false );
-    }
-    data[ i / 8 ] <<= 1;
-    // Now compare the low and high cycle times to see if the bit is a 0 or 1.
-    if( high_cycles > low_cycles )
-    {
-      // High cycles are greater than 50us low cycle count, must be a 1.
-      data[ i / 8 ] |= 1;
-    }
-    // Else high cycles are less than (or equal to, a weird case) the 50us low
-    // cycle count so this must be a zero.  Nothing needs to be changed in the
-    // stored data.
-  }
-
   // Check we read 40 bits and that the checksum matches.
-  if( data[ 4 ] == ( ( data[ 0 ] + data[ 1 ] + data[ 2 ] + data[ 3 ]) & 0xFF ) )
-  {
-    return( true );
-  }
-  else
-  {
-    return( false );
-  }
+  return( checksum_valid( ) );
+}
+
+
+
+/*
+ * End the start signal in interrupt mode: arm the edge decoder and release
+ * the line to the pull-up.  The sensor answers after 20-40 us.
+ */
+void DHT_nonblocking::release_line( )
+{
+  begin_edges( );
+  digitalWrite( _pin, HIGH );
+  pinMode( _pin, INPUT );
+}
+
+
+
+/*
+ * Check the checksum of the data bytes (sum of the first four bytes).
+ */
+bool DHT_nonblocking::checksum_valid( ) const
+{
+  return( data[ 4 ] == ( ( data[ 0 ] + data[ 1 ] + data[ 2 ] + data[ 3 ]) & 0xFF ) );
 }
 
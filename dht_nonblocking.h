@@ -33,15 +33,34 @@
 #define DHT_TYPE_21  1
 #define DHT_TYPE_22  2
 
+/* Edge decoder (interrupt mode): the sensor answers with 83 edges, the
+   response (low, high) and 40 bits (low ~50 us, high ~26 us for a 0 and
+   ~70 us for a 1).  Every pulse must end within DHT_EDGE_TIMEOUT. */
+#define DHT_EDGE_COUNT     83
+#define DHT_EDGE_TIMEOUT   255   /* Maximum length of a pulse in us. */
+#define DHT_EDGE_ONE       48    /* High pulses longer than this (in us) are a 1. */
+#define DHT_EDGE_PENDING   0
+#define DHT_EDGE_DONE      1
+#define DHT_EDGE_FAILED    2
+
 
 class DHT_nonblocking
 {
   public:
     DHT_nonblocking( uint8_t pin, uint8_t type );
     bool measure( float *temperature, float *humidity );
+    const uint8_t *get_data( ) const;
+    bool decode( const uint8_t *raw, float *temperature, float *humidity );
+    void set_interrupt_mode( bool enable );
+    void pin_changed( );
+    void begin_edges( );
+    void decode_edge( bool level, uint16_t time );
+    uint8_t edge_status( ) const;
 
   private:
     bool read_data( );
+    void release_line( );
+    bool checksum_valid( ) const;
     bool read_nonblocking( );
     float read_temperature( ) const;
     float read_humidity( ) const;
@@ -49,10 +68,14 @@ class DHT_nonblocking
     uint8_t dht_state;
     unsigned long dht_timestamp;
     uint8_t data[ 6 ];
+    bool interrupt_mode;
+    volatile uint8_t edge_index;    /* Next expected edge, DHT_EDGE_COUNT when done. */
+    volatile bool edge_failed;
+    uint16_t edge_time;             /* micros( ) of the last edge. */
     const uint8_t _pin, _type, _bit, _port;
-    const uint32_t _maxcycles;
+    const uint16_t _maxcycles;
 
-    uint32_t expect_pulse( bool level ) const;
+    uint16_t expect_pulse( bool level ) const;
 };
 
 
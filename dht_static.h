@@ -0,0 +1,529 @@
+/*
+ * DHT11, DHT21, and DHT22 non-blocking driver, specialized at compile time.
+ * Based on DHT_nonblocking (dht_nonblocking.h) by Ole Wolf, which is based
+ * on Adafruit Industries' DHT driver library.
+ *
+ * The pin, its input register and bit mask, the cycle limit of a pulse and
+ * the decoding of the sensor type are template parameters, so the compiler
+ * resolves them: an object only holds the state machine and the data bytes,
+ * and the code of the other sensor types is not compiled.  With EDGES the
+ * bits are decoded from the edges by the pin change interrupt (like the
+ * interrupt mode of DHT_nonblocking), otherwise by busy loops with
+ * interrupts disabled.
+ *
+ * All sensors share the interface DHT_sensor (a pointer to its virtual
+ * table in every object), so a DHTManager polls sensors on different pins
+ * and of different types by one scheduler.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _DHT_STATIC_H
+#define _DHT_STATIC_H
+
+#include "dht_nonblocking.h"   /* DHT_TYPE_*, DHT_EDGE_* and DHT_interrupt. */
+
+
+/* Results of DHT_sensor::poll( ). */
+#define DHT_POLL_BUSY   0   /* No new measurement. */
+#define DHT_POLL_VALID  1   /* A valid measurement was read. */
+#define DHT_POLL_FAILED 2   /* The read failed, the sensor cools down. */
+
+
+/*
+ * Interface of a sensor for the polling by a DHTManager.  It is never
+ * deleted through the interface (the sensors are global objects).
+ */
+class DHT_sensor
+{
+  public:
+    /*
+     * Advance the state machine of the read.  The temperature (in degrees
+     * Celsius) and the humidity (in %) are only written with DHT_POLL_VALID.
+     */
+    virtual uint8_t poll( float *temperature, float *humidity ) = 0;
+
+    /*
+     * True from the start signal till the end of the transmission, false
+     * while idle or cooling down.
+     */
+    virtual bool active( ) const = 0;
+
+    virtual const uint8_t *get_data( ) const = 0;
+    virtual bool decode( const uint8_t *raw, float *temperature, float *humidity ) = 0;
+
+  protected:
+    ~DHT_sensor( )
+    {
+    }
+};
+
+
+/* Selects the read of the bits at compile time (tag of the overloads). */
+template< bool EDGES > struct DHT_mode
+{
+};
+
+
+/* State of the edge decoder, empty without EDGES. */
+template< bool EDGES > struct DHT_edge_state
+{
+};
+
+template< > struct DHT_edge_state< true >
+{
+  DHT_edge_state( )
+    : edge_index( DHT_EDGE_COUNT ),
+      edge_failed( true ),
+      edge_time( 0 )
+  {
+  }
+
+  volatile uint8_t edge_index;    /* Next expected edge, DHT_EDGE_COUNT when done. */
+  volatile bool edge_failed;
+  uint16_t edge_time;             /* micros( ) of the last edge. */
+};
+
+
+template< uint8_t PIN, uint8_t TYPE, bool EDGES = false >
+class DHT_static : public DHT_sensor, private DHT_edge_state< EDGES >
+{
+  static_assert( TYPE == DHT_TYPE_11 || TYPE == DHT_TYPE_21 || TYPE == DHT_TYPE_22,
+                 "DHT_static: unknown sensor type" );
+
+  public:
+    DHT_static( )
+    {
+      dht_state = IDLE;
+      pinMode( PIN, INPUT );
+      digitalWrite( PIN, HIGH );
+    }
+
+
+
+    /*
+     * Instruct the DHT to begin sampling.  Keep polling until it returns
+     * true.  The temperature is in degrees Celsius, and the humidity is in %.
+     */
+    bool measure( float *temperature, float *humidity )
+    {
+      return( poll( temperature, humidity ) == DHT_POLL_VALID );
+    }
+
+
+
+    /*
+     * Advance the read like measure( ), but tell a failed read
+     * (DHT_POLL_FAILED) from a pending one (DHT_POLL_BUSY).
+     */
+    uint8_t poll( float *temperature, float *humidity )
+    {
+      uint8_t state = dht_state;
+      if( read_nonblocking( ) == true )
+      {
+        *temperature = read_temperature( );
+        *humidity    = read_humidity( );
+        return( DHT_POLL_VALID );
+      }
+      if( dht_state == COOLDOWN && state != COOLDOWN )
+      {
+        return( DHT_POLL_FAILED );
+      }
+      return( DHT_POLL_BUSY );
+    }
+
+
+
+    bool active( ) const
+    {
+      return( dht_state != IDLE && dht_state != COOLDOWN );
+    }
+
+
+
+    /*
+     * The five data bytes of the last transmission (humidity, temperature,
+     * checksum), e.g. for a trace of the raw inputs.
+     */
+    const uint8_t *get_data( ) const
+    {
+      return( data );
+    }
+
+
+
+    /*
+     * Decode five data bytes of a transmission like measure( ), e.g. of a
+     * replayed trace.  Returns false if the checksum doesn't match.
+     */
+    bool decode( const uint8_t *raw, float *temperature, float *humidity )
+    {
+      memcpy( data, raw, 5 );
+      if( checksum_valid( ) == false )
+      {
+        return( false );
+      }
+      *temperature = read_temperature( );
+      *humidity    = read_humidity( );
+      return( true );
+    }
+
+
+
+    /*
+     * Pin change handler of the data pin with EDGES.  Call it on every level
+     * change of the pin (interrupt context).
+     */
+    void pin_changed( )
+    {
+      decode_edge( ( *input_register( ) & pin_bit( ) ) != 0, micros( ) );
+    }
+
+
+
+    /*
+     * Prepare the edge decoder for a new transmission.  The edges before are
+     * ignored.
+     */
+    void begin_edges( )
+    {
+      this->edge_index = 0;
+      this->edge_failed = false;
+    }
+
+
+
+    /*
+     * Decode the next edge of a transmission, see
+     * DHT_nonblocking::decode_edge( ).  The level is the one after the edge,
+     * the time is micros( ) of the edge.
+     */
+    void decode_edge( bool level, uint16_t time )
+    {
+      if( this->edge_failed == true || this->edge_index >= DHT_EDGE_COUNT )
+      {
+        return;
+      }
+      if( this->edge_index == 0 && level == HIGH )
+      {
+        return;
+      }
+
+      uint16_t pulse = time - this->edge_time;
+      bool expected = ( this->edge_index & 1 ) != 0;
+      if( level != expected || ( this->edge_index > 0 && pulse > DHT_EDGE_TIMEOUT ) )
+      {
+        this->edge_failed = true;
+        return;
+      }
+      if( this->edge_index >= 4 && level == LOW )
+      {
+        uint8_t bit = ( this->edge_index - 4 ) / 2;
+        data[ bit / 8 ] <<= 1;
+        if( pulse > DHT_EDGE_ONE )
+        {
+          data[ bit / 8 ] |= 1;
+        }
+      }
+      this->edge_time = time;
+      this->edge_index++;
+    }
+
+
+
+    /*
+     * State of the edge decoder: DHT_EDGE_PENDING while the edges arrive,
+     * DHT_EDGE_DONE after all 40 bits, DHT_EDGE_FAILED after a timing error.
+     */
+    uint8_t edge_status( ) const
+    {
+      if( this->edge_failed == true )
+      {
+        return( DHT_EDGE_FAILED );
+      }
+      return( this->edge_index >= DHT_EDGE_COUNT ? DHT_EDGE_DONE : DHT_EDGE_PENDING );
+    }
+
+
+  private:
+    enum
+    {
+      IDLE,
+      BEGIN_MEASUREMENT,
+      BEGIN_MEASUREMENT_2,
+      DO_READING,
+      RECEIVING,
+      COOLDOWN
+    };
+
+    /* Number of milliseconds of the start signal (DHT11: at least 18 ms). */
+    static const uint8_t START_TIME = 20;
+    /* Number of milliseconds to wait for the edges of a transmission (~5 ms). */
+    static const uint8_t RECEIVE_TIME = 10;
+    /* Number of milliseconds before a new sensor read may be initiated. */
+    static const uint16_t COOLDOWN_TIME = 2000;
+    /* Number of loop cycles, after which a pulse times out (1 ms). */
+    static const uint16_t MAX_CYCLES = microsecondsToClockCycles( 1000 );
+
+    uint8_t dht_state;
+    unsigned long dht_timestamp;
+    uint8_t data[ 5 ];
+
+
+
+#if defined( __AVR_ATmega328P__ )
+    /* Uno: pins 0-7 are on port D, 8-13 on port B, 14-19 (A0-A5) on port C. */
+    static volatile uint8_t *input_register( )
+    {
+      return( PIN < 8 ? &PIND : ( PIN < 14 ? &PINB : &PINC ) );
+    }
+
+    static uint8_t pin_bit( )
+    {
+      return( 1 << ( PIN < 8 ? PIN : ( PIN < 14 ? PIN - 8 : PIN - 14 ) ) );
+    }
+#else
+    static volatile uint8_t *input_register( )
+    {
+      return( portInputRegister( digitalPinToPort( PIN ) ) );
+    }
+
+    static uint8_t pin_bit( )
+    {
+      return( digitalPinToBitMask( PIN ) );
+    }
+#endif
+
+
+
+    /*
+     * State machine of the non-blocking read, see
+     * DHT_nonblocking::read_nonblocking( ).
+     */
+    bool read_nonblocking( )
+    {
+      bool status = false;
+
+      switch( dht_state )
+      {
+      case IDLE:
+        dht_state = BEGIN_MEASUREMENT;
+        break;
+
+      case BEGIN_MEASUREMENT:
+        digitalWrite( PIN, HIGH );
+        data[ 0 ] = data[ 1 ] = data[ 2 ] = data[ 3 ] = data[ 4 ] = 0;
+        dht_timestamp = millis( );
+        dht_state = BEGIN_MEASUREMENT_2;
+        break;
+
+      case BEGIN_MEASUREMENT_2:
+        if( millis( ) - dht_timestamp > 250 )
+        {
+          pinMode( PIN, OUTPUT );
+          digitalWrite( PIN, LOW );
+          dht_timestamp = millis( );
+          dht_state = DO_READING;
+        }
+        break;
+
+      case DO_READING:
+        if( millis( ) - dht_timestamp > START_TIME )
+        {
+          dht_timestamp = millis( );
+          status = start_reading( DHT_mode< EDGES >( ) );
+        }
+        break;
+
+      case RECEIVING:
+        status = receive( DHT_mode< EDGES >( ) );
+        break;
+
+      case COOLDOWN:
+        if( millis( ) - dht_timestamp > COOLDOWN_TIME )
+        {
+          dht_state = IDLE;
+        }
+        break;
+
+      default:
+        break;
+      }
+
+      return( status );
+    }
+
+
+
+    /* End the start signal and read the bits by busy loops. */
+    bool start_reading( DHT_mode< false > )
+    {
+      dht_state = COOLDOWN;
+      return( read_data( ) );
+    }
+
+
+
+    /* End the start signal and leave the bits to the edge decoder. */
+    bool start_reading( DHT_mode< true > )
+    {
+      begin_edges( );
+      digitalWrite( PIN, HIGH );
+      pinMode( PIN, INPUT );
+      dht_state = RECEIVING;
+      return( false );
+    }
+
+
+
+    bool receive( DHT_mode< false > )
+    {
+      return( false );
+    }
+
+
+
+    /* Wait for the edges of the transmission. */
+    bool receive( DHT_mode< true > )
+    {
+      if( edge_status( ) == DHT_EDGE_PENDING && millis( ) - dht_timestamp <= RECEIVE_TIME )
+      {
+        return( false );
+      }
+      bool status = edge_status( ) == DHT_EDGE_DONE && checksum_valid( );
+      this->edge_failed = true;
+      dht_timestamp = millis( );
+      dht_state = COOLDOWN;
+      return( status );
+    }
+
+
+
+    /*
+     * Read the bits by busy loops with interrupts disabled and decode every
+     * bit as soon as its high pulse ended, see DHT_nonblocking::read_data( ).
+     */
+    bool read_data( )
+    {
+      {
+        volatile DHT_interrupt interrupt;
+
+        digitalWrite( PIN, HIGH );
+        delayMicroseconds( 40 );
+        pinMode( PIN, INPUT );
+        delayMicroseconds( 10 );
+
+        if( expect_pulse( LOW ) == 0 )
+        {
+          return( false );
+        }
+        if( expect_pulse( HIGH ) == 0 )
+        {
+          return( false );
+        }
+
+        for( uint8_t i = 0; i < 40; ++i )
+        {
+          uint16_t low_cycles  = expect_pulse( LOW );
+          uint16_t high_cycles = expect_pulse( HIGH );
+          if( ( low_cycles == 0 ) || ( high_cycles == 0 ) )
+          {
+            return( false );
+          }
+          data[ i / 8 ] <<= 1;
+          if( high_cycles > low_cycles )
+          {
+            data[ i / 8 ] |= 1;
+          }
+        }
+      }
+
+      return( checksum_valid( ) );
+    }
+
+
+
+    /*
+     * Expect the input to be at the specified level and return the number
+     * of loop cycles spent there, 0 after MAX_CYCLES.
+     */
+    static uint16_t expect_pulse( bool level )
+    {
+      uint16_t count = 0;
+    #ifdef __AVR
+      uint8_t port_state = level ? pin_bit( ) : 0;
+      while( ( *input_register( ) & pin_bit( ) ) == port_state )
+      {
+        if( count++ >= MAX_CYCLES )
+        {
+          return( 0 );
+        }
+      }
+    #else
+      while( digitalRead( PIN ) == level )
+      {
+        if( count++ >= MAX_CYCLES )
+        {
+          return( 0 );
+        }
+      }
+    #endif
+      return( count );
+    }
+
+
+
+    /*
+     * Check the checksum of the data bytes (sum of the first four bytes).
+     */
+    bool checksum_valid( ) const
+    {
+      return( data[ 4 ] == ( ( data[ 0 ] + data[ 1 ] + data[ 2 ] + data[ 3 ] ) & 0xFF ) );
+    }
+
+
+
+    /* Temperature in degrees Celsius: DHT11 whole degrees, DHT21/22 0.1
+       degrees with the sign in the highest bit. */
+    float read_temperature( ) const
+    {
+      if( TYPE == DHT_TYPE_11 )
+      {
+        return( (float) data[ 2 ] );
+      }
+      int16_t value = ( ( data[ 2 ] & 0x7f ) << 8 ) | data[ 3 ];
+      if( ( data[ 2 ] & 0x80 ) != 0 )
+      {
+        value = -value;
+      }
+      return( ( (float) value ) / 10.0 );
+    }
+
+
+
+    /* Relative humidity in %: DHT11 whole percent, DHT21/22 0.1 percent. */
+    float read_humidity( ) const
+    {
+      if( TYPE == DHT_TYPE_11 )
+      {
+        return( (float) data[ 0 ] );
+      }
+      uint16_t value = ( data[ 0 ] << 8 ) | data[ 1 ];
+      return( (float) value / 10.0 );
+    }
+};
+
+
+#endif /* _DHT_STATIC_H */
@@ -0,0 +1,698 @@
+/*
+  Devices.cpp - Models of the devices of the camper van for the host simulator.
+  The I2C devices behave on register level like the datasheets (reset values,
+  auto increment, alarm flags), the DHT answers the start signal with the
+  bit waveform of its data line.
+
+  Licensed under "MIT" License.
+*/
+#include "Devices.h"
+
+#include <math.h>
+#include <time.h>
+
+#include "Arduino.h"
+#include "dht_nonblocking.h"
+
+// MPU6050 registers
+#define MPU_REG_SMPLRT_DIV 0x19
+#define MPU_REG_CONFIG 0x1A
+#define MPU_REG_GYRO_CONFIG 0x1B
+#define MPU_REG_ACCEL_CONFIG 0x1C
+#define MPU_REG_FIFO_EN 0x23
+#define MPU_REG_INT_PIN_CFG 0x37
+#define MPU_REG_INT_ENABLE 0x38
+#define MPU_REG_INT_STATUS 0x3A
+#define MPU_REG_ACCEL_XOUT_H 0x3B
+#define MPU_REG_TEMP_OUT_H 0x41
+#define MPU_REG_GYRO_XOUT_H 0x43
+#define MPU_REG_GYRO_ZOUT_L 0x48
+#define MPU_REG_USER_CTRL 0x6A
+#define MPU_GYRO_OFFSET_X 1.2   // Zero rate offset of the gyroscope around x in deg/s (the MPU6050 allows +-20)
+#define MPU_GYRO_OFFSET_Y -0.7  // Zero rate offset of the gyroscope around y in deg/s
+#define MPU_REG_PWR_MGMT_1 0x6B
+#define MPU_REG_FIFO_COUNTH 0x72
+#define MPU_REG_FIFO_COUNTL 0x73
+#define MPU_REG_FIFO_R_W 0x74
+#define MPU_REG_WHO_AM_I 0x75
+#define MPU_FIFO_SIZE 1024
+
+// DS3231 registers
+#define RTC_REG_ALARM_1 0x07
+#define RTC_REG_ALARM_2 0x0B
+#define RTC_REG_CONTROL 0x0E
+#define RTC_REG_STATUS 0x0F
+#define RTC_REG_TEMPERATURE 0x11
+
+static uint8_t dec2bcd(uint8_t dec) {
+    return ((dec / 10) << 4) | (dec % 10);
+}
+
+static uint8_t bcd2dec(uint8_t bcd) {
+    return (bcd >> 4) * 10 + (bcd & 0x0F);
+}
+
+// ------------------------------- MPU6050 -------------------------------
+
+/*
+ * Constructor of the MPU6050 model.
+ * @param environment Source of the tilt
+ * @param offsetX Mounting angle around x in deg (seen as offset by the sketch)
+ * @param offsetY Mounting angle around y in deg
+ * @param offsetAcZ Factory offset of the z acceleration in LSB (removed by the sketch)
+ * @param intPin Arduino pin of the INT output (0xFF: not connected)
+ */
+MPU6050Model::MPU6050Model(Environment &environment, float offsetX, float offsetY, int16_t offsetAcZ, uint8_t intPin)
+    : environment(environment), offsetX(offsetX), offsetY(offsetY), offsetAcZ(offsetAcZ), intPin(intPin) {
+    lastPhiX = 0;
+    lastPhiY = 0;
+    lastSample = 0;
+    generation = 0;
+    nextSample = 0;
+    fifoSampleCount = 0;
+    fifoOverflowCount = 0;
+    reset();
+}
+
+/*
+ * Write transaction: register pointer and optional register values.
+ * Setting only the pointer to the data registers starts a read, which samples the sensors.
+ */
+void MPU6050Model::receive(const uint8_t *data, uint8_t length) {
+    if (length == 0) {
+        return;
+    }
+    pointer = data[0] & 0x7F;
+    for (uint8_t i = 1; i < length; i++) {
+        writeRegister(pointer, data[i]);
+        pointer = (pointer + 1) & 0x7F;
+    }
+    if (length == 1 && pointer >= MPU_REG_ACCEL_XOUT_H && pointer <= MPU_REG_GYRO_ZOUT_L) {
+        sample();
+    }
+}
+
+/*
+ * Read transaction: next register (auto increment, except for the FIFO data register).
+ */
+uint8_t MPU6050Model::transmit(void) {
+    uint8_t value = readRegister(pointer);
+    if (pointer != MPU_REG_FIFO_R_W) {
+        pointer = (pointer + 1) & 0x7F;
+    }
+    return value;
+}
+
+/*
+ * Get a register value (for the report).
+ */
+uint8_t MPU6050Model::getRegister(uint8_t reg) {
+    return registers[reg & 0x7F];
+}
+
+/*
+ * Get the number of samples written into the FIFO.
+ */
+unsigned long MPU6050Model::getFifoSampleCount(void) {
+    return fifoSampleCount;
+}
+
+/*
+ * Get the number of FIFO overflows (set FIFO_OFLOW_INT flags).
+ */
+unsigned long MPU6050Model::getFifoOverflowCount(void) {
+    return fifoOverflowCount;
+}
+
+/*
+ * Reset values of the registers (power on or DEVICE_RESET). The device starts in sleep mode.
+ */
+void MPU6050Model::reset(void) {
+    memset(registers, 0, sizeof(registers));
+    registers[MPU_REG_PWR_MGMT_1] = 0x40;
+    registers[MPU_REG_WHO_AM_I] = 0x68;
+    pointer = 0;
+    fifo.clear();
+    scheduleSample(true);
+    updateInterrupt();
+}
+
+// PRIVATE
+
+void MPU6050Model::writeRegister(uint8_t reg, uint8_t value) {
+    if (reg == MPU_REG_WHO_AM_I) {
+        return;
+    }
+    if (reg == MPU_REG_PWR_MGMT_1 && (value & 0x80)) {
+        reset();  // DEVICE_RESET bit clears itself
+        return;
+    }
+    if (reg == MPU_REG_INT_STATUS || reg == MPU_REG_FIFO_COUNTH || reg == MPU_REG_FIFO_COUNTL || reg == MPU_REG_FIFO_R_W) {
+        return;  // read only (writes to the FIFO are not modeled)
+    }
+    if (reg == MPU_REG_USER_CTRL && (value & 0x04)) {
+        fifo.clear();  // FIFO_RESET bit clears itself
+        value &= ~0x04;
+    }
+    registers[reg] = value;
+    switch (reg) {
+        case MPU_REG_SMPLRT_DIV:
+        case MPU_REG_CONFIG:
+        case MPU_REG_FIFO_EN:
+        case MPU_REG_USER_CTRL:
+        case MPU_REG_PWR_MGMT_1:
+            scheduleSample(true);
+            break;
+        case MPU_REG_INT_PIN_CFG:
+        case MPU_REG_INT_ENABLE:
+            updateInterrupt();
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Register value of a read. FIFO_COUNT is latched at the read of the high byte,
+ * a read of INT_STATUS clears the interrupt flags.
+ */
+uint8_t MPU6050Model::readRegister(uint8_t reg) {
+    uint8_t value;
+    switch (reg) {
+        case MPU_REG_FIFO_R_W:
+            if (fifo.empty()) {
+                return 0;
+            }
+            value = fifo.front();
+            fifo.pop_front();
+            return value;
+        case MPU_REG_FIFO_COUNTH:
+            registers[MPU_REG_FIFO_COUNTH] = fifo.size() >> 8;
+            registers[MPU_REG_FIFO_COUNTL] = fifo.size() & 0xFF;
+            return registers[reg];
+        case MPU_REG_INT_STATUS:
+            value = registers[reg];
+            registers[reg] = 0;
+            updateInterrupt();
+            return value;
+        default:
+            return registers[reg];
+    }
+}
+
+/*
+ * Sample acceleration, temperature and angular rate into the data registers.
+ * In sleep mode the registers keep their last values.
+ */
+void MPU6050Model::sample(void) {
+    if (registers[MPU_REG_PWR_MGMT_1] & 0x40) {
+        return;
+    }
+    float phiX, phiY;
+    environment.getTilt(phiX, phiY);
+    phiX += offsetX;
+    phiY += offsetY;
+
+    // phiY = asin(ax / |a|), phiX = asin(ay / |a|)
+    float ax = sin(phiY * DEG_TO_RAD);
+    float ay = sin(phiX * DEG_TO_RAD);
+    float az = sqrt(max(0.0f, 1.0f - ax * ax - ay * ay));
+    int32_t accelScale = 16384 >> ((registers[MPU_REG_ACCEL_CONFIG] >> 3) & 0x03);
+    setWord(MPU_REG_ACCEL_XOUT_H, ax * accelScale + environment.getNoise(40));
+    setWord(MPU_REG_ACCEL_XOUT_H + 2, ay * accelScale + environment.getNoise(40));
+    setWord(MPU_REG_ACCEL_XOUT_H + 4, az * accelScale - offsetAcZ + environment.getNoise(40));
+
+    setWord(MPU_REG_TEMP_OUT_H, (environment.getTemperature() - 36.53) * 340);
+
+    uint64_t now = Simulation::now();
+    float dt = lastSample == 0 ? 0 : (now - lastSample) / 1e6;
+    float gyroScale = 131.0 / (1 << ((registers[MPU_REG_GYRO_CONFIG] >> 3) & 0x03));
+    float rateX = dt > 0 ? (phiX - lastPhiX) / dt : 0;
+    float rateY = dt > 0 ? (phiY - lastPhiY) / dt : 0;
+    // A rotation around y lowers ax, so phiY turns against the rate around y
+    setWord(MPU_REG_GYRO_XOUT_H, (rateX + MPU_GYRO_OFFSET_X) * gyroScale + environment.getNoise(20));
+    setWord(MPU_REG_GYRO_XOUT_H + 2, (-rateY + MPU_GYRO_OFFSET_Y) * gyroScale + environment.getNoise(20));
+    setWord(MPU_REG_GYRO_XOUT_H + 4, environment.getNoise(20));
+    lastPhiX = phiX;
+    lastPhiY = phiY;
+    lastSample = now;
+}
+
+/*
+ * Schedule the next sample into the FIFO. The sample rate is the gyroscope output rate
+ * (8 kHz without DLPF, else 1 kHz) divided by 1 + SMPLRT_DIV.
+ * @param restart true after a configuration change: cancels the scheduled sample and starts a new period
+ */
+void MPU6050Model::scheduleSample(bool restart) {
+    if (restart) {
+        generation++;
+        nextSample = Simulation::now();
+    }
+    if (!(registers[MPU_REG_USER_CTRL] & 0x40) || registers[MPU_REG_FIFO_EN] == 0 || (registers[MPU_REG_PWR_MGMT_1] & 0x40)) {
+        return;
+    }
+    uint8_t dlpf = registers[MPU_REG_CONFIG] & 0x07;
+    uint32_t gyroRate = (dlpf == 0 || dlpf == 7) ? 8000 : 1000;
+    nextSample += 1000000ULL * (1 + registers[MPU_REG_SMPLRT_DIV]) / gyroRate;
+    uint32_t sampleGeneration = generation;
+    Simulation::schedule(nextSample, [this, sampleGeneration]() {
+        if (sampleGeneration == generation) {
+            fifoSample();
+            scheduleSample(false);
+        }
+    });
+}
+
+/*
+ * Sample into the data registers and copy the enabled ones to the FIFO (in register order).
+ * A full FIFO drops its oldest bytes and sets FIFO_OFLOW_INT.
+ */
+void MPU6050Model::fifoSample(void) {
+    sample();
+    uint8_t enable = registers[MPU_REG_FIFO_EN];
+    const uint8_t enableBits[7] = {0x08, 0x08, 0x08, 0x80, 0x40, 0x20, 0x10};  // AcX, AcY, AcZ, Temp, GyX, GyY, GyZ
+    for (uint8_t i = 0; i < 7; i++) {
+        if (enable & enableBits[i]) {
+            fifo.push_back(registers[MPU_REG_ACCEL_XOUT_H + 2 * i]);
+            fifo.push_back(registers[MPU_REG_ACCEL_XOUT_H + 2 * i + 1]);
+        }
+    }
+    fifoSampleCount++;
+    registers[MPU_REG_INT_STATUS] |= 0x01;  // DATA_RDY_INT
+    if (fifo.size() > MPU_FIFO_SIZE) {
+        fifo.erase(fifo.begin(), fifo.begin() + (fifo.size() - MPU_FIFO_SIZE));
+        if (!(registers[MPU_REG_INT_STATUS] & 0x10)) {
+            fifoOverflowCount++;
+        }
+        registers[MPU_REG_INT_STATUS] |= 0x10;  // FIFO_OFLOW_INT
+    }
+    updateInterrupt();
+}
+
+/*
+ * INT is active, while an enabled interrupt flag is set (latched mode). INT_LEVEL selects
+ * active low, INT_OPEN an open drain output.
+ */
+void MPU6050Model::updateInterrupt(void) {
+    if (intPin == 0xFF) {
+        return;
+    }
+    uint8_t config = registers[MPU_REG_INT_PIN_CFG];
+    bool active = (registers[MPU_REG_INT_STATUS] & registers[MPU_REG_INT_ENABLE] & 0x19) != 0;
+    uint8_t level = active != ((config & 0x80) != 0) ? HIGH : LOW;
+    Simulation::setInput(intPin, (config & 0x40) && level == HIGH ? -1 : level);
+}
+
+/*
+ * Store a saturated 16 bit value in big endian order.
+ */
+void MPU6050Model::setWord(uint8_t reg, int32_t value) {
+    value = constrain(value, -32768, 32767);
+    registers[reg] = (uint16_t)value >> 8;
+    registers[reg + 1] = value & 0xFF;
+}
+
+// ------------------------------- DS3231 --------------------------------
+
+/*
+ * Constructor of the DS3231 model.
+ * @param environment Source of the temperature
+ * @param unixtime Time of the RTC at power on
+ * @param ppm Rate error of the RTC against the Arduino clock in ppm
+ * @param intPin Arduino pin of the INT/SQW output (0xFF: not connected)
+ */
+DS3231Model::DS3231Model(Environment &environment, uint32_t unixtime, int32_t ppm, uint8_t intPin)
+    : environment(environment), ppm(ppm), intPin(intPin) {
+    memset(registers, 0, sizeof(registers));
+    registers[RTC_REG_CONTROL] = 0x1C;  // INTCN, RS2, RS1
+    registers[RTC_REG_STATUS] = 0x08;   // EN32kHz
+    pointer = 0;
+    baseRtcUs = (uint64_t)unixtime * 1000000;
+    baseSimUs = Simulation::now();
+    generation = 0;
+    alarmCount = 0;
+    acknowledgeCount = 0;
+    latchTime();
+    scheduleTick();
+}
+
+/*
+ * Write transaction: register pointer and optional register values.
+ * Writing the time registers restarts the second.
+ */
+void DS3231Model::receive(const uint8_t *data, uint8_t length) {
+    if (length == 0) {
+        return;
+    }
+    pointer = data[0] % sizeof(registers);
+    latchTime();
+    bool timeWritten = false;
+    for (uint8_t i = 1; i < length; i++) {
+        uint8_t value = data[i];
+        if (pointer == RTC_REG_STATUS) {
+            uint8_t status = registers[RTC_REG_STATUS];
+            if ((status & 0x01) && !(value & 0x01)) {
+                acknowledgeCount++;
+            }
+            // A1F, A2F and OSF can only be cleared
+            registers[RTC_REG_STATUS] = (status & value & 0x83) | (value & 0x08);
+        } else if (pointer < RTC_REG_TEMPERATURE) {
+            registers[pointer] = value;
+            timeWritten |= pointer < RTC_REG_ALARM_1;
+        }
+        pointer = (pointer + 1) % sizeof(registers);
+    }
+    if (timeWritten) {
+        setTimeFromRegisters();
+    }
+    updateInterrupt();
+}
+
+uint8_t DS3231Model::transmit(void) {
+    uint8_t value = registers[pointer];
+    pointer = (pointer + 1) % sizeof(registers);
+    return value;
+}
+
+/*
+ * Get the current time of the RTC.
+ */
+uint32_t DS3231Model::getUnixtime(void) {
+    return rtcNow() / 1000000;
+}
+
+/*
+ * Get the number of alarm 1 matches.
+ */
+unsigned long DS3231Model::getAlarmCount(void) {
+    return alarmCount;
+}
+
+/*
+ * Get the number of alarm 1 flags cleared by the sketch.
+ */
+unsigned long DS3231Model::getAcknowledgeCount(void) {
+    return acknowledgeCount;
+}
+
+// PRIVATE
+
+/*
+ * RTC time, which runs with the rate error against the virtual time.
+ * @return Time in us since 1970
+ */
+uint64_t DS3231Model::rtcNow(void) {
+    int64_t elapsed = Simulation::now() - baseSimUs;
+    return baseRtcUs + elapsed + elapsed * ppm / 1000000;
+}
+
+/*
+ * Copy the current time into the time registers (done by the DS3231 on every access).
+ */
+void DS3231Model::latchTime(void) {
+    time_t seconds = rtcNow() / 1000000;
+    struct tm t;
+    gmtime_r(&seconds, &t);
+    registers[0] = dec2bcd(t.tm_sec);
+    registers[1] = dec2bcd(t.tm_min);
+    registers[2] = dec2bcd(t.tm_hour);
+    registers[3] = t.tm_wday == 0 ? 7 : t.tm_wday;
+    registers[4] = dec2bcd(t.tm_mday);
+    registers[5] = dec2bcd(t.tm_mon + 1) | (t.tm_year >= 200 ? 0x80 : 0);
+    registers[6] = dec2bcd(t.tm_year % 100);
+
+    float temperature = environment.getTemperature();
+    int16_t quarters = (int16_t)(temperature * 4);
+    registers[RTC_REG_TEMPERATURE] = (uint8_t)(quarters >> 2);
+    registers[RTC_REG_TEMPERATURE + 1] = (quarters & 0x03) << 6;
+}
+
+/*
+ * Take over the time written into the time registers.
+ */
+void DS3231Model::setTimeFromRegisters(void) {
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    t.tm_sec = bcd2dec(registers[0] & 0x7F);
+    t.tm_min = bcd2dec(registers[1] & 0x7F);
+    t.tm_hour = bcd2dec(registers[2] & 0x3F);
+    t.tm_mday = bcd2dec(registers[4] & 0x3F);
+    t.tm_mon = bcd2dec(registers[5] & 0x1F) - 1;
+    t.tm_year = bcd2dec(registers[6]) + 100 + ((registers[5] & 0x80) ? 100 : 0);
+    baseRtcUs = (uint64_t)timegm(&t) * 1000000;
+    baseSimUs = Simulation::now();
+    generation++;
+    scheduleTick();
+}
+
+/*
+ * Schedule the check of the alarms at the next full RTC second.
+ */
+void DS3231Model::scheduleTick(void) {
+    uint64_t next = (rtcNow() / 1000000 + 1) * 1000000;
+    uint64_t rtcElapsed = next - baseRtcUs;
+    uint64_t simElapsed = (rtcElapsed * 1000000 + 1000000 + ppm - 1) / (1000000 + ppm);
+    uint32_t tickGeneration = generation;
+    Simulation::schedule(baseSimUs + simElapsed, [this, tickGeneration]() {
+        if (tickGeneration == generation) {
+            tick();
+        }
+    });
+}
+
+/*
+ * Full second: compare the alarm registers with the time (mask bits A1Mx/A2Mx, DY/DT).
+ */
+void DS3231Model::tick(void) {
+    latchTime();
+    const uint8_t *a1 = &registers[RTC_REG_ALARM_1];
+    bool match1 = ((a1[0] & 0x80) || (a1[0] & 0x7F) == registers[0]) &&
+                  ((a1[1] & 0x80) || (a1[1] & 0x7F) == registers[1]) &&
+                  ((a1[2] & 0x80) || (a1[2] & 0x3F) == registers[2]) &&
+                  ((a1[3] & 0x80) || ((a1[3] & 0x40) ? (a1[3] & 0x0F) == registers[3] : (a1[3] & 0x3F) == registers[4]));
+    const uint8_t *a2 = &registers[RTC_REG_ALARM_2];
+    bool match2 = registers[0] == 0 &&
+                  ((a2[0] & 0x80) || (a2[0] & 0x7F) == registers[1]) &&
+                  ((a2[1] & 0x80) || (a2[1] & 0x3F) == registers[2]) &&
+                  ((a2[2] & 0x80) || ((a2[2] & 0x40) ? (a2[2] & 0x0F) == registers[3] : (a2[2] & 0x3F) == registers[4]));
+    if (match1) {
+        registers[RTC_REG_STATUS] |= 0x01;
+        alarmCount++;
+    }
+    if (match2) {
+        registers[RTC_REG_STATUS] |= 0x02;
+    }
+    updateInterrupt();
+    scheduleTick();
+}
+
+/*
+ * INT/SQW is pulled low, if the interrupt output is selected (INTCN) and an enabled alarm flag is set.
+ */
+void DS3231Model::updateInterrupt(void) {
+    if (intPin == 0xFF) {
+        return;
+    }
+    uint8_t control = registers[RTC_REG_CONTROL];
+    uint8_t flags = registers[RTC_REG_STATUS] & control & 0x03;
+    bool active = (control & 0x04) && flags != 0;
+    Simulation::setInput(intPin, active ? LOW : -1);
+}
+
+// ---------------------------- Climate offset ----------------------------
+
+/*
+ * Constructor of the climate at another place.
+ * @param environment Source of the inside climate and the other quantities
+ * @param temperatureOffset Difference to the inside temperature in K
+ * @param humidityOffset Difference to the inside humidity in %
+ */
+ClimateOffset::ClimateOffset(Environment &environment, float temperatureOffset, float humidityOffset)
+    : environment(environment), temperatureOffset(temperatureOffset), humidityOffset(humidityOffset) {}
+
+void ClimateOffset::getTilt(float &phiX, float &phiY) {
+    environment.getTilt(phiX, phiY);
+}
+
+float ClimateOffset::getTemperature(void) {
+    return environment.getTemperature() + temperatureOffset;
+}
+
+float ClimateOffset::getHumidity(void) {
+    return constrain(environment.getHumidity() + humidityOffset, 0.0f, 100.0f);
+}
+
+int16_t ClimateOffset::getNoise(int16_t amplitude) {
+    return environment.getNoise(amplitude);
+}
+
+// --------------------------------- DHT ---------------------------------
+
+/*
+ * Constructor of the DHT model.
+ * @param environment Source of temperature and humidity
+ * @param pin Arduino pin of the data line
+ * @param type DHT_TYPE_11, DHT_TYPE_21 or DHT_TYPE_22
+ */
+DHTModel::DHTModel(Environment &environment, uint8_t pin, uint8_t type)
+    : environment(environment), pin(pin), type(type) {
+    startSignal = false;
+    startSignalTime = 0;
+    busyUntil = 0;
+    transmissionCount = 0;
+}
+
+/*
+ * Connect to the data line. The module has a pull-up resistor.
+ */
+void DHTModel::begin(void) {
+    Simulation::setPinDevice(pin, this);
+    Simulation::setInput(pin, HIGH);
+}
+
+/*
+ * Watch the start signal of the Arduino: the line is pulled low and released again.
+ */
+void DHTModel::pinChanged(uint8_t changedPin) {
+    uint64_t now = Simulation::now();
+    bool low = Simulation::getMode(pin) == OUTPUT && Simulation::getOutput(pin) == LOW;
+    if (low) {
+        if (!startSignal) {
+            startSignal = true;
+            startSignalTime = now;
+        }
+        return;
+    }
+    if (!startSignal) {
+        return;
+    }
+    startSignal = false;
+    uint64_t minimum = type == DHT_TYPE_11 ? 18000 : 1000;
+    if (now - startSignalTime >= minimum && now >= busyUntil) {
+        transmit(now + 30);
+    }
+}
+
+/*
+ * Get the number of started transmissions.
+ */
+unsigned long DHTModel::getTransmissionCount(void) {
+    return transmissionCount;
+}
+
+// PRIVATE
+
+/*
+ * Schedule the waveform: 80 us low, 80 us high, 40 bits (50 us low, 26 us high for 0 / 70 us high for 1), 50 us low.
+ * @param time Start of the response in us
+ */
+void DHTModel::transmit(uint64_t time) {
+    float temperature = environment.getTemperature();
+    float humidity = environment.getHumidity();
+    uint8_t data[5];
+    if (type == DHT_TYPE_11) {
+        data[0] = constrain((int)(humidity + 0.5), 20, 90);
+        data[1] = 0;
+        data[2] = constrain((int)(temperature + 0.5), 0, 50);
+        data[3] = 0;
+    } else {
+        uint16_t h = constrain((int)(humidity * 10 + 0.5), 0, 1000);
+        int16_t t = (int16_t)round(temperature * 10);
+        uint16_t tRaw = t < 0 ? (0x8000 | -t) : t;
+        data[0] = h >> 8;
+        data[1] = h & 0xFF;
+        data[2] = tRaw >> 8;
+        data[3] = tRaw & 0xFF;
+    }
+    data[4] = data[0] + data[1] + data[2] + data[3];
+    transmissionCount++;
+
+    time = scheduleLevel(time, LOW) + 80;
+    time = scheduleLevel(time, HIGH) + 80;
+    for (uint8_t i = 0; i < 40; i++) {
+        bool one = data[i / 8] & (0x80 >> (i % 8));
+        time = scheduleLevel(time, LOW) + 50;
+        time = scheduleLevel(time, HIGH) + (one ? 70 : 26);
+    }
+    time = scheduleLevel(time, LOW) + 50;
+    busyUntil = scheduleLevel(time, HIGH);
+}
+
+/*
+ * Schedule a level of the data line.
+ * @return Time of the level change
+ */
+uint64_t DHTModel::scheduleLevel(uint64_t time, int8_t level) {
+    uint8_t dataPin = pin;
+    Simulation::schedule(time, [dataPin, level]() {
+        Simulation::setInput(dataPin, level);
+    });
+    return time;
+}
+
+// ---------------------------- I2C bus fault ----------------------------
+
+/*
+ * Constructor of the bus fault.
+ * @param sdaPin Arduino pin of SDA
+ * @param sclPin Arduino pin of SCL
+ */
+I2CBusFault::I2CBusFault(uint8_t sdaPin, uint8_t sclPin) : sdaPin(sdaPin), sclPin(sclPin) {
+    clocksLeft = 0;
+    lastScl = HIGH;
+    holdCount = 0;
+}
+
+/*
+ * Watch the SCL line (clocked by the bus recovery of the sketch).
+ */
+void I2CBusFault::begin(void) {
+    Simulation::setPinDevice(sclPin, this);
+}
+
+/*
+ * Hold SDA low until the master clocked SCL.
+ * @param clocks Number of SCL clocks until the slave releases SDA
+ */
+void I2CBusFault::hold(uint8_t clocks) {
+    if (clocks == 0) {
+        return;
+    }
+    clocksLeft = clocks;
+    lastScl = HIGH;  // the bus is idle high, the TWI module drives it
+    holdCount++;
+    Simulation::setI2CHeld(true);
+    Simulation::setInput(sdaPin, LOW);
+}
+
+/*
+ * Count the rising edges of SCL and release SDA after the last clock.
+ */
+void I2CBusFault::pinChanged(uint8_t pin) {
+    uint8_t level = Simulation::digitalRead(sclPin);
+    bool rising = level && !lastScl;
+    lastScl = level;
+    if (clocksLeft == 0 || !rising) {
+        return;
+    }
+    if (--clocksLeft == 0) {
+        Simulation::setInput(sdaPin, -1);
+        Simulation::setI2CHeld(false);
+    }
+}
+
+/*
+ * Get the number of holds of SDA.
+ */
+unsigned long I2CBusFault::getHoldCount(void) {
+    return holdCount;
+}
+
+// -------------------------------- SH1106 -------------------------------
+
+void SH1106Model::receive(const uint8_t *data, uint8_t length) {
+}
+
+uint8_t SH1106Model::transmit(void) {
+    return 0;
+}
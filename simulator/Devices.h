@@ -0,0 +1,171 @@
+/*
+  Devices.h - Models of the devices of the camper van for the host simulator.
+  The I2C devices behave on register level like the datasheets (reset values,
+  auto increment, alarm flags), the DHT answers the start signal with the
+  bit waveform of its data line.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef DEVICES_H
+#define DEVICES_H
+
+#include <deque>
+
+#include "Simulation.h"
+
+/*
+ * Physical quantities seen by the sensors. Implemented by the scenario.
+ */
+class Environment {
+   public:
+    virtual ~Environment() {}
+    virtual void getTilt(float &phiX, float &phiY) = 0;  // Tilt of the van in deg
+    virtual float getTemperature(void) = 0;              // Inside temperature in degC
+    virtual float getHumidity(void) = 0;                 // Inside humidity in %
+    virtual int16_t getNoise(int16_t amplitude) = 0;     // Noise in [-amplitude, amplitude]
+};
+
+/*
+ * Climate at another place than inside (outside, fridge): the inside climate of an environment
+ * shifted by fixed offsets. The other quantities are the ones of the environment.
+ */
+class ClimateOffset : public Environment {
+   public:
+    ClimateOffset(Environment &environment, float temperatureOffset, float humidityOffset);
+    void getTilt(float &phiX, float &phiY);
+    float getTemperature(void);
+    float getHumidity(void);
+    int16_t getNoise(int16_t amplitude);
+
+   private:
+    Environment &environment;
+    float temperatureOffset;  // Difference to the inside temperature in K
+    float humidityOffset;     // Difference to the inside humidity in %
+};
+
+/*
+ * MPU6050 accelerometer and gyroscope. Samples the tilt when the register pointer is set to
+ * the data registers. With the FIFO enabled it samples at the sample rate into the FIFO and
+ * drives the INT pin by the enabled interrupts (latched until INT_STATUS is read).
+ */
+class MPU6050Model : public I2CDevice {
+   public:
+    MPU6050Model(Environment &environment, float offsetX, float offsetY, int16_t offsetAcZ, uint8_t intPin);
+    void receive(const uint8_t *data, uint8_t length);
+    uint8_t transmit(void);
+    uint8_t getRegister(uint8_t reg);
+    unsigned long getFifoSampleCount(void);
+    unsigned long getFifoOverflowCount(void);
+    void reset(void);
+
+   private:
+    Environment &environment;
+    float offsetX;      // Mounting angle around x in deg
+    float offsetY;      // Mounting angle around y in deg
+    int16_t offsetAcZ;  // Factory offset of the z acceleration in LSB
+    uint8_t registers[128];
+    uint8_t pointer;
+    float lastPhiX;
+    float lastPhiY;
+    uint64_t lastSample;
+    uint8_t intPin;                   // Arduino pin of the INT output (0xFF: not connected)
+    std::deque<uint8_t> fifo;
+    uint32_t generation;              // Invalidates the scheduled samples after a configuration change
+    uint64_t nextSample;              // Virtual time of the next sample into the FIFO
+    unsigned long fifoSampleCount;
+    unsigned long fifoOverflowCount;
+    void writeRegister(uint8_t reg, uint8_t value);
+    uint8_t readRegister(uint8_t reg);
+    void sample(void);
+    void setWord(uint8_t reg, int32_t value);
+    void scheduleSample(bool restart);
+    void fifoSample(void);
+    void updateInterrupt(void);
+};
+
+/*
+ * DS3231 real time clock. Runs with a rate error against the Arduino clock,
+ * checks the alarms every second and drives the open drain INT/SQW pin.
+ */
+class DS3231Model : public I2CDevice {
+   public:
+    DS3231Model(Environment &environment, uint32_t unixtime, int32_t ppm, uint8_t intPin);
+    void receive(const uint8_t *data, uint8_t length);
+    uint8_t transmit(void);
+    uint32_t getUnixtime(void);
+    unsigned long getAlarmCount(void);
+    unsigned long getAcknowledgeCount(void);
+
+   private:
+    Environment &environment;
+    uint8_t registers[0x13];
+    uint8_t pointer;
+    uint64_t baseRtcUs;     // RTC time at baseSimUs in us since 1970
+    uint64_t baseSimUs;     // Virtual time of the last time setting
+    int32_t ppm;            // Rate error against the virtual time
+    uint8_t intPin;         // Arduino pin of INT/SQW (0xFF: not connected)
+    uint32_t generation;    // Invalidates the scheduled tick after a time setting
+    unsigned long alarmCount;
+    unsigned long acknowledgeCount;
+    uint64_t rtcNow(void);
+    void latchTime(void);
+    void setTimeFromRegisters(void);
+    void scheduleTick(void);
+    void tick(void);
+    void updateInterrupt(void);
+};
+
+/*
+ * DHT11/DHT22 temperature and humidity sensor on a single wire data line.
+ * A low start signal of at least 18 ms (DHT11) or 1 ms (DHT22) starts a transmission.
+ */
+class DHTModel : public PinDevice {
+   public:
+    DHTModel(Environment &environment, uint8_t pin, uint8_t type);
+    void begin(void);
+    void pinChanged(uint8_t pin);
+    unsigned long getTransmissionCount(void);
+
+   private:
+    Environment &environment;
+    uint8_t pin;
+    uint8_t type;
+    bool startSignal;
+    uint64_t startSignalTime;
+    uint64_t busyUntil;
+    unsigned long transmissionCount;
+    void transmit(uint64_t time);
+    uint64_t scheduleLevel(uint64_t time, int8_t level);
+};
+
+/*
+ * Fault of a slave on the I2C bus: it holds SDA low (e.g. after a reset in the middle of a read)
+ * until it saw a number of SCL clocks. No transaction completes while SDA is held.
+ */
+class I2CBusFault : public PinDevice {
+   public:
+    I2CBusFault(uint8_t sdaPin, uint8_t sclPin);
+    void begin(void);
+    void hold(uint8_t clocks);
+    void pinChanged(uint8_t pin);
+    unsigned long getHoldCount(void);
+
+   private:
+    uint8_t sdaPin;
+    uint8_t sclPin;
+    uint8_t clocksLeft;      // SCL clocks until SDA is released (0: not held)
+    uint8_t lastScl;         // Level of SCL at the last pin change
+    unsigned long holdCount;
+};
+
+/*
+ * SH1106 display controller. Accepts all commands and data, the text is tracked by the lcdgfx stub.
+ */
+class SH1106Model : public I2CDevice {
+   public:
+    void receive(const uint8_t *data, uint8_t length);
+    uint8_t transmit(void);
+};
+
+#endif
@@ -0,0 +1,333 @@
+/*
+  Scenario.cpp - Scripted day of the camper van for the host simulator.
+  Battery with fridge, lights and solar charging, tilt of the parked van,
+  inside climate, water switches and the user inputs at the rotary encoder.
+  All noise comes from a seeded generator, so every run is reproducible.
+
+  Licensed under "MIT" License.
+*/
+#include "Scenario.h"
+
+#include <math.h>
+
+#include "Arduino.h"
+
+#define BATTERY_CAPACITY 100.0  // Capacity of the battery in Ah
+#define BATTERY_RESISTANCE 0.015  // Internal resistance in Ohm
+#define BATTERY_START_SOC 0.75  // State of charge at the start
+#define BATTERY_EFFICIENCY 0.95  // Stored share of the charge
+#define BATTERY_TEMPCO 0.004     // Change of the open circuit voltage in V/K (to 25 degC)
+
+#define TILT_X 1.8   // Tilt of the parked van around x in deg
+#define TILT_Y -0.7  // Tilt of the parked van around y in deg
+
+#define PRESS_TIME 150000  // Duration of a key press in us
+#define STEP_TIME 150000   // Time between two rotary steps in us
+#define PHASE_TIME 5000    // Time between two phases of a rotary step in us
+#define BOUNCE_TIME 1000   // Bounce time of the water switches in us
+#define ANALOG_STEP 10000  // Time, for which the battery signals of the ADC are kept in us (the ADC converts every ms)
+
+// Open circuit voltage of the battery over the state of charge (10 % ... 100 %) at 25 degC
+static const float ocvMap[] = {11.51, 11.66, 11.81, 11.96, 12.10, 12.24, 12.37, 12.50, 12.62, 12.73};
+
+/*
+ * Constructor of the scenario.
+ * @param startUnixtime Wall clock time at power on
+ * @param seed Seed of the noise generator
+ * @param pins Pins of the sensors and the rotary encoder
+ */
+Scenario::Scenario(uint32_t startUnixtime, uint32_t seed, const ScenarioPinsType &pins)
+    : startUnixtime(startUnixtime), random(seed), pins(pins) {
+    charge = BATTERY_START_SOC * BATTERY_CAPACITY;
+    lastUpdate = 0;
+    analogSlot = UINT64_MAX;
+    memset(hourEnergy, 0, sizeof(hourEnergy));
+    lastHour = -1;
+    userInputs = 0;
+}
+
+/*
+ * Connect the sensors and schedule the events of all days.
+ * @param duration Simulated time in us
+ */
+void Scenario::begin(uint64_t duration) {
+    Simulation::setAnalogSource(pins.voltage, this);
+    Simulation::setAnalogSource(pins.current, this);
+    Simulation::setInput(pins.freshWater, LOW);
+    Simulation::setInput(pins.greyWater, HIGH);
+    Simulation::setInput(pins.rotarySW, HIGH);
+    Simulation::setInput(pins.rotaryDT, HIGH);
+    Simulation::setInput(pins.rotaryCLK, HIGH);
+
+    uint32_t days = duration / (86400ULL * 1000000) + 2;
+    for (uint32_t day = 0; day < days; day++) {
+        // Grey water tank full after the dishes, emptied half an hour later
+        scheduleWater(timeOfDay(day, 14, 0, 0), timeOfDay(day, 14, 30, 0), pins.greyWater, LOW);
+        // Fresh water tank empty in the evening, refilled after 75 minutes
+        scheduleWater(timeOfDay(day, 19, 0, 0), timeOfDay(day, 20, 15, 0), pins.freshWater, HIGH);
+
+        // Morning: wake up, look at the battery and scroll through the climate history
+        schedulePress(timeOfDay(day, 7, 15, 0));
+        scheduleTurn(timeOfDay(day, 7, 15, 5), 1);
+        scheduleTurn(timeOfDay(day, 7, 15, 15), 1);
+        schedulePress(timeOfDay(day, 7, 15, 20));
+        scheduleTurn(timeOfDay(day, 7, 15, 22), 3);
+        schedulePress(timeOfDay(day, 7, 15, 30));
+        scheduleTurn(timeOfDay(day, 7, 15, 35), -2);
+        // Noon: wake up by a turn
+        scheduleTurn(timeOfDay(day, 12, 0, 0), 1);
+        // Evening: battery check, the display goes to standby by itself
+        schedulePress(timeOfDay(day, 21, 0, 0));
+        scheduleTurn(timeOfDay(day, 21, 0, 3), 1);
+    }
+}
+
+/*
+ * Calibrate the tilt by the menu on the first morning: the parked van is taken as level.
+ * Wake up, turn to the calibration menu, confirm and turn back to the main menu.
+ */
+void Scenario::scheduleCalibration(void) {
+    schedulePress(timeOfDay(0, 6, 45, 0));
+    for (uint8_t i = 0; i < 4; i++) {
+        scheduleTurn(timeOfDay(0, 6, 45, 2 + i), 1);
+    }
+    schedulePress(timeOfDay(0, 6, 45, 7));
+    scheduleTurn(timeOfDay(0, 6, 45, 9), 1);
+    schedulePress(timeOfDay(0, 6, 45, 11));
+    for (uint8_t i = 0; i < 4; i++) {
+        scheduleTurn(timeOfDay(0, 6, 45, 15 + i), -1);
+    }
+}
+
+/*
+ * Tilt of the parked van. People inside make it wobble slightly.
+ */
+void Scenario::getTilt(float &phiX, float &phiY) {
+    phiX = TILT_X;
+    phiY = TILT_Y;
+    float hour = hourOfDay(Simulation::now());
+    if (hour >= 7 && hour < 23) {
+        phiX += getNoise(15) / 100.0;
+        phiY += getNoise(15) / 100.0;
+    }
+}
+
+/*
+ * Inside temperature: 10 degC to 24 degC, maximum at 15:00.
+ */
+float Scenario::getTemperature(void) {
+    float hour = hourOfDay(Simulation::now());
+    return 17.0 + 7.0 * sin((hour - 9.0) / 24.0 * TWO_PI);
+}
+
+/*
+ * Inside humidity: 53 % to 77 %, minimum at 15:00.
+ */
+float Scenario::getHumidity(void) {
+    float hour = hourOfDay(Simulation::now());
+    return 65.0 - 12.0 * sin((hour - 9.0) / 24.0 * TWO_PI);
+}
+
+/*
+ * Uniform noise of a linear congruential generator.
+ * @param amplitude Maximum absolute value
+ */
+int16_t Scenario::getNoise(int16_t amplitude) {
+    random = random * 1664525UL + 1013904223UL;
+    return (int16_t)((random >> 8) % (2 * amplitude + 1)) - amplitude;
+}
+
+/*
+ * Raw ADC values of the voltage divider (1:5) and the ACS712 30A (66 mV/A, 2.5 V offset).
+ * The battery signals are kept for ANALOG_STEP, the noise is new for every conversion.
+ */
+int Scenario::analogValue(uint8_t pin) {
+    updateBattery();
+    uint64_t slot = Simulation::now() / ANALOG_STEP;
+    if (slot != analogSlot) {
+        analogSlot = slot;
+        analogVoltage = getBatteryVoltage();
+        analogCurrent = getBatteryCurrent();
+    }
+    if (pin == pins.voltage) {
+        return (int)(analogVoltage * 0.2 * 1024.0 / 5.0 + 0.5) + getNoise(1);
+    }
+    if (pin == pins.current) {
+        return (int)((2500.0 - 66.2 * analogCurrent) * 1024.0 / 5000.0 + 0.5) + getNoise(2);
+    }
+    return 0;
+}
+
+/*
+ * Terminal voltage: open circuit voltage (at the inside temperature) minus the drop at the
+ * internal resistance.
+ */
+float Scenario::getBatteryVoltage(void) {
+    float soc = getBatterySOC() * 10.0;  // 1 ... 10 for the map
+    int index = constrain((int)soc - 1, 0, 8);
+    float ocv = ocvMap[index] + (ocvMap[index + 1] - ocvMap[index]) * (soc - 1 - index);
+    ocv += BATTERY_TEMPCO * (getTemperature() - 25.0);
+    return ocv - getBatteryCurrent() * BATTERY_RESISTANCE;
+}
+
+/*
+ * Battery current (positive: discharge).
+ */
+float Scenario::getBatteryCurrent(void) {
+    float current = loadCurrent(hourOfDay(Simulation::now()));
+    if (current < 0 && charge >= BATTERY_CAPACITY) {
+        return 0;  // charge controller stops at a full battery
+    }
+    return current;
+}
+
+/*
+ * State of charge of the battery (0 ... 1).
+ */
+float Scenario::getBatterySOC(void) {
+    updateBattery();
+    return charge / BATTERY_CAPACITY;
+}
+
+/*
+ * Get the discharge of an hour of the day (negative: charged).
+ * @param hour Hour of the day
+ * @return Discharge in Ah
+ */
+float Scenario::getHourEnergy(uint8_t hour) {
+    return hourEnergy[hour % SCENARIO_HOURS];
+}
+
+/*
+ * Get the number of user inputs (key presses and rotary steps).
+ */
+unsigned long Scenario::getUserInputCount(void) {
+    return userInputs;
+}
+
+// PRIVATE
+
+/*
+ * Hour of the day (wall clock) at a virtual time.
+ */
+float Scenario::hourOfDay(uint64_t time) {
+    uint64_t seconds = startUnixtime + time / 1000000;
+    return (seconds % 86400) / 3600.0 + (time % 1000000) / 3.6e9;
+}
+
+/*
+ * Virtual time of a wall clock time.
+ * @param day Day since the start (0: first day)
+ * @return Time in us, 0 if the time is before the start
+ */
+uint64_t Scenario::timeOfDay(uint32_t day, uint8_t hour, uint8_t minute, uint8_t second) {
+    int64_t midnight = startUnixtime - startUnixtime % 86400;
+    int64_t seconds = midnight + day * 86400LL + hour * 3600L + minute * 60L + second - startUnixtime;
+    return seconds > 0 ? seconds * 1000000 : 0;
+}
+
+/*
+ * Sum of all loads minus the solar current.
+ * @param hour Hour of the day
+ * @return Current in A (positive: discharge)
+ */
+float Scenario::loadCurrent(float hour) {
+    float current = 0.4;  // electronics
+    if (fmod(hour * 60.0, 30.0) < 12.0) {
+        current += 4.5;  // compressor fridge, 40 % duty cycle
+    }
+    if (hour >= 19.0 && hour < 23.0) {
+        current += 1.5;  // lights
+    }
+    if ((hour >= 7.33 && hour < 7.42) || (hour >= 19.5 && hour < 19.58)) {
+        current += 5.0;  // water pump
+    }
+    if (hour >= 6.0 && hour < 20.0) {
+        current -= 9.0 * pow(sin((hour - 6.0) / 14.0 * PI), 1.5);  // solar panel
+    }
+    return current;
+}
+
+/*
+ * Integrate the battery current up to the current virtual time in whole steps of 1 s, so the
+ * float charge doesn't depend on how often the sketch samples (every ms by the ADC interrupt).
+ */
+void Scenario::updateBattery(void) {
+    uint64_t now = Simulation::now();
+    while (now - lastUpdate >= 1000000) {
+        uint64_t step = 1000000;
+        float hour = hourOfDay(lastUpdate);
+        float current = loadCurrent(hour);
+        if (current < 0 && charge >= BATTERY_CAPACITY) {
+            current = 0;
+        }
+        float ah = current * step / 3.6e9;
+        float stored = current < 0 ? ah * BATTERY_EFFICIENCY : ah;
+        charge = constrain(charge - stored, 0.0f, (float)BATTERY_CAPACITY);
+        if ((int)hour != lastHour) {
+            lastHour = (int)hour;
+            hourEnergy[lastHour % SCENARIO_HOURS] = 0;  // new hour, the value of yesterday is overwritten
+        }
+        hourEnergy[lastHour % SCENARIO_HOURS] += ah;
+        lastUpdate += step;
+    }
+}
+
+/*
+ * Schedule a bouncing water switch.
+ * @param from Time of the switch in us
+ * @param to Time of the switch back in us
+ * @param pin Pin of the switch
+ * @param level Level between from and to
+ */
+void Scenario::scheduleWater(uint64_t from, uint64_t to, uint8_t pin, uint8_t level) {
+    if (from == 0) {
+        return;
+    }
+    uint8_t other = !level;
+    Simulation::schedule(from, [pin, level]() { Simulation::setInput(pin, level); });
+    Simulation::schedule(from + BOUNCE_TIME, [pin, other]() { Simulation::setInput(pin, other); });
+    Simulation::schedule(from + 2 * BOUNCE_TIME, [pin, level]() { Simulation::setInput(pin, level); });
+    Simulation::schedule(to, [pin, other]() { Simulation::setInput(pin, other); });
+}
+
+/*
+ * Schedule a key press of the rotary switch.
+ */
+void Scenario::schedulePress(uint64_t time) {
+    if (time == 0) {
+        return;
+    }
+    uint8_t pin = pins.rotarySW;
+    Simulation::schedule(time, [this, pin]() {
+        userInputs++;
+        Simulation::setInput(pin, LOW);
+    });
+    Simulation::schedule(time + PRESS_TIME, [pin]() { Simulation::setInput(pin, HIGH); });
+}
+
+/*
+ * Schedule rotary steps. A full step runs through the four phases of the gray code.
+ * @param steps Number of steps (positive: clockwise)
+ */
+void Scenario::scheduleTurn(uint64_t time, int8_t steps) {
+    if (time == 0) {
+        return;
+    }
+    static const uint8_t phasesCW[4] = {1, 0, 2, 3};   // (CLK << 1) | DT
+    static const uint8_t phasesCCW[4] = {2, 0, 1, 3};
+    const uint8_t *phases = steps > 0 ? phasesCW : phasesCCW;
+    uint8_t pinDT = pins.rotaryDT;
+    uint8_t pinCLK = pins.rotaryCLK;
+    for (int8_t step = 0; step < abs(steps); step++) {
+        for (uint8_t i = 0; i < 4; i++) {
+            uint8_t phase = phases[i];
+            bool last = i == 3;
+            Simulation::schedule(time + step * STEP_TIME + i * PHASE_TIME, [this, pinDT, pinCLK, phase, last]() {
+                userInputs += last;
+                Simulation::setInput(pinDT, phase & 0x01);
+                Simulation::setInput(pinCLK, phase >> 1);
+            });
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/*
+  Scenario.h - Scripted day of the camper van for the host simulator.
+  Battery with fridge, lights and solar charging, tilt of the parked van,
+  inside climate, water switches and the user inputs at the rotary encoder.
+  All noise comes from a seeded generator, so every run is reproducible.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "Devices.h"
+#include "Simulation.h"
+
+#define SCENARIO_HOURS 24  // Hours of the energy statistic
+
+struct ScenarioPinsType {
+    uint8_t voltage;     // Analog pin of the voltage sensor
+    uint8_t current;     // Analog pin of the current sensor
+    uint8_t freshWater;  // Fresh water switch (low while water is above the switch)
+    uint8_t greyWater;   // Grey water switch (low while the tank is full)
+    uint8_t rotarySW;    // Rotary switch (low while pressed)
+    uint8_t rotaryDT;    // Rotary data
+    uint8_t rotaryCLK;   // Rotary clock
+};
+
+class Scenario : public Environment, public AnalogSource {
+   public:
+    Scenario(uint32_t startUnixtime, uint32_t seed, const ScenarioPinsType &pins);
+    void begin(uint64_t duration);
+    void scheduleCalibration(void);
+
+    // Environment
+    void getTilt(float &phiX, float &phiY);
+    float getTemperature(void);
+    float getHumidity(void);
+    int16_t getNoise(int16_t amplitude);
+
+    // AnalogSource
+    int analogValue(uint8_t pin);
+
+    float getBatteryVoltage(void);
+    float getBatteryCurrent(void);
+    float getBatterySOC(void);
+    float getHourEnergy(uint8_t hour);
+    unsigned long getUserInputCount(void);
+
+   private:
+    uint32_t startUnixtime;
+    uint32_t random;
+    ScenarioPinsType pins;
+    float charge;                    // Battery charge in Ah
+    uint64_t lastUpdate;             // Virtual time of the last battery update in us
+    uint64_t analogSlot;             // ANALOG_STEP of the kept battery signals
+    float analogVoltage;             // Kept battery voltage of the ADC
+    float analogCurrent;             // Kept battery current of the ADC
+    float hourEnergy[SCENARIO_HOURS];  // Discharge in Ah per hour of the day (last 24 h)
+    int8_t lastHour;                 // Hour of the day of the last battery update
+    unsigned long userInputs;
+    float hourOfDay(uint64_t time);
+    uint64_t timeOfDay(uint32_t day, uint8_t hour, uint8_t minute, uint8_t second);
+    float loadCurrent(float hour);
+    void updateBattery(void);
+    void scheduleWater(uint64_t from, uint64_t to, uint8_t pin, uint8_t level);
+    void schedulePress(uint64_t time);
+    void scheduleTurn(uint64_t time, int8_t steps);
+};
+
+#endif
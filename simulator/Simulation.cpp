@@ -0,0 +1,863 @@
+/*
+  Simulation.cpp - Virtual time, pins, interrupts and I2C bus of the host simulator.
+  Every stubbed Arduino call advances the virtual time by the cost of the emulated
+  operation. Scheduled events (sensor models, user inputs) run as soon as the virtual
+  time passes them, interrupts are delivered like on the AVR (not while disabled).
+
+  Licensed under "MIT" License.
+*/
+#include "Simulation.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <deque>
+#include <queue>
+#include <vector>
+
+#include "Arduino.h"
+#include "util/twi.h"
+
+// The state is plain data, because global constructors of the sketch (e.g. the DHT or the rotary)
+// already call pinMode() and digitalWrite() before main().
+volatile uint8_t simPortInput[SIM_PORT_COUNT];
+
+static uint64_t simTime = 0;
+static uint64_t timeLimit = 0;
+static uint32_t eventOrder = 0;
+static bool eventsRunning = false;
+
+static uint8_t pinModes[SIM_PIN_COUNT];       // INPUT, OUTPUT or INPUT_PULLUP
+static uint8_t pinOutputs[SIM_PIN_COUNT];     // PORT register bit (output level or pull-up)
+static int8_t pinInputs[SIM_PIN_COUNT];       // Level driven by a device, -1 if released
+static uint8_t pinLevels[SIM_PIN_COUNT];      // Current level of the pin
+static bool pinInputsInitialized = false;
+static PinDevice *pinDevices[SIM_PIN_COUNT];
+static AnalogSource *analogSources[SIM_PIN_COUNT];
+
+static bool interruptsEnabled = true;
+static bool interruptRunning = false;
+static unsigned long handlerEnables = 0;  // Interrupts enabled by a handler (nesting on the AVR)
+static uint8_t pinChangePending = 0;         // Bit per port
+static uint8_t externalPending = 0;          // Bit per INT0/INT1
+static void (*externalHandlers[2])(void);
+static int externalModes[2];
+static void (*pinChangeHook)(uint8_t port, uint8_t pins);
+static void (*adcHook)(void);
+static bool adcPending = false;              // ADC interrupt flagged, not yet delivered
+
+static uint8_t adcControlA = 0;              // ADCSRA (incl. ADIF)
+static uint8_t adcControlB = 0;              // ADCSRB
+static uint8_t adcMux = 0;                   // ADMUX
+static uint16_t adcResult = 0;               // ADCH:ADCL
+static bool adcRunning = false;              // Auto trigger by the Timer0 overflow active
+static bool adcConverting = false;           // Conversion started, result not yet there (ADSC)
+static uint8_t adcConvertingMux = 0;         // MUX of the running conversion, latched at its start
+static uint64_t adcNext = 0;                 // Time of the next start or result of a conversion
+
+static I2CDevice *i2cDevices[SIM_I2C_ADDRESSES];
+static I2CStatisticType i2cStatistics[SIM_I2C_ADDRESSES];
+static uint32_t i2cByteTime = 90000;         // Time of one byte (9 clocks) in ns (100 kHz)
+static uint32_t i2cByteTimeRemainder = 0;    // Fraction of a us in ns
+static uint32_t i2cTimeout = 0;              // Timeout of the blocking Wire calls in us (0: none)
+static bool i2cHeld = false;                 // SDA held low by a slave, no transaction completes
+
+enum SIM_TWI_STATE {
+    SIM_TWI_IDLE,       // Bus released or address not acknowledged
+    SIM_TWI_ADDRESS,    // Start condition sent, next byte is the address
+    SIM_TWI_TRANSMIT,   // Master transmitter
+    SIM_TWI_RECEIVE     // Master receiver
+};
+
+static uint8_t twiBitRate = 0;               // TWBR
+static uint8_t twiStatus = TW_NO_INFO;       // TWSR (status and prescaler bits)
+static uint8_t twiData = 0;                  // TWDR
+static uint8_t twiControlRegister = 0;       // TWCR (incl. TWINT flag)
+static uint8_t twiState = SIM_TWI_IDLE;
+static bool twiBusOwned = false;             // Start condition sent and no stop yet
+static uint8_t twiAddress = 0;
+static uint8_t twiBuffer[SIM_TWI_BUFFER];    // Bytes of the write transaction
+static uint8_t twiLength = 0;
+
+static bool serialOutput = false;
+static FILE *serialCapture = NULL;
+static uint32_t serialByteTime = 0;          // Time of one byte (10 bits) in us, 0: not started
+static uint64_t serialEmptyTime = 0;         // Virtual time when the transmit buffer runs empty
+
+struct SimEventType {
+    uint64_t time;
+    uint32_t order;
+    SimAction action;
+};
+
+struct SimEventLater {
+    bool operator()(const SimEventType &a, const SimEventType &b) const {
+        return a.time != b.time ? a.time > b.time : a.order > b.order;
+    }
+};
+
+typedef std::priority_queue<SimEventType, std::vector<SimEventType>, SimEventLater> SimEventQueue;
+
+static SimEventQueue &events(void) {
+    static SimEventQueue queue;
+    return queue;
+}
+
+static std::deque<char> &serialBuffer(void) {
+    static std::deque<char> buffer;
+    return buffer;
+}
+
+/*
+ * All pins are released by the devices at power on.
+ */
+static void initializePins(void) {
+    if (pinInputsInitialized) {
+        return;
+    }
+    for (uint8_t i = 0; i < SIM_PIN_COUNT; i++) {
+        pinInputs[i] = -1;
+    }
+    pinInputsInitialized = true;
+}
+
+// PUBLIC
+
+/*
+ * Get the virtual time.
+ * @return Time since power on in us
+ */
+uint64_t Simulation::now(void) {
+    return simTime;
+}
+
+/*
+ * Advance the virtual time and run all events, which got due.
+ * @param us Duration in us
+ */
+void Simulation::advance(uint64_t us) {
+    uint64_t end = simTime + us;
+    if (timeLimit != 0 && end > timeLimit) {
+        fprintf(stderr, "Simulation stuck: virtual time limit exceeded (endless loop in the sketch?)\n");
+        exit(2);
+    }
+    if (eventsRunning) {
+        simTime = end;
+        return;
+    }
+    runEvents(end);
+}
+
+/*
+ * Schedule an event.
+ * @param time Virtual time in us. An event in the past runs on the next advance.
+ * @param action Function to run
+ */
+void Simulation::schedule(uint64_t time, SimAction action) {
+    SimEventType event = {time, eventOrder++, action};
+    events().push(event);
+}
+
+/*
+ * Abort the simulation, if the virtual time passes a limit (protection against endless loops).
+ * @param limit Virtual time in us (0: no limit)
+ */
+void Simulation::setTimeLimit(uint64_t limit) {
+    timeLimit = limit;
+}
+
+/*
+ * Set the mode of a pin like the AVR core: INPUT disables, INPUT_PULLUP enables the pull-up.
+ */
+void Simulation::pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= SIM_PIN_COUNT) {
+        return;
+    }
+    initializePins();
+    pinModes[pin] = mode;
+    if (mode == INPUT) {
+        pinOutputs[pin] = LOW;
+    } else if (mode == INPUT_PULLUP) {
+        pinOutputs[pin] = HIGH;
+    }
+    updatePin(pin, true);
+}
+
+/*
+ * Set the output level of a pin, or the pull-up of an input pin.
+ */
+void Simulation::digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin >= SIM_PIN_COUNT) {
+        return;
+    }
+    initializePins();
+    pinOutputs[pin] = value ? HIGH : LOW;
+    updatePin(pin, true);
+}
+
+/*
+ * Get the level of a pin.
+ */
+uint8_t Simulation::digitalRead(uint8_t pin) {
+    if (pin >= SIM_PIN_COUNT) {
+        return LOW;
+    }
+    initializePins();
+    return pinLevels[pin];
+}
+
+/*
+ * Drive a pin by a device (switch, sensor, open drain output).
+ * @param pin Arduino pin number
+ * @param level HIGH, LOW or -1 to release the pin
+ */
+void Simulation::setInput(uint8_t pin, int8_t level) {
+    if (pin >= SIM_PIN_COUNT) {
+        return;
+    }
+    initializePins();
+    pinInputs[pin] = level;
+    updatePin(pin, false);
+}
+
+/*
+ * Get the mode of a pin.
+ */
+uint8_t Simulation::getMode(uint8_t pin) {
+    return pin < SIM_PIN_COUNT ? pinModes[pin] : INPUT;
+}
+
+/*
+ * Get the output register bit of a pin (e.g. the state of a LED).
+ */
+uint8_t Simulation::getOutput(uint8_t pin) {
+    return pin < SIM_PIN_COUNT ? pinOutputs[pin] : LOW;
+}
+
+/*
+ * Register a device, which is notified about the writes of the sketch to a pin.
+ */
+void Simulation::setPinDevice(uint8_t pin, PinDevice *device) {
+    if (pin < SIM_PIN_COUNT) {
+        pinDevices[pin] = device;
+    }
+}
+
+/*
+ * Register the signal source of an analog pin.
+ */
+void Simulation::setAnalogSource(uint8_t pin, AnalogSource *source) {
+    if (pin < SIM_PIN_COUNT) {
+        analogSources[pin] = source;
+    }
+}
+
+/*
+ * Convert an analog pin. The value is taken at the end of the conversion.
+ * @return Raw 10 bit value
+ */
+int Simulation::analogRead(uint8_t pin) {
+    advance(SIM_COST_ANALOG_READ);
+    if (pin < SIM_PIN_COUNT && analogSources[pin] != NULL) {
+        int value = analogSources[pin]->analogValue(pin);
+        return value < 0 ? 0 : (value > 1023 ? 1023 : value);
+    }
+    return 0;
+}
+
+/*
+ * Enable or disable the interrupts. Pending interrupts are delivered on enable.
+ */
+void Simulation::setInterrupts(bool enabled) {
+    if (enabled && interruptRunning) {
+        handlerEnables++;  // the AVR would deliver nested interrupts from here on
+    }
+    interruptsEnabled = enabled;
+    if (enabled) {
+        deliverInterrupts();
+    }
+}
+
+/*
+ * Get the number of times a handler enabled the interrupts (0: no handler can be nested).
+ */
+unsigned long Simulation::getHandlerEnables(void) {
+    return handlerEnables;
+}
+
+/*
+ * Attach a handler to the external interrupt INT0 (pin 2) or INT1 (pin 3).
+ * @param number Interrupt number
+ * @param handler Interrupt handler
+ * @param mode CHANGE, FALLING or RISING
+ */
+void Simulation::attachInterrupt(uint8_t number, void (*handler)(void), int mode) {
+    if (number < 2) {
+        externalHandlers[number] = handler;
+        externalModes[number] = mode;
+    }
+}
+
+/*
+ * Detach the handler of an external interrupt.
+ */
+void Simulation::detachInterrupt(uint8_t number) {
+    if (number < 2) {
+        externalHandlers[number] = NULL;
+    }
+}
+
+/*
+ * Register the pin change interrupt vector (shared by all pins of a port).
+ * @param hook Called with the port and its input register on a level change of any pin of the port.
+ */
+void Simulation::setPinChangeHook(void (*hook)(uint8_t port, uint8_t pins)) {
+    pinChangeHook = hook;
+}
+
+/*
+ * Register the ADC interrupt vector (conversion complete with ADIE).
+ */
+void Simulation::setAdcHook(void (*hook)(void)) {
+    adcHook = hook;
+}
+
+/*
+ * Connect a device to the I2C bus.
+ */
+void Simulation::attachI2C(uint8_t address, I2CDevice *device) {
+    if (address < SIM_I2C_ADDRESSES) {
+        i2cDevices[address] = device;
+    }
+}
+
+/*
+ * Set the SCL frequency of the bus.
+ * @param frequency Clock in Hz
+ */
+void Simulation::setI2CClock(uint32_t frequency) {
+    if (frequency > 0) {
+        i2cByteTime = 9000000000ULL / frequency;
+    }
+}
+
+/*
+ * Set the timeout of the blocking Wire calls (Wire.setWireTimeout).
+ * @param timeout Timeout in us (0: wait forever)
+ */
+void Simulation::setI2CTimeout(uint32_t timeout) {
+    i2cTimeout = timeout;
+}
+
+/*
+ * Hold the bus (SDA low by a slave) or release it. A held bus completes no transaction:
+ * the blocking Wire calls end by their timeout, the TWI module never sets TWINT or
+ * ends the stop condition.
+ */
+void Simulation::setI2CHeld(bool held) {
+    i2cHeld = held;
+}
+
+bool Simulation::isI2CHeld(void) {
+    return i2cHeld;
+}
+
+/*
+ * Wait of a blocking Wire call on a held bus: until the timeout, or forever like the AVR Wire
+ * library without a timeout (ends the simulation by the time limit).
+ */
+static void i2cWaitHeld(void) {
+    if (i2cTimeout == 0) {
+        while (true) {
+            Simulation::advance(1000);
+        }
+    }
+    Simulation::advance(i2cTimeout);
+}
+
+/*
+ * Write transaction on the I2C bus (address byte and data bytes).
+ * @return true, if the device acknowledged the address.
+ */
+bool Simulation::i2cWrite(uint8_t address, const uint8_t *data, uint8_t length) {
+    if (i2cHeld) {
+        i2cWaitHeld();
+        return false;
+    }
+    i2cTransfer(address, length);
+    I2CDevice *device = address < SIM_I2C_ADDRESSES ? i2cDevices[address] : NULL;
+    if (device == NULL) {
+        i2cStatistics[address & 0x7F].nacks++;
+        return false;
+    }
+    device->receive(data, length);
+    return true;
+}
+
+/*
+ * Read transaction on the I2C bus (address byte and data bytes).
+ * @return Number of bytes read (0, if the device did not acknowledge the address).
+ */
+uint8_t Simulation::i2cRead(uint8_t address, uint8_t *data, uint8_t length) {
+    if (i2cHeld) {
+        i2cWaitHeld();
+        return 0;
+    }
+    I2CDevice *device = address < SIM_I2C_ADDRESSES ? i2cDevices[address] : NULL;
+    if (device == NULL) {
+        i2cTransfer(address, 0);
+        i2cStatistics[address & 0x7F].nacks++;
+        return 0;
+    }
+    i2cTransfer(address, length);
+    for (uint8_t i = 0; i < length; i++) {
+        data[i] = device->transmit();
+    }
+    return length;
+}
+
+/*
+ * Get the bus statistic of a device address.
+ */
+const I2CStatisticType &Simulation::getI2CStatistic(uint8_t address) {
+    return i2cStatistics[address & 0x7F];
+}
+
+/*
+ * Read an I/O register. Polling TWCR takes a bit of time, so a polling loop does not stall the virtual time.
+ * @param address Register address (SIM_REG_...)
+ */
+uint8_t Simulation::readRegister(uint8_t address) {
+    switch (address) {
+        case SIM_REG_SREG:
+            return interruptsEnabled ? _BV(SREG_I) : 0;
+        case SIM_REG_ADCL:
+            return adcResult & 0xFF;
+        case SIM_REG_ADCH:
+            return adcResult >> 8;
+        case SIM_REG_ADCSRA:
+            return adcControlA;
+        case SIM_REG_ADCSRB:
+            return adcControlB;
+        case SIM_REG_ADMUX:
+            return adcMux;
+        case SIM_REG_TWBR:
+            return twiBitRate;
+        case SIM_REG_TWSR:
+            return twiStatus;
+        case SIM_REG_TWDR:
+            return twiData;
+        case SIM_REG_TWCR:
+            advance(1);
+            return twiControlRegister;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Write an I/O register. The bit rate registers set the clock of the bus (like Wire.setClock()).
+ * @param address Register address (SIM_REG_...)
+ * @param value New value
+ */
+void Simulation::writeRegister(uint8_t address, uint8_t value) {
+    switch (address) {
+        case SIM_REG_SREG:
+            setInterrupts(value & _BV(SREG_I));  // only the global interrupt flag is emulated
+            break;
+        case SIM_REG_ADCSRA:
+            adcControl(value);
+            break;
+        case SIM_REG_ADCSRB:
+            adcControlB = value;
+            adcControl(adcControlA & ~_BV(ADIF));
+            break;
+        case SIM_REG_ADMUX:
+            adcMux = value;
+            break;
+        case SIM_REG_TWBR:
+            twiBitRate = value;
+            setI2CClock(F_CPU / (16 + 2UL * twiBitRate * (1UL << (2 * (twiStatus & 0x03)))));
+            break;
+        case SIM_REG_TWSR:
+            twiStatus = (twiStatus & TW_STATUS_MASK) | (value & 0x03);
+            setI2CClock(F_CPU / (16 + 2UL * twiBitRate * (1UL << (2 * (twiStatus & 0x03)))));
+            break;
+        case SIM_REG_TWDR:
+            twiData = value;
+            break;
+        case SIM_REG_TWCR:
+            twiControl(value);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Enable the output of the sketch's Serial prints to stdout.
+ */
+void Simulation::setSerialOutput(bool enabled) {
+    serialOutput = enabled;
+}
+
+bool Simulation::getSerialOutput(void) {
+    return serialOutput;
+}
+
+/*
+ * Write the sketch's Serial output to a file (e.g. a binary trace).
+ */
+void Simulation::setSerialCapture(FILE *file) {
+    serialCapture = file;
+}
+
+/*
+ * Start the transmission at a baud rate (0: stopped, writes don't take time).
+ */
+void Simulation::serialBegin(unsigned long baud) {
+    serialByteTime = baud > 0 ? (10000000UL + baud / 2) / baud : 0;
+    serialEmptyTime = now();
+}
+
+/*
+ * Transmit a byte. Waits like the AVR core, while the transmit buffer is full.
+ */
+void Simulation::serialWrite(uint8_t c) {
+    if (serialByteTime > 0) {
+        if (serialAvailableForWrite() == 0) {
+            advance(serialEmptyTime - now() - (uint64_t)(SIM_SERIAL_TX_BUFFER - 2) * serialByteTime);
+        }
+        serialEmptyTime = (serialEmptyTime > now() ? serialEmptyTime : now()) + serialByteTime;
+    }
+    if (serialOutput) {
+        putchar(c);
+    }
+    if (serialCapture != NULL) {
+        fputc(c, serialCapture);
+    }
+}
+
+/*
+ * Free space in the transmit buffer in bytes.
+ */
+int Simulation::serialAvailableForWrite(void) {
+    if (serialByteTime == 0) {
+        return SIM_SERIAL_TX_BUFFER - 1;
+    }
+    uint64_t time = now();
+    int queued = serialEmptyTime > time ? (serialEmptyTime - time + serialByteTime - 1) / serialByteTime : 0;
+    return queued < SIM_SERIAL_TX_BUFFER - 1 ? SIM_SERIAL_TX_BUFFER - 1 - queued : 0;
+}
+
+/*
+ * Wait until the transmit buffer is empty.
+ */
+void Simulation::serialFlush(void) {
+    if (serialByteTime > 0 && serialEmptyTime > now()) {
+        advance(serialEmptyTime - now());
+    }
+    if (serialOutput) {
+        fflush(stdout);
+    }
+}
+
+/*
+ * Queue text as received by the serial port (e.g. profiler commands).
+ */
+void Simulation::serialInput(const char *text) {
+    while (*text) {
+        serialBuffer().push_back(*text++);
+    }
+}
+
+int Simulation::serialAvailable(void) {
+    return serialBuffer().size();
+}
+
+int Simulation::serialRead(void) {
+    if (serialBuffer().empty()) {
+        return -1;
+    }
+    char c = serialBuffer().front();
+    serialBuffer().pop_front();
+    return (uint8_t)c;
+}
+
+// PRIVATE
+
+/*
+ * Run all events up to a time. Every event runs at its own time and the interrupts it flags
+ * are delivered before the next event, like on the MCU (e.g. the edges of a DHT transmission
+ * within one delay()). Nested calls (a stub call from an event or an interrupt handler) only
+ * advance the time, the outer call runs the events.
+ * @param end Virtual time after the events
+ */
+void Simulation::runEvents(uint64_t end) {
+    SimEventQueue &queue = events();
+    while (true) {
+        // The conversions of the ADC run like events, but without the queue (start and result per ms)
+        bool conversion = adcRunning && adcNext <= end && (queue.empty() || adcNext < queue.top().time);
+        if (!conversion && (queue.empty() || queue.top().time > end)) {
+            break;
+        }
+        uint64_t time = conversion ? adcNext : queue.top().time;
+        if (time > simTime) {
+            simTime = time;
+        }
+        eventsRunning = true;
+        if (conversion) {
+            adcConvert();
+        } else {
+            SimAction action = queue.top().action;
+            queue.pop();
+            action();
+        }
+        eventsRunning = false;
+        deliverInterrupts();
+    }
+    if (end > simTime) {
+        simTime = end;
+    }
+    deliverInterrupts();
+}
+
+/*
+ * Call the handlers of the pending interrupts, if the interrupts are enabled.
+ * Handlers run with disabled interrupts like an ISR.
+ */
+void Simulation::deliverInterrupts(void) {
+    if (!interruptsEnabled || interruptRunning || (pinChangePending == 0 && externalPending == 0 && !adcPending)) {
+        return;
+    }
+    interruptRunning = true;
+    interruptsEnabled = false;
+    while (pinChangePending != 0 || externalPending != 0 || adcPending) {
+        for (uint8_t n = 0; n < 2; n++) {
+            if (externalPending & bit(n)) {
+                externalPending &= ~bit(n);
+                if (externalHandlers[n] != NULL) {
+                    externalHandlers[n]();
+                }
+            }
+        }
+        for (uint8_t port = 0; port < SIM_PORT_COUNT; port++) {
+            if (pinChangePending & bit(port)) {
+                pinChangePending &= ~bit(port);
+                if (pinChangeHook != NULL) {
+                    pinChangeHook(port, simPortInput[port]);
+                }
+            }
+        }
+        if (adcPending) {
+            adcPending = false;
+            adcControlA &= ~_BV(ADIF);  // cleared by the execution of the vector
+            if (adcHook != NULL) {
+                adcHook();
+            }
+        }
+    }
+    interruptsEnabled = true;
+    interruptRunning = false;
+}
+
+/*
+ * Recalculate the level of a pin and flag the interrupts of a level change.
+ * @param pin Arduino pin number
+ * @param notify true, if the pin device is notified (write by the sketch)
+ */
+void Simulation::updatePin(uint8_t pin, bool notify) {
+    uint8_t level;
+    if (pinModes[pin] == OUTPUT) {
+        level = pinOutputs[pin];
+    } else if (pinInputs[pin] >= 0) {
+        level = pinInputs[pin];
+    } else {
+        level = pinOutputs[pin];  // pull-up or floating (reads low)
+    }
+
+    if (level != pinLevels[pin]) {
+        pinLevels[pin] = level;
+        uint8_t port = simPinToPort(pin);
+        uint8_t mask = simPinToMask(pin);
+        if (level) {
+            simPortInput[port] |= mask;
+        } else {
+            simPortInput[port] &= ~mask;
+        }
+        pinChangePending |= bit(port);
+
+        int8_t number = pin == 2 ? 0 : (pin == 3 ? 1 : -1);
+        if (number >= 0 && externalHandlers[number] != NULL) {
+            int mode = externalModes[number];
+            if (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level)) {
+                externalPending |= bit(number);
+            }
+        }
+    }
+
+    if (notify && pinDevices[pin] != NULL) {
+        pinDevices[pin]->pinChanged(pin);
+    }
+}
+
+/*
+ * Advance the time by a transaction: start, address byte, data bytes and stop.
+ */
+void Simulation::i2cTransfer(uint8_t address, uint8_t length) {
+    I2CStatisticType &statistic = i2cStatistics[address & 0x7F];
+    statistic.transactions++;
+    statistic.bytes += length + 1;
+    uint64_t time = (uint64_t)(length + 1) * i2cByteTime + i2cByteTimeRemainder;
+    i2cByteTimeRemainder = time % 1000;
+    advance(time / 1000 + 10);  // plus start and stop condition
+}
+
+/*
+ * Write of ADCSRA (writing ADIF clears the flag). The auto trigger by the Timer0 overflow
+ * (ADTS 100) converts at every overflow, the other trigger sources and single conversions
+ * by ADSC are not emulated (analogRead() converts by itself).
+ */
+void Simulation::adcControl(uint8_t value) {
+    uint8_t flag = (value & _BV(ADIF)) ? 0 : (adcControlA & _BV(ADIF));
+    adcControlA = (value & ~(_BV(ADIF) | _BV(ADSC))) | flag | (adcControlA & _BV(ADSC));  // ADSC is set by the conversion
+    if (!(adcControlA & _BV(ADIE))) {
+        adcPending = false;
+    }
+    bool running = (adcControlA & _BV(ADEN)) && (adcControlA & _BV(ADATE)) && (adcControlB & 0x07) == _BV(ADTS2);
+    if (running && !adcRunning) {
+        adcNext = (simTime / SIM_TIMER0_OVERFLOW + 1) * SIM_TIMER0_OVERFLOW;
+        adcConverting = false;
+    }
+    if (!running) {
+        adcConverting = false;
+        adcControlA &= ~_BV(ADSC);
+    }
+    adcRunning = running;
+}
+
+/*
+ * Start or result of an auto triggered conversion. At the overflow the conversion starts with
+ * the channel of ADMUX (latched, a later write of ADMUX only selects the next one) and ADSC is
+ * set. The result (13 ADC clocks later) samples the latched channel, clears ADSC, sets ADIF and
+ * flags the interrupt. An unread result is overwritten like on the MCU.
+ */
+void Simulation::adcConvert(void) {
+    if (!adcConverting) {
+        adcConverting = true;
+        adcConvertingMux = adcMux;
+        adcControlA |= _BV(ADSC);
+        adcNext += SIM_COST_ANALOG_READ;
+        return;
+    }
+    adcConverting = false;
+    adcControlA &= ~_BV(ADSC);
+    uint8_t pin = A0 + (adcConvertingMux & 0x0F);
+    int value = 0;
+    if (pin < SIM_PIN_COUNT && analogSources[pin] != NULL) {
+        value = constrain(analogSources[pin]->analogValue(pin), 0, 1023);
+    }
+    adcResult = (adcConvertingMux & _BV(ADLAR)) ? value << 6 : value;
+    adcControlA |= _BV(ADIF);
+    if (adcControlA & _BV(ADIE)) {
+        adcPending = true;
+    }
+    adcNext += SIM_TIMER0_OVERFLOW - SIM_COST_ANALOG_READ;
+}
+
+/*
+ * Write of TWCR. Writing TWINT clears the flag and starts the next action of the TWI module:
+ * start condition, stop condition, address byte, data byte or receive of a byte. The flag
+ * is set again, when the action is completed on the bus.
+ */
+void Simulation::twiControl(uint8_t value) {
+    uint8_t flag = (value & _BV(TWINT)) ? 0 : (twiControlRegister & _BV(TWINT));
+    twiControlRegister = (value & ~_BV(TWINT)) | flag;
+    if (!(value & _BV(TWEN))) {
+        twiState = SIM_TWI_IDLE;
+        twiBusOwned = false;
+        return;
+    }
+    if (!(value & _BV(TWINT)) || i2cHeld) {
+        return;  // no action, or it never completes on a held bus
+    }
+    uint32_t bitTime = i2cByteTime / 9;
+
+    if (value & _BV(TWSTO)) {
+        twiDeliver();
+        twiBusOwned = false;
+        twiStatus = (twiStatus & 0x03) | TW_NO_INFO;
+        schedule(now() + (bitTime + 999) / 1000, []() {
+            twiControlRegister &= ~_BV(TWSTO);
+        });
+        return;
+    }
+    if (value & _BV(TWSTA)) {
+        twiDeliver();
+        twiComplete(twiBusOwned ? TW_REP_START : TW_START, bitTime);
+        twiBusOwned = true;
+        twiState = SIM_TWI_ADDRESS;
+        return;
+    }
+
+    switch (twiState) {
+        case SIM_TWI_ADDRESS: {
+            bool read = twiData & TW_READ;
+            twiAddress = twiData >> 1;
+            I2CStatisticType &statistic = i2cStatistics[twiAddress];
+            statistic.transactions++;
+            statistic.bytes++;
+            if (i2cDevices[twiAddress] == NULL) {
+                statistic.nacks++;
+                twiState = SIM_TWI_IDLE;
+                twiComplete(read ? TW_MR_SLA_NACK : TW_MT_SLA_NACK, i2cByteTime);
+            } else {
+                twiState = read ? SIM_TWI_RECEIVE : SIM_TWI_TRANSMIT;
+                twiLength = 0;
+                twiComplete(read ? TW_MR_SLA_ACK : TW_MT_SLA_ACK, i2cByteTime);
+            }
+            break;
+        }
+        case SIM_TWI_TRANSMIT:
+            if (twiLength < SIM_TWI_BUFFER) {
+                twiBuffer[twiLength++] = twiData;
+            }
+            i2cStatistics[twiAddress].bytes++;
+            twiComplete(TW_MT_DATA_ACK, i2cByteTime);
+            break;
+        case SIM_TWI_RECEIVE:
+            twiData = i2cDevices[twiAddress]->transmit();  // not read by the master before TWINT
+            i2cStatistics[twiAddress].bytes++;
+            twiComplete((value & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK, i2cByteTime);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Set the TWINT flag and the status, when an action of the TWI module is completed on the bus.
+ * @param status Status code (util/twi.h)
+ * @param ns Duration of the action in ns
+ */
+void Simulation::twiComplete(uint8_t status, uint32_t ns) {
+    uint64_t time = (uint64_t)ns + i2cByteTimeRemainder;
+    i2cByteTimeRemainder = time % 1000;
+    schedule(now() + time / 1000, [status]() {
+        if (i2cHeld) {
+            return;  // the bus was taken during the action
+        }
+        twiStatus = (twiStatus & 0x03) | status;
+        twiControlRegister |= _BV(TWINT);
+    });
+}
+
+/*
+ * Pass the bytes of a write transaction to the device (on the stop or repeated start condition).
+ */
+void Simulation::twiDeliver(void) {
+    if (twiState == SIM_TWI_TRANSMIT) {
+        i2cDevices[twiAddress]->receive(twiBuffer, twiLength);
+    }
+    twiState = SIM_TWI_IDLE;
+}
@@ -0,0 +1,161 @@
+/*
+  Simulation.h - Virtual time, pins, interrupts and I2C bus of the host simulator.
+  Every stubbed Arduino call advances the virtual time by the cost of the emulated
+  operation. Scheduled events (sensor models, user inputs) run as soon as the virtual
+  time passes them, interrupts are delivered like on the AVR (not while disabled).
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+
+#define SIM_PIN_COUNT 20    // Digital pins 0..13 and analog pins A0..A5 (14..19)
+#define SIM_PORT_COUNT 5    // Port numbers of digitalPinToPort (PB = 2, PC = 3, PD = 4)
+#define SIM_I2C_ADDRESSES 128
+
+// Costs of the emulated operations in us (ATmega328P @ 16 MHz)
+#define SIM_COST_DIGITAL_IO 4    // digitalRead, digitalWrite, pinMode
+#define SIM_COST_ANALOG_READ 112 // 13 ADC clocks @ 125 kHz plus overhead
+#define SIM_COST_LOOP 10         // Call of loop() and the scheduler without a due task
+#define SIM_TIMER0_OVERFLOW 1024 // Period of the Timer0 overflow in us (prescaler 64), trigger source of the ADC
+
+#define SIM_SERIAL_TX_BUFFER 64  // Transmit buffer of HardwareSerial in bytes (one slot stays free)
+
+// Addresses of the emulated I/O registers (data memory addresses of the ATmega328P)
+#define SIM_REG_SREG 0x5F
+#define SIM_REG_ADCL 0x78
+#define SIM_REG_ADCH 0x79
+#define SIM_REG_ADCSRA 0x7A
+#define SIM_REG_ADCSRB 0x7B
+#define SIM_REG_ADMUX 0x7C
+#define SIM_REG_TWBR 0xB8
+#define SIM_REG_TWSR 0xB9
+#define SIM_REG_TWDR 0xBB
+#define SIM_REG_TWCR 0xBC
+#define SIM_TWI_BUFFER 32         // Bytes of a write transaction by the TWI registers, which are passed to the device
+
+typedef std::function<void(void)> SimAction;
+
+/*
+ * Interface of an I2C slave device on the simulated bus.
+ */
+class I2CDevice {
+   public:
+    virtual ~I2CDevice() {}
+    virtual void receive(const uint8_t *data, uint8_t length) = 0;  // Write transaction of the master
+    virtual uint8_t transmit(void) = 0;                              // Next byte of a read transaction
+};
+
+/*
+ * Interface of a device, which watches the pin writes of the sketch (e.g. the start signal of the DHT).
+ */
+class PinDevice {
+   public:
+    virtual ~PinDevice() {}
+    virtual void pinChanged(uint8_t pin) = 0;
+};
+
+/*
+ * Interface of an analog signal source.
+ */
+class AnalogSource {
+   public:
+    virtual ~AnalogSource() {}
+    virtual int analogValue(uint8_t pin) = 0;  // Raw 10 bit ADC value
+};
+
+struct I2CStatisticType {
+    unsigned long transactions;  // Write and read transactions (incl. address only transactions)
+    unsigned long bytes;         // Bytes on the bus (incl. address bytes)
+    unsigned long nacks;         // Transactions to a missing device
+};
+
+class Simulation {
+   public:
+    // Time and events
+    static uint64_t now(void);
+    static void advance(uint64_t us);
+    static void schedule(uint64_t time, SimAction action);
+    static void setTimeLimit(uint64_t limit);
+
+    // Pins
+    static void pinMode(uint8_t pin, uint8_t mode);
+    static void digitalWrite(uint8_t pin, uint8_t value);
+    static uint8_t digitalRead(uint8_t pin);
+    static void setInput(uint8_t pin, int8_t level);
+    static uint8_t getMode(uint8_t pin);
+    static uint8_t getOutput(uint8_t pin);
+    static void setPinDevice(uint8_t pin, PinDevice *device);
+    static void setAnalogSource(uint8_t pin, AnalogSource *source);
+    static int analogRead(uint8_t pin);
+
+    // Interrupts
+    static void setInterrupts(bool enabled);
+    static unsigned long getHandlerEnables(void);
+    static void attachInterrupt(uint8_t number, void (*handler)(void), int mode);
+    static void detachInterrupt(uint8_t number);
+    static void setPinChangeHook(void (*hook)(uint8_t port, uint8_t pins));
+    static void setAdcHook(void (*hook)(void));
+
+    // I2C bus
+    static void attachI2C(uint8_t address, I2CDevice *device);
+    static void setI2CClock(uint32_t frequency);
+    static void setI2CTimeout(uint32_t timeout);
+    static void setI2CHeld(bool held);
+    static bool isI2CHeld(void);
+    static bool i2cWrite(uint8_t address, const uint8_t *data, uint8_t length);
+    static uint8_t i2cRead(uint8_t address, uint8_t *data, uint8_t length);
+    static const I2CStatisticType &getI2CStatistic(uint8_t address);
+
+    // I/O registers (status register, ADC and TWI module)
+    static uint8_t readRegister(uint8_t address);
+    static void writeRegister(uint8_t address, uint8_t value);
+
+    // Serial
+    static void setSerialOutput(bool enabled);
+    static bool getSerialOutput(void);
+    static void setSerialCapture(FILE *file);
+    static void serialBegin(unsigned long baud);
+    static void serialWrite(uint8_t c);
+    static int serialAvailableForWrite(void);
+    static void serialFlush(void);
+    static void serialInput(const char *text);
+    static int serialAvailable(void);
+    static int serialRead(void);
+
+   private:
+    static void runEvents(uint64_t end);
+    static void deliverInterrupts(void);
+    static void updatePin(uint8_t pin, bool notify);
+    static void i2cTransfer(uint8_t address, uint8_t length);
+    static void adcControl(uint8_t value);
+    static void adcConvert(void);
+    static void twiControl(uint8_t value);
+    static void twiComplete(uint8_t status, uint32_t ns);
+    static void twiDeliver(void);
+};
+
+extern volatile uint8_t simPortInput[SIM_PORT_COUNT];
+
+/*
+ * Port number of a pin like on the ATmega328P (PD: 0..7, PB: 8..13, PC: A0..A5).
+ */
+inline uint8_t simPinToPort(uint8_t pin) {
+    return pin < 8 ? 4 : (pin < 14 ? 2 : 3);
+}
+
+/*
+ * Bit mask of a pin in its port.
+ */
+inline uint8_t simPinToMask(uint8_t pin) {
+    return 1 << (pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - 14));
+}
+
+#endif
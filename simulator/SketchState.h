@@ -0,0 +1,76 @@
+/*
+  SketchState.h - Processed sensor state of the sketch for the simulator and the replay.
+  Included after the sketch, as it reads the sketch's globals. The digest covers all
+  values derived from the raw sensor inputs, so a replay of a trace must reproduce it
+  bit for bit.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef SKETCHSTATE_H
+#define SKETCHSTATE_H
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Add bytes to a FNV-1a hash.
+ */
+inline void sketchStateHash(uint32_t &hash, const void *data, size_t length) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+}
+
+/*
+ * Digest of the processed sensor state (field by field, so padding bytes don't matter).
+ */
+inline uint32_t sketchStateDigest(void) {
+    uint32_t hash = 2166136261UL;
+    sketchStateHash(hash, &DCData.voltage, sizeof(DCData.voltage));
+    sketchStateHash(hash, &DCData.current, sizeof(DCData.current));
+    sketchStateHash(hash, &DCData.power, sizeof(DCData.power));
+    sketchStateHash(hash, &DCData.energy, sizeof(DCData.energy));
+    sketchStateHash(hash, &DCData.soc, sizeof(DCData.soc));
+    sketchStateHash(hash, DCData.energy24, sizeof(DCData.energy24));
+    const int32_t charge = batteryState.getCharge();
+    sketchStateHash(hash, &charge, sizeof(charge));
+    const MPUDataType &mpu = MPU_device.data;
+    const float mpuValues[] = {mpu.AcX, mpu.AcY, mpu.AcZ, mpu.GyX, mpu.GyY, mpu.GyZ, mpu.Temp, mpu.phiX, mpu.phiY};
+    sketchStateHash(hash, mpuValues, sizeof(mpuValues));
+    sketchStateHash(hash, &tiltFilterX, sizeof(tiltFilterX));
+    sketchStateHash(hash, &tiltFilterY, sizeof(tiltFilterY));
+    for (uint8_t i = 0; i < dhtManager.getCount(); i++) {
+        sketchStateHash(hash, &dhtSensors[i].temperature, sizeof(dhtSensors[i].temperature));
+        sketchStateHash(hash, &dhtSensors[i].humidity, sizeof(dhtSensors[i].humidity));
+    }
+    sketchStateHash(hash, dhtManager.getHistoryHours(), DHT_HISTORY_COUNT);
+    for (uint8_t i = 0; i < dhtManager.getCount(); i++) {
+        sketchStateHash(hash, dhtSensors[i].temperatureHistory, sizeof(dhtSensors[i].temperatureHistory));
+        sketchStateHash(hash, dhtSensors[i].humidityHistory, sizeof(dhtSensors[i].humidityHistory));
+    }
+    sketchStateHash(hash, &WaterData.fresh, sizeof(WaterData.fresh));
+    sketchStateHash(hash, &WaterData.grey, sizeof(WaterData.grey));
+    return hash;
+}
+
+/*
+ * Print the CSV header of sketchStatePrint().
+ */
+inline void sketchStateHeader(FILE *file) {
+    fprintf(file, "time_ms,record,voltage_mV,current_mA,power_mW,energy_mAs,soc,phiX,phiY,temperature,humidity,fresh,grey\n");
+}
+
+/*
+ * Print the processed sensor state as a CSV line. DC values in mV, mA, mW and mAs, floats with 9 digits, so they are exact.
+ * @param time Time of the record in ms
+ * @param record Type of the record
+ */
+inline void sketchStatePrint(FILE *file, unsigned long time, uint8_t record) {
+    fprintf(file, "%lu,%u,%ld,%ld,%ld,%ld,%d,%.9g,%.9g,%.9g,%.9g,%d,%d\n", time, record, (long)DCData.voltage, (long)DCData.current,
+            (long)DCData.power, (long)DCData.energy, DCData.soc, MPU_device.data.phiX, MPU_device.data.phiY,
+            dhtSensors[DHT_INSIDE].temperature, dhtSensors[DHT_INSIDE].humidity, WaterData.fresh, WaterData.grey);
+}
+
+#endif
@@ -0,0 +1,220 @@
+/*
+  battery.cpp - Check of the coulomb counting state of charge (BatteryState) with synthetic
+  charge and discharge profiles on the host.
+  Every profile is a battery current over time. A battery model (charge efficiency, open circuit
+  voltage over the state of charge, internal resistance) follows it in double; the estimator
+  gets the measured current (noise, offset error of the sensor, 1/16 LSB steps of the ADC
+  means) and the voltage at the sensor period of the sketch and is anchored like by the sketch.
+  Its error to the true state of charge must stay within the limit of the profile. The former
+  estimate (state of charge of the voltage at currents up to 1 A, rounded to 5 %) is compared.
+
+  Usage: camper_battery [-v]
+    -v  Print the samples of every profile as CSV (time, current, voltage, true, estimate, former)
+
+  Licensed under "MIT" License.
+*/
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+
+#include "BatteryState.h"
+
+#define BATTERY_PERIOD 500        // Time between two samples in ms (SENSOR_PERIOD of the sketch)
+#define BATTERY_CAPACITY 100      // Capacity in Ah
+#define BATTERY_EFFICIENCY 95     // Charge efficiency of the estimator in %
+#define BATTERY_REST_CURRENT 1000 // Maximum current at rest in mA
+#define BATTERY_REST_TIME 900     // Time at rest in s
+#define BATTERY_RESISTANCE 0.015  // Internal resistance in Ohm
+#define BATTERY_CURRENT_LSB (5000.0 / 16384.0 / 66.2)  // Current step of the ADC means in A
+
+// Open circuit voltage of the battery over the state of charge (0 %, 10 % ... 100 %)
+static const double ocvMap[] = {11.36, 11.51, 11.66, 11.81, 11.96, 12.10, 12.24, 12.37, 12.50, 12.62, 12.73};
+
+struct BatteryProfile {
+    const char *name;
+    double hours;                // Length of the profile
+    double startSOC;             // True state of charge at the start (0 ... 1)
+    double efficiency;           // True charge efficiency
+    double offset;               // Offset error of the current sensor in A
+    double (*current)(double t); // True current in A at t in s (positive: discharge)
+    double settle;               // Time in h, after which the errors count (the start was anchored at rest)
+    double maxError;             // Limit of the error in %
+};
+
+struct BatteryResult {
+    double maxError;     // After the settle time
+    double finalError;
+    double formerError;  // Maximum error of the former estimate
+    unsigned anchors;
+};
+
+/*
+ * Loads of the van (fridge 4.5 A at 40 % duty cycle, electronics, lights, water pump), charged by
+ * the solar panel over the day. Starts at midnight.
+ */
+static double vanDay(double t) {
+    double hour = fmod(t / 3600.0, 24.0);
+    double current = 0.4;
+    if (fmod(hour * 60.0, 30.0) < 12.0) {
+        current += 4.5;
+    }
+    if (hour >= 19.0 && hour < 23.0) {
+        current += 1.5;
+    }
+    if ((hour >= 7.33 && hour < 7.42) || (hour >= 19.5 && hour < 19.58)) {
+        current += 5.0;
+    }
+    if (hour >= 6.0 && hour < 20.0) {
+        current -= 9.0 * pow(sin((hour - 6.0) / 14.0 * M_PI), 1.5);
+    }
+    return current;
+}
+
+/*
+ * Parked van with everything off at night (rests of hours), the fridge runs over the day.
+ */
+static double parked(double t) {
+    double hour = fmod(t / 3600.0, 24.0);
+    if (hour < 7.0 || hour >= 22.0) {
+        return 0.05;
+    }
+    return vanDay(t);
+}
+
+/*
+ * Constant discharge of 10 A after one minute at rest.
+ */
+static double discharge(double t) {
+    return t < 60.0 ? 0.0 : 10.0;
+}
+
+/*
+ * One hour at rest, charger with 20 A for 2 h, discharge with 8 A for 3 h, again and again.
+ */
+static double cycles(double t) {
+    double phase = fmod(t / 3600.0, 6.0);
+    if (phase < 1.0) {
+        return 0.0;
+    }
+    if (phase < 3.0) {
+        return -20.0;
+    }
+    return 8.0;
+}
+
+static const BatteryProfile profiles[] = {
+    {"discharge", 7, 1.0, 0.95, 0.0, discharge, 0.0, 1.0},
+    {"cycles", 48, 0.3, 0.95, 0.0, cycles, 0.0, 1.5},
+    {"van day", 72, 0.75, 0.95, 0.0, vanDay, 0.5, 2.0},
+    {"offset", 72, 0.75, 0.95, 0.15, parked, 0.5, 3.0},
+    {"efficiency", 72, 0.75, 0.90, 0.0, parked, 0.5, 3.0},
+};
+
+/*
+ * Open circuit voltage of a state of charge.
+ * @param soc State of charge (0 ... 1)
+ */
+static double ocv(double soc) {
+    double position = fmin(fmax(soc, 0.0), 1.0) * 10.0;
+    int index = fmin(position, 9.0);
+    return ocvMap[index] + (ocvMap[index + 1] - ocvMap[index]) * (position - index);
+}
+
+/*
+ * State of charge of an open circuit voltage (inverse of ocv()).
+ * @return State of charge in % (0 ... 100)
+ */
+static double ocvSOC(double voltage) {
+    if (voltage <= ocvMap[0]) {
+        return 0.0;
+    }
+    for (int i = 0; i < 10; i++) {
+        if (voltage < ocvMap[i + 1]) {
+            return (i + (voltage - ocvMap[i]) / (ocvMap[i + 1] - ocvMap[i])) * 10.0;
+        }
+    }
+    return 100.0;
+}
+
+/*
+ * Run a profile through the battery model and the estimator.
+ */
+static void runProfile(const BatteryProfile &profile, bool verbose, BatteryResult &result) {
+    std::mt19937 random(1);
+    std::normal_distribution<double> currentNoise(0.0, 0.03);
+    std::normal_distribution<double> voltageNoise(0.0, 0.003);
+    BatteryState state(BATTERY_CAPACITY, BATTERY_EFFICIENCY, BATTERY_REST_CURRENT, BATTERY_REST_TIME);
+    double charge = profile.startSOC * BATTERY_CAPACITY;  // true charge in Ah
+    double voltage = 0, current = 0;  // EMA like the sketch
+    int former = 0;
+    result.maxError = 0;
+    result.formerError = 0;
+
+    long samples = profile.hours * 3600000.0 / BATTERY_PERIOD;
+    for (long n = 0; n < samples; n++) {
+        double t = n * BATTERY_PERIOD / 1000.0;
+        double trueCurrent = profile.current(t);
+        if (trueCurrent < 0 && charge >= BATTERY_CAPACITY) {
+            trueCurrent = 0;  // charge controller stops at a full battery
+        }
+        double ah = trueCurrent * BATTERY_PERIOD / 3.6e6;
+        charge = fmin(fmax(charge - (trueCurrent < 0 ? ah * profile.efficiency : ah), 0.0), BATTERY_CAPACITY);
+        double trueSOC = charge / BATTERY_CAPACITY * 100.0;
+
+        double measured = round((trueCurrent + profile.offset + currentNoise(random)) / BATTERY_CURRENT_LSB) * BATTERY_CURRENT_LSB;
+        double terminal = ocv(charge / BATTERY_CAPACITY) - trueCurrent * BATTERY_RESISTANCE + voltageNoise(random);
+        voltage = n == 0 ? terminal : 0.3 * terminal + 0.7 * voltage;
+        current = n == 0 ? measured : 0.3 * measured + 0.7 * current;
+
+        state.update(lround(measured * 1000.0), BATTERY_PERIOD);
+        if (state.isResting()) {
+            state.anchor(ocvSOC(voltage) * 10.0 + 0.5);
+        }
+        if (current <= 1.0) {
+            former = ((int)(ocvSOC(voltage) + 2.5) / 5) * 5;
+        }
+
+        double error = fabs(state.getSOC() / 10.0 - trueSOC);
+        if (t >= profile.settle * 3600.0) {
+            result.maxError = fmax(result.maxError, error);
+            result.formerError = fmax(result.formerError, fabs(former - trueSOC));
+        }
+        result.finalError = error;
+        if (verbose && n % 120 == 0) {
+            printf("%s,%.0f,%.3f,%.3f,%.2f,%.1f,%d\n", profile.name, t, measured, voltage, trueSOC, state.getSOC() / 10.0, former);
+        }
+    }
+    result.anchors = state.getAnchors();
+}
+
+int main(int argc, char **argv) {
+    bool verbose = false;
+    int option;
+    while ((option = getopt(argc, argv, "v")) != -1) {
+        if (option == 'v') {
+            verbose = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    bool passed = true;
+    printf("Errors of the state of charge in %% (after the settle time):\n");
+    printf("%-12s %6s %8s %8s %8s %8s %8s\n", "Profile", "Hours", "Max", "Limit", "Final", "Rests", "Former");
+    for (const BatteryProfile &profile : profiles) {
+        BatteryResult result;
+        runProfile(profile, verbose, result);
+        bool ok = result.maxError < profile.maxError;
+        printf("%-12s %6.0f %8.2f %8.1f %8.2f %8u %8.1f%s\n", profile.name, profile.hours, result.maxError, profile.maxError,
+               result.finalError, result.anchors, result.formerError, ok ? "" : "  FAILED");
+        passed = passed && ok;
+    }
+    if (!passed) {
+        printf("State of charge exceeds the limits\n");
+        return 1;
+    }
+    printf("State of charge within the limits\n");
+    return 0;
+}
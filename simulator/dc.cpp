@@ -0,0 +1,174 @@
+/*
+  dc.cpp - Check and speed of the fixed-point DC processing of the sketch (DC_process) on the host.
+  Every raw value of the ADC means (0 ... 16383 in 1/16 LSB) of both pins is converted by
+  DC_process and by the former float formulas; voltage and current must be within 1 mV and
+  1 mA, the power within 1 mW beyond the rounding of both (V * 1 mA + I * 1 mV). Synthetic
+  sequences (noise, steps, a charge and discharge cycle) are filtered by DC_process and by the
+  EMA in double with the same weight (5/16). The energy of an hour (24 hours of a cycle) is
+  compared with the exact sum of the currents and with the former float accumulation in Ah.
+
+  Usage: camper_dc
+
+  Licensed under "MIT" License.
+*/
+
+// The sketch with generated prototypes (like the Arduino builder), to call DC_process.
+#include "sketch.cpp"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#define DC_CHECK_RUNS 2000000
+#define DC_CHECK_HOUR 7200  // Sensor periods of an hour
+
+// Former float conversions of DC_process in V and A
+static double formerVoltage(uint16_t raw) {
+    return raw * 5.0 / 16384.0 / 0.2;
+}
+
+static double formerCurrent(uint16_t raw) {
+    return -((raw * 5000.0 / 16384.0 - 2500.0) / 66.2);
+}
+
+/*
+ * Convert every raw value by a new DC struct (the first reading seeds the filters).
+ * @return true, if all values are within the limits
+ */
+static bool checkConversion(void) {
+    double voltageError = 0, currentError = 0, powerError = 0;
+    for (uint32_t raw = 0; raw < 16384; raw++) {
+        DCDataType data = {0, 0, 0, 0, 0};
+        DC_process(data, DCRawType{(uint16_t)raw, (uint16_t)(16383 - raw)}, SENSOR_PERIOD);
+        double voltage = formerVoltage(raw) * 1000.0;
+        double current = formerCurrent(16383 - raw) * 1000.0;
+        voltageError = fmax(voltageError, fabs(data.voltage - voltage));
+        currentError = fmax(currentError, fabs(data.current - current));
+        powerError = fmax(powerError, fabs(data.power - voltage * current / 1000.0) - (fabs(voltage) + fabs(current)) / 1000.0);
+    }
+    bool ok = voltageError <= 1.0 && currentError <= 1.0 && powerError <= 1.0;
+    printf("%-12s %10.3f %10.3f %10.3f%s\n", "conversion", voltageError, currentError, powerError, ok ? "" : "  FAILED");
+    return ok;
+}
+
+/*
+ * Filter a sequence of raw values by DC_process and by the EMA in double.
+ * @param name Name of the sequence
+ * @param sequence Raw values of period i
+ * @return true, if the filtered values are within the limits
+ */
+template <typename Sequence>
+static bool checkFilter(const char *name, Sequence sequence) {
+    DCDataType data = {0, 0, 0, 0, 0};
+    double voltage = 0, current = 0;
+    double voltageError = 0, currentError = 0, powerError = 0;
+    for (long i = 0; i < DC_CHECK_HOUR; i++) {
+        DCRawType raw = sequence(i);
+        DC_process(data, raw, SENSOR_PERIOD);
+        double voltageRaw = formerVoltage(raw.voltage) * 1000.0;
+        double currentRaw = formerCurrent(raw.current) * 1000.0;
+        if (i == 0) {
+            voltage = voltageRaw;
+            current = currentRaw;
+        }
+        voltage += (voltageRaw - voltage) * DC_EMA_WEIGHT / (1 << DC_EMA_SHIFT);
+        current += (currentRaw - current) * DC_EMA_WEIGHT / (1 << DC_EMA_SHIFT);
+        voltageError = fmax(voltageError, fabs(data.voltage - voltage));
+        currentError = fmax(currentError, fabs(data.current - current));
+        powerError = fmax(powerError, fabs(data.power - voltage * current / 1000.0) - (fabs(voltage) + fabs(current)) / 1000.0);
+    }
+    bool ok = voltageError <= 1.0 && currentError <= 1.0 && powerError <= 1.0;
+    printf("%-12s %10.3f %10.3f %10.3f%s\n", name, voltageError, currentError, powerError, ok ? "" : "  FAILED");
+    return ok;
+}
+
+/*
+ * Count the energy of 24 hours of a charge and discharge cycle (an hour per window, like the
+ * sketch) and compare it with the exact sum of the currents and the former float accumulation.
+ * @return true, if the energy of every hour is within 1 mAh
+ */
+static bool checkEnergy(void) {
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0.0, 8.0);
+    DCDataType data = {0, 0, 0, 0, 0};
+    double maxError = 0, maxFormerError = 0;
+    for (int hour = 0; hour < 24; hour++) {
+        batteryState.resetCounters();
+        double exact = 0;  // mAs
+        float former = 0;  // Ah, the former accumulation
+        for (long i = 0; i < DC_CHECK_HOUR; i++) {
+            double t = (hour * DC_CHECK_HOUR + i) / (24.0 * DC_CHECK_HOUR);
+            double amps = 12.0 * sin(2.0 * M_PI * t) + 3.0 * sin(2.0 * M_PI * 37.0 * t);  // Charge by day, load at night
+            uint16_t rawCurrent = lround((2500.0 - amps * 66.2) * 16384.0 / 5000.0 + noise(random));
+            DC_process(data, DCRawType{8100, rawCurrent}, SENSOR_PERIOD);
+            double currentRaw = formerCurrent(rawCurrent);
+            exact += currentRaw * SENSOR_PERIOD;
+            former = former + (float)(currentRaw * SENSOR_PERIOD / 1000.0 / 60.0 / 60.0);
+        }
+        // The counters take the charge efficiency only for the state of charge, not for the energy
+        maxError = fmax(maxError, fabs(data.energy - exact) / 3600.0);
+        maxFormerError = fmax(maxFormerError, fabs(former * 3600000.0 - exact) / 3600.0);
+    }
+    bool ok = maxError <= 1.0;
+    printf("Energy of an hour: error %.3f mAh (former float accumulation %.3f mAh)%s\n", maxError, maxFormerError, ok ? "" : "  FAILED");
+    return ok;
+}
+
+/*
+ * Host time of the conversion and filter of a reading, fixed-point and former float.
+ */
+static void benchmark(void) {
+    volatile uint16_t rawVoltage = 8100, rawCurrent = 7850;
+    DCDataType data = {0, 0, 0, 0, 0};
+    volatile int32_t sinkFixed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < DC_CHECK_RUNS; i++) {
+        int32_t voltageRaw = fixedScale(rawVoltage + (i & 15), DC_VOLTAGE_FACTOR, 16 - FIXED_FRACTION);
+        int32_t currentRaw = fixedScale(DC_CURRENT_ZERO - (int32_t)rawCurrent - (i & 15), DC_CURRENT_FACTOR, 15 - FIXED_FRACTION);
+        data.voltageAverage = fixedEma(data.voltageAverage, voltageRaw, DC_EMA_WEIGHT, DC_EMA_SHIFT);
+        data.currentAverage = fixedEma(data.currentAverage, currentRaw, DC_EMA_WEIGHT, DC_EMA_SHIFT);
+        sinkFixed = fixedRound(data.voltageAverage, FIXED_FRACTION) * fixedRound(data.currentAverage, FIXED_FRACTION) / 1000;
+    }
+    std::chrono::duration<double, std::nano> fixedTime = std::chrono::steady_clock::now() - start;
+
+    float voltage = 0, current = 0;
+    volatile float sinkFloat = 0;
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < DC_CHECK_RUNS; i++) {
+        float voltageRaw = (rawVoltage + (i & 15)) * 5.0 / 16384.0 / 0.2;
+        float currentRaw = -(((rawCurrent + (i & 15)) * 5000.0 / 16384.0 - 2500.0) / 66.2);
+        current = 0.3 * currentRaw + 0.7 * current;
+        voltage = 0.3 * voltageRaw + 0.7 * voltage;
+        sinkFloat = voltage * current;
+    }
+    std::chrono::duration<double, std::nano> floatTime = std::chrono::steady_clock::now() - start;
+    printf("Host time per reading: fixed %.1f ns, former float %.1f ns (board cycles: DC_BENCHMARK)\n",
+           fixedTime.count() / DC_CHECK_RUNS, floatTime.count() / DC_CHECK_RUNS);
+}
+
+int main(int argc, char **argv) {
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0.0, 20.0);
+    bool passed = true;
+    printf("Maximum errors to the float conversion and EMA (power beyond the rounding of mV and mA):\n");
+    printf("%-12s %10s %10s %10s\n", "Sequence", "mV", "mA", "mW");
+    passed = checkConversion() && passed;
+    passed = checkFilter("noise", [&](long i) {
+                 return DCRawType{(uint16_t)lround(8100 + noise(random)), (uint16_t)lround(7850 + noise(random))};
+             }) && passed;
+    passed = checkFilter("steps", [](long i) {
+                 return DCRawType{(uint16_t)(i / 40 % 2 ? 8300 : 7900), (uint16_t)(i / 40 % 3 == 0 ? 5200 : (i / 40 % 3 == 1 ? 8192 : 11100))};
+             }) && passed;
+    passed = checkFilter("cycle", [](long i) {
+                 double phase = 2.0 * M_PI * i / DC_CHECK_HOUR;
+                 return DCRawType{(uint16_t)lround(8150 + 300 * sin(phase)), (uint16_t)lround(8192 + 4000 * sin(phase))};
+             }) && passed;
+    passed = checkEnergy() && passed;
+    benchmark();
+    if (!passed) {
+        printf("DC processing failed\n");
+        return 1;
+    }
+    printf("DC processing within the limits of the float conversion\n");
+    return 0;
+}
@@ -0,0 +1,235 @@
+/*
+  dht.cpp - Check of the DHT drivers on the host.
+  Decoding: random data bytes of DHT11, DHT21 and DHT22 transmissions (valid measurements and
+  random bytes) are decoded by the template DHT_static and by DHT_nonblocking, the results
+  must be the same.
+
+  Edge decoder (interrupt mode): synthesizes the edges of DHT11 and DHT22 transmissions, as the
+  pin change interrupt sees them: every edge is late by the latency of the interrupt (random up
+  to a limit) and timed by micros() in steps of 4 us. They are fed to decode_edge() of both
+  drivers and the decoded bytes are compared with the sent ones. Faulty streams (a lost pair of
+  edges, a stalled sensor, a flipped bit) must never end as a valid measurement.
+
+  Usage: camper_dht [-n transmissions]
+    -n  Number of random data bytes per type and transmissions per case (default 2000)
+
+  Licensed under "MIT" License.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#include "dht_nonblocking.h"
+#include "dht_static.h"
+
+#define DHT_MAX_LATENCY 8  // Latency of the pin change interrupt, which must be tolerated (in us)
+
+struct DHTEdge {
+    bool level;     // Level after the edge
+    uint32_t time;  // Time of the edge in us
+};
+
+enum DHT_FAULT {
+    DHT_FAULT_NONE,
+    DHT_FAULT_LOST_PAIR,  // Two edges within one interrupt (the level doesn't change)
+    DHT_FAULT_STALLED,    // The sensor stops in the middle of a transmission
+    DHT_FAULT_LONG_PULSE, // A pulse longer than DHT_EDGE_TIMEOUT
+    DHT_FAULT_FLIPPED     // A bit with the high pulse of the other value
+};
+
+struct DHTCase {
+    const char *name;
+    uint8_t type;
+    uint8_t fault;
+    uint8_t latency;  // Maximum latency of the edges in us
+    bool valid;       // The transmission must be decoded to the sent bytes
+};
+
+static const DHTCase cases[] = {
+    {"DHT11", DHT_TYPE_11, DHT_FAULT_NONE, 0, true},
+    {"DHT11 latency", DHT_TYPE_11, DHT_FAULT_NONE, DHT_MAX_LATENCY, true},
+    {"DHT22 latency", DHT_TYPE_22, DHT_FAULT_NONE, DHT_MAX_LATENCY, true},
+    {"lost edge pair", DHT_TYPE_22, DHT_FAULT_LOST_PAIR, DHT_MAX_LATENCY, false},
+    {"stalled sensor", DHT_TYPE_22, DHT_FAULT_STALLED, DHT_MAX_LATENCY, false},
+    {"long pulse", DHT_TYPE_22, DHT_FAULT_LONG_PULSE, DHT_MAX_LATENCY, false},
+    {"flipped bit", DHT_TYPE_22, DHT_FAULT_FLIPPED, DHT_MAX_LATENCY, false},
+};
+
+/*
+ * Edges of a transmission like the DHTModel of the simulator: release of the line, 80 us low,
+ * 80 us high, 40 bits (50 us low, 26 us high for a 0 / 70 us high for a 1), 50 us low.
+ */
+static std::vector<DHTEdge> transmission(const uint8_t *data, uint8_t fault, std::mt19937 &random) {
+    std::vector<DHTEdge> edges;
+    uint8_t faultBit = random() % 40;
+    uint32_t time = 1000;
+    edges.push_back({true, time});  // release of the line by the start signal
+    time += 30;
+    edges.push_back({false, time});
+    time += 80;
+    edges.push_back({true, time});
+    time += 80;
+    for (uint8_t i = 0; i < 40; i++) {
+        bool one = data[i / 8] & (0x80 >> (i % 8));
+        if (fault == DHT_FAULT_FLIPPED && i == faultBit) {
+            one = !one;
+        }
+        edges.push_back({false, time});
+        time += fault == DHT_FAULT_LONG_PULSE && i == faultBit ? 300 : 50;
+        edges.push_back({true, time});
+        time += one ? 70 : 26;
+    }
+    edges.push_back({false, time});
+    time += 50;
+    edges.push_back({true, time});
+
+    size_t faultEdge = 4 + 2 * faultBit;
+    if (fault == DHT_FAULT_LOST_PAIR) {
+        edges.erase(edges.begin() + faultEdge, edges.begin() + faultEdge + 2);
+    } else if (fault == DHT_FAULT_STALLED) {
+        edges.resize(faultEdge);
+    }
+    return edges;
+}
+
+/*
+ * Data bytes of a random measurement of the sensor type (DHT21 like DHT22).
+ */
+static void measurement(uint8_t type, std::mt19937 &random, uint8_t *data) {
+    if (type == DHT_TYPE_11) {
+        data[0] = 20 + random() % 71;
+        data[1] = 0;
+        data[2] = random() % 51;
+        data[3] = 0;
+    } else {
+        uint16_t humidity = random() % 1001;
+        int16_t temperature = (int16_t)(random() % 1201) - 400;
+        uint16_t raw = temperature < 0 ? (0x8000 | -temperature) : temperature;
+        data[0] = humidity >> 8;
+        data[1] = humidity & 0xFF;
+        data[2] = raw >> 8;
+        data[3] = raw & 0xFF;
+    }
+    data[4] = data[0] + data[1] + data[2] + data[3];
+}
+
+/*
+ * Decode random data bytes by both drivers.
+ * @return Number of data bytes with different results
+ */
+template <uint8_t TYPE>
+static long checkDecode(long count, long *validCount) {
+    std::mt19937 random(1);
+    DHT_nonblocking reference(7, TYPE);
+    DHT_static<7, TYPE> sensor;
+    long mismatches = 0;
+    *validCount = 0;
+    for (long n = 0; n < count; n++) {
+        uint8_t raw[5];
+        if (n % 2 == 0) {
+            measurement(TYPE, random, raw);
+        } else {
+            for (uint8_t i = 0; i < 5; i++) {
+                raw[i] = random();
+            }
+        }
+        float temperature[2], humidity[2];
+        bool valid[2];
+        valid[0] = reference.decode(raw, &temperature[0], &humidity[0]);
+        valid[1] = sensor.decode(raw, &temperature[1], &humidity[1]);
+        if (valid[0] != valid[1] ||
+            (valid[0] && (memcmp(&temperature[0], &temperature[1], sizeof(float)) != 0 ||
+                          memcmp(&humidity[0], &humidity[1], sizeof(float)) != 0))) {
+            mismatches++;
+        }
+        *validCount += valid[1];
+    }
+    return mismatches;
+}
+
+/*
+ * Feed the transmissions of a case to the edge decoder of a driver.
+ * @param results Counts of the edge states (DHT_EDGE_PENDING, DHT_EDGE_DONE, DHT_EDGE_FAILED)
+ * @return Number of transmissions with a wrong result
+ */
+template <class Sensor>
+static long checkEdges(Sensor &sensor, const DHTCase &check, long count, long results[3]) {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> latency(0, check.latency);
+    long wrong = 0;
+    results[0] = results[1] = results[2] = 0;
+    for (long n = 0; n < count; n++) {
+        uint8_t sent[5];
+        measurement(check.type, random, sent);
+        sensor.begin_edges();
+        for (const DHTEdge &edge : transmission(sent, check.fault, random)) {
+            uint32_t time = (edge.time + latency(random)) & ~3UL;  // micros() counts in steps of 4 us
+            sensor.decode_edge(edge.level, time);
+        }
+        uint8_t status = sensor.edge_status();
+        uint8_t received[5];
+        memcpy(received, sensor.get_data(), 5);
+        float temperature, humidity;
+        bool valid = status == DHT_EDGE_DONE && sensor.decode(received, &temperature, &humidity);
+        results[status]++;
+        if (valid != check.valid || (valid && memcmp(received, sent, 5) != 0)) {
+            wrong++;
+        }
+    }
+    return wrong;
+}
+
+int main(int argc, char **argv) {
+    long count = 2000;
+    int option;
+    while ((option = getopt(argc, argv, "n:")) != -1) {
+        if (option == 'n') {
+            count = atol(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-n transmissions]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    bool passed = true;
+    printf("Decoding of DHT_static against DHT_nonblocking:\n");
+    printf("%-16s %12s %8s %8s\n", "Type", "Data bytes", "Valid", "Differ");
+    const char *typeNames[] = {"DHT11", "DHT21", "DHT22"};
+    long mismatches[3], validCounts[3];
+    mismatches[DHT_TYPE_11] = checkDecode<DHT_TYPE_11>(count, &validCounts[DHT_TYPE_11]);
+    mismatches[DHT_TYPE_21] = checkDecode<DHT_TYPE_21>(count, &validCounts[DHT_TYPE_21]);
+    mismatches[DHT_TYPE_22] = checkDecode<DHT_TYPE_22>(count, &validCounts[DHT_TYPE_22]);
+    for (uint8_t type = 0; type < 3; type++) {
+        printf("%-16s %12ld %8ld %8ld%s\n", typeNames[type], count, validCounts[type], mismatches[type],
+               mismatches[type] == 0 ? "" : "  FAILED");
+        passed = passed && mismatches[type] == 0;
+    }
+
+    printf("\nEdge decoder (DHT_nonblocking / DHT_static):\n");
+    printf("%-16s %12s %8s %8s %8s\n", "Case", "Transmission", "Decoded", "Pending", "Failed");
+    for (const DHTCase &check : cases) {
+        DHT_nonblocking reference(7, check.type);
+        long results[3], staticResults[3];
+        long wrong = checkEdges(reference, check, count, results);
+        if (check.type == DHT_TYPE_11) {
+            DHT_static<7, DHT_TYPE_11, true> sensor;
+            wrong += checkEdges(sensor, check, count, staticResults);
+        } else {
+            DHT_static<7, DHT_TYPE_22, true> sensor;
+            wrong += checkEdges(sensor, check, count, staticResults);
+        }
+        bool same = memcmp(results, staticResults, sizeof(results)) == 0;
+        printf("%-16s %12ld %8ld %8ld %8ld%s\n", check.name, count, results[DHT_EDGE_DONE], results[DHT_EDGE_PENDING],
+               results[DHT_EDGE_FAILED], wrong == 0 && same ? "" : "  FAILED");
+        passed = passed && wrong == 0 && same;
+    }
+    if (!passed) {
+        printf("DHT drivers failed\n");
+        return 1;
+    }
+    printf("DHT drivers passed (edges with a latency up to %d us)\n", DHT_MAX_LATENCY);
+    return 0;
+}
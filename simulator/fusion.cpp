@@ -0,0 +1,202 @@
+/*
+  fusion.cpp - Check of the tilt fusion (TiltFilter) with synthetic disturbance traces on the host.
+  Every trace is a tilt of the van over time with disturbances of the accelerometer (people
+  walking, wind gusts, leveling on wedges) and a gyroscope with offset and noise, sampled at
+  the sensor period of the sketch. Both filter modes and the former display value (mean of the
+  last 10 accelerometer angles) are compared with the true tilt.
+
+  The gyroscope rate of a sample is either the mean of the sensor period (MPU_FIFO) or the
+  rate at the time of the sample (one reading per sensor period, DLPF 5 Hz).
+
+  Usage: camper_fusion [-v]
+    -v  Print the samples of every trace as CSV (time, true, accelerometer, complementary, Kalman, mean)
+
+  Licensed under "MIT" License.
+*/
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#include "TiltFilter.h"
+
+#define FUSION_PERIOD 500       // Time between two samples in ms (SENSOR_PERIOD of the sketch)
+#define FUSION_MEAN_COUNT 10    // Samples of the former mean (MPU_HISTORY_COUNT)
+#define FUSION_SETTLE 30        // Time in s, after which the errors count (the filters settled)
+
+struct FusionTrace {
+    const char *name;
+    double seconds;             // Length of the trace
+    double offset;              // Offset of the gyroscope in deg/s
+    double (*angle)(double t);  // True tilt in deg
+    double (*disturbance)(double t, std::mt19937 &random);  // Error of the accelerometer angle in deg
+    double maxError;            // Limit of the error of the fused angles in deg
+    bool calmer;                // The fused angles must have a smaller rms error than the mean
+};
+
+struct FusionResult {
+    double maxError;
+    double rmsError;
+};
+
+static std::normal_distribution<double> noise(0.0, 1.0);
+
+// Parked at 1.5 deg, two people walking in the van for one minute every three minutes:
+// the van rocks by 0.2 deg at 0.7 Hz, the steps shake the accelerometer by up to 2 deg.
+static double walkingAngle(double t) {
+    bool walking = fmod(t, 180) >= 60 && fmod(t, 180) < 120;
+    return 1.5 + (walking ? 0.2 * sin(2 * M_PI * 0.7 * t) : 0);
+}
+static double walkingDisturbance(double t, std::mt19937 &random) {
+    bool walking = fmod(t, 180) >= 60 && fmod(t, 180) < 120;
+    return walking ? std::uniform_real_distribution<double>(-2, 2)(random) : 0;
+}
+
+// Parked at -0.7 deg with wind: gusts of 3 s every 20 s rock the van by 0.5 deg at 0.8 Hz,
+// the lateral acceleration adds 1 deg to the accelerometer angle.
+static double windAngle(double t) {
+    double gust = fmod(t, 20);
+    return -0.7 + (gust < 3 ? 0.5 * sin(M_PI * gust / 3) * sin(2 * M_PI * 0.8 * t) : 0);
+}
+static double windDisturbance(double t, std::mt19937 &random) {
+    double gust = fmod(t, 20);
+    return gust < 3 ? 1.0 * sin(M_PI * gust / 3) * sin(2 * M_PI * 0.8 * t + 0.5) : 0;
+}
+
+// Leveling: the van is driven on wedges every 2 minutes (3 deg in 4 s, back after a minute),
+// jolts of 1 deg while driving.
+static double levelingAngle(double t) {
+    double phase = fmod(t, 120);
+    if (phase < 60) {
+        return 0;
+    }
+    if (phase < 64) {
+        return 3 * (phase - 60) / 4;
+    }
+    if (phase < 116) {
+        return 3;
+    }
+    return 3 * (120 - phase) / 4;
+}
+static double levelingDisturbance(double t, std::mt19937 &random) {
+    double phase = fmod(t, 120);
+    bool driving = (phase >= 60 && phase < 64) || phase >= 116;
+    return driving ? std::uniform_real_distribution<double>(-1, 1)(random) : 0;
+}
+
+// Quiet night with a large offset of the gyroscope (the MPU6050 allows +-20 deg/s).
+static double quietAngle(double t) {
+    return 2.0;
+}
+static double quietDisturbance(double t, std::mt19937 &random) {
+    return 0;
+}
+
+static const FusionTrace traces[] = {
+    {"walking", 900, 1.5, walkingAngle, walkingDisturbance, 1.2, true},
+    {"wind", 600, -0.8, windAngle, windDisturbance, 1.0, false},  // real rocking: the gyroscope follows it
+    {"leveling", 600, 0.5, levelingAngle, levelingDisturbance, 0.7, true},
+    {"offset", 600, 8.0, quietAngle, quietDisturbance, 0.3, false},  // only noise: the mean is best
+};
+
+/*
+ * Convert an angle or rate to 0.01 units, rounded.
+ */
+static int16_t centi(double value) {
+    return (int16_t)lround(value * 100);
+}
+
+/*
+ * Run one trace through both filter modes and the former mean.
+ * @param results Results of complementary, Kalman and mean
+ * @param meanRate true: gyroscope rate of a sample is the mean of the period (FIFO)
+ */
+static void runTrace(const FusionTrace &trace, bool meanRate, bool verbose, FusionResult results[3]) {
+    std::mt19937 random(1);
+    TiltFilter complementary(TILT_FILTER_COMPLEMENTARY);
+    TiltFilter kalman(TILT_FILTER_KALMAN);
+    std::vector<int16_t> history;
+    double sumSquares[3] = {0, 0, 0};
+    long count = 0;
+    const double dt = FUSION_PERIOD / 1000.0;
+    for (int i = 0; i < 3; i++) {
+        results[i].maxError = 0;
+    }
+
+    for (double t = dt; t <= trace.seconds; t += dt) {
+        double angle = trace.angle(t);
+        double rate = meanRate ? (angle - trace.angle(t - dt)) / dt : (trace.angle(t + 1e-3) - trace.angle(t - 1e-3)) / 2e-3;
+        int16_t gyro = centi(rate + trace.offset + 0.05 * noise(random));  // noise of the gyroscope: 0.05 deg/s
+        int16_t accel = centi(angle + trace.disturbance(t, random) + 0.14 * noise(random));  // noise: 40 LSB
+
+        double fused[3];
+        fused[0] = complementary.update(accel, gyro, FUSION_PERIOD) / 100.0;
+        fused[1] = kalman.update(accel, gyro, FUSION_PERIOD) / 100.0;
+        history.push_back(accel);
+        if (history.size() > FUSION_MEAN_COUNT) {
+            history.erase(history.begin());
+        }
+        long sum = 0;
+        for (int16_t value : history) {
+            sum += value;
+        }
+        fused[2] = sum / 100.0 / history.size();
+
+        if (verbose) {
+            printf("%.1f,%.2f,%.2f,%.2f,%.2f,%.2f\n", t, angle, accel / 100.0, fused[0], fused[1], fused[2]);
+        }
+        if (t < FUSION_SETTLE) {
+            continue;
+        }
+        for (int i = 0; i < 3; i++) {
+            double error = fabs(fused[i] - angle);
+            results[i].maxError = fmax(results[i].maxError, error);
+            sumSquares[i] += error * error;
+        }
+        count++;
+    }
+    for (int i = 0; i < 3; i++) {
+        results[i].rmsError = sqrt(sumSquares[i] / count);
+    }
+}
+
+int main(int argc, char **argv) {
+    bool verbose = false;
+    int option;
+    while ((option = getopt(argc, argv, "v")) != -1) {
+        if (option == 'v') {
+            verbose = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    bool passed = true;
+    printf("Errors of the tilt in deg after %d s (max / rms):\n", FUSION_SETTLE);
+    printf("%-10s %-6s %15s %15s %15s\n", "Trace", "Rate", "Complementary", "Kalman", "Mean of 10");
+    for (const FusionTrace &trace : traces) {
+        for (int meanRate = 1; meanRate >= 0; meanRate--) {
+            FusionResult results[3];
+            runTrace(trace, meanRate, verbose, results);
+            printf("%-10s %-6s", trace.name, meanRate ? "FIFO" : "sample");
+            for (int i = 0; i < 3; i++) {
+                printf("    %5.2f / %4.2f", results[i].maxError, results[i].rmsError);
+            }
+            // The fused angles must stay within the limit of the trace (and be calmer than the mean)
+            bool ok = true;
+            for (int i = 0; i < 2; i++) {
+                ok = ok && results[i].maxError < trace.maxError && (!trace.calmer || results[i].rmsError < results[2].rmsError);
+            }
+            printf("%s\n", ok ? "" : "  FAILED");
+            passed = passed && ok;
+        }
+    }
+    if (!passed) {
+        printf("Tilt fusion exceeds the limits\n");
+        return 1;
+    }
+    printf("Tilt fusion within the limits\n");
+    return 0;
+}
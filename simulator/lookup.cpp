@@ -0,0 +1,237 @@
+/*
+  lookup.cpp - Check and speed of the lookup tables (LookupTable1D, LookupTable, LookupTable2D)
+  on the host.
+  Tables of 10 (battery map), 64 and 255 breakpoints are interpolated by the binary search of
+  LookupTable1D, by its uniform grid (the same breakpoints), by the template LookupTable
+  (reciprocal slopes) and by the former implementation (linear scan over double breakpoints).
+  Inside the breakpoints all must give the same outputs (within the float precision); outside,
+  the clamped and the extrapolated outputs are checked against the ends and the straight lines
+  of the end segments. The former implementation took segment 0 for every input outside.
+
+  LookupTable2D is checked against the bilinear interpolation in double on a grid of 16 x 16
+  values (inside and clamped outside). The battery table of the sketch is built at compile time
+  (static_assert on its reciprocal slopes).
+
+  Usage: camper_lookup
+
+  Licensed under "MIT" License.
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "LookupTable.h"
+#include "LookupTable1D.h"
+
+#define LOOKUP_BENCHMARK_RUNS 2000000
+#define LOOKUP_MAX_ERROR 1e-4  // Maximum difference of the outputs relative to the output range
+#define LOOKUP_GRID 16         // Breakpoints per input of the 2D check
+
+// Built by the compiler: the factories must be constant expressions
+constexpr float batteryVoltages[] = {11.51, 11.66, 11.81, 11.96, 12.10, 12.24, 12.37, 12.50, 12.62, 12.73};
+constexpr float batterySOCs[] = {10, 20, 30, 40, 50, 60, 70, 80, 90, 100};
+static_assert(lookupIncreasing(batteryVoltages), "batteryVoltages must increase");
+constexpr LookupTable<10> batteryTable = lookupTable(batteryVoltages, batterySOCs);
+static_assert(batteryTable.axis.reciprocals[0] > 6.66f && batteryTable.axis.reciprocals[0] < 6.67f, "Reciprocal slope of 0.15 V");
+constexpr float equalPoints[] = {1, 2, 2};
+static_assert(!lookupIncreasing(equalPoints), "Equal breakpoints don't increase");
+
+/*
+ * The implementation up to now (reference of the outputs and the speed).
+ */
+class FormerLookupTable1D {
+   public:
+    FormerLookupTable1D(const double *inputValues, const double *outputValues, size_t size)
+        : inputValues_(inputValues), outputValues_(outputValues), size_(size) {}
+
+    double interpolate(double inputValue) const {
+        size_t index = findClosestIndex(inputValue);
+        double x0 = inputValues_[index];
+        double x1 = inputValues_[index + 1];
+        double y0 = outputValues_[index];
+        double y1 = outputValues_[index + 1];
+        return y0 + (y1 - y0) * (inputValue - x0) / (x1 - x0);
+    }
+
+   private:
+    size_t findClosestIndex(double inputValue) const {
+        for (size_t i = 0; i < size_ - 1; ++i) {
+            if (inputValue >= inputValues_[i] && inputValue <= inputValues_[i + 1]) {
+                return i;
+            }
+        }
+        return 0;  // printed an error to Serial
+    }
+
+    const double *inputValues_;
+    const double *outputValues_;
+    size_t size_;
+};
+
+/*
+ * Nanoseconds per call of a lookup (average of LOOKUP_BENCHMARK_RUNS calls over the breakpoints).
+ */
+template <typename Function>
+static double benchmark(float first, float last, Function function) {
+    volatile float sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < LOOKUP_BENCHMARK_RUNS; i++) {
+        float input = first + (last - first) * ((i * 7919) % 10007) / 10007.0f;
+        sink = sink + function(input);
+    }
+    std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+    return time.count() / LOOKUP_BENCHMARK_RUNS;
+}
+
+/*
+ * Check the outputs of a table and time the implementations.
+ * @param name Name of the table
+ * @param inputs Breakpoints
+ * @param outputs Outputs of the breakpoints
+ * @param uniform Breakpoints on a uniform grid
+ * @return true, if all outputs are within the limits
+ */
+template <uint8_t N>
+static bool runCase(const char *name, const float (&inputs)[N], const float (&outputs)[N], bool uniform) {
+    uint8_t size = N;
+    std::vector<double> formerInputs(inputs, inputs + N);
+    std::vector<double> formerOutputs(outputs, outputs + N);
+    float first = inputs[0], last = inputs[size - 1];
+    float step = (last - first) / (size - 1);
+    float range = fabs(outputs[size - 1] - outputs[0]);
+
+    LookupTable1D search(inputs, outputs, size, LOOKUP_EXTRAPOLATE);
+    LookupTable1D clamped(inputs, outputs, size, LOOKUP_CLAMP);
+    LookupTable1D grid(first, step, outputs, size, LOOKUP_EXTRAPOLATE);
+    FormerLookupTable1D former(formerInputs.data(), formerOutputs.data(), size);
+    LookupTable<N, LOOKUP_EXTRAPOLATE> compiled = lookupTable<LOOKUP_EXTRAPOLATE>(inputs, outputs);
+    LookupTable<N> compiledClamped = lookupTable(inputs, outputs);
+
+    // Inside: all the same as the former one
+    double maxError = 0;
+    for (int i = 0; i <= 10000; i++) {
+        float input = first + (last - first) * i / 10000.0f;
+        double reference = former.interpolate(input);
+        maxError = fmax(maxError, fabs(search.interpolate(input) - reference));
+        maxError = fmax(maxError, fabs(clamped.interpolate(input) - reference));
+        maxError = fmax(maxError, fabs(compiled.interpolate(input) - reference));
+        maxError = fmax(maxError, fabs(compiledClamped.interpolate(input) - reference));
+        if (uniform) {
+            maxError = fmax(maxError, fabs(grid.interpolate(input) - reference));
+        }
+    }
+
+    // Outside: ends and straight lines of the end segments
+    double outsideError = 0;
+    float span = last - first;
+    for (int side = 0; side < 2; side++) {
+        int index = side == 0 ? 0 : size - 2;
+        float input = side == 0 ? first - span / 4 : last + span / 4;
+        double slope = (outputs[index + 1] - outputs[index]) / (double)(inputs[index + 1] - inputs[index]);
+        double line = outputs[index] + slope * (input - inputs[index]);
+        outsideError = fmax(outsideError, fabs(search.interpolate(input) - line));
+        outsideError = fmax(outsideError, fabs(compiled.interpolate(input) - line));
+        if (uniform) {
+            outsideError = fmax(outsideError, fabs(grid.interpolate(input) - line));
+        }
+        outsideError = fmax(outsideError, fabs(clamped.interpolate(input) - outputs[side == 0 ? 0 : size - 1]));
+        outsideError = fmax(outsideError, fabs(compiledClamped.interpolate(input) - outputs[side == 0 ? 0 : size - 1]));
+    }
+    float above = last + span / 4;
+    double formerAbove = former.interpolate(above);
+
+    double formerTime = benchmark(first, last, [&](float input) { return (float)former.interpolate(input); });
+    double searchTime = benchmark(first, last, [&](float input) { return search.interpolate(input); });
+    double compiledTime = benchmark(first, last, [&](float input) { return compiled.interpolate(input); });
+    double gridTime = uniform ? benchmark(first, last, [&](float input) { return grid.interpolate(input); }) : 0;
+
+    bool ok = maxError < LOOKUP_MAX_ERROR * range && outsideError < LOOKUP_MAX_ERROR * range;
+    printf("%-10s %5u %10.2g %10.2g %9.1f %9.1f %9.1f", name, size, maxError / range, outsideError / range, formerTime, searchTime,
+           compiledTime);
+    if (uniform) {
+        printf(" %9.1f", gridTime);
+    } else {
+        printf(" %9s", "-");
+    }
+    printf("   %.1f at %.2f instead of %.1f%s\n", formerAbove, above, search.interpolate(above), ok ? "" : "  FAILED");
+    return ok;
+}
+
+/*
+ * Check LookupTable2D against the bilinear interpolation in double and time it.
+ * @return true, if all outputs are within the limits
+ */
+static bool run2D(void) {
+    static float inputsX[LOOKUP_GRID], inputsY[LOOKUP_GRID], values[LOOKUP_GRID][LOOKUP_GRID];
+    for (int i = 0; i < LOOKUP_GRID; i++) {
+        inputsX[i] = i * i * 0.1f;  // not uniform
+        inputsY[i] = i * 2.0f - 10.0f;
+    }
+    for (int iy = 0; iy < LOOKUP_GRID; iy++) {
+        for (int ix = 0; ix < LOOKUP_GRID; ix++) {
+            values[iy][ix] = sin(inputsX[ix] * 0.2) * 50.0 + inputsY[iy] * inputsY[iy];
+        }
+    }
+    LookupTable2D<LOOKUP_GRID, LOOKUP_GRID> table = lookupTable2D(inputsX, inputsY, values);
+    float lastX = inputsX[LOOKUP_GRID - 1], lastY = inputsY[LOOKUP_GRID - 1];
+
+    // Reference: bilinear in double, inputs clamped to the grid
+    auto reference = [&](double x, double y) {
+        x = fmin(fmax(x, inputsX[0]), lastX);
+        y = fmin(fmax(y, inputsY[0]), lastY);
+        int ix = 0, iy = 0;
+        while (ix < LOOKUP_GRID - 2 && x >= inputsX[ix + 1]) {
+            ix++;
+        }
+        while (iy < LOOKUP_GRID - 2 && y >= inputsY[iy + 1]) {
+            iy++;
+        }
+        double fx = (x - inputsX[ix]) / (inputsX[ix + 1] - inputsX[ix]);
+        double fy = (y - inputsY[iy]) / (inputsY[iy + 1] - inputsY[iy]);
+        double v0 = values[iy][ix] + (values[iy][ix + 1] - values[iy][ix]) * fx;
+        double v1 = values[iy + 1][ix] + (values[iy + 1][ix + 1] - values[iy + 1][ix]) * fx;
+        return v0 + (v1 - v0) * fy;
+    };
+    double maxError = 0;
+    for (int i = 0; i <= 200; i++) {
+        for (int j = 0; j <= 200; j++) {
+            float x = -2.0f + (lastX + 4.0f) * i / 200.0f;  // also outside
+            float y = inputsY[0] - 2.0f + (lastY - inputsY[0] + 4.0f) * j / 200.0f;
+            maxError = fmax(maxError, fabs(table.interpolate(x, y) - reference(x, y)));
+        }
+    }
+    double range = 150.0;
+    double time = benchmark(0, lastX, [&](float x) { return table.interpolate(x, x * 0.7f - 10.0f); });
+    bool ok = maxError < LOOKUP_MAX_ERROR * range;
+    printf("%-10s %5u %10.2g %10s %9s %9s %9.1f%s\n", "2D", LOOKUP_GRID * LOOKUP_GRID, maxError / range, "clamped", "-", "-", time,
+           ok ? "" : "  FAILED");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    static float sine64[2][64], sine255[2][255];
+    for (int i = 0; i < 64; i++) {
+        sine64[0][i] = i * (float)(M_PI / 2) / 63;
+        sine64[1][i] = sin(sine64[0][i]);
+    }
+    for (int i = 0; i < 255; i++) {
+        sine255[0][i] = i * (float)(M_PI / 2) / 254;
+        sine255[1][i] = sin(sine255[0][i]);
+    }
+
+    bool passed = true;
+    printf("Errors relative to the output range, host time per lookup in ns, former output above the breakpoints:\n");
+    printf("%-10s %5s %10s %10s %9s %9s %9s %9s   %s\n", "Table", "Size", "Inside", "Outside", "Former", "Search", "Template", "Grid",
+           "Former above");
+    passed = runCase("battery", batteryVoltages, batterySOCs, false) && passed;
+    passed = runCase("sine 64", sine64[0], sine64[1], true) && passed;
+    passed = runCase("sine 255", sine255[0], sine255[1], true) && passed;
+    passed = run2D() && passed;
+    if (!passed) {
+        printf("Lookup tables failed\n");
+        return 1;
+    }
+    printf("Lookup tables match the former one inside and clamp or extrapolate outside\n");
+    return 0;
+}
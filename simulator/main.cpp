@@ -0,0 +1,259 @@
+/*
+  main.cpp - Host simulator of the Arduino Camper Van sketch.
+  Runs setup() and loop() of the unchanged sketch against the stubbed Arduino core,
+  the device models and a scripted day in virtual time, and prints a report.
+
+  Usage: camper_sim [-t hours] [-s seed] [-v] [-f] [-c] [-T trace.bin]
+    -t hours  Simulated time (default 24)
+    -s seed   Seed of the sensor noise (default 1)
+    -v        Print the serial output of the sketch
+    -f        Inject I2C faults: MPU unplugged (3.5 h), SDA held (5.5 h), RTC unplugged over the alarm at 7.5 h
+    -c        Calibrate the tilt by the menu at 6:45 (the parked van is taken as level)
+    -T file   Write the serial output to a file (the sensor trace of a build with -DTRACE)
+
+  Licensed under "MIT" License.
+*/
+
+// The sketch with generated prototypes (like the Arduino builder), so the report can read its globals.
+#include "sketch.cpp"
+
+#include <EEPROM.h>
+
+#include <chrono>
+
+#include "Devices.h"
+#include "PinChangeInterrupt.h"
+#include "Scenario.h"
+#include "Simulation.h"
+#include "SketchState.h"
+
+#define SIM_START_UNIXTIME 1720765800UL  // 2024-07-12 06:30:00
+#define SIM_RTC_PPM 300                  // Rate error of the RTC against the Arduino clock
+#define SIM_HOUR 3600000000ULL           // One hour of virtual time in us
+#define SIM_OUTSIDE_TEMPERATURE -6       // Outside against inside temperature in K (DHT_OUTSIDE)
+#define SIM_OUTSIDE_HUMIDITY 15          // Outside against inside humidity in % (DHT_OUTSIDE)
+#define SIM_FRIDGE_TEMPERATURE -18       // Fridge against inside temperature in K (DHT_FRIDGE)
+#define SIM_FRIDGE_HUMIDITY -10          // Fridge against inside humidity in % (DHT_FRIDGE)
+
+/*
+ * Schedule the faults of the I2C bus. Every device must come back without a restart of the sketch.
+ */
+static void scheduleFaults(MPU6050Model &mpu, DS3231Model &rtc, I2CBusFault &busFault) {
+    // MPU unplugged for 5 min, powers up with its reset values
+    Simulation::schedule(3.5 * SIM_HOUR, []() {
+        Simulation::attachI2C(MPU_I2C_ADDR, NULL);
+    });
+    Simulation::schedule(3.5 * SIM_HOUR + 300000000ULL, [&mpu]() {
+        mpu.reset();
+        Simulation::attachI2C(MPU_I2C_ADDR, &mpu);
+    });
+    // A slave holds SDA low for 5 clocks
+    Simulation::schedule(5.5 * SIM_HOUR, [&busFault]() {
+        busFault.hold(5);
+    });
+    // RTC unplugged from 30 s before the alarm at 14:00 until 1 min after it (the RTC keeps running)
+    Simulation::schedule(7.5 * SIM_HOUR - 30000000ULL, []() {
+        Simulation::attachI2C(DS3231_ADDRESS, NULL);
+    });
+    Simulation::schedule(7.5 * SIM_HOUR + 60000000ULL, [&rtc]() {
+        Simulation::attachI2C(DS3231_ADDRESS, &rtc);
+    });
+}
+
+/*
+ * Print the final state of the sketch and the statistics of the run.
+ */
+static void report(uint64_t duration, double seconds, unsigned long passes, Scenario &scenario,
+                   MPU6050Model &mpu, DS3231Model &rtc, DHTModel **dhts, I2CBusFault &busFault) {
+    printf("Simulated time:      %.1f h in %.2f s (%.0fx real time)\n", duration / 3.6e9, seconds, duration / 1e6 / seconds);
+    printf("Loop passes:         %lu\n", passes);
+    printf("User inputs:         %lu\n", scenario.getUserInputCount());
+    printf("Awake (last minute): %u permille\n", powerSaver.getAwakePermille());
+
+    printf("\nI2C bus                 transactions      bytes  nacks\n");
+    const uint8_t addresses[] = {DISPLAY_I2C_ADDR, DS3231_ADDRESS, MPU_I2C_ADDR};
+    const char *names[] = {"SH1106 display", "DS3231 RTC", "MPU6050"};
+    unsigned long totalBytes = 0;
+    for (uint8_t i = 0; i < sizeof(addresses); i++) {
+        const I2CStatisticType &statistic = Simulation::getI2CStatistic(addresses[i]);
+        printf("  0x%02X %-16s %12lu %10lu %6lu\n", addresses[i], names[i], statistic.transactions, statistic.bytes, statistic.nacks);
+        totalBytes += statistic.bytes;
+    }
+    printf("  total %38lu\n", totalBytes);
+    printf("  TWI queue: %lu transactions completed, %lu posts rejected (queue full)\n", TwiQueue::getCompleted(),
+           TwiQueue::getRejected());
+    printf("  Bus recoveries: %lu (SDA held %lu times)\n", TwiQueue::getRecoveries(), busFault.getHoldCount());
+    I2CHealth *health[] = {&MPU_device.health, &RTC_device.health};
+    for (uint8_t i = 0; i < 2; i++) {
+        printf("  Health %-8s %lu ok, %lu nack, %lu timeout, degraded %u times%s\n", i == 0 ? "MPU6050:" : "DS3231:", health[i]->getSuccesses(),
+               health[i]->getNacks(), health[i]->getTimeouts(), health[i]->getDegradedCount(), health[i]->isDegraded() ? " (now)" : "");
+    }
+
+    printf("\nHourly rollovers:    %lu (alarms of the RTC: %lu)\n", rtc.getAcknowledgeCount(), rtc.getAlarmCount());
+    printf("ADC conversions:     %lu (by the interrupt, %lu dropped after a delayed interrupt)\n", AdcSampler::getConversions(),
+           AdcSampler::getDropped());
+    printf("Interrupt handlers:  %lu enables of the interrupts (nesting)\n", Simulation::getHandlerEnables());
+    printf("DHT transmissions:  ");
+    for (uint8_t i = 0; i < dhtManager.getCount(); i++) {
+        printf(" %lu", dhts[i]->getTransmissionCount());
+    }
+    printf("\n");
+#ifdef MPU_FIFO
+    printf("MPU FIFO:            %lu samples, %lu overflows (counted by the sketch: %u), %u samples in the last average\n",
+           mpu.getFifoSampleCount(), mpu.getFifoOverflowCount(), MPU_device.getFifoOverflows(), MPU_device.getFifoSamples());
+#endif
+    printf("Software clock:      %02d:%02d:%02d %02d.%02d.%04d (drift %ld s, %u RTC reads)\n", softClock.t.hour, softClock.t.minute,
+           softClock.t.second, softClock.t.day, softClock.t.month, softClock.t.year, softClock.getDrift(), softClock.getResyncCount());
+    bool mpuShadow = MPU_device.verifyRegisters();
+    bool rtcShadow = RTC_device.verifyRegisters();
+    printf("Register shadows:    MPU %s, RTC %s\n", mpuShadow ? "match" : "differ", rtcShadow ? "match" : "differ");
+    printf("Scheduler overruns: ");
+    for (uint8_t i = 0; i < scheduler.getTaskCount(); i++) {
+        printf(" %u", scheduler.getOverruns(i));
+    }
+    printf("\n");
+
+    printf("\nBattery:             %.2f V, %.2f A, %.1f W, SoC %d %% (model: %.2f V, %.2f A, SoC %.0f %%)\n", DCData.voltage / 1000.0,
+           DCData.current / 1000.0, DCData.power / 1000.0, DCData.soc, scenario.getBatteryVoltage(), scenario.getBatteryCurrent(), scenario.getBatterySOC() * 100);
+    printf("Battery state:       %.1f Ah, SoC %.1f %%, anchored in %u rests\n", batteryState.getCharge() / 3600000.0,
+           batteryState.getSOC() / 10.0, batteryState.getAnchors());
+    printf("Tilt:                %.2f, %.2f deg (fused %.2f, %.2f deg, gyroscope offset %.2f, %.2f deg/s)\n",
+           MPU_device.data.phiX, MPU_device.data.phiY, tiltFilterX.getAngle() / 100.0, tiltFilterY.getAngle() / 100.0,
+           tiltFilterX.getOffset() / 100.0, tiltFilterY.getOffset() / 100.0);
+    const MPUOffsetType &offset = MPU_device.offset;
+    MPUOffsetType stored;
+    bool valid = EepromStore::load(EEPROM_MPU_OFFSET, MPU_OFFSET_VERSION, &stored, sizeof(stored));
+    printf("MPU offsets:         AcZ %d LSB, gyroscope %d, %d, %d LSB, tilt %.2f, %.2f deg (EEPROM: %s, %lu bytes written)\n",
+           offset.AcZ, offset.GyX, offset.GyY, offset.GyZ, offset.tiltX / 100.0, offset.tiltY / 100.0,
+           !valid ? "empty" : memcmp(&stored, &offset, sizeof(stored)) == 0 ? "stored" : "differs", EEPROM.getWriteCount());
+    for (uint8_t i = 0; i < dhtManager.getCount(); i++) {
+        printf("Climate %-12s %.0f degC, %.0f %% (%u %% failed reads)\n", dhtSensors[i].name, dhtSensors[i].temperature,
+               dhtSensors[i].humidity, dhtManager.getErrorRate(i));
+    }
+    printf("Water:               fresh %s, grey %s\n", WaterData.fresh ? "okay" : "empty", WaterData.grey ? "full" : "okay");
+#ifdef TRACE
+    printf("Trace:               %u records dropped\n", sensorTrace.getDropped());
+#endif
+    printf("State digest:        %08lx\n", (unsigned long)sketchStateDigest());
+
+    printf("\nHistory  hour  temp  hum  energy/Ah  model/Ah\n");
+    for (uint8_t i = 0; i < DHT_HISTORY_COUNT; i++) {
+        const int8_t *hours = dhtManager.getHistoryHours();
+        uint8_t hour = (hours[i] + 23) % 24;  // the energy of the hour before the rollover
+        printf("  %2u     %4d  %4d %4d  %9.2f  %8.2f\n", i, hours[i], dhtSensors[DHT_INSIDE].temperatureHistory[i],
+               dhtSensors[DHT_INSIDE].humidityHistory[i],
+               i < DC_ENERGY_COUNT ? DCData.energy24[i] : 0.0, scenario.getHourEnergy(hour));
+    }
+
+    printf("\nScreen\n  +---------------------+\n");
+    for (uint8_t line = 0; line < LCDGFX_LINES; line++) {
+        printf("  |%s|\n", DisplaySH1106_128x64_I2C::getLine(line));
+    }
+    printf("  +---------------------+\n");
+}
+
+int main(int argc, char **argv) {
+    double hours = 24;
+    uint32_t seed = 1;
+    FILE *trace = NULL;
+    bool faults = false;
+    bool calibration = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            hours = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            Simulation::setSerialOutput(true);
+        } else if (strcmp(argv[i], "-f") == 0) {
+            faults = true;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            calibration = true;
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            trace = fopen(argv[++i], "wb");
+            if (trace == NULL) {
+                fprintf(stderr, "Can't write %s\n", argv[i]);
+                return 1;
+            }
+            Simulation::setSerialCapture(trace);
+        } else {
+            fprintf(stderr, "Usage: %s [-t hours] [-s seed] [-v] [-f] [-c] [-T trace.bin]\n", argv[0]);
+            return 1;
+        }
+    }
+#ifndef TRACE
+    if (trace != NULL) {
+        fprintf(stderr, "Warning: the sketch was built without TRACE (make DEFINES=-DTRACE)\n");
+    }
+#endif
+    uint64_t duration = hours * 3.6e9;
+
+    ScenarioPinsType pins = {VOLTAGE_PIN, CURRENT_PIN, FRESH_WATER_PIN, GREY_WATER_PIN, ROTARY_PIN_SW, ROTARY_PIN_DT, ROTARY_PIN_CLK};
+    Scenario scenario(SIM_START_UNIXTIME, seed, pins);
+    MPU6050Model mpu(scenario, MPU6050_OFFSET_phiX, MPU6050_OFFSET_phiY, MPU6050_OFFSET_AcZ, MPU_INT_PIN);
+    DS3231Model rtc(scenario, SIM_START_UNIXTIME, SIM_RTC_PPM, RTC_INT_PIN);
+    DHTModel dht(scenario, DHT_PIN, DHT_TYPE);
+#ifdef DHT_OUTSIDE
+    ClimateOffset outside(scenario, SIM_OUTSIDE_TEMPERATURE, SIM_OUTSIDE_HUMIDITY);
+    DHTModel dhtOutside(outside, DHT_OUTSIDE_PIN, DHT_OUTSIDE_TYPE);
+#endif
+#ifdef DHT_FRIDGE
+    ClimateOffset fridge(scenario, SIM_FRIDGE_TEMPERATURE, SIM_FRIDGE_HUMIDITY);
+    DHTModel dhtFridge(fridge, DHT_FRIDGE_PIN, DHT_FRIDGE_TYPE);
+#endif
+    DHTModel *dhts[] = {  // in the order of dhtSensors
+        &dht,
+#ifdef DHT_OUTSIDE
+        &dhtOutside,
+#endif
+#ifdef DHT_FRIDGE
+        &dhtFridge,
+#endif
+    };
+    SH1106Model sh1106;
+    I2CBusFault busFault(SDA, SCL);
+    Simulation::attachI2C(MPU_I2C_ADDR, &mpu);
+    Simulation::attachI2C(DS3231_ADDRESS, &rtc);
+    Simulation::attachI2C(DISPLAY_I2C_ADDR, &sh1106);
+    Simulation::setPinChangeHook(PinChangeInterrupt::handle);
+    Simulation::setAdcHook(AdcSampler::handle);
+    for (DHTModel *model : dhts) {
+        model->begin();
+    }
+    busFault.begin();
+    if (faults) {
+        scheduleFaults(mpu, rtc, busFault);
+    }
+    scenario.begin(duration);
+    if (calibration) {
+        scenario.scheduleCalibration();
+    }
+    Simulation::setTimeLimit(duration + 60000000ULL);
+    Simulation::schedule(duration > 1000000 ? duration - 1000000 : 0, []() {
+        Simulation::serialInput("p");  // print the statistics at the end, if the profiler is active
+    });
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long passes = 0;
+    setup();
+    while (Simulation::now() < duration) {
+        loop();
+        Simulation::advance(SIM_COST_LOOP);
+        passes++;
+    }
+#ifdef TRACE
+    // Transmit the records still buffered, so the trace covers the final state
+    while (!sensorTrace.isEmpty()) {
+        Simulation::advance(1000);
+        sensorTrace.flush();
+    }
+#endif
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (trace != NULL) {
+        fclose(trace);
+    }
+
+    fflush(stdout);
+    report(duration, elapsed.count(), passes, scenario, mpu, rtc, dhts, busFault);
+    return 0;
+}
@@ -0,0 +1,31 @@
+# prototypes.awk - Turns the sketch into a C++ file like the Arduino builder does:
+# includes Arduino.h and inserts prototypes of all functions in front of the first function definition.
+# Usage: awk -f prototypes.awk sketch.ino sketch.ino > sketch.cpp
+
+NR == FNR {
+    if ($0 ~ /^[A-Za-z_][A-Za-z0-9_ *&:<>]*[ *&][A-Za-z_][A-Za-z0-9_]*\(.*\) *\{ *$/ && $0 !~ /^(else|return|if|for|while|switch)[ (]/) {
+        if (!first) {
+            first = FNR
+        }
+        proto = $0
+        sub(/ *\{ *$/, ";", proto)
+        protos[++n] = proto
+    }
+    next
+}
+
+FNR == 1 {
+    print "#include \"Arduino.h\""
+    printf "#line 1 \"%s\"\n", FILENAME
+}
+
+FNR == first {
+    for (i = 1; i <= n; i++) {
+        print protos[i]
+    }
+    printf "#line %d \"%s\"\n", FNR, FILENAME
+}
+
+{
+    print
+}
@@ -0,0 +1,215 @@
+/*
+  replay.cpp - Replay of a recorded sensor trace (see SensorTrace.h) on the host.
+  Feeds the raw inputs of every record through the processing code of the sketch,
+  as fast as possible, and prints the processed values after each record. The time
+  of the records is set as virtual time, so millis() returns the recorded time.
+
+  Usage: camper_replay [-q] trace.bin
+    -q  Print only the summary (no CSV lines)
+
+  Licensed under "MIT" License.
+*/
+
+// The sketch with generated prototypes (like the Arduino builder), to call its processing functions.
+#include "sketch.cpp"
+
+#include <vector>
+
+#include "SensorTrace.h"
+#include "Simulation.h"
+#include "SketchState.h"
+
+/*
+ * Reader of the bytes of a trace.
+ */
+class TraceReader {
+   public:
+    TraceReader(const std::vector<uint8_t> &data) : data(data), position(0), valid(true) {}
+
+    bool atEnd(void) {
+        return position >= data.size();
+    }
+
+    bool isValid(void) {
+        return valid;
+    }
+
+    uint8_t byte(void) {
+        if (position >= data.size()) {
+            valid = false;
+            return 0;
+        }
+        return data[position++];
+    }
+
+    unsigned long varint(void) {
+        unsigned long value = 0;
+        for (uint8_t shift = 0; shift < 35; shift += 7) {
+            uint8_t b = byte();
+            value |= (unsigned long)(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                return value;
+            }
+        }
+        valid = false;
+        return value;
+    }
+
+    int16_t word(void) {
+        uint8_t high = byte();
+        return (int16_t)(high << 8 | byte());
+    }
+
+   private:
+    const std::vector<uint8_t> &data;
+    size_t position;
+    bool valid;
+};
+
+/*
+ * Read a whole file.
+ */
+static bool readFile(const char *path, std::vector<uint8_t> &data) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + length);
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    bool quiet = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            quiet = true;
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    std::vector<uint8_t> data;
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s [-q] trace.bin\n", argv[0]);
+        return 1;
+    }
+    if (!readFile(path, data)) {
+        fprintf(stderr, "Can't read %s\n", path);
+        return 1;
+    }
+
+    TraceReader reader(data);
+    if (reader.byte() != 'C' || reader.byte() != 'V' || reader.byte() != 'T' || reader.byte() != TRACE_VERSION) {
+        fprintf(stderr, "%s is no trace of version %d\n", path, TRACE_VERSION);
+        return 1;
+    }
+    uint32_t time = reader.varint();  // millis() of the board (wraps after 49.7 days)
+    uint64_t clock = time;            // Virtual time in ms (doesn't wrap)
+
+    display.initialize();
+    if (!quiet) {
+        sketchStateHeader(stdout);
+    }
+
+    unsigned long counts[TRACE_OFFSET + 1] = {0};
+    unsigned long dropped = 0;
+    while (!reader.atEnd() && reader.isValid()) {
+        uint8_t type = reader.byte();
+        // 32 bit like millis(): a delta of a record behind the last one (older traces) is negative
+        int32_t delta = (uint32_t)reader.varint();
+        time = (uint32_t)(time + delta);
+        clock += delta;
+        if (clock * 1000 > Simulation::now()) {
+            Simulation::advance(clock * 1000 - Simulation::now());
+        }
+
+        switch (type) {
+            case TRACE_SAMPLE: {
+                unsigned long dt = reader.varint();
+                SensorSampleType sample;
+                uint32_t adc = reader.byte();
+                adc |= (uint32_t)reader.byte() << 8;
+                adc |= (uint32_t)reader.byte() << 16;
+                adc |= (uint32_t)reader.byte() << 24;
+                sample.dc.voltage = adc & 0x3FFF;
+                sample.dc.current = (adc >> 14) & 0x3FFF;
+                sample.mpu.AcX = reader.word();
+                sample.mpu.AcY = reader.word();
+                sample.mpu.AcZ = reader.word();
+                sample.mpu.Temp = reader.word();
+                sample.mpu.GyX = reader.word();
+                sample.mpu.GyY = reader.word();
+                sample.mpu.GyZ = reader.word();
+                sample.water = reader.byte();
+                sensors_process(sample, dt);
+                break;
+            }
+            case TRACE_DHT: {
+                uint8_t sensor = reader.byte();
+                uint8_t bytes[5];
+                for (uint8_t i = 0; i < 5; i++) {
+                    bytes[i] = reader.byte();
+                }
+                dhtManager.decode(sensor, bytes);
+                break;
+            }
+            case TRACE_ROTARY:
+                switch (reader.byte()) {
+                    case TRACE_ROTARY_CW:
+                        rotary_turn(1);
+                        break;
+                    case TRACE_ROTARY_CCW:
+                        rotary_turn(-1);
+                        break;
+                    case TRACE_ROTARY_PRESS:
+                        rotary_press();
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            case TRACE_ROLLOVER:
+                history_rollover(reader.byte());
+                break;
+            case TRACE_DROPPED:
+                dropped += reader.varint();
+                break;
+            case TRACE_OFFSET:
+                MPU_device.offset.AcX = reader.word();
+                MPU_device.offset.AcY = reader.word();
+                MPU_device.offset.AcZ = reader.word();
+                MPU_device.offset.GyX = reader.word();
+                MPU_device.offset.GyY = reader.word();
+                MPU_device.offset.GyZ = reader.word();
+                MPU_device.offset.tiltX = reader.word();
+                MPU_device.offset.tiltY = reader.word();
+                MPU_offset_changed();
+                break;
+            default:
+                fprintf(stderr, "Unknown record type %u at %lu ms\n", type, (unsigned long)time);
+                return 1;
+        }
+        if (!reader.isValid()) {
+            fprintf(stderr, "Trace truncated at %lu ms\n", (unsigned long)time);
+            break;
+        }
+        counts[type]++;
+        if (!quiet) {
+            sketchStatePrint(stdout, time, type);
+        }
+    }
+
+    fflush(stdout);
+    fprintf(quiet ? stdout : stderr, "Records:             %lu samples, %lu DHT, %lu rotary, %lu rollovers (%lu records dropped)\n",
+            counts[TRACE_SAMPLE], counts[TRACE_DHT], counts[TRACE_ROTARY], counts[TRACE_ROLLOVER], dropped);
+    fprintf(quiet ? stdout : stderr, "State digest:        %08lx\n", (unsigned long)sketchStateDigest());
+    return 0;
+}
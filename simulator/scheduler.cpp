@@ -0,0 +1,191 @@
+/*
+  scheduler.cpp - Check of the task scheduler (Scheduler) in virtual time on the host.
+  Drives Scheduler::run() with a virtual clock, which the tasks advance by their run time.
+  Checks the order of due tasks (due time, then priority), that missed runs are skipped
+  instead of caught up in a burst, the count of the overruns, and with the tasks of the
+  sketch (display 30 ms, DHT 5 ms, ...) and wake ups after a standby, where all tasks are
+  overdue at once: the polling rotary task must wait at most for the longest single task,
+  a sensor reading at most for one run of every other task.
+
+  Usage: camper_scheduler
+
+  Licensed under "MIT" License.
+*/
+#include <cstdio>
+#include <cstring>
+
+#include "Scheduler.h"
+
+#define SCHEDULER_CHECK_TIME 600000UL  // Virtual time of the load check in ms
+#define SCHEDULER_CHECK_WAKE 10000UL   // Time between two standby sleeps in ms
+#define SCHEDULER_CHECK_SLEEP 1500UL   // Length of a standby sleep in ms
+
+static unsigned long now;  // Virtual time in ms, advanced by the tasks and the idle passes
+static char order[16];     // Names of the run tasks (order check)
+static uint8_t orderLength;
+
+struct LoadTask {
+    const char *name;
+    uint16_t period;
+    uint8_t priority;
+    uint16_t deadline;
+    uint16_t offset;          // Delay of the first run in ms
+    uint16_t cost;            // Run time in ms
+    unsigned long runs;
+    unsigned long lastStart;  // Start of the last run (0: none since the last sleep)
+    unsigned long maxGap;     // Longest time between two starts (without a sleep between)
+};
+
+// Tasks of scheduler_setup() with their run times on the Uno (rotary: with the loop pass)
+static LoadTask loadTasks[] = {
+    {"rotary", 0, 4, 5, 0, 1},          {"sensors", 500, 3, 100, 0, 2},     {"DHT", 2000, 2, 50, 0, 5},
+    {"clock", 1000, 2, 100, 500, 1},    {"display", 1000, 1, 1000, 0, 30},  {"standby", 1000, 0, 1000, 0, 0},
+};
+#define LOAD_TASKS (sizeof(loadTasks) / sizeof(loadTasks[0]))
+
+/*
+ * Task of the order check: records its name.
+ */
+template <char NAME>
+static void orderTask(unsigned long dt) {
+    order[orderLength++] = NAME;
+}
+
+/*
+ * Task of the load check: records the time since its last start and takes its run time.
+ */
+template <uint8_t N>
+static void loadTask(unsigned long dt) {
+    LoadTask &task = loadTasks[N];
+    if (task.lastStart != 0 && now - task.lastStart > task.maxGap) {
+        task.maxGap = now - task.lastStart;
+    }
+    task.lastStart = now;
+    task.runs++;
+    now += task.cost;
+}
+
+static void emptyTask(unsigned long dt) {}
+
+/*
+ * Print the result of a check.
+ */
+static bool report(const char *name, bool ok, const char *detail) {
+    printf("%-10s %-6s %s\n", name, ok ? "ok" : "FAILED", detail);
+    return ok;
+}
+
+/*
+ * Due tasks run by their due time, tasks due at the same time by their priority.
+ */
+static bool checkOrder(void) {
+    Scheduler scheduler;
+    orderLength = 0;
+    scheduler.addTask(orderTask<'A'>, 100, 1, 10, 0, 10);
+    scheduler.addTask(orderTask<'B'>, 100, 2, 10, 0, 10);
+    scheduler.addTask(orderTask<'C'>, 100, 0, 10, 0, 5);
+    scheduler.addTask(orderTask<'D'>, 100, 3, 10, 0, 30);  // not yet due
+    while (scheduler.run(20)) {
+    }
+    order[orderLength] = '\0';
+    char detail[64];
+    snprintf(detail, sizeof(detail), "run order %s (expected CBA)", order);
+    return report("order", strcmp(order, "CBA") == 0, detail);
+}
+
+/*
+ * A task, which missed several periods, runs once and is due a period later.
+ */
+static bool checkSkip(void) {
+    Scheduler scheduler;
+    orderLength = 0;
+    scheduler.addTask(orderTask<'S'>, 10, 0, 10, 0);
+    scheduler.run(0);
+    unsigned long runs = 0;
+    while (scheduler.run(55)) {
+        runs++;
+    }
+    bool early = scheduler.run(64);
+    bool due = scheduler.run(65);
+    char detail[64];
+    snprintf(detail, sizeof(detail), "%lu run after 5 missed periods, next one %s", runs, due && !early ? "a period later" : "wrong");
+    return report("skip", runs == 1 && due && !early, detail);
+}
+
+/*
+ * Only runs later than due + deadline (polling task: last run + deadline) are overruns.
+ */
+static bool checkOverruns(void) {
+    Scheduler periodic;
+    periodic.addTask(emptyTask, 100, 0, 5, 0, 100);
+    periodic.run(103);  // 3 ms late
+    periodic.run(207);  // 7 ms late: overrun
+    Scheduler polling;
+    polling.addTask(emptyTask, 0, 0, 5, 0);
+    polling.run(4);   // 4 ms after the last run
+    polling.run(12);  // 8 ms after the last run: overrun
+    polling.run(15);
+    char detail[64];
+    snprintf(detail, sizeof(detail), "periodic %u (expected 1), polling %u (expected 1)", periodic.getOverruns(0), polling.getOverruns(0));
+    return report("overruns", periodic.getOverruns(0) == 1 && polling.getOverruns(0) == 1, detail);
+}
+
+/*
+ * The tasks of the sketch with their run times and a standby sleep every 10 s.
+ */
+static bool checkLoad(void) {
+    void (*callbacks[])(unsigned long) = {loadTask<0>, loadTask<1>, loadTask<2>, loadTask<3>, loadTask<4>, loadTask<5>};
+    Scheduler scheduler;
+    now = 1;
+    for (uint8_t i = 0; i < LOAD_TASKS; i++) {
+        LoadTask &task = loadTasks[i];
+        scheduler.addTask(callbacks[i], task.period, task.priority, task.deadline, now, task.offset);
+    }
+    unsigned long nextSleep = SCHEDULER_CHECK_WAKE;
+    while (now < SCHEDULER_CHECK_TIME) {
+        if (now >= nextSleep) {
+            now += SCHEDULER_CHECK_SLEEP;  // all tasks are overdue after the wake up
+            nextSleep = now + SCHEDULER_CHECK_WAKE;
+            for (uint8_t i = 0; i < LOAD_TASKS; i++) {
+                loadTasks[i].lastStart = 0;
+            }
+        }
+        if (!scheduler.run(now)) {
+            now++;
+        }
+    }
+
+    // Bounds: the rotary task runs between any two other tasks
+    const LoadTask &rotary = loadTasks[0];
+    const LoadTask &sensors = loadTasks[1];
+    uint16_t longest = 0, others = rotary.cost;
+    for (uint8_t i = 1; i < LOAD_TASKS; i++) {
+        longest = max(longest, loadTasks[i].cost);
+        if (i != 1) {
+            others += loadTasks[i].cost + rotary.cost;
+        }
+    }
+    longest += rotary.cost;
+    bool passed = true;
+    char detail[96];
+    snprintf(detail, sizeof(detail), "rotary every %lu ms at most (longest task and its run %u ms), %lu runs", rotary.maxGap, longest, rotary.runs);
+    passed = report("rotary", rotary.maxGap <= longest, detail) && passed;
+    snprintf(detail, sizeof(detail), "sensors late %lu ms at most (other tasks and rotary %u ms), %lu runs", sensors.maxGap - sensors.period, others,
+             sensors.runs);
+    passed = report("sensors", sensors.maxGap - sensors.period <= others, detail) && passed;
+    return passed;
+}
+
+int main(int argc, char **argv) {
+    bool passed = true;
+    passed = checkOrder() && passed;
+    passed = checkSkip() && passed;
+    passed = checkOverruns() && passed;
+    passed = checkLoad() && passed;
+    if (!passed) {
+        printf("Scheduler failed\n");
+        return 1;
+    }
+    printf("Scheduler runs the tasks in order and in time\n");
+    return 0;
+}
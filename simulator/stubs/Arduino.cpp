@@ -0,0 +1,181 @@
+/*
+  Arduino.cpp - Host stub of the Arduino core for the simulator.
+  Only the part of the API used by the sketch and its libraries. Time, pins and
+  interrupts are emulated by the Simulation class.
+
+  Licensed under "MIT" License.
+*/
+#include "Arduino.h"
+
+#include "Simulation.h"
+
+HardwareSerial Serial;
+
+// Time
+
+unsigned long millis(void) {
+    return (unsigned long)(uint32_t)(Simulation::now() / 1000);
+}
+
+unsigned long micros(void) {
+    return (unsigned long)(uint32_t)Simulation::now();
+}
+
+void delay(unsigned long ms) {
+    uint64_t end = Simulation::now() + (uint64_t)ms * 1000;
+    while (Simulation::now() < end) {
+        Simulation::advance(min(end - Simulation::now(), (uint64_t)1000));  // events and interrupts every ms
+    }
+}
+
+void delayMicroseconds(unsigned int us) {
+    Simulation::advance(us);
+}
+
+// Pins
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    Simulation::pinMode(pin, mode);
+    Simulation::advance(SIM_COST_DIGITAL_IO);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    Simulation::digitalWrite(pin, value);
+    Simulation::advance(SIM_COST_DIGITAL_IO);
+}
+
+int digitalRead(uint8_t pin) {
+    Simulation::advance(SIM_COST_DIGITAL_IO);
+    return Simulation::digitalRead(pin);
+}
+
+int analogRead(uint8_t pin) {
+    if (pin < A0) {
+        pin += A0;  // channel number
+    }
+    return Simulation::analogRead(pin);
+}
+
+// Interrupts
+
+void noInterrupts(void) {
+    Simulation::setInterrupts(false);
+}
+
+void interrupts(void) {
+    Simulation::setInterrupts(true);
+}
+
+void attachInterrupt(uint8_t number, void (*handler)(void), int mode) {
+    Simulation::attachInterrupt(number, handler, mode);
+}
+
+void detachInterrupt(uint8_t number) {
+    Simulation::detachInterrupt(number);
+}
+
+// avr-libc
+
+char *dtostrf(double value, signed char width, unsigned char precision, char *buffer) {
+    sprintf(buffer, "%*.*f", width, precision, value);
+    return buffer;
+}
+
+// Print
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+    }
+    return size;
+}
+
+// Serial
+
+void HardwareSerial::begin(unsigned long baud) {
+    Simulation::serialBegin(baud);
+}
+
+void HardwareSerial::end(void) {
+    Simulation::serialBegin(0);
+}
+
+int HardwareSerial::available(void) {
+    return Simulation::serialAvailable();
+}
+
+int HardwareSerial::read(void) {
+    return Simulation::serialRead();
+}
+
+int HardwareSerial::availableForWrite(void) {
+    return Simulation::serialAvailableForWrite();
+}
+
+void HardwareSerial::flush(void) {
+    Simulation::serialFlush();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    Simulation::serialWrite(c);
+    return 1;
+}
+
+size_t Print::print(const char *text) {
+    return write((const uint8_t *)text, strlen(text));
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base) {
+    return printNumber(value, base, false);
+}
+
+size_t Print::print(int value, int base) {
+    return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return printNumber(value, base, false);
+}
+
+size_t Print::print(long value, int base) {
+    if (value < 0 && base == DEC) {
+        return printNumber(-(unsigned long)value, base, true);
+    }
+    return printNumber((unsigned long)value, base, false);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return printNumber(value, base, false);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[40];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return print(buffer);
+}
+
+size_t Print::println(void) {
+    return print("\r\n");
+}
+
+size_t Print::printNumber(unsigned long value, int base, bool negative) {
+    char buffer[8 * sizeof(long) + 2];
+    char *p = &buffer[sizeof(buffer) - 1];
+    *p = '\0';
+    if (base < 2) {
+        base = 10;
+    }
+    do {
+        uint8_t digit = value % base;
+        value /= base;
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    } while (value != 0);
+    if (negative) {
+        *--p = '-';
+    }
+    return print(p);
+}
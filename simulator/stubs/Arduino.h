@@ -0,0 +1,252 @@
+/*
+  Arduino.h - Host stub of the Arduino core for the simulator.
+  Only the part of the API used by the sketch and its libraries. Time, pins and
+  interrupts are emulated by the Simulation class.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <type_traits>
+
+// Defined on the command line like by the Arduino builder
+#ifndef ARDUINO
+#define ARDUINO 10819
+#endif
+#ifndef F_CPU
+#define F_CPU 16000000L
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define LED_BUILTIN 13
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define SDA A4
+#define SCL A5
+
+#define PB 2
+#define PC 3
+#define PD 4
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define sq(x) ((x) * (x))
+#define bit(b) (1UL << (b))
+#define bitRead(value, b) (((value) >> (b)) & 0x01)
+#define bitSet(value, b) ((value) |= (1UL << (b)))
+#define bitClear(value, b) ((value) &= ~(1UL << (b)))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+template <class T, class U>
+typename std::common_type<T, U>::type min(T a, U b) {
+    return b < a ? b : a;
+}
+
+template <class T, class U>
+typename std::common_type<T, U>::type max(T a, U b) {
+    return a < b ? b : a;
+}
+
+// Program memory is plain memory on the host
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_float(p) (*(const float *)(p))
+#define pgm_read_ptr(p) (*(void *const *)(p))
+#define strcpy_P strcpy
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define sprintf_P sprintf
+
+// Pins and ports
+#include "Simulation.h"
+
+#define digitalPinToPort(pin) simPinToPort(pin)
+#define digitalPinToBitMask(pin) simPinToMask(pin)
+#define portInputRegister(port) (&simPortInput[port])
+#define digitalPinToInterrupt(pin) ((pin) == 2 ? 0 : ((pin) == 3 ? 1 : -1))
+#define microsecondsToClockCycles(a) ((a) * (F_CPU / 1000000L))
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+
+#define _BV(b) (1 << (b))
+
+/*
+ * I/O register of the ATmega328P. The accesses are emulated by the simulation.
+ */
+class SimRegister {
+   public:
+    SimRegister(uint8_t address) : address(address) {}
+    operator uint8_t() const {
+        return Simulation::readRegister(address);
+    }
+    SimRegister &operator=(uint8_t value) {
+        Simulation::writeRegister(address, value);
+        return *this;
+    }
+    SimRegister &operator|=(uint8_t value) {
+        return *this = *this | value;
+    }
+    SimRegister &operator&=(uint8_t value) {
+        return *this = *this & value;
+    }
+
+   private:
+    uint8_t address;
+};
+
+// Status register (only the global interrupt flag)
+#define SREG SimRegister(SIM_REG_SREG)
+#define SREG_I 7
+
+// ADC registers and bits
+#define ADCL SimRegister(SIM_REG_ADCL)
+#define ADCH SimRegister(SIM_REG_ADCH)
+#define ADCSRA SimRegister(SIM_REG_ADCSRA)
+#define ADCSRB SimRegister(SIM_REG_ADCSRB)
+#define ADMUX SimRegister(SIM_REG_ADMUX)
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+#define ADTS0 0
+#define ADTS1 1
+#define ADTS2 2
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+
+// TWI (I2C) registers and bits
+#define TWBR SimRegister(SIM_REG_TWBR)
+#define TWSR SimRegister(SIM_REG_TWSR)
+#define TWDR SimRegister(SIM_REG_TWDR)
+#define TWCR SimRegister(SIM_REG_TWCR)
+#define TWPS0 0
+#define TWPS1 1
+#define TWIE 0
+#define TWEN 2
+#define TWWC 3
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA 6
+#define TWINT 7
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+void noInterrupts(void);
+void interrupts(void);
+void attachInterrupt(uint8_t number, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t number);
+
+char *dtostrf(double value, signed char width, unsigned char precision, char *buffer);
+
+/*
+ * Base class of the character outputs (like the Print class of the core).
+ */
+class Print {
+   public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    virtual int availableForWrite(void) {
+        return 0;
+    }
+    virtual void flush(void) {}
+
+    size_t print(const char *text);
+    size_t print(char c);
+    size_t print(unsigned char value, int base = DEC);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println(void);
+    template <class T>
+    size_t println(T value) {
+        return print(value) + println();
+    }
+    template <class T>
+    size_t println(T value, int format) {
+        return print(value, format) + println();
+    }
+
+   private:
+    size_t printNumber(unsigned long value, int base, bool negative);
+};
+
+/*
+ * Serial port. The transmission is emulated by the simulation (buffer and baud rate),
+ * the input is queued by the simulation.
+ */
+class HardwareSerial : public Print {
+   public:
+    void begin(unsigned long baud);
+    void end(void);
+    int available(void);
+    int read(void);
+    int availableForWrite(void);
+    void flush(void);
+    size_t write(uint8_t c);
+    using Print::write;
+
+    operator bool() {
+        return true;
+    }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,38 @@
+/*
+  EEPROM.cpp - Host stub of the Arduino EEPROM library for the simulator.
+
+  Licensed under "MIT" License.
+*/
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass() {
+    memset(memory, 0xFF, sizeof(memory));
+    writeCount = 0;
+}
+
+uint8_t EEPROMClass::read(int address) {
+    return address >= 0 && address <= E2END ? memory[address] : 0xFF;
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+    if (address >= 0 && address <= E2END) {
+        memory[address] = value;
+        writeCount++;
+    }
+}
+
+void EEPROMClass::update(int address, uint8_t value) {
+    if (read(address) != value) {
+        write(address, value);
+    }
+}
+
+uint16_t EEPROMClass::length(void) {
+    return E2END + 1;
+}
+
+unsigned long EEPROMClass::getWriteCount(void) {
+    return writeCount;
+}
@@ -0,0 +1,32 @@
+/*
+  EEPROM.h - Host stub of the Arduino EEPROM library for the simulator.
+  1 KB of EEPROM (ATmega328P) in memory, erased (0xFF) at the start of the simulation.
+  Counts the written bytes (an update with the same value doesn't write).
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include "Arduino.h"
+
+#define E2END 0x3FF
+
+class EEPROMClass {
+   public:
+    EEPROMClass();
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    void update(int address, uint8_t value);
+    uint16_t length(void);
+    unsigned long getWriteCount(void);
+
+   private:
+    uint8_t memory[E2END + 1];
+    unsigned long writeCount;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
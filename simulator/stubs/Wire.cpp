@@ -0,0 +1,151 @@
+/*
+  Wire.cpp - Host stub of the Arduino Wire library for the simulator.
+  Same interface as the AVR version (32 byte buffers), the transactions are
+  executed by the simulated I2C bus.
+
+  Licensed under "MIT" License.
+*/
+#include "Wire.h"
+
+#include "Simulation.h"
+
+TwoWire Wire;
+
+TwoWire::TwoWire() {
+    rxIndex = 0;
+    rxLength = 0;
+    txAddress = 0;
+    txLength = 0;
+    transmitting = false;
+    timeoutFlag = false;
+}
+
+/*
+ * Like on the AVR the clock is set to 100 kHz.
+ */
+void TwoWire::begin(void) {
+    rxIndex = 0;
+    rxLength = 0;
+    txLength = 0;
+    setClock(100000);
+}
+
+void TwoWire::end(void) {
+}
+
+/*
+ * Set the bit rate register of the TWI module like the AVR version (prescaler 1).
+ */
+void TwoWire::setClock(uint32_t clock) {
+    Simulation::writeRegister(SIM_REG_TWSR, 0);
+    Simulation::writeRegister(SIM_REG_TWBR, ((F_CPU / clock) - 16) / 2);
+}
+
+void TwoWire::setWireTimeout(uint32_t timeout, bool resetWithTimeout) {
+    Simulation::setI2CTimeout(timeout);
+}
+
+bool TwoWire::getWireTimeoutFlag(void) {
+    return timeoutFlag;
+}
+
+void TwoWire::clearWireTimeoutFlag(void) {
+    timeoutFlag = false;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    transmitting = true;
+    txAddress = address;
+    txLength = 0;
+}
+
+void TwoWire::beginTransmission(int address) {
+    beginTransmission((uint8_t)address);
+}
+
+uint8_t TwoWire::endTransmission(void) {
+    return endTransmission((uint8_t) true);
+}
+
+/*
+ * Send the buffered bytes. Like on the AVR an endTransmission() without beginTransmission()
+ * sends an address only transaction to the last address.
+ * @return 0: success, 2: NACK on the address, 5: timeout (held bus)
+ */
+uint8_t TwoWire::endTransmission(uint8_t sendStop) {
+    bool held = Simulation::isI2CHeld();
+    bool ack = Simulation::i2cWrite(txAddress, txBuffer, txLength);
+    txLength = 0;
+    transmitting = false;
+    if (held) {
+        timeoutFlag = true;
+        return 5;
+    }
+    return ack ? 0 : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+    return requestFrom(address, quantity, (uint8_t) true);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
+    if (quantity > BUFFER_LENGTH) {
+        quantity = BUFFER_LENGTH;
+    }
+    if (Simulation::isI2CHeld()) {
+        timeoutFlag = true;
+    }
+    rxLength = Simulation::i2cRead(address, rxBuffer, quantity);
+    rxIndex = 0;
+    return rxLength;
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity) {
+    return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t) true);
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop) {
+    return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop);
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (!transmitting || txLength >= BUFFER_LENGTH) {
+        return 0;
+    }
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity) {
+    for (size_t i = 0; i < quantity; i++) {
+        if (write(data[i]) == 0) {
+            return i;
+        }
+    }
+    return quantity;
+}
+
+/*
+ * Number of received bytes. Takes a bit of time, so a polling loop on a failed read does not stall the virtual time.
+ */
+int TwoWire::available(void) {
+    Simulation::advance(1);
+    return rxLength - rxIndex;
+}
+
+int TwoWire::read(void) {
+    if (rxIndex >= rxLength) {
+        return -1;
+    }
+    return rxBuffer[rxIndex++];
+}
+
+int TwoWire::peek(void) {
+    if (rxIndex >= rxLength) {
+        return -1;
+    }
+    return rxBuffer[rxIndex];
+}
+
+void TwoWire::flush(void) {
+}
@@ -0,0 +1,61 @@
+/*
+  Wire.h - Host stub of the Arduino Wire library for the simulator.
+  Same interface as the AVR version (32 byte buffers), the transactions are
+  executed by the simulated I2C bus.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef TWOWIRE_H
+#define TWOWIRE_H
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+#define WIRE_HAS_END 1
+#define WIRE_HAS_TIMEOUT 1
+
+class TwoWire {
+   public:
+    TwoWire();
+    void begin(void);
+    void end(void);
+    void setClock(uint32_t clock);
+    void setWireTimeout(uint32_t timeout = 25000, bool resetWithTimeout = false);
+    bool getWireTimeoutFlag(void);
+    void clearWireTimeoutFlag(void);
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address);
+    uint8_t endTransmission(void);
+    uint8_t endTransmission(uint8_t sendStop);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop);
+    uint8_t requestFrom(int address, int quantity);
+    uint8_t requestFrom(int address, int quantity, int sendStop);
+
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t quantity);
+    inline size_t write(unsigned long n) { return write((uint8_t)n); }
+    inline size_t write(long n) { return write((uint8_t)n); }
+    inline size_t write(unsigned int n) { return write((uint8_t)n); }
+    inline size_t write(int n) { return write((uint8_t)n); }
+    int available(void);
+    int read(void);
+    int peek(void);
+    void flush(void);
+
+   private:
+    uint8_t rxBuffer[BUFFER_LENGTH];
+    uint8_t rxIndex;
+    uint8_t rxLength;
+    uint8_t txAddress;
+    uint8_t txBuffer[BUFFER_LENGTH];
+    uint8_t txLength;
+    bool transmitting;
+    bool timeoutFlag;   // A call ended by the timeout (held bus)
+};
+
+extern TwoWire Wire;
+
+#endif
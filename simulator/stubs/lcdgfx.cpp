@@ -0,0 +1,145 @@
+/*
+  lcdgfx.cpp - Host stub of the lcdgfx display library for the simulator.
+  Only the SH1106 I2C display with a fixed font. The drawing operations send the
+  same amount of bytes to the simulated I2C bus as the real driver, the printed
+  text is kept in a character screen for the report.
+
+  Licensed under "MIT" License.
+*/
+#include "lcdgfx.h"
+
+#include "Simulation.h"
+#include "Wire.h"
+
+#define LCDGFX_CHUNK 31  // Data bytes per I2C transaction (Wire buffer minus control byte)
+
+const uint8_t ssd1306xled_font6x8[] = {0x00, 0x06, 0x08, 0x20};
+
+static char screen[LCDGFX_LINES][LCDGFX_COLUMNS + 1];
+
+/*
+ * Clear a part of the character screen.
+ */
+static void clearScreen(uint8_t firstLine, uint8_t lastLine) {
+    for (uint8_t line = firstLine; line <= lastLine && line < LCDGFX_LINES; line++) {
+        memset(screen[line], ' ', LCDGFX_COLUMNS);
+        screen[line][LCDGFX_COLUMNS] = '\0';
+    }
+}
+
+void lcd_delay(unsigned long ms) {
+    delay(ms);
+}
+
+DisplaySH1106_128x64_I2C::DisplaySH1106_128x64_I2C(int8_t rstPin, const SPlatformI2cConfig &config) {
+    address = config.addr;
+    frequency = config.frequency;
+    color = 0xFFFF;
+    clearScreen(0, LCDGFX_LINES - 1);
+}
+
+/*
+ * Start of the bus (with the clock of the configuration, if set) and the initialization
+ * sequence of the controller (25 command bytes).
+ */
+void DisplaySH1106_128x64_I2C::begin(void) {
+    Wire.begin();
+    if (frequency != 0) {
+        Wire.setClock(frequency);
+    }
+    uint8_t commands[26] = {0x00};
+    Simulation::i2cWrite(address, commands, sizeof(commands));
+}
+
+void DisplaySH1106_128x64_I2C::end(void) {
+}
+
+void DisplaySH1106_128x64_I2C::setFixedFont(const uint8_t *font) {
+}
+
+void DisplaySH1106_128x64_I2C::clear(void) {
+    fill(0x00);
+}
+
+/*
+ * Fill all pages (132 columns of the SH1106 RAM).
+ */
+void DisplaySH1106_128x64_I2C::fill(uint8_t pattern) {
+    for (uint8_t page = 0; page < LCDGFX_LINES; page++) {
+        sendCommands(page, 0);
+        sendData(132);
+    }
+    clearScreen(0, LCDGFX_LINES - 1);
+}
+
+void DisplaySH1106_128x64_I2C::setColor(uint16_t newColor) {
+    color = newColor;
+}
+
+/*
+ * Print a text with the 6x8 font. Only page aligned positions are used by the sketch.
+ */
+void DisplaySH1106_128x64_I2C::printFixed(int x, int y, const char *text) {
+    int length = strlen(text);
+    int width = min(length * 6, 128 - x);
+    if (width <= 0 || y < 0 || y >= 64) {
+        return;
+    }
+    sendCommands(y / 8, x);
+    sendData(width);
+
+    char *line = screen[y / 8];
+    for (int i = 0; i < length && x / 6 + i < LCDGFX_COLUMNS; i++) {
+        line[x / 6 + i] = text[i];
+    }
+}
+
+/*
+ * Fill a rectangle with the current color. A black rectangle clears the covered text lines.
+ */
+void DisplaySH1106_128x64_I2C::fillRect(int x1, int y1, int x2, int y2) {
+    for (int page = y1 / 8; page <= y2 / 8 && page < LCDGFX_LINES; page++) {
+        sendCommands(page, x1);
+        sendData(x2 - x1 + 1);
+    }
+    if (color == 0) {
+        clearScreen(y1 / 8, y2 / 8);
+    }
+}
+
+/*
+ * Draw a horizontal line (read-modify-write free, one page).
+ */
+void DisplaySH1106_128x64_I2C::drawHLine(int x1, int y1, int x2) {
+    sendCommands(y1 / 8, x1);
+    sendData(x2 - x1 + 1);
+}
+
+/*
+ * Get a line of the character screen.
+ */
+const char *DisplaySH1106_128x64_I2C::getLine(uint8_t line) {
+    return screen[line % LCDGFX_LINES];
+}
+
+// PRIVATE
+
+/*
+ * Set page and column address (control byte and 3 commands).
+ */
+void DisplaySH1106_128x64_I2C::sendCommands(uint8_t page, uint8_t column) {
+    uint8_t commands[4] = {0x00, (uint8_t)(0xB0 | page), (uint8_t)((column + 2) & 0x0F), (uint8_t)(0x10 | ((column + 2) >> 4))};
+    Simulation::i2cWrite(address, commands, sizeof(commands));
+}
+
+/*
+ * Send display data in chunks of the Wire buffer size.
+ */
+void DisplaySH1106_128x64_I2C::sendData(int count) {
+    uint8_t data[LCDGFX_CHUNK + 1] = {0x40};
+    while (count > 0) {
+        uint8_t length = min(count, LCDGFX_CHUNK);
+        Simulation::i2cWrite(address, data, length + 1);
+        count -= length;
+    }
+}
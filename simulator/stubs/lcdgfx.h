@@ -0,0 +1,53 @@
+/*
+  lcdgfx.h - Host stub of the lcdgfx display library for the simulator.
+  Only the SH1106 I2C display with a fixed font. The drawing operations send the
+  same amount of bytes to the simulated I2C bus as the real driver, the printed
+  text is kept in a character screen for the report.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef LCDGFX_H
+#define LCDGFX_H
+
+#include "Arduino.h"
+
+#define LCDGFX_COLUMNS 21  // Characters per line (6x8 font)
+#define LCDGFX_LINES 8     // Lines (pages)
+
+typedef struct {
+    int8_t busId;
+    uint8_t addr;
+    int8_t scl;
+    int8_t sda;
+    uint32_t frequency;
+} SPlatformI2cConfig;
+
+extern const uint8_t ssd1306xled_font6x8[];
+
+void lcd_delay(unsigned long ms);
+
+class DisplaySH1106_128x64_I2C {
+   public:
+    explicit DisplaySH1106_128x64_I2C(int8_t rstPin, const SPlatformI2cConfig &config = {-1, 0x3C, -1, -1, 0});
+    void begin(void);
+    void end(void);
+    void setFixedFont(const uint8_t *font);
+    void clear(void);
+    void fill(uint8_t pattern);
+    void setColor(uint16_t color);
+    void printFixed(int x, int y, const char *text);
+    void fillRect(int x1, int y1, int x2, int y2);
+    void drawHLine(int x1, int y1, int x2);
+
+    static const char *getLine(uint8_t line);
+
+   private:
+    uint8_t address;
+    uint32_t frequency;
+    uint16_t color;
+    void sendCommands(uint8_t page, uint8_t column);
+    void sendData(int count);
+};
+
+#endif
@@ -0,0 +1,22 @@
+/*
+  crc16.h - Host stub of avr-libc's util/crc16.h for the simulator.
+  Same results as the inline assembler of avr-libc.
+
+  Licensed under "MIT" License.
+*/
+
+#ifndef _UTIL_CRC16_H_
+#define _UTIL_CRC16_H_
+
+#include <stdint.h>
+
+/*
+ * CRC-CCITT (polynomial 0x1021, reflected 0x8408) of one more byte.
+ */
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data) {
+    data ^= crc & 0xFF;
+    data ^= data << 4;
+    return (((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3);
+}
+
+#endif
@@ -0,0 +1,150 @@
+/*
+  tilt.cpp - Accuracy and speed of the fixed-point tilt of the MPU6050 driver on the host.
+  Compares MPU6050::getTilt() with the tilt by libm (double) for raw acceleration vectors over
+  the full range of the accelerometer (+-2 g), and times it against the float math, which it
+  replaced (asin of the normalized vector, as in the driver up to now).
+
+  Usage: camper_tilt [-s step]
+    -s  Step of the raw values of the sweep in LSB (default 257)
+
+  Licensed under "MIT" License.
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "MPU6050_minimal.h"
+
+#define TILT_MAX_ERROR 10        // Maximum error in 0.01 deg
+#define TILT_MIN_MAGNITUDE 0.25  // Vectors with less acceleration in g (free fall) have no useful tilt
+#define TILT_BENCHMARK_RUNS 2000000
+
+static MPU6050 mpu;  // offsets of MPU6050_minimal.h (no calibration)
+
+/*
+ * Tilt by the float math of the driver up to now (reference of the benchmark).
+ */
+static void floatTilt(int16_t AcX, int16_t AcY, int16_t AcZ, float &phiX, float &phiY) {
+    float x = (int16_t)(AcX + MPU6050_OFFSET_AcX) / (float)MPU6050_Ac_convert;
+    float y = (int16_t)(AcY + MPU6050_OFFSET_AcY) / (float)MPU6050_Ac_convert;
+    float z = (int16_t)(AcZ + MPU6050_OFFSET_AcZ) / (float)MPU6050_Ac_convert;
+    float length = sqrtf(x * x + y * y + z * z);
+    phiY = asinf(x / length) * (float)RAD_TO_DEG - (float)MPU6050_OFFSET_phiY;
+    phiX = asinf(y / length) * (float)RAD_TO_DEG - (float)MPU6050_OFFSET_phiX;
+}
+
+/*
+ * Tilt by libm in double precision (reference of the accuracy) in 0.01 deg.
+ */
+static void exactTilt(int16_t AcX, int16_t AcY, int16_t AcZ, double &tiltX, double &tiltY) {
+    double x = (double)AcX + MPU6050_OFFSET_AcX;
+    double y = (double)AcY + MPU6050_OFFSET_AcY;
+    double z = (double)AcZ + MPU6050_OFFSET_AcZ;
+    tiltY = atan2(x, hypot(y, z)) * RAD_TO_DEG * 100 - MPU6050_OFFSET_TILT_Y;
+    tiltX = atan2(y, hypot(x, z)) * RAD_TO_DEG * 100 - MPU6050_OFFSET_TILT_X;
+}
+
+/*
+ * Next raw value of the sweep, which ends with the limit of the range (32767).
+ */
+static long nextValue(long value, int step) {
+    if (value == 32767) {
+        return 32768;  // end of the sweep
+    }
+    return value + step > 32767 ? 32767 : value + step;
+}
+
+/*
+ * Nanoseconds per call of a tilt function (average of TILT_BENCHMARK_RUNS calls on a set of vectors).
+ */
+template <typename Function>
+static double benchmark(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < TILT_BENCHMARK_RUNS; i++) {
+        int16_t AcX = (i * 7919) % 16384 - 8192;
+        int16_t AcY = (i * 104729) % 16384 - 8192;
+        function(AcX, AcY, (int16_t)(16384 - MPU6050_OFFSET_AcZ));
+    }
+    std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+    return time.count() / TILT_BENCHMARK_RUNS;
+}
+
+int main(int argc, char **argv) {
+    int step = 257;
+    int option;
+    while ((option = getopt(argc, argv, "s:")) != -1) {
+        if (option == 's') {
+            step = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-s step]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (step < 1) {
+        step = 1;
+    }
+
+    // Sweep of the raw values (all combinations of x, y, z in steps and the limits of the range)
+    long vectors = 0;
+    double maxError = 0, sumError = 0, maxFloatError = 0;
+    int16_t worst[3] = {0, 0, 0};
+    const double minLength = TILT_MIN_MAGNITUDE * MPU6050_Ac_convert;
+    for (long x = -32768; x <= 32767; x = nextValue(x, step)) {
+        for (long y = -32768; y <= 32767; y = nextValue(y, step)) {
+            for (long z = -32768; z <= 32767; z = nextValue(z, step)) {
+                double length = sqrt(sq((double)x + MPU6050_OFFSET_AcX) + sq((double)y + MPU6050_OFFSET_AcY) +
+                                     sq((double)z + MPU6050_OFFSET_AcZ));
+                if (length < minLength) {
+                    continue;
+                }
+                int16_t tiltX, tiltY;
+                double exactX, exactY;
+                mpu.getTilt(x, y, z, tiltX, tiltY);
+                exactTilt(x, y, z, exactX, exactY);
+                double error = fmax(fabs(tiltX - exactX), fabs(tiltY - exactY));
+                if (error > maxError) {
+                    maxError = error;
+                    worst[0] = x;
+                    worst[1] = y;
+                    worst[2] = z;
+                }
+                sumError += error;
+                vectors++;
+
+                // The old float path wraps the int16 sum of the raw value and the offset, so only inside the range
+                if (z + MPU6050_OFFSET_AcZ <= 32767) {
+                    float phiX, phiY;
+                    floatTilt(x, y, z, phiX, phiY);
+                    maxFloatError = fmax(maxFloatError, fmax(fabs(phiX * 100 - exactX), fabs(phiY * 100 - exactY)));
+                }
+            }
+        }
+    }
+
+    volatile int16_t sinkFixed;
+    volatile float sinkFloat;
+    double fixedTime = benchmark([&](int16_t AcX, int16_t AcY, int16_t AcZ) {
+        int16_t tiltX, tiltY;
+        mpu.getTilt(AcX, AcY, AcZ, tiltX, tiltY);
+        sinkFixed = tiltX + tiltY;
+    });
+    double floatTime = benchmark([&](int16_t AcX, int16_t AcY, int16_t AcZ) {
+        float phiX, phiY;
+        floatTilt(AcX, AcY, AcZ, phiX, phiY);
+        sinkFloat = phiX + phiY;
+    });
+
+    printf("Vectors:             %ld (step %d LSB, |a| >= %.2f g)\n", vectors, step, TILT_MIN_MAGNITUDE);
+    printf("Fixed-point error:   max %.2f, mean %.3f (0.01 deg), worst at %d, %d, %d\n", maxError,
+           vectors > 0 ? sumError / vectors : 0.0, worst[0], worst[1], worst[2]);
+    printf("Float error:         max %.2f (0.01 deg)\n", maxFloatError);
+    printf("Host time per tilt:  fixed %.1f ns, float %.1f ns\n", fixedTime, floatTime);
+    if (vectors == 0 || maxError >= TILT_MAX_ERROR) {
+        printf("Tilt error exceeds %.2f deg\n", TILT_MAX_ERROR / 100.0);
+        return 1;
+    }
+    printf("Tilt error below %.2f deg\n", TILT_MAX_ERROR / 100.0);
+    return 0;
+}